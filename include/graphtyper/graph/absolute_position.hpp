@@ -33,6 +33,6 @@ public:
 
 };
 
-extern AbsolutePosition absolute_pos;
+extern AbsolutePosition & absolute_pos; // The offsets of the default genotyping context
 
 } // namespace gyper
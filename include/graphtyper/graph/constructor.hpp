@@ -9,6 +9,18 @@
 namespace gyper
 {
 
+class GenotypingContext;
+
+/** \brief Constructs the graph of 'context' and calculates its absolute position offsets. */
+void construct_graph(GenotypingContext & context,
+                     std::string const & reference_filename,
+                     std::string const & vcf_filename,
+                     std::string const & region,
+                     bool is_sv_graph = false,
+                     bool use_absolute_positions = true,
+                     bool check_index = true);
+
+/** \brief Constructs the graph of the current context. */
 void construct_graph(std::string const & reference_filename,
                      std::string const & vcf_filename,
                      std::string const & region,
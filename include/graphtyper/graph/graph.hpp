@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory> // std::shared_ptr
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -11,9 +12,11 @@
 #include <graphtyper/graph/genomic_region.hpp>
 #include <graphtyper/graph/haplotype.hpp>
 #include <graphtyper/graph/location.hpp>
+#include <graphtyper/graph/position_index.hpp>
 #include <graphtyper/graph/sv.hpp>
 #include <graphtyper/index/kmer_label.hpp>
 #include <graphtyper/typer/path.hpp>
+#include <graphtyper/utilities/flat_array.hpp>
 
 
 namespace gyper
@@ -24,6 +27,8 @@ class Variant;
 class VarRecord;
 
 using TSVKey = std::tuple<uint32_t, std::vector<char>, std::vector<std::vector<char> > >; // pos, ref, alts
+using TRefNodes = RefNodes; // Struct of arrays with huge pages, probed at random while aligning
+using TVarNodes = VarNodes;
 
 struct Contig
 {
@@ -50,12 +55,14 @@ public:
   bool use_absolute_positions{true};
   bool is_sv_graph{false};
   GenomicRegion genomic_region;
-  std::vector<char> reference;
+  FlatArray<char> reference;
   uint32_t reference_offset{0};
-  std::vector<RefNode> ref_nodes;
-  std::vector<VarNode> var_nodes;
+  TRefNodes ref_nodes;
+  TVarNodes var_nodes;
+  PositionIndex position_index; // Of the reference nodes, built when they are added
   std::vector<SV> SVs;
   std::vector<Contig> contigs;
+  std::shared_ptr<void const> mapping; // Keeps a mapped graph file alive, if the arrays above are views of it
 
   /****************
    * CONSTRUCTORS *
@@ -154,7 +161,7 @@ public:
   uint32_t get_ref_reach_pos(uint32_t pos) const;
   uint32_t get_actual_pos(uint32_t pos) const;
 
-  std::unordered_map<uint32_t, std::vector<uint32_t> > ref_reach_to_special_pos;
+  SpecialPositions ref_reach_to_special_pos;
   std::vector<uint32_t> ref_reach_poses;
   std::vector<uint32_t> actual_poses;
 
@@ -193,6 +200,6 @@ private:
                               ) const;
 };
 
-extern Graph graph;
+extern Graph & graph; // The graph of the default genotyping context
 
 } // namespace gyper
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
 #include <string>
 
 #include <graphtyper/graph/graph.hpp>
@@ -7,8 +9,21 @@
 namespace gyper
 {
 
+/**
+ * Graphs are saved as flat graph files, which have the reference genome and contig offsets precomputed. Loading maps
+ * a flat graph file and its node arrays are used in place. Graphs saved with boost::serialization are still loaded.
+ */
+
+// The graph of the current genotyping context is saved or loaded
 void save_graph(std::string const & graph_path);
 void load_graph(std::string const & graph_path);
+
+// Loads a saved graph from memory. Its arrays are views of 'data' if 'mapping' keeps it alive, otherwise copies.
+void load_graph(char const * data, std::size_t const size, std::shared_ptr<void const> const & mapping = nullptr);
+
 Graph load_secondary_graph(std::string const & graph_path);
 
+// Converts a graph of either format to a flat graph file
+void convert_graph(std::string const & old_graph_path, std::string const & graph_path);
+
 } // namespace gyper
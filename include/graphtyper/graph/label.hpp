@@ -1,46 +1,71 @@
 #pragma once
 
-#include <string>
+#include <cstdint> // uint16_t, uint32_t
 #include <vector>
 
 #include <boost/serialization/access.hpp>
 
 #include <graphtyper/constants.hpp>
+#include <graphtyper/graph/sequence_arena.hpp>
+#include <graphtyper/utilities/flat_array.hpp>
 
 
 namespace gyper
 {
 
-class RefNode;
-class VarNode;
+/** \brief The position, sequence and allele number of a graph node. Its sequence is a view into the graph's arena. */
+class Label
+{
+public:
+  uint32_t order{INVALID_ID};
+  DnaView dna;
+  uint16_t variant_num{INVALID_NUM};
 
+  Label() noexcept = default;
+  Label(uint32_t const _order, DnaView const & _dna, uint16_t const _variant_num) noexcept
+    : order(_order), dna(_dna), variant_num(_variant_num)
+  {}
+
+  /**
+   * CLASS INFORMATION
+   */
+  uint32_t reach() const {return order + dna.size() - 1;}
+};
 
 
-class Label
+/**
+ * @brief The orders and sequences of the labels of a node array, each as one contiguous array.
+ * @details Graph walks read the order and sequence length of many nodes, and few of their bases, so these are kept
+ *          apart from each other instead of in a struct for each node.
+ */
+class LabelArrays
 {
   friend class boost::serialization::access;
-  friend class gyper::RefNode;
-  friend class gyper::VarNode;
 
 public:
-  uint32_t order;
-  std::vector<char> dna;
-  uint16_t variant_num;
+  Label
+  get(std::size_t const i, uint16_t const variant_num) const
+  {
+    return Label(orders[i], sequences.view(positions[i], lengths[i]), variant_num);
+  }
 
-  Label(Label const & l) noexcept;
-  Label(Label && l) noexcept;
-  Label(uint32_t const & order, std::vector<char> && dna, uint16_t const & variant_num) noexcept;
+  uint32_t get_order(std::size_t const i) const {return orders[i];}
+  uint32_t get_length(std::size_t const i) const {return lengths[i];}
 
-  /**
-   * CLASS INFORMATION
-   */
-  uint32_t reach() const;
+  void push_back(uint32_t const order, std::vector<char> const & dna);
+  void change_order(std::size_t const i, uint32_t const change);
+  std::size_t size() const {return orders.size();}
+  void clear();
+  std::size_t size_in_bytes() const;
 
 private:
-  Label() noexcept;
+  FlatArray<uint32_t> orders;
+  FlatArray<uint32_t> lengths;
+  FlatArray<uint64_t> positions; // Of the sequences in 'sequences'
+  SequenceArena sequences;
 
   template <typename Archive>
-  void serialize(Archive & ar, const unsigned int);
+  void serialize(Archive & ar, unsigned int);
 };
 
 } // namespace gyper
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint> // uint16_t, uint32_t
+#include <unordered_map>
+#include <vector>
+
+#include <boost/serialization/access.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/unordered_map.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <graphtyper/constants.hpp>
+#include <graphtyper/graph/graph.hpp>
+
+
+namespace gyper
+{
+
+/**
+ * @brief The layout of graphs which were saved with boost::serialization, before graphs were saved as flat graph files.
+ * @details Nodes were objects with a label each and reference nodes had a vector of their variant nodes. The members
+ *          are serialized in the same order as they were, so boost reads the same bytes. Other members of the graph are
+ *          read into 'graph' directly.
+ */
+struct LegacyLabel
+{
+  uint32_t order{0};
+  std::vector<char> dna;
+  uint16_t variant_num{0};
+
+  template <typename Archive>
+  void
+  serialize(Archive & ar, unsigned int)
+  {
+    ar & order;
+    ar & dna;
+    ar & variant_num;
+  }
+};
+
+
+struct LegacyRefNode
+{
+  LegacyLabel label;
+  std::vector<TNodeIndex> out_var_ids;
+
+  template <typename Archive>
+  void
+  serialize(Archive & ar, unsigned int)
+  {
+    ar & label;
+    ar & out_var_ids;
+  }
+};
+
+
+struct LegacyVarNode
+{
+  LegacyLabel label;
+  TNodeIndex out_ref_id{0};
+
+  template <typename Archive>
+  void
+  serialize(Archive & ar, unsigned int)
+  {
+    ar & label;
+    ar & out_ref_id;
+  }
+};
+
+
+struct LegacyGraph
+{
+  Graph & graph;
+  std::vector<LegacyRefNode> ref_nodes;
+  std::vector<LegacyVarNode> var_nodes;
+  std::unordered_map<uint32_t, std::vector<uint32_t> > ref_reach_to_special_pos;
+
+  explicit LegacyGraph(Graph & _graph) : graph(_graph) {}
+
+  template <typename Archive>
+  void
+  serialize(Archive & ar, unsigned int)
+  {
+    ar & ref_nodes;
+    ar & var_nodes;
+    ar & graph.use_prefix_chr;
+    ar & graph.use_absolute_positions;
+    ar & graph.is_sv_graph;
+    ar & graph.genomic_region;
+    ar & graph.ref_reach_poses;
+    ar & graph.actual_poses;
+    ar & ref_reach_to_special_pos;
+    ar & graph.SVs;
+    ar & graph.contigs;
+  }
+};
+
+} // namespace gyper
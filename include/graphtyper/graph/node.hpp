@@ -1,59 +1,147 @@
 #pragma once
-#include <iostream>
+#include <cstddef> // std::size_t
+#include <iterator> // std::forward_iterator_tag
 #include <vector>
 
 #include <boost/serialization/access.hpp>
 
 #include <graphtyper/graph/label.hpp>
+#include <graphtyper/utilities/flat_array.hpp>
 
 
 namespace gyper
 {
 
+/** \brief A reference node as read from RefNodes. Its variant nodes are consecutive and follow the node. */
 class RefNode
 {
-  friend class boost::serialization::access;
-
 public:
   Label label;
-  std::vector<TNodeIndex> out_var_ids;
-
-  RefNode();
-  RefNode(Label && l, std::vector<TNodeIndex> && c) noexcept;
-  RefNode(RefNode const & rn) noexcept;
+  TNodeIndex first_var_id{0};
+  uint32_t num_vars{0};
 
-  void change_label_order(uint32_t change);
+  RefNode() = default;
+  RefNode(Label const & l, TNodeIndex const first_var, uint32_t const _num_vars) noexcept
+    : label(l), first_var_id(first_var), num_vars(_num_vars)
+  {}
 
-  std::size_t out_degree() const;
-  Label const & get_label() const;
+  std::size_t out_degree() const {return num_vars;}
+  Label get_label() const {return label;}
   TNodeIndex get_var_index(unsigned const & index) const;
   std::vector<TNodeIndex> get_vars() const;
+};
+
+
+/** \brief A variant node as read from VarNodes. */
+class VarNode
+{
+public:
+  Label label;
+  TNodeIndex out_ref_id{0};
+
+  VarNode() = default;
+  VarNode(Label const & l, TNodeIndex const ori) noexcept
+    : label(l), out_ref_id(ori)
+  {}
+
+  std::size_t out_degree() const {return 1;}
+  Label get_label() const {return label;}
+  TNodeIndex get_out_ref_index() const {return out_ref_id;}
+};
+
+
+/** \brief Iterates the nodes of RefNodes or VarNodes, which are read by value. */
+template <typename TNodes, typename TNode>
+class NodeIterator
+{
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = TNode;
+  using difference_type = std::ptrdiff_t;
+  using pointer = TNode const *;
+  using reference = TNode;
+
+  NodeIterator(TNodes const & _nodes, std::size_t const _i) : nodes(&_nodes), i(_i) {}
+
+  TNode operator*() const {return (*nodes)[i];}
+  NodeIterator & operator++() {++i; return *this;}
+  NodeIterator operator++(int) {NodeIterator it(*this); ++i; return it;}
+  bool operator==(NodeIterator const & it) const {return i == it.i;}
+  bool operator!=(NodeIterator const & it) const {return i != it.i;}
 
 private:
-  template <class Archive>
-  void serialize(Archive & ar, const unsigned int);
+  TNodes const * nodes;
+  std::size_t i;
 };
 
 
-class VarNode
+/**
+ * @brief The reference nodes of a graph as one array for each of their fields (struct of arrays).
+ * @details Nodes are read by value as RefNode. Their sequences are 2-bit packed back to back, so walking the graph
+ *          reads a few contiguous arrays instead of a heap block for each node.
+ */
+class RefNodes
 {
   friend class boost::serialization::access;
 
 public:
-  Label label;
-  TNodeIndex out_ref_id;
+  using value_type = RefNode;
+  using const_iterator = NodeIterator<RefNodes, RefNode>;
+
+  RefNode operator[](std::size_t const r) const {return RefNode(labels.get(r, 0), first_var_ids[r], out_degrees[r]);}
+  RefNode at(std::size_t const r) const; // Throws std::out_of_range
+  uint32_t get_order(std::size_t const r) const {return labels.get_order(r);}
+  RefNode front() const;
+  RefNode back() const;
+  const_iterator begin() const {return const_iterator(*this, 0);}
+  const_iterator end() const {return const_iterator(*this, size());}
+  std::size_t size() const {return first_var_ids.size();}
+  bool empty() const {return size() == 0;}
+
+  /** \brief Adds a node followed by 'num_vars' variant nodes, the first of which is 'first_var'. */
+  void push_back(uint32_t const order, std::vector<char> const & dna, TNodeIndex const first_var, uint32_t num_vars);
+  void change_label_order(std::size_t const r, uint32_t const change);
+  void clear();
+  std::size_t size_in_bytes() const;
+
+private:
+  LabelArrays labels;
+  FlatArray<uint32_t> first_var_ids; // Node indices fit in 32 bits, like the variant ids of k-mer labels
+  FlatArray<uint32_t> out_degrees;
+
+  template <class Archive>
+  void serialize(Archive & ar, const unsigned int);
+};
 
-  VarNode();
-  VarNode(Label && l, TNodeIndex && ori) noexcept;
-  VarNode(VarNode const & vn) noexcept;
 
-  void change_label_order(uint32_t change);
+/** \brief The variant nodes of a graph as one array for each of their fields (struct of arrays). */
+class VarNodes
+{
+  friend class boost::serialization::access;
 
-  std::size_t out_degree() const;
-  Label const & get_label() const;
-  TNodeIndex get_out_ref_index() const;
+public:
+  using value_type = VarNode;
+  using const_iterator = NodeIterator<VarNodes, VarNode>;
+
+  VarNode operator[](std::size_t const v) const {return VarNode(labels.get(v, variant_nums[v]), out_ref_ids[v]);}
+  VarNode at(std::size_t const v) const; // Throws std::out_of_range
+  VarNode front() const;
+  VarNode back() const;
+  const_iterator begin() const {return const_iterator(*this, 0);}
+  const_iterator end() const {return const_iterator(*this, size());}
+  std::size_t size() const {return out_ref_ids.size();}
+  bool empty() const {return size() == 0;}
+
+  void push_back(uint32_t const order, std::vector<char> const & dna, uint16_t const variant_num, TNodeIndex out_ref);
+  void change_label_order(std::size_t const v, uint32_t const change);
+  void clear();
+  std::size_t size_in_bytes() const;
 
 private:
+  LabelArrays labels;
+  FlatArray<uint16_t> variant_nums;
+  FlatArray<uint32_t> out_ref_ids;
+
   template <class Archive>
   void serialize(Archive & ar, const unsigned int);
 };
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm> // std::min
+#include <cstddef> // std::size_t
+#include <cstdint> // uint32_t
+
+#include <boost/serialization/access.hpp>
+
+#include <graphtyper/utilities/flat_array.hpp>
+#include <graphtyper/utilities/prefetch.hpp>
+
+
+namespace gyper
+{
+
+class RefNodes;
+
+
+/**
+ * @brief Finds the reference node of a position in O(log n) with a binary search that does not branch on the orders.
+ * @details The orders of the reference nodes are stored in Eytzinger layout, i.e. as an implicit binary search tree in
+ *          breadth-first order starting at index 1, so the first levels of the search share cache lines and the
+ *          children of a node four levels down are in one cache line which is prefetched. The index must be built
+ *          again when the reference nodes change.
+ */
+class PositionIndex
+{
+  friend class boost::serialization::access;
+
+public:
+  void build(RefNodes const & ref_nodes);
+  void clear();
+
+  std::size_t size() const {return orders.empty() ? 0 : orders.size() - 1;} // Number of reference nodes
+  std::size_t size_in_bytes() const {return orders.size_in_bytes() + ref_ids.size_in_bytes();}
+
+  /** \brief Index of the first reference node with an order larger than 'pos', or size() if there is none. */
+  std::size_t
+  upper_bound(uint32_t const pos) const
+  {
+    std::size_t const n = size();
+    uint32_t const * const tree = orders.data();
+    std::size_t k = 1;
+
+    while (k <= n)
+    {
+      prefetch(tree + std::min(k * 16, n)); // The 16 descendants of 'k' four levels down
+      k = 2 * k + (tree[k] <= pos);
+    }
+
+    // Go up past the right turns at the bottom of the search, 'k' is then the last left turn or 0 if there was none
+#ifdef __GNUC__
+    k >>= __builtin_ffsll(static_cast<long long>(~k));
+#else
+    while (k & 1)
+      k >>= 1;
+
+    k >>= 1;
+#endif
+
+    return k == 0 ? n : ref_ids[k];
+  }
+
+private:
+  FlatArray<uint32_t> orders; // Eytzinger layout, the first element is unused
+  FlatArray<uint32_t> ref_ids; // Reference node of each element of 'orders'
+
+  template <typename Archive>
+  void serialize(Archive & ar, unsigned int);
+};
+
+
+/**
+ * @brief The special positions of each reference reach, as a sorted array of reference reaches and the special
+ *        positions of all of them back to back.
+ * @details The special positions of the i-th reference reach are between ends[i - 1] and ends[i]. Special positions are
+ *          created in order of reference reach so adding them is an append.
+ */
+class SpecialPositions
+{
+  friend class boost::serialization::access;
+
+public:
+  using const_iterator = FlatArray<uint32_t>::const_iterator;
+
+  void add(uint32_t const ref_reach, uint32_t const special_pos);
+  void clear();
+
+  std::size_t count(uint32_t const ref_reach) const {return find(ref_reach) < ref_reaches.size() ? 1 : 0;}
+  uint32_t at(uint32_t const ref_reach, std::size_t const i) const; // Throws std::out_of_range
+
+  // Iterates over the reference reaches which have special positions
+  const_iterator begin() const {return ref_reaches.begin();}
+  const_iterator end() const {return ref_reaches.end();}
+  std::size_t size() const {return ref_reaches.size();}
+  bool empty() const {return ref_reaches.empty();}
+  std::size_t size_in_bytes() const;
+
+private:
+  FlatArray<uint32_t> ref_reaches; // Sorted
+  FlatArray<uint32_t> ends; // End of the special positions of each reference reach in 'special_poses'
+  FlatArray<uint32_t> special_poses;
+
+  std::size_t find(uint32_t const ref_reach) const; // Index of 'ref_reach' in 'ref_reaches', or size() if missing
+  std::size_t get_begin(std::size_t const i) const {return i == 0 ? 0 : ends[i - 1];}
+
+  template <typename Archive>
+  void serialize(Archive & ar, unsigned int);
+};
+
+} // namespace gyper
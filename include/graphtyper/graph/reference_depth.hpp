@@ -41,7 +41,7 @@ public:
   /****************
    * MODIFICATION *
    ****************/
-  void set_depth_sizes(long sample_count, long reference_size = graph.reference.size());
+  void set_depth_sizes(long sample_count, long reference_size);
   void add_depth(long start_pos, long end_pos, long sample_index);
   void add_genotype_paths(GenotypePaths const & geno, long sample_index);
 };
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef> // std::size_t, std::ptrdiff_t
+#include <cstdint> // uint32_t, uint64_t
+#include <iterator> // std::random_access_iterator_tag
+#include <vector> // std::vector
+
+#include <boost/serialization/access.hpp>
+
+#include <graphtyper/utilities/flat_array.hpp>
+
+
+namespace gyper
+{
+
+/**
+ * @brief A read-only view of a sequence in a SequenceArena, bases are returned by value.
+ * @details The view is invalidated when more sequences are added to its arena, like an iterator of a std::vector.
+ */
+class DnaView
+{
+public:
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+    using pointer = char const *;
+    using reference = char;
+
+    const_iterator() noexcept = default;
+    const_iterator(uint64_t const * _words, char const * _chars, uint64_t _i) noexcept
+      : words(_words), chars(_chars), i(_i)
+    {}
+
+    char operator*() const {return chars ? chars[i] : decode(words, i);}
+    char operator[](difference_type const n) const {return *(*this + n);}
+
+    const_iterator & operator++() {++i; return *this;}
+    const_iterator & operator--() {--i; return *this;}
+    const_iterator operator++(int) {const_iterator it(*this); ++i; return it;}
+    const_iterator operator--(int) {const_iterator it(*this); --i; return it;}
+    const_iterator & operator+=(difference_type const n) {i += n; return *this;}
+    const_iterator & operator-=(difference_type const n) {i -= n; return *this;}
+    const_iterator operator+(difference_type const n) const {return const_iterator(words, chars, i + n);}
+    const_iterator operator-(difference_type const n) const {return const_iterator(words, chars, i - n);}
+    difference_type operator-(const_iterator const & it) const {return static_cast<difference_type>(i - it.i);}
+
+    bool operator==(const_iterator const & it) const {return i == it.i;}
+    bool operator!=(const_iterator const & it) const {return i != it.i;}
+    bool operator<(const_iterator const & it) const {return i < it.i;}
+    bool operator>(const_iterator const & it) const {return i > it.i;}
+    bool operator<=(const_iterator const & it) const {return i <= it.i;}
+    bool operator>=(const_iterator const & it) const {return i >= it.i;}
+
+  private:
+    uint64_t const * words{nullptr};
+    char const * chars{nullptr};
+    uint64_t i{0}; // Base index in 'words', or char index in 'chars'
+  };
+
+  using iterator = const_iterator;
+  using value_type = char;
+  using size_type = std::size_t;
+
+  DnaView() noexcept = default;
+  DnaView(uint64_t const * _words, char const * _chars, uint64_t _start, uint32_t _length) noexcept
+    : words(_words), chars(_chars), start(_start), length(_length)
+  {}
+
+  std::size_t size() const {return length;}
+  bool empty() const {return length == 0;}
+  char operator[](std::size_t const i) const {return chars ? chars[i] : decode(words, start + i);}
+  char front() const {return (*this)[0];}
+  char back() const {return (*this)[length - 1];}
+
+  const_iterator begin() const {return const_iterator(words, chars, chars ? 0 : start);}
+  const_iterator end() const {return begin() + length;}
+  const_iterator cbegin() const {return begin();}
+  const_iterator cend() const {return end();}
+
+  /** \brief The 'count' bases from 'pos', without copying them. */
+  DnaView
+  substr(std::size_t const pos, uint32_t const count) const
+  {
+    return chars ? DnaView(nullptr, chars + pos, 0, count) : DnaView(words, nullptr, start + pos, count);
+  }
+
+  std::vector<char> to_vector() const {return std::vector<char>(begin(), end());}
+  operator std::vector<char>() const {return to_vector();} // Code which needs a std::vector<char> keeps working
+
+  /** \brief The base at 'i' of 2-bit packed 'words', each word has 32 bases starting from its lowest bits. */
+  static char
+  decode(uint64_t const * words, uint64_t const i)
+  {
+    return "ACGT"[(words[i >> 5] >> ((i & 31) << 1)) & 3];
+  }
+
+private:
+  uint64_t const * words{nullptr}; // Set if the sequence is 2-bit packed
+  char const * chars{nullptr}; // Set if the sequence has other characters than ACGT
+  uint64_t start{0}; // First base in 'words'
+  uint32_t length{0};
+};
+
+
+bool operator==(DnaView const & a, DnaView const & b);
+bool operator==(DnaView const & a, std::vector<char> const & b);
+bool operator==(std::vector<char> const & a, DnaView const & b);
+bool operator!=(DnaView const & a, DnaView const & b);
+bool operator!=(DnaView const & a, std::vector<char> const & b);
+bool operator!=(std::vector<char> const & a, DnaView const & b);
+
+
+/**
+ * @brief Sequences of graph node labels stored back to back in one array.
+ * @details Sequences of only A, C, G and T are 2-bit packed, others (with N, special characters or SV tags) are stored
+ *          with a byte per character in a second array. Each sequence is referred to by the position add() returned.
+ */
+class SequenceArena
+{
+  friend class boost::serialization::access;
+
+public:
+  /** \brief Appends a sequence and returns its position, which view() takes with the length of the sequence. */
+  uint64_t add(std::vector<char> const & dna);
+
+  DnaView
+  view(uint64_t const position, uint32_t const length) const
+  {
+    // The lowest bit of a position tells if the sequence is unpacked
+    if (position & 1ull)
+      return DnaView(nullptr, unpacked.data() + (position >> 1), 0, length);
+
+    return DnaView(packed.data(), nullptr, position >> 1, length);
+  }
+
+  void clear();
+  std::size_t size_in_bytes() const; // Memory used by the sequences
+
+private:
+  FlatArray<uint64_t> packed; // 32 bases per word
+  uint64_t num_packed_bases{0};
+  FlatArray<char> unpacked;
+
+  template <typename Archive>
+  void serialize(Archive & ar, unsigned int);
+};
+
+} // namespace gyper
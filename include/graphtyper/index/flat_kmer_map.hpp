@@ -0,0 +1,502 @@
+#pragma once
+
+#include <algorithm> // std::sort, std::move
+#include <cassert> // assert
+#include <cstdint> // uint64_t, uint32_t
+#include <cstdlib> // std::exit
+#include <utility> // std::move
+#include <vector> // std::vector
+
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/utilities/huge_page_allocator.hpp> // gyper::HugePageVector
+#include <graphtyper/utilities/kmer_key.hpp> // gyper::TKmerKey, gyper::fold_key
+#include <graphtyper/utilities/prefetch.hpp> // gyper::prefetch
+
+
+namespace gyper
+{
+
+/** \brief A slot of the table of a FlatKmerMap. */
+template <typename TKey>
+struct FlatKmerSlot
+{
+  TKey key = 0;
+  uint32_t offset = 0; /** \brief Index of the first value of this key. */
+  uint32_t count = 0;  /** \brief Number of values of this key, zero when the slot is empty. */
+};
+
+
+/** \brief Slots of 128 bit keys are padded to their alignment by a member, so files get zeros instead of garbage. */
+template <>
+struct FlatKmerSlot<TUint128>
+{
+  TUint128 key = 0;
+  uint32_t offset = 0;
+  uint32_t count = 0;
+  uint64_t padding = 0;
+};
+
+
+/**
+ * @brief A frozen, read-only map from k-mers to a list of values.
+ * @details Keys live in an open-addressing table (linear probing, at most half full) where each slot stores
+ *          the offset and count of its values in one contiguous array. A lookup therefore touches the slot and
+ *          the start of its values, instead of following a pointer to a separately allocated vector per key.
+ *          Slots with zero count are empty, so keys without values cannot be stored and no empty key is needed. Keys
+ *          are 64 bit, or 128 bit for k-mers with more than 32 bases.
+ */
+template <typename TValue, typename TKey = TKmerKey>
+class FlatKmerMap
+{
+public:
+  using Slot = FlatKmerSlot<TKey>;
+
+  /** \brief Values of a single key, a view into the contiguous value array. */
+  class Range
+  {
+  public:
+    TValue const * first = nullptr;
+    TValue const * last = nullptr;
+
+    Range() = default;
+    Range(TValue const * f, TValue const * l) : first(f), last(l) {}
+
+    TValue const * begin() const {return first;}
+    TValue const * end() const {return last;}
+    std::size_t size() const {return static_cast<std::size_t>(last - first);}
+    bool empty() const {return first == last;}
+  };
+
+  FlatKmerMap() = default;
+  FlatKmerMap(FlatKmerMap const & o);
+  FlatKmerMap(FlatKmerMap && o) noexcept;
+  FlatKmerMap & operator=(FlatKmerMap const & o);
+  FlatKmerMap & operator=(FlatKmerMap && o) noexcept;
+
+  /**
+   * @brief Builds the map from a container with (key, std::vector<TValue>) elements, e.g. a std::unordered_map.
+   * @details The values of each key keep their order. Keys with no values are skipped.
+   */
+  template <typename TMap>
+  void build(TMap const & map);
+
+  /**
+   * @brief Builds the map from unique keys with their values back to back, 'counts' has the number of values of each.
+   * @details The values are moved into the map instead of copied, so nothing is buffered by key. Keys with no values
+   *          are skipped.
+   */
+  void build(std::vector<TKey> const & keys,
+             std::vector<uint32_t> const & counts,
+             HugePageVector<TValue> && new_values);
+
+  /**
+   * @brief Uses a table and values owned by someone else, e.g. a mapped index file, which must outlive the map.
+   * @details The table must have been built by build(), 'new_num_slots' is a power of two.
+   */
+  void view(Slot const * new_slots,
+            std::size_t const new_num_slots,
+            TValue const * new_values,
+            std::size_t const new_num_values,
+            std::size_t const new_num_keys);
+
+  Range find(TKey const key) const;
+
+  /** \brief Prefetches the first slot 'key' is probed in, so a following find() of it does not wait on memory. */
+  void prefetch_key(TKey const key) const;
+
+  /** \brief Calls f(key, range) for every key in the map, in table order. */
+  template <typename TFunc>
+  void for_each(TFunc && f) const;
+
+  /**
+   * @brief Removes the keys for which pred(key, range) is true, in place, and returns how many were removed.
+   * @details Later slots of a probe sequence are shifted back into the removed slots and the values of the remaining
+   *          keys are moved together, so the table stays as if it was built without the removed keys. A map which is a
+   *          view is copied first.
+   */
+  template <typename TPred>
+  std::size_t erase_if(TPred && pred);
+
+  std::size_t size() const {return num_keys;}
+  std::size_t num_values() const {return total_values;}
+  std::size_t capacity() const {return num_slots;}
+  std::size_t memory_usage() const {return num_slots * sizeof(Slot) + total_values * sizeof(TValue);}
+  Slot const * slot_data() const {return slots;}
+  TValue const * value_data() const {return values;}
+  void clear();
+
+private:
+  HugePageVector<Slot> owned_slots;
+  HugePageVector<TValue> owned_values;
+  Slot const * slots = nullptr; // Either owned_slots or a view
+  TValue const * values = nullptr; // Either owned_values or a view
+  std::size_t num_slots = 0;
+  std::size_t total_values = 0;
+  uint64_t mask = 0;
+  std::size_t num_keys = 0;
+
+  bool is_owned() const {return slots == owned_slots.data();}
+  void point_to_owned();
+  static uint64_t hash(TKey const key);
+};
+
+
+template <typename TValue, typename TKey>
+inline uint64_t
+FlatKmerMap<TValue, TKey>::hash(TKey const key)
+{
+  // Finalizer of MurmurHash3, k-mers of nearby reference positions share most of their bits
+  uint64_t h = fold_key(key);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+
+template <typename TValue, typename TKey>
+template <typename TMap>
+void
+FlatKmerMap<TValue, TKey>::build(TMap const & map)
+{
+  std::size_t new_total_values = 0;
+  std::size_t new_num_keys = 0;
+
+  for (auto it = map.begin(); it != map.end(); ++it)
+  {
+    new_total_values += it->second.size();
+    new_num_keys += it->second.size() > 0;
+  }
+
+  if (new_total_values >= 0xFFFFFFFFull)
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::flat_kmer_map] Too many values (" << new_total_values << ") for the index.";
+    std::exit(1);
+  }
+
+  // Keep the table at most half full so probe sequences stay short
+  std::size_t new_num_slots = 16;
+
+  while (new_num_slots < 2 * new_num_keys)
+    new_num_slots <<= 1;
+
+  HugePageVector<Slot> new_slots(new_num_slots);
+  HugePageVector<TValue> new_values;
+  new_values.reserve(new_total_values);
+
+  for (auto it = map.begin(); it != map.end(); ++it)
+  {
+    if (it->second.size() == 0)
+      continue;
+
+    uint64_t i = hash(it->first) & (new_num_slots - 1);
+
+    while (new_slots[i].count > 0)
+    {
+      assert(new_slots[i].key != it->first);
+      i = (i + 1) & (new_num_slots - 1);
+    }
+
+    new_slots[i].key = it->first;
+    new_slots[i].offset = static_cast<uint32_t>(new_values.size());
+    new_slots[i].count = static_cast<uint32_t>(it->second.size());
+    new_values.insert(new_values.end(), it->second.begin(), it->second.end());
+  }
+
+  assert(new_values.size() == new_total_values);
+  owned_slots = std::move(new_slots);
+  owned_values = std::move(new_values);
+  num_keys = new_num_keys;
+  point_to_owned();
+}
+
+
+template <typename TValue, typename TKey>
+void
+FlatKmerMap<TValue, TKey>::build(std::vector<TKey> const & keys,
+                                 std::vector<uint32_t> const & counts,
+                                 HugePageVector<TValue> && new_values)
+{
+  assert(keys.size() == counts.size());
+
+  if (new_values.size() >= 0xFFFFFFFFull)
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::flat_kmer_map] Too many values (" << new_values.size()
+                             << ") for the index.";
+    std::exit(1);
+  }
+
+  std::size_t new_num_keys = 0;
+
+  for (uint32_t const count : counts)
+    new_num_keys += count > 0;
+
+  std::size_t new_num_slots = 16;
+
+  while (new_num_slots < 2 * new_num_keys)
+    new_num_slots <<= 1;
+
+  HugePageVector<Slot> new_slots(new_num_slots);
+  uint32_t offset = 0;
+
+  for (std::size_t k = 0; k < keys.size(); ++k)
+  {
+    if (counts[k] == 0)
+      continue;
+
+    uint64_t i = hash(keys[k]) & (new_num_slots - 1);
+
+    while (new_slots[i].count > 0)
+    {
+      assert(new_slots[i].key != keys[k]);
+      i = (i + 1) & (new_num_slots - 1);
+    }
+
+    new_slots[i].key = keys[k];
+    new_slots[i].offset = offset;
+    new_slots[i].count = counts[k];
+    offset += counts[k];
+  }
+
+  assert(offset == new_values.size());
+  owned_slots = std::move(new_slots);
+  owned_values = std::move(new_values);
+  num_keys = new_num_keys;
+  point_to_owned();
+}
+
+
+template <typename TValue, typename TKey>
+void
+FlatKmerMap<TValue, TKey>::view(Slot const * new_slots,
+                                std::size_t const new_num_slots,
+                                TValue const * new_values,
+                                std::size_t const new_num_values,
+                                std::size_t const new_num_keys)
+{
+  assert((new_num_slots & (new_num_slots - 1)) == 0);
+  owned_slots = HugePageVector<Slot>();
+  owned_values = HugePageVector<TValue>();
+  slots = new_slots;
+  values = new_values;
+  num_slots = new_num_slots;
+  total_values = new_num_values;
+  mask = new_num_slots > 0 ? new_num_slots - 1 : 0;
+  num_keys = new_num_keys;
+}
+
+
+template <typename TValue, typename TKey>
+inline typename FlatKmerMap<TValue, TKey>::Range
+FlatKmerMap<TValue, TKey>::find(TKey const key) const
+{
+  if (num_keys == 0)
+    return Range();
+
+  uint64_t i = hash(key) & mask;
+
+  while (slots[i].count > 0)
+  {
+    if (slots[i].key == key)
+    {
+      TValue const * first = values + slots[i].offset;
+      return Range(first, first + slots[i].count);
+    }
+
+    i = (i + 1) & mask;
+  }
+
+  return Range();
+}
+
+
+template <typename TValue, typename TKey>
+inline void
+FlatKmerMap<TValue, TKey>::prefetch_key(TKey const key) const
+{
+  if (num_keys > 0)
+    prefetch(slots + (hash(key) & mask));
+}
+
+
+template <typename TValue, typename TKey>
+template <typename TFunc>
+void
+FlatKmerMap<TValue, TKey>::for_each(TFunc && f) const
+{
+  for (std::size_t i = 0; i < num_slots; ++i)
+  {
+    if (slots[i].count > 0)
+      f(slots[i].key, Range(values + slots[i].offset, values + slots[i].offset + slots[i].count));
+  }
+}
+
+
+template <typename TValue, typename TKey>
+template <typename TPred>
+std::size_t
+FlatKmerMap<TValue, TKey>::erase_if(TPred && pred)
+{
+  std::vector<TKey> erased_keys;
+
+  for_each([&](TKey const key, Range const & range)
+    {
+      if (pred(key, range))
+        erased_keys.push_back(key);
+    });
+
+  if (erased_keys.empty())
+    return 0;
+
+  if (!is_owned())
+  {
+    owned_slots.assign(slots, slots + num_slots);
+    owned_values.assign(values, values + total_values);
+    point_to_owned();
+  }
+
+  for (TKey const key : erased_keys)
+  {
+    uint64_t i = hash(key) & mask;
+
+    while (owned_slots[i].key != key)
+      i = (i + 1) & mask;
+
+    assert(owned_slots[i].count > 0);
+
+    // Move each later slot of the probe sequence into the hole, unless the hole is before the slot its key hashes to
+    for (uint64_t j = (i + 1) & mask; owned_slots[j].count > 0; j = (j + 1) & mask)
+    {
+      uint64_t const home = hash(owned_slots[j].key) & mask;
+
+      if (((j - home) & mask) >= ((j - i) & mask))
+      {
+        owned_slots[i] = owned_slots[j];
+        i = j;
+      }
+    }
+
+    owned_slots[i] = Slot();
+  }
+
+  // Move the values of the remaining keys together, in the order they were stored
+  std::vector<std::size_t> order;
+  order.reserve(num_keys - erased_keys.size());
+
+  for (std::size_t i = 0; i < owned_slots.size(); ++i)
+  {
+    if (owned_slots[i].count > 0)
+      order.push_back(i);
+  }
+
+  std::sort(order.begin(), order.end(), [this](std::size_t const a, std::size_t const b)
+    {
+      return owned_slots[a].offset < owned_slots[b].offset;
+    });
+
+  uint32_t new_total_values = 0;
+
+  for (std::size_t const i : order)
+  {
+    Slot & slot = owned_slots[i];
+
+    if (slot.offset != new_total_values)
+    {
+      std::move(owned_values.begin() + slot.offset,
+                owned_values.begin() + slot.offset + slot.count,
+                owned_values.begin() + new_total_values);
+      slot.offset = new_total_values;
+    }
+
+    new_total_values += slot.count;
+  }
+
+  owned_values.erase(owned_values.begin() + new_total_values, owned_values.end());
+  num_keys -= erased_keys.size();
+  point_to_owned();
+  return erased_keys.size();
+}
+
+
+template <typename TValue, typename TKey>
+FlatKmerMap<TValue, TKey>::FlatKmerMap(FlatKmerMap const & o)
+{
+  *this = o;
+}
+
+
+template <typename TValue, typename TKey>
+FlatKmerMap<TValue, TKey>::FlatKmerMap(FlatKmerMap && o) noexcept
+{
+  *this = std::move(o);
+}
+
+
+template <typename TValue, typename TKey>
+FlatKmerMap<TValue, TKey> &
+FlatKmerMap<TValue, TKey>::operator=(FlatKmerMap const & o)
+{
+  if (this == &o)
+    return *this;
+
+  owned_slots = o.owned_slots;
+  owned_values = o.owned_values;
+  num_keys = o.num_keys;
+
+  if (o.is_owned())
+    point_to_owned();
+  else
+    view(o.slots, o.num_slots, o.values, o.total_values, o.num_keys);
+
+  return *this;
+}
+
+
+template <typename TValue, typename TKey>
+FlatKmerMap<TValue, TKey> &
+FlatKmerMap<TValue, TKey>::operator=(FlatKmerMap && o) noexcept
+{
+  if (this == &o)
+    return *this;
+
+  // Moving a vector keeps its buffer, so pointers into owned storage stay valid
+  owned_slots = std::move(o.owned_slots);
+  owned_values = std::move(o.owned_values);
+  slots = o.slots;
+  values = o.values;
+  num_slots = o.num_slots;
+  total_values = o.total_values;
+  mask = o.mask;
+  num_keys = o.num_keys;
+  o.clear();
+  return *this;
+}
+
+
+template <typename TValue, typename TKey>
+void
+FlatKmerMap<TValue, TKey>::point_to_owned()
+{
+  slots = owned_slots.data();
+  values = owned_values.data();
+  num_slots = owned_slots.size();
+  total_values = owned_values.size();
+  mask = num_slots > 0 ? num_slots - 1 : 0;
+}
+
+
+template <typename TValue, typename TKey>
+void
+FlatKmerMap<TValue, TKey>::clear()
+{
+  owned_slots = HugePageVector<Slot>();
+  owned_values = HugePageVector<TValue>();
+  point_to_owned();
+  num_keys = 0;
+}
+
+
+} // namespace gyper
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint> // uint64_t, uint32_t
+#include <vector> // std::vector
+
+#include <graphtyper/utilities/huge_page_allocator.hpp> // gyper::HugePageVector
+#include <graphtyper/utilities/kmer_key.hpp> // gyper::TKmerKey
+
+
+namespace gyper
+{
+
+/**
+ * @brief Finds all indexed k-mers within Hamming distance 1 of a query k-mer.
+ * @details A k-mer with a single mismatch has either its first H or its last K - H bases intact (pigeonhole
+ *          principle), where H is 16 bases for 64 bit keys and 32 bases for 128 bit keys. The keys are therefore kept
+ *          twice, sorted by their first half and sorted by their last half, each with a radix directory on the leading
+ *          bits. A query looks up the keys sharing each half with the query and keeps those which differ by exactly one
+ *          base in the other half. Very large buckets (e.g. in low complexity sequence) are instead probed with the
+ *          possible neighbours of that half. Keys shorter than 2 * H bases are shifted to the leading bits, so the
+ *          halves are always half of the key bits.
+ */
+class Hamming1Index
+{
+public:
+  Hamming1Index() = default;
+
+  void build(std::vector<TKmerKey> && keys);
+  void clear();
+
+  /**
+   * @brief Appends all indexed keys with exactly one mismatching base to 'key' to 'neighbours'.
+   * @details Neighbours are in the same order as in to_uint64_vec_hamming_distance_1().
+   */
+  void find_neighbours(TKmerKey const key, std::vector<TKmerKey> & neighbours) const;
+
+  std::size_t size() const {return first_half_keys.size();}
+  std::size_t memory_usage() const;
+
+private:
+  HugePageVector<TKmerKey> first_half_keys; // Sorted keys
+  HugePageVector<TKmerKey> last_half_keys; // Sorted keys with their halves swapped
+  HugePageVector<uint32_t> first_half_directory; // Offset of the first key with each value of the leading bits
+  HugePageVector<uint32_t> last_half_directory;
+  uint32_t directory_shift = 8 * sizeof(TKmerKey);
+};
+
+} // namespace gyper
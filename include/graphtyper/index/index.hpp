@@ -5,6 +5,7 @@
 #include <vector> // std::vector
 
 #include <graphtyper/index/kmer_label.hpp> // gyper::KmerLabel
+#include <graphtyper/utilities/kmer_key.hpp> // gyper::TKmerKey
 
 
 namespace gyper
@@ -17,7 +18,7 @@ class Index
 {
 public:
   std::size_t const MAX_BUFFER = 100000000; // One-hundred million or in worst case 1800 MB if we disregard overhead (which is probably something like 2-5x)
-  std::unordered_map<uint64_t, std::vector<KmerLabel> > buffer_map;
+  std::unordered_map<TKmerKey, std::vector<KmerLabel>, KmerKeyHash> buffer_map;
   bool opened = false;
   HashTable hamming0;
 
@@ -29,14 +30,14 @@ public:
 
   Index & operator=(Index &&);
 
-  bool exists(uint64_t const key) const;
-  std::vector<KmerLabel> get(uint64_t const key) const;
-  std::vector<std::vector<KmerLabel> > multi_get(std::vector<std::vector<uint64_t> > const & multi_keys) const;
+  bool exists(TKmerKey const key) const;
+  std::vector<KmerLabel> get(TKmerKey const key) const;
+  std::vector<std::vector<KmerLabel> > multi_get(std::vector<std::vector<TKmerKey> > const & multi_keys) const;
 
   void open(std::string const & f, bool clear_first = false, bool read_only = false);
   void close();
-  void put(uint64_t const key, KmerLabel && value);
-  void put(uint64_t const key, std::vector<KmerLabel> && values);
+  void put(TKmerKey const key, KmerLabel && value);
+  void put(TKmerKey const key, std::vector<KmerLabel> && values);
   bool check();
   void commit();
   std::size_t size();
@@ -1,25 +1,67 @@
 #pragma once
-#include <cstdint>
+#include <array> // std::array
+#include <cassert> // assert
+#include <cstdint> // uint8_t, uint32_t, uint64_t
+#include <vector> // std::vector
 
+#include <graphtyper/constants.hpp> // gyper::K
 #include <graphtyper/utilities/type_conversions.hpp> // to_uint64()
 
 
 namespace gyper
 {
 
+/**
+ * @brief Variant IDs of index entries which do not fit inline in the entry.
+ * @details Each node links to the previously added ID of the same entry, so a copied entry shares the IDs it had with
+ *          the original and both can add new IDs without copying. Nodes are never removed, the arena is cleared as a
+ *          whole when no entry refers to it.
+ */
+class VariantIdArena
+{
+public:
+  static uint32_t constexpr NO_NODE = 0xFFFFFFFFu;
+
+  struct Node
+  {
+    uint32_t variant_id;
+    uint32_t previous;
+  };
+
+  uint32_t
+  push(uint32_t const variant_id, uint32_t const previous)
+  {
+    nodes.push_back({variant_id, previous});
+    return static_cast<uint32_t>(nodes.size() - 1);
+  }
+
+  Node const & operator[](uint32_t const i) const {return nodes[i];}
+  void clear() {nodes.clear();}
+  std::size_t size() const {return nodes.size();}
+
+private:
+  std::vector<Node> nodes;
+};
+
+
 /**
  * @brief A datastructure of new entries to be added to the index.
  * @details This class is a helper class to the Indexer class. In it we store already calculated
- *          information to improve performance of the index construction algorithm.
+ *          information to improve performance of the index construction algorithm. The first INLINE_IDS variant IDs
+ *          are stored in the entry and the rest in a VariantIdArena, so entries are copied without allocating.
  */
 class IndexEntry
 {
 public:
-  uint64_t dna = 0u;                      /** \brief A string of DNA bases represented as a 64 bit integer. */
+  static uint32_t constexpr INLINE_IDS = 4;
+
+  TKmerKey dna = 0u;                      /** \brief A string of DNA bases represented as a key of K bases. */
   uint32_t start_index = 0u;              /** \brief The index where the variant starts on the reference genome. */
-  std::vector<uint32_t> variant_id;
   uint32_t total_var_num = 1u;
   uint32_t total_var_count = 0u;
+  uint32_t variant_ids[INLINE_IDS] = {0u, 0u, 0u, 0u};
+  uint32_t overflow = VariantIdArena::NO_NODE; /** \brief Arena node of the last variant ID if it is not inline. */
+  uint8_t num_variant_ids = 0u;
   uint8_t valid = 0u;
 
   IndexEntry(uint32_t const s)
@@ -27,8 +69,11 @@ public:
   {}
 
   IndexEntry(uint32_t const s, uint32_t const i, bool const is_reference, unsigned const var_num)
-    : start_index(s), variant_id(1, i), total_var_num(var_num), total_var_count(static_cast<uint32_t>(!is_reference))
-  {}
+    : start_index(s), total_var_num(var_num), total_var_count(static_cast<uint32_t>(!is_reference))
+  {
+    variant_ids[0] = i;
+    num_variant_ids = 1;
+  }
 
   void inline
   add_to_dna(char const base)
@@ -59,7 +104,114 @@ public:
     }
   }
 
+  /**
+   * \brief Adds variant 'v' unless it was the last one added.
+   * \details An entry passes each variant label once and gets its ID on every base of it, so checking the last ID is
+   *          enough to keep the IDs unique.
+   */
+  void inline
+  add_variant_id(uint32_t const v, VariantIdArena & arena)
+  {
+    if (num_variant_ids > 0 && last_variant_id(arena) == v)
+      return;
+
+    assert(num_variant_ids < 0xFFu);
+
+    if (num_variant_ids < INLINE_IDS)
+      variant_ids[num_variant_ids] = v;
+    else
+      overflow = arena.push(v, overflow);
+
+    ++num_variant_ids;
+  }
+
+  uint32_t inline
+  last_variant_id(VariantIdArena const & arena) const
+  {
+    assert(num_variant_ids > 0);
+    return num_variant_ids <= INLINE_IDS ? variant_ids[num_variant_ids - 1] : arena[overflow].variant_id;
+  }
+
+  /** \brief Writes the variant IDs in the order they were added to 'ids', which must fit num_variant_ids IDs. */
+  void inline
+  get_variant_ids(uint32_t * ids, VariantIdArena const & arena) const
+  {
+    uint32_t i = num_variant_ids;
 
+    for (uint32_t node = overflow; i > INLINE_IDS; node = arena[node].previous)
+      ids[--i] = arena[node].variant_id;
+
+    for (; i > 0; --i)
+      ids[i - 1] = variant_ids[i - 1];
+  }
 };
 
+
+/**
+ * @brief The k-mers which are being extended by the indexer, grouped by the position of their first base.
+ * @details A ring buffer with a sublist for each of the last K bases, the front sublist has the k-mers starting at the
+ *          most recent base and the back sublist has the oldest k-mers. Sublists keep their memory when they are
+ *          cleared or reused, so once the buffers have grown to the largest bubble in the graph no more memory is
+ *          allocated.
+ */
+class EntryRing
+{
+public:
+  using TSublist = std::vector<IndexEntry>;
+
+  std::size_t size() const {return num_sublists;}
+  bool empty() const {return num_sublists == 0;}
+  void clear() {num_sublists = 0;}
+
+  /** \brief The i-th sublist from the front. */
+  TSublist & operator[](std::size_t const i) {return sublists[(first + i) % K];}
+  TSublist const & operator[](std::size_t const i) const {return sublists[(first + i) % K];}
+  TSublist & back() {return (*this)[num_sublists - 1];}
+
+  /** \brief Adds an empty sublist to the front and returns it. */
+  TSublist &
+  push_front()
+  {
+    assert(num_sublists < K);
+    first = (first + K - 1) % K;
+    ++num_sublists;
+    sublists[first].clear();
+    return sublists[first];
+  }
+
+  void
+  pop_back()
+  {
+    assert(num_sublists > 0);
+    --num_sublists;
+  }
+
+  /** \brief Adds empty sublists to the back until there are 'new_size' sublists. */
+  void
+  grow(std::size_t const new_size)
+  {
+    assert(new_size <= K);
+
+    for (; num_sublists < new_size; ++num_sublists)
+      (*this)[num_sublists].clear();
+  }
+
+  /** \brief Makes this a copy of 'other', reusing the memory of the sublists. */
+  void
+  assign(EntryRing const & other)
+  {
+    first = other.first;
+    num_sublists = other.num_sublists;
+
+    for (std::size_t i = 0; i < num_sublists; ++i)
+      (*this)[i].assign(other[i].begin(), other[i].end());
+  }
+
+private:
+  std::array<TSublist, K> sublists;
+  std::size_t first = 0;
+  std::size_t num_sublists = 0;
+};
+
+
 } // namespace gyper
@@ -6,6 +6,8 @@
 #include <memory>
 #include <fstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <boost/archive/binary_iarchive.hpp>
 
@@ -18,12 +20,52 @@
 namespace gyper
 {
 
-using TEntrySublist = std::deque<IndexEntry>;
-using TEntryList = std::deque<TEntrySublist>;
+class GenotypingContext;
+class Graph;
+class MemIndex;
 
-void index_graph(std::string const & index_path);
+// The graph of the current genotyping context is indexed unless a context is given
+void index_graph(std::string const & index_path); // Writes the index to disk, and a flat index file if flat_index is set
+void index_graph(MemIndex & new_mem_index, bool const mask_repeats = true); // Builds an in-memory index from the graph
+void index_graph(GenotypingContext & context, bool const mask_repeats = true); // Builds the index of the context
 void index_graph(std::string const & graph_path, std::string const & index_path);
 void load_index(std::string const & index_path);
 Index<RocksDB> load_secondary_index(std::string const & index_path);
 
+
+/**
+ * @brief Builds in-memory indexes of graphs which differ from the previously indexed graph only around some variants.
+ * @details The graph is split into segments which start at each reference node after a reference label of at least
+ *          K - 1 bases. The labels of a segment only depend on its nodes, the variants before it and the K - 1 bases
+ *          before those. The labels of every segment are kept, so when a segment is the same in the old graph its labels
+ *          only get new variant IDs and special positions, and only the other segments are indexed again. The index is
+ *          then built from the labels in the same order as index_graph() puts them, so both give the same index.
+ */
+class IncrementalIndexer
+{
+public:
+  /** \brief Indexes the whole graph of the current context into 'new_mem_index'. */
+  void index(MemIndex & new_mem_index);
+
+  /** \brief Indexes the graph of the current context into 'new_mem_index', 'old_graph' was indexed last time. */
+  void update(MemIndex & new_mem_index, Graph const & old_graph);
+
+  std::size_t get_num_segments() const {return segments.size();}
+  std::size_t get_num_indexed_segments() const {return num_indexed_segments;} // Segments indexed in the last call
+
+private:
+  struct Segment
+  {
+    uint32_t order; // Order of the first reference node
+    TNodeIndex r_begin; // First reference node
+    std::size_t labels_begin; // First label of the segment in 'labels'
+  };
+
+  std::vector<Segment> segments;
+  std::vector<std::pair<TKmerKey, PackedKmerLabel> > labels; // Labels of all segments in the order they were put
+  std::size_t num_indexed_segments = 0;
+
+  void rebuild(MemIndex & new_mem_index, Graph const * old_graph);
+};
+
 } // namespace gyper
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic> // std::atomic
+#include <cassert> // assert
+#include <cstdint> // uint64_t
+#include <string> // std::string
+#include <vector> // std::vector
+
+#include <graphtyper/utilities/huge_page_allocator.hpp> // gyper::HugePageVector
+#include <graphtyper/utilities/kmer_key.hpp> // gyper::fold_key
+#include <graphtyper/utilities/prefetch.hpp> // gyper::prefetch
+
+
+namespace gyper
+{
+
+/**
+ * @brief Membership filter for k-mers which fits in cache far better than the index it guards.
+ * @details A blocked Bloom filter. Each key sets NUM_BITS bits within a single 512 bit (cache line) block, so a query
+ *          reads one cache line. There are no false negatives. With at least BITS_PER_KEY bits per key the false
+ *          positive rate is below 1%. 128 bit keys are folded to 64 bits before they are hashed.
+ */
+class KmerFilter
+{
+public:
+  static uint64_t constexpr BITS_PER_KEY = 12;
+  static uint64_t constexpr NUM_BITS = 4; // Bits set per key
+  static uint64_t constexpr WORDS_PER_BLOCK = 8;
+
+  KmerFilter() = default;
+  KmerFilter(KmerFilter const & o);
+  KmerFilter(KmerFilter && o) noexcept;
+  KmerFilter & operator=(KmerFilter const & o);
+  KmerFilter & operator=(KmerFilter && o) noexcept;
+
+  /** \brief Builds the filter for 'num_keys' keys, which are inserted with insert(). */
+  void reset(std::size_t const num_keys);
+  void clear();
+
+  template <typename TKey>
+  void insert(TKey const key);
+
+  template <typename TKey>
+  bool may_contain(TKey const key) const;
+
+  template <typename TKey>
+  void prefetch_key(TKey const key) const;
+
+  /** \brief Uses filter words owned by someone else, e.g. a mapped index file, which must outlive the filter. */
+  void view(uint64_t const * new_words, std::size_t const new_num_words);
+
+  bool empty() const {return num_words == 0;}
+  std::size_t memory_usage() const {return num_words * sizeof(uint64_t);}
+  uint64_t const * data() const {return words;}
+  std::size_t size() const {return num_words;} /** \brief Number of 64 bit words. */
+
+private:
+  HugePageVector<uint64_t> blocks; // Owned filter words, empty if the filter is a view
+  uint64_t const * words = nullptr; // Either blocks or a view
+  std::size_t num_words = 0;
+  uint64_t block_mask = 0;
+
+  static uint64_t hash(uint64_t key);
+  uint64_t * owned_block_of(uint64_t const h) {return blocks.data() + ((h >> 36) & block_mask) * WORDS_PER_BLOCK;}
+  uint64_t const * block_of(uint64_t const h) const {return words + ((h >> 36) & block_mask) * WORDS_PER_BLOCK;}
+};
+
+
+/**
+ * @brief Counts how index lookups are answered, shared by all threads querying the same index.
+ * @details Lookups are counted per query batch and then added, so the atomics are rarely touched.
+ */
+class KmerFilterStats
+{
+public:
+  std::atomic<uint64_t> filtered{0}; /** \brief Lookups rejected by the filter. */
+  std::atomic<uint64_t> hits{0}; /** \brief Lookups passing the filter and found in the index. */
+  std::atomic<uint64_t> false_positives{0}; /** \brief Lookups passing the filter but not found in the index. */
+
+  KmerFilterStats() = default;
+  KmerFilterStats(KmerFilterStats const & o);
+  KmerFilterStats & operator=(KmerFilterStats const & o);
+
+  void add(uint64_t const new_filtered, uint64_t const new_hits, uint64_t const new_false_positives);
+  void clear();
+  std::string to_string() const;
+};
+
+
+inline uint64_t
+KmerFilter::hash(uint64_t key)
+{
+  // A different mixer than in FlatKmerMap, so filter blocks and table slots are independent
+  key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+  return key ^ (key >> 31);
+}
+
+
+template <typename TKey>
+inline void
+KmerFilter::insert(TKey const key)
+{
+  assert(words == blocks.data()); // A view cannot be changed
+  uint64_t const h = hash(fold_key(key));
+  uint64_t * block = owned_block_of(h);
+
+  for (uint64_t i = 0; i < NUM_BITS; ++i)
+  {
+    uint64_t const pos = (h >> (9 * i)) & 511ull;
+    block[pos >> 6] |= 1ull << (pos & 63ull);
+  }
+}
+
+
+template <typename TKey>
+inline bool
+KmerFilter::may_contain(TKey const key) const
+{
+  if (num_words == 0)
+    return true;
+
+  uint64_t const h = hash(fold_key(key));
+  uint64_t const * block = block_of(h);
+
+  // Each bit position uses 9 of the lowest 36 bits of the hash
+  for (uint64_t i = 0; i < NUM_BITS; ++i)
+  {
+    uint64_t const pos = (h >> (9 * i)) & 511ull;
+
+    if ((block[pos >> 6] & (1ull << (pos & 63ull))) == 0)
+      return false;
+  }
+
+  return true;
+}
+
+
+template <typename TKey>
+inline void
+KmerFilter::prefetch_key(TKey const key) const
+{
+  if (num_words > 0)
+    prefetch(block_of(hash(fold_key(key))));
+}
+
+
+} // namespace gyper
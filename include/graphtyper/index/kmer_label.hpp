@@ -85,9 +85,52 @@ private:
   }
 
 
+};
+
+/**
+ * @brief The form of a KmerLabel which is stored in the in-memory index.
+ * @details These are the same 12 bytes which are written to the on-disk index. The variant number and order are
+ *          looked up in the graph when the label is consumed, see GenotypePaths::add_next_kmer_labels.
+ */
+class PackedKmerLabel
+{
+public:
+  uint32_t start_index = INVALID_ID;
+  uint32_t end_index = INVALID_ID;
+  uint32_t variant_id = INVALID_ID;
+
+  PackedKmerLabel() noexcept = default;
+
+  PackedKmerLabel(uint32_t const s, uint32_t const e, uint32_t const i) noexcept
+    : start_index(s)
+    , end_index(e)
+    , variant_id(i)
+  {}
+
+  PackedKmerLabel(KmerLabel const & label) noexcept
+    : start_index(label.start_index)
+    , end_index(label.end_index)
+    , variant_id(label.variant_id)
+  {}
+
+  bool
+  operator==(PackedKmerLabel const & c2) const
+  {
+    return start_index == c2.start_index && end_index == c2.end_index && variant_id == c2.variant_id;
+  }
+
+
+  bool
+  operator!=(PackedKmerLabel const & c2) const
+  {
+    return !(*this == c2);
+  }
+
+
 };
 
 // Type aliases
 using TKmerLabels = std::vector<std::vector<KmerLabel> >;
+using TPackedKmerLabels = std::vector<std::vector<PackedKmerLabel> >;
 
 } // namespace gyper
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array> // std::array
+#include <cstdint> // uint32_t, uint64_t
+#include <mutex> // std::mutex
+#include <string> // std::string
+#include <unordered_map> // std::unordered_map
+#include <vector> // std::vector
+
+#include <graphtyper/index/kmer_label.hpp> // gyper::PackedKmerLabel
+#include <graphtyper/utilities/kmer_key.hpp> // gyper::TKmerKey
+
+
+namespace gyper
+{
+
+/**
+ * @brief A bounded cache of decoded labels of k-mers looked up in an on-disk index, shared by all threads.
+ * @details Keys are spread over NUM_SHARDS shards with a lock each. Each shard evicts with the CLOCK algorithm: a
+ *          lookup marks its entry as referenced and the clock hand evicts the first entry which has not been referenced
+ *          since the hand last passed it. Keys without labels are cached too, most lookups of k-mers with a mismatch
+ *          are for keys which are not in the index.
+ */
+class KmerLabelCache
+{
+public:
+  static std::size_t constexpr NUM_SHARDS = 64;
+
+  /** \brief A cache using about 'max_bytes' bytes for its entries. */
+  explicit KmerLabelCache(std::size_t const max_bytes);
+  KmerLabelCache(KmerLabelCache const &) = delete;
+  KmerLabelCache & operator=(KmerLabelCache const &) = delete;
+
+  /** \brief Appends the labels of 'key' to 'labels' and returns true if 'key' is cached. */
+  bool get(TKmerKey const key, std::vector<PackedKmerLabel> & labels);
+  void put(TKmerKey const key, std::vector<PackedKmerLabel> const & labels);
+
+  std::size_t memory_usage() const;
+  std::string to_string() const; /** \brief Hit rate and size of the cache. */
+
+private:
+  struct Entry
+  {
+    TKmerKey key;
+    std::vector<PackedKmerLabel> labels;
+    bool referenced;
+  };
+
+  struct Shard
+  {
+    mutable std::mutex mutex;
+    std::unordered_map<TKmerKey, uint32_t, KmerKeyHash> positions; // Key to its index in entries
+    std::vector<Entry> entries;
+    std::size_t hand = 0;
+    std::size_t bytes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  std::size_t max_shard_bytes;
+  std::array<Shard, NUM_SHARDS> shards;
+
+  Shard & get_shard(TKmerKey const key);
+  void evict(Shard & shard);
+  static std::size_t get_entry_bytes(std::size_t const num_labels);
+};
+
+} // namespace gyper
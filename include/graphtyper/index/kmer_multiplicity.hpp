@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint> // uint64_t
+#include <string> // std::string
+#include <vector> // std::vector
+
+
+namespace gyper
+{
+
+/**
+ * @brief Histogram of how many labels the k-mers of an index have, and how many of them are masked as repeats.
+ * @details Multiplicities of MAX_MULTIPLICITY or more share the last bin of the histogram.
+ */
+class KmerMultiplicityStats
+{
+public:
+  static std::size_t constexpr MAX_MULTIPLICITY = 64;
+
+  std::vector<uint64_t> histogram; /** \brief histogram[m] is the number of keys with m labels. */
+  uint64_t num_keys = 0;
+  uint64_t num_labels = 0;
+  uint64_t num_repeat_keys = 0; /** \brief Keys with too many labels to be stored, only their multiplicity is kept. */
+  uint64_t num_repeat_labels = 0;
+  uint64_t max_multiplicity = 0;
+
+  KmerMultiplicityStats();
+
+  void add(uint64_t const multiplicity, bool const is_repeat);
+
+  /** \brief Smallest multiplicity which at least 'fraction' of the keys have at most, within the histogram. */
+  uint64_t get_quantile(double const fraction) const;
+
+  std::string to_string() const;
+};
+
+} // namespace gyper
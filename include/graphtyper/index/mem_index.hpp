@@ -1,11 +1,17 @@
 #pragma once
 
+#include <memory> // std::shared_ptr
+#include <string> // std::string
 #include <vector> // std::vector
 #include <unordered_map> // std::unordered_map
+#include <utility> // std::pair
 
-#include <google/dense_hash_map> // google::dense_hash_map
-
+#include <graphtyper/index/flat_kmer_map.hpp> // gyper::FlatKmerMap
+#include <graphtyper/index/hamming1_index.hpp> // gyper::Hamming1Index
+#include <graphtyper/index/kmer_filter.hpp> // gyper::KmerFilter
+#include <graphtyper/index/kmer_label_cache.hpp> // gyper::KmerLabelCache
 #include <graphtyper/index/kmer_label.hpp> // gyper::KmerLabel
+#include <graphtyper/index/kmer_multiplicity.hpp> // gyper::KmerMultiplicityStats
 #include <graphtyper/index/rocksdb.hpp> // gyper::Index<gyper::RocksDB>
 
 
@@ -17,21 +23,144 @@ class Graph;
 class MemIndex
 {
 public:
-  uint64_t empty_key = 0ul;
-  google::dense_hash_map<uint64_t, std::vector<KmerLabel> > hamming0;
-  std::unordered_map<uint64_t, uint64_t> hamming1;
+  FlatKmerMap<PackedKmerLabel> hamming0; // Frozen after load() or commit()
+  FlatKmerMap<uint32_t> repeats; // Masked keys with more than repeat_threshold labels, mapped to their multiplicity
+  uint64_t repeat_threshold{0}; // Zero if repeats were not masked
+  Hamming1Index hamming1; // Only built when the hamming1_index option is set
+  KmerFilter filter; // Rejects most keys which are not in hamming0 before they are looked up
+  mutable KmerFilterStats filter_stats; // Lookup counts since the last commit
+  std::unordered_map<TKmerKey, std::vector<PackedKmerLabel>, KmerKeyHash> buffer_map; // Labels not yet committed
+
+  std::shared_ptr<void const> mapping; // Keeps the memory alive which the table and filter are views of, if any
+  std::shared_ptr<Index<RocksDB> > disk_index; // Queried instead of hamming0 in the low memory mode
+  std::shared_ptr<KmerLabelCache> label_cache; // Labels recently read from disk_index
 
   MemIndex() = default;
   void load(Index<RocksDB> & index);
-  // void generate_hamming1_hash_map();
-  std::vector<KmerLabel> get(std::vector<uint64_t> const & keys) const;
-  std::vector<std::vector<KmerLabel> > multi_get(std::vector<std::vector<uint64_t> > const & keys) const;
-  std::vector<std::vector<KmerLabel> > multi_get_hamming1(std::vector<std::vector<uint64_t> > const & keys) const;
+
+  /**
+   * @brief Writes the table, labels and filter to a flat index file, which map() can use in place.
+   * @details The file starts with a versioned header with the k-mer size, layout, counts, section offsets and
+   *          checksums. The k-mer size and slot size record whether the keys are 64 or 128 bits. Each section is 64
+   *          byte aligned so the mapped table has the same alignment as in memory.
+   */
+  void save(std::string const & path) const;
+
+  /** \brief Size in bytes of the flat index which write_flat() writes. */
+  std::size_t get_flat_size() const;
+
+  /** \brief Writes the same flat index as save() to 'data', which must hold get_flat_size() zeroed bytes. */
+  void write_flat(char * data) const;
+
+  /**
+   * @brief Maps a flat index file written by save() and queries it in place, without reading it first.
+   * @details Returns false if the file is missing or was not written for this version, k-mer size or layout. The
+   *          header checksum is always checked, the checksum of the (large) payload only if 'verify_payload' is set.
+   */
+  bool map(std::string const & path, bool const verify_payload = false);
+
+  /** \brief Uses a flat index at 'data', which must stay valid for as long as the index is used. */
+  bool attach(char const * data, std::size_t const size, bool const verify_payload);
+
+  /**
+   * @brief Queries the RocksDB index at 'index_path' on disk instead of loading it, for indexes too large for memory.
+   * @details Lookups read the labels of keys which are not cached with a single MultiGet per batch and keep up to
+   *          'cache_bytes' bytes of decoded labels in a CLOCK cache.
+   */
+  void open_disk(std::string const & index_path, std::size_t const cache_bytes);
+  bool is_on_disk() const {return disk_index != nullptr;}
+
+  // Building the index directly from the graph, without a round trip through RocksDB
+  void put(TKmerKey const key, KmerLabel && label);
+  void put(TKmerKey const key, std::vector<KmerLabel> && labels);
+
+  /**
+   * @brief Builds the table from the buffered and previously committed labels.
+   * @details Keys with more than max_index_labels labels are never returned by a lookup. Unless 'mask_repeats' is
+   *          false they are moved to the repeats table, which keeps only their multiplicity, and lookups of them drop
+   *          the seed right away. Their labels cannot be recovered by a later commit.
+   */
+  void commit(bool const mask_repeats = true);
+
+  /**
+   * @brief Moves the committed keys with more than max_index_labels labels to the repeats table, in place.
+   * @details Gives the same index as committing with 'mask_repeats' set, without copying the table back to the buffer.
+   *          The filter and Hamming distance 1 index have the keys of both tables, so they stay as they are.
+   */
+  void mask_repeats();
+
+  /**
+   * @brief Builds the table from unique keys with their labels back to back, e.g. as sorted runs are merged.
+   * @details Replaces the committed labels and masks repeats like commit(), without buffering the labels by key.
+   */
+  void build(std::vector<TKmerKey> const & keys,
+             std::vector<uint32_t> const & counts,
+             HugePageVector<PackedKmerLabel> && labels);
+
+  void generate_hamming1_index();
+
+  /** \brief Multiplicity histogram of the committed keys, including the masked repeats. */
+  KmerMultiplicityStats get_multiplicity_stats() const;
+
+  /**
+   * @brief Looks up all keys, 'hits' gets the index and labels of each key found, in the order of the keys.
+   * @details Filter blocks and table slots of upcoming keys are prefetched while earlier keys are resolved, so the
+   *          memory accesses of many keys overlap instead of being waited on one at a time.
+   */
+  void batch_find(std::vector<TKmerKey> const & keys,
+                  std::vector<std::pair<uint32_t, FlatKmerMap<PackedKmerLabel>::Range> > & hits) const;
+
+  std::vector<PackedKmerLabel> get(std::vector<TKmerKey> const & keys) const;
+  TPackedKmerLabels multi_get(std::vector<std::vector<TKmerKey> > const & keys) const;
+
+  /**
+   * @brief Gets the labels of all k-mers within Hamming distance 1 of each unique key, excluding the key itself.
+   * @details Gives the same labels in the same order as looking up all 3 * K neighbours of each key with multi_get().
+   *          Seeds with more than one key (ambiguous bases) are looked up as they are.
+   */
+  TPackedKmerLabels multi_get_hamming1(std::vector<std::vector<TKmerKey> > const & keys) const;
+
+private:
+  using THit = std::pair<uint32_t, FlatKmerMap<PackedKmerLabel>::Range>;
+
+  // Builds the filter and Hamming distance 1 index of the tables, which no longer refer to a mapping or disk index
+  void finish_build();
+
+  // Finds the keys in the table, or on disk in the low memory mode where 'disk_labels' holds the labels of the hits
+  void find_all(std::vector<TKmerKey> const & keys,
+                std::vector<THit> & hits,
+                std::vector<std::vector<PackedKmerLabel> > & disk_labels) const;
 };
 
 
+/**
+ * @brief Loads the index at 'index_path' into 'new_mem_index', mapping its flat index file if there is one.
+ * @details Otherwise the RocksDB index is loaded, unless it would not fit in index_memory_budget. Then it is queried on
+ *          disk with a label cache of that size instead.
+ */
+void load_mem_index(MemIndex & new_mem_index, std::string const & index_path);
+
+
+/** \brief Path of the flat index file which is saved with the RocksDB index at 'index_path'. */
+std::string get_flat_index_path(std::string const & index_path);
+
 MemIndex load_secondary_mem_index(std::string const & secondary_index_path, Graph & secondary_graph);
 
-extern MemIndex mem_index;
+extern MemIndex & mem_index; // The index of the default genotyping context
+
+
+/**
+ * @brief Copies the in-memory index of the current context to memory on each NUMA node ("replicate") or to memory interleaved across
+ *        the nodes ("interleave").
+ * @details The copies are flat indexes in NumaBuffers. Threads pinned to a node look up reads in the copy returned by
+ *          get_local_mem_index(). Indexes queried on disk are not copied.
+ */
+void place_mem_index_on_numa_nodes(std::string const & placement);
+
+/** \brief Frees the copies of place_mem_index_on_numa_nodes() and adds their lookup counts to the index. */
+void clear_numa_mem_indexes();
+
+/** \brief The copy of the current context's index on the NUMA node of the calling thread, or the index itself. */
+MemIndex const & get_local_mem_index();
 
 } // namespace gyper
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint> // uint64_t
+#include <cstring> // memcpy
+#include <memory> // std::unique_ptr
 #include <string> // std::string
 #include <unordered_map>
 #include <vector> // std::vector
@@ -12,12 +15,17 @@
 #include <rocksdb/options.h>
 #include <rocksdb/statistics.h>
 
+namespace rocksdb
+{
+class SstFileWriter;
+}
+
 
 namespace gyper
 {
 
 std::vector<KmerLabel> value_to_labels(std::string const & value);
-uint64_t key_to_uint64_t(std::string const & key_str);
+TKmerKey key_to_uint64_t(std::string const & key_str);
 
 
 class RocksDB
@@ -28,6 +36,7 @@ public:
   rocksdb::Options options;
   bool destroy_db_after_use = true;
   bool opened = false;
+  bool use_block_cache = false; // Set before opening an index which is queried on disk with point lookups
   std::string filename;
 
   /** CONSTRUCTORS */
@@ -38,6 +47,60 @@ public:
 };
 
 
+/**
+ * \brief The order of 'key' in the database.
+ * \details Keys are stored as the bytes of the integer and the database orders them bytewise, so on little endian
+ *          machines it is not the same as the order of the integers. The function is its own inverse.
+ */
+inline TKmerKey
+to_db_key_order(TKmerKey const key)
+{
+  unsigned char bytes[sizeof(TKmerKey)];
+  memcpy(bytes, &key, sizeof(TKmerKey));
+  TKmerKey order = 0;
+
+  for (unsigned i = 0; i < sizeof(TKmerKey); ++i)
+    order = (order << 8) | bytes[i];
+
+  return order;
+}
+
+
+/**
+ * @brief Bulk loads keys into an empty RocksDB index.
+ * @details The keys are written to SST files next to the database, which are ingested when all keys have been put.
+ *          This skips the memtables, write-ahead log and compactions of the normal write path, and the files are placed
+ *          directly in the bottommost level since nothing overlaps them. Each key must be put once with all of its
+ *          labels, in increasing order of to_db_key_order().
+ */
+class SstIndexWriter
+{
+public:
+  static uint64_t constexpr MAX_FILE_SIZE = 256ull << 20; // A new SST file is started after this many bytes
+
+  SstIndexWriter(Index<RocksDB> & db_index);
+  ~SstIndexWriter(); // Removes files which were not ingested
+  SstIndexWriter(SstIndexWriter const &) = delete;
+  SstIndexWriter & operator=(SstIndexWriter const &) = delete;
+
+  void put(TKmerKey const key, std::vector<KmerLabel> const & labels);
+
+  /** \brief Finishes the last file and ingests all of them into the index. */
+  void ingest();
+
+  uint64_t get_num_keys() const {return num_keys;}
+
+private:
+  Index<RocksDB> & db_index;
+  std::unique_ptr<rocksdb::SstFileWriter> writer;
+  std::vector<std::string> paths;
+  uint64_t num_keys = 0;
+  TKmerKey last_order = 0;
+
+  void finish_file();
+};
+
+
 extern Index<RocksDB> index; // Global index
 
 } // namespace gyper
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string> // std::string
+
+
+namespace gyper
+{
+
+/**
+ * @brief Loads the graph and in-memory index of the current context from a segment shared by the processes of a host.
+ * @details The first process loads the graph and index as usual and publishes them in the segment called 'name' (see
+ *          SharedSegment::get_path()), later processes attach to it. The index is queried in place, so each process
+ *          only keeps its own copy of the (much smaller) graph. A segment of a graph or index which has since changed
+ *          is replaced when no process uses it. Returns false if the segment can be neither used nor created, the
+ *          caller should then load the graph and index privately.
+ */
+bool load_shared_graph_and_index(std::string const & name,
+                                 std::string const & graph_path,
+                                 std::string const & index_path);
+
+} // namespace gyper
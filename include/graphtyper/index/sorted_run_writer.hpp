@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint> // uint32_t, uint64_t
+#include <functional> // std::function
+#include <string> // std::string
+#include <vector> // std::vector
+
+#include <graphtyper/index/kmer_label.hpp> // gyper::KmerLabel
+#include <graphtyper/utilities/kmer_key.hpp> // gyper::TKmerKey
+
+
+namespace gyper
+{
+
+/**
+ * @brief Collects the labels of an index within a fixed amount of memory and gives them back grouped by key.
+ * @details Labels are buffered until the buffer holds max_memory bytes. Then the buffer is sorted by key and written
+ *          to a temporary file as a sorted run. merge() merges the runs and gives each key once, with its labels in the
+ *          order they were put. It works as a sink for the indexer, like Index and MemIndex. When there are more than
+ *          MAX_MERGE_WIDTH runs they are first merged into fewer runs, so there is a limit on the files open at once.
+ */
+class SortedRunWriter
+{
+public:
+  static std::size_t constexpr MAX_MERGE_WIDTH = 64; // Most runs merged at once, more are merged in several passes
+  static std::size_t constexpr MIN_BLOCK_RECORDS = 1024; // Fewest records read from a run at a time
+
+  struct Record
+  {
+    TKmerKey key;
+    uint32_t seq; // Order of the label within its run
+    uint32_t start_index;
+    uint32_t end_index;
+    uint32_t variant_id;
+  };
+
+  SortedRunWriter(std::string const & run_prefix, std::size_t const max_memory);
+  ~SortedRunWriter(); // Removes the run files
+  SortedRunWriter(SortedRunWriter const &) = delete;
+  SortedRunWriter & operator=(SortedRunWriter const &) = delete;
+
+  void put(TKmerKey const key, KmerLabel && label);
+  void put(TKmerKey const key, std::vector<KmerLabel> && labels);
+
+  /**
+   * \brief Calls 'f' for every key in increasing order with all of its labels.
+   * \details Reading the runs back uses at most max_memory bytes of buffers. The writer is empty afterwards.
+   */
+  void merge(std::function<void(TKmerKey const key, std::vector<KmerLabel> & labels)> const & f);
+
+  std::size_t get_max_records() const {return max_records;}
+  std::size_t get_num_runs() const {return run_paths.size();}
+  uint64_t get_num_labels() const {return num_labels;}
+
+private:
+  std::string run_prefix;
+  std::size_t max_records;
+  std::vector<Record> buffer;
+  std::vector<std::string> run_paths;
+  uint64_t num_labels = 0;
+  std::size_t num_written_runs = 0;
+
+  std::string get_run_path();
+  void write_run();
+  void remove_runs();
+};
+
+} // namespace gyper
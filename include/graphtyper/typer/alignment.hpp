@@ -14,12 +14,47 @@
 namespace gyper
 {
 
+class EncodedRead;
+class GenotypingContext;
+
+/** \brief How reads are seeded before the seeds are walked to full alignments. */
+enum class SeedMode
+{
+  GRID, // K-mers every K - 1 bases and their Hamming distance 1 neighbours
+  SYNCMER // Exact closed syncmers, reads with too few syncmer hits use the grid
+};
+
+/**
+ * \brief Aligns one orientation of a read to the graph.
+ * \param read The IUPAC sequence of the read in the orientation to align.
+ * \param encoded The read encoded from its BAM record, always in the forward orientation.
+ * \param is_reverse_complement Set if 'read' is the reverse complement of the encoded read.
+ */
+void
+find_genotype_paths_of_one_of_the_sequences(seqan::IupacString const & read,
+                                            EncodedRead const & encoded,
+                                            bool const is_reverse_complement,
+                                            GenotypePaths & geno,
+                                            SeedMode const seed_mode,
+                                            Graph const & graph,
+                                            MemIndex const & mem_index
+                                            );
+
+/** \brief Aligns a read and its reverse complement to the graph of the current context. */
 std::pair<GenotypePaths, GenotypePaths>
 align_read(bam1_t * rec,
            seqan::IupacString const & seq,
            seqan::IupacString const & rseq
            );
 
+/** \brief Aligns a read and its reverse complement to the graph of 'context'. */
+std::pair<GenotypePaths, GenotypePaths>
+align_read(GenotypingContext & context,
+           bam1_t * rec,
+           seqan::IupacString const & seq,
+           seqan::IupacString const & rseq
+           );
+
 GenotypePaths *
 update_unpaired_read_paths(std::pair<GenotypePaths, GenotypePaths> & geno_paths, bam1_t * rec);
 
@@ -7,6 +7,7 @@
 namespace gyper
 {
 
+class GenotypingContext;
 
 // returns the prefix to the output files
 std::vector<std::string>
@@ -20,6 +21,19 @@ call(std::vector<std::string> const & hts_path,
      bool const is_discovery,
      bool const is_writing_hap);
 
+// same as above, but the graph and index are loaded into and read from 'context'
+std::vector<std::string>
+call(GenotypingContext & context,
+     std::vector<std::string> const & hts_path,
+     std::string const & graph_path,
+     std::string const & index_path,
+     std::string const & output_dir,
+     long const minimum_variant_support,
+     double const minimum_variant_support_ratio,
+     bool const is_writing_calls_vcf,
+     bool const is_discovery,
+     bool const is_writing_hap);
+
 // returns the written variant maps
 std::vector<std::string>
 discover_directly_from_bam(std::string const & graph_path,
@@ -29,4 +43,14 @@ discover_directly_from_bam(std::string const & graph_path,
                            long minimum_variant_support,
                            double minimum_variant_support_ratio);
 
+// same as above, but the graph is loaded into and read from 'context'
+std::vector<std::string>
+discover_directly_from_bam(GenotypingContext & context,
+                           std::string const & graph_path,
+                           std::vector<std::string> const & hts_paths,
+                           std::string const & region_str,
+                           std::string const & output_dir,
+                           long minimum_variant_support,
+                           double minimum_variant_support_ratio);
+
 } // namespace gyper
@@ -15,6 +15,7 @@ namespace gyper
 // Forward declarations
 class Graph;
 class KmerLabel;
+class PackedKmerLabel;
 class Path;
 class VariantCandidate;
 
@@ -63,6 +64,14 @@ public:
                             int mismatches = 0
                             );
 
+  // Labels from the in-memory index are expanded using the graph before they are added
+  void add_next_kmer_labels(std::vector<PackedKmerLabel> const & ll,
+                            uint32_t start_index,
+                            uint32_t read_end_index,
+                            int mismatches,
+                            gyper::Graph const & graph
+                            );
+
   void add_prev_kmer_labels(std::vector<KmerLabel> const & ll,
                             uint32_t const read_start_index,
                             uint32_t const read_end_index,
@@ -15,12 +15,14 @@
 namespace gyper
 {
 
+class GenotypingContext;
 class HaplotypeCall;
 
 class VcfWriter
 {
 public:
-  explicit VcfWriter(uint32_t variant_distance = 60);
+  explicit VcfWriter(uint32_t variant_distance = 60); // Writes calls in the graph of the current context
+  explicit VcfWriter(GenotypingContext const & _context, uint32_t variant_distance = 60);
 //  explicit VcfWriter(std::vector<std::string> const & samples, uint32_t variant_distance = 60);
 
   /*******************
@@ -36,6 +38,7 @@ public:
   std::vector<HaplotypeCall> get_haplotype_calls() const;
 
 private:
+  GenotypingContext const & context;
   std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t> > id2hap; // first = haplotype, second = local genotype id
 
 public:
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <cstdint> // uint64_t
+#include <cstring> // std::memcpy
+#include <ostream> // std::ostream
+#include <string> // std::string
+#include <type_traits> // std::integral_constant, std::is_arithmetic, std::is_enum
+#include <unordered_map> // std::unordered_map
+#include <utility> // std::move
+#include <vector> // std::vector
+
+#include <boost/serialization/access.hpp>
+
+#include <graphtyper/utilities/flat_array.hpp> // gyper::FlatArray
+#include <graphtyper/utilities/huge_page_allocator.hpp> // gyper::HugePageVector
+
+
+namespace gyper
+{
+
+uint64_t constexpr FLAT_ARCHIVE_ALIGNMENT = 64; // Arrays start on a cache line
+
+
+/**
+ * @brief Writes the same serialize() members as boost's binary_oarchive, but arrays of numbers are written as they are
+ *        in memory and aligned, so FlatIArchive can read them in place.
+ */
+class FlatOArchive
+{
+public:
+  explicit FlatOArchive(std::ostream & _os) : os(_os) {}
+
+  template <typename T>
+  FlatOArchive &
+  operator&(T const & t)
+  {
+    save(t);
+    return *this;
+  }
+
+  template <typename T>
+  FlatOArchive &
+  operator<<(T const & t)
+  {
+    save(t);
+    return *this;
+  }
+
+  uint64_t get_offset() const {return offset;}
+
+  /** \brief Pads with zeros to the next multiple of FLAT_ARCHIVE_ALIGNMENT. */
+  void align();
+
+private:
+  std::ostream & os;
+  uint64_t offset{0}; // Bytes written
+
+  void write(void const * data, uint64_t const size);
+
+  template <typename T>
+  void
+  save(T const & t)
+  {
+    save(t, std::integral_constant<bool, std::is_arithmetic<T>::value || std::is_enum<T>::value>());
+  }
+
+  template <typename T>
+  void
+  save(T const & t, std::true_type)
+  {
+    write(&t, sizeof(T));
+  }
+
+  template <typename T>
+  void
+  save(T const & t, std::false_type)
+  {
+    boost::serialization::access::serialize(*this, const_cast<T &>(t), 0u);
+  }
+
+  void
+  save(std::string const & s)
+  {
+    save(static_cast<uint64_t>(s.size()));
+    write(s.data(), s.size());
+  }
+
+  template <typename T>
+  void
+  save_array(T const * data, uint64_t const size)
+  {
+    save(size);
+    align();
+    write(data, size * sizeof(T));
+  }
+
+  template <typename T, typename TAllocator>
+  void
+  save(std::vector<T, TAllocator> const & v)
+  {
+    save(v, std::integral_constant<bool, std::is_arithmetic<T>::value>());
+  }
+
+  template <typename T, typename TAllocator>
+  void
+  save(std::vector<T, TAllocator> const & v, std::true_type)
+  {
+    save_array(v.data(), v.size());
+  }
+
+  template <typename T, typename TAllocator>
+  void
+  save(std::vector<T, TAllocator> const & v, std::false_type)
+  {
+    save(static_cast<uint64_t>(v.size()));
+
+    for (T const & item : v)
+      save(item);
+  }
+
+  template <typename T>
+  void
+  save(FlatArray<T> const & a)
+  {
+    save_array(a.data(), a.size());
+  }
+
+  template <typename TKey, typename TValue>
+  void
+  save(std::unordered_map<TKey, TValue> const & m)
+  {
+    save(static_cast<uint64_t>(m.size()));
+
+    for (auto const & key_value : m)
+    {
+      save(key_value.first);
+      save(key_value.second);
+    }
+  }
+};
+
+
+/**
+ * @brief Reads what FlatOArchive wrote from memory.
+ * @details With views, FlatArrays are views of the memory, which must then outlive them and be aligned to 8 bytes.
+ *          Otherwise every array is copied. Reading past the end is fatal.
+ */
+class FlatIArchive
+{
+public:
+  FlatIArchive(char const * _data, std::size_t const _size, bool const _is_viewing)
+    : data(_data), size(_size), is_viewing(_is_viewing)
+  {}
+
+  template <typename T>
+  FlatIArchive &
+  operator&(T & t)
+  {
+    load(t);
+    return *this;
+  }
+
+  template <typename T>
+  FlatIArchive &
+  operator>>(T & t)
+  {
+    load(t);
+    return *this;
+  }
+
+  uint64_t get_offset() const {return offset;}
+
+  /** \brief Skips the padding FlatOArchive::align() wrote. */
+  void align();
+
+private:
+  char const * data;
+  std::size_t const size;
+  bool const is_viewing;
+  uint64_t offset{0}; // Bytes read
+
+  char const * read(uint64_t const num_bytes); // Returns the bytes, which are not aligned
+  uint64_t read_count(); // Number of items which follow, each takes at least a byte
+
+  template <typename T>
+  void
+  load(T & t)
+  {
+    load(t, std::integral_constant<bool, std::is_arithmetic<T>::value || std::is_enum<T>::value>());
+  }
+
+  template <typename T>
+  void
+  load(T & t, std::true_type)
+  {
+    std::memcpy(&t, read(sizeof(T)), sizeof(T));
+  }
+
+  template <typename T>
+  void
+  load(T & t, std::false_type)
+  {
+    boost::serialization::access::serialize(*this, t, 0u);
+  }
+
+  void
+  load(std::string & s)
+  {
+    uint64_t const num = read_count();
+    s.assign(read(num), num);
+  }
+
+  template <typename T, typename TAllocator>
+  void
+  load(std::vector<T, TAllocator> & v)
+  {
+    load(v, std::integral_constant<bool, std::is_arithmetic<T>::value>());
+  }
+
+  template <typename T, typename TAllocator>
+  void
+  load(std::vector<T, TAllocator> & v, std::true_type)
+  {
+    uint64_t const num = read_count();
+    align();
+    char const * const bytes = read(num * sizeof(T));
+    v.resize(num);
+
+    if (num > 0)
+      std::memcpy(v.data(), bytes, num * sizeof(T));
+  }
+
+  template <typename T, typename TAllocator>
+  void
+  load(std::vector<T, TAllocator> & v, std::false_type)
+  {
+    uint64_t const num = read_count();
+    v.clear();
+    v.resize(num);
+
+    for (T & item : v)
+      load(item);
+  }
+
+  template <typename T>
+  void
+  load(FlatArray<T> & a)
+  {
+    uint64_t const num = read_count();
+    align();
+    char const * const bytes = read(num * sizeof(T));
+
+    if (is_viewing)
+    {
+      a.view(reinterpret_cast<T const *>(bytes), num);
+    }
+    else
+    {
+      HugePageVector<T> values(num);
+
+      if (num > 0)
+        std::memcpy(values.data(), bytes, num * sizeof(T));
+
+      a.assign(std::move(values));
+    }
+  }
+
+  template <typename TKey, typename TValue>
+  void
+  load(std::unordered_map<TKey, TValue> & m)
+  {
+    uint64_t const num = read_count();
+    m.clear();
+    m.reserve(num);
+
+    for (uint64_t i = 0; i < num; ++i)
+    {
+      TKey key;
+      load(key);
+      load(m[key]);
+    }
+  }
+};
+
+} // namespace gyper
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cassert> // assert
+#include <cstddef> // std::size_t
+#include <utility> // std::move
+
+#include <graphtyper/utilities/huge_page_allocator.hpp> // gyper::HugePageVector
+
+
+namespace gyper
+{
+
+/**
+ * @brief An array which either owns its elements in huge pages or is a view of elements owned by someone else, e.g. a
+ *        mapped graph file which must outlive the view.
+ * @details Views are read in place. Modifying a view copies its elements into owned memory first. Copies of a view are
+ *          views of the same elements.
+ */
+template <typename T>
+class FlatArray
+{
+public:
+  using value_type = T;
+  using const_iterator = T const *;
+
+  FlatArray() = default;
+  FlatArray(FlatArray const & a) : owned(a.owned), ptr(a.ptr), num(a.num) {point_to_owned_if(a.is_owned());}
+  FlatArray(FlatArray && a) noexcept : owned(std::move(a.owned)), ptr(a.ptr), num(a.num) {a.reset();}
+
+  FlatArray &
+  operator=(FlatArray const & a)
+  {
+    owned = a.owned;
+    ptr = a.ptr;
+    num = a.num;
+    point_to_owned_if(a.is_owned());
+    return *this;
+  }
+
+  FlatArray &
+  operator=(FlatArray && a) noexcept
+  {
+    owned = std::move(a.owned);
+    ptr = a.ptr;
+    num = a.num;
+    a.reset();
+    return *this;
+  }
+
+  T const & operator[](std::size_t const i) const {assert(i < num); return ptr[i];}
+  T const & front() const {assert(num > 0); return ptr[0];}
+  T const & back() const {assert(num > 0); return ptr[num - 1];}
+  T const * data() const {return ptr;}
+  const_iterator begin() const {return ptr;}
+  const_iterator end() const {return ptr + num;}
+  std::size_t size() const {return num;}
+  bool empty() const {return num == 0;}
+  bool is_owned() const {return ptr == owned.data();}
+
+  /** \brief Bytes owned by the array, views take none. */
+  std::size_t size_in_bytes() const {return owned.capacity() * sizeof(T);}
+
+  void
+  push_back(T const & value)
+  {
+    make_owned();
+    owned.push_back(value);
+    point_to_owned();
+  }
+
+  void
+  set(std::size_t const i, T const & value)
+  {
+    assert(i < num);
+    make_owned();
+    owned[i] = value;
+  }
+
+  template <typename TIterator>
+  void
+  assign(TIterator first, TIterator last)
+  {
+    owned.assign(first, last);
+    point_to_owned();
+  }
+
+  void
+  assign(HugePageVector<T> && values)
+  {
+    owned = std::move(values);
+    point_to_owned();
+  }
+
+  /** \brief Views 'size' elements at 'data', which must stay valid for as long as the array is used. */
+  void
+  view(T const * data, std::size_t const size)
+  {
+    owned = HugePageVector<T>();
+    ptr = data;
+    num = size;
+  }
+
+  void
+  clear()
+  {
+    owned = HugePageVector<T>();
+    point_to_owned();
+  }
+
+private:
+  HugePageVector<T> owned;
+  T const * ptr = nullptr; // Either owned.data() or a view
+  std::size_t num = 0;
+
+  void
+  point_to_owned()
+  {
+    ptr = owned.data();
+    num = owned.size();
+  }
+
+  void
+  point_to_owned_if(bool const is_owned_copy)
+  {
+    if (is_owned_copy)
+      point_to_owned();
+  }
+
+  void
+  make_owned()
+  {
+    if (!is_owned())
+      owned.assign(ptr, ptr + num);
+
+    point_to_owned();
+  }
+
+  void
+  reset()
+  {
+    owned = HugePageVector<T>();
+    point_to_owned();
+  }
+};
+
+} // namespace gyper
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory> // std::shared_ptr
+#include <vector> // std::vector
+
+#include <graphtyper/graph/absolute_position.hpp>
+#include <graphtyper/graph/graph.hpp>
+#include <graphtyper/index/mem_index.hpp>
+#include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/task_scheduler.hpp>
+
+
+namespace gyper
+{
+
+/**
+ * @brief The graph, index and options that a region is genotyped with.
+ * @details Each thread works on the context bound to it with a ContextBinding, or on the default context if none is.
+ *          Contexts bound to different threads are independent, so regions can be genotyped concurrently. Functions
+ *          which start threads bind their own context in each of them.
+ */
+class GenotypingContext
+{
+public:
+  Graph graph;
+  MemIndex mem_index;
+  AbsolutePosition absolute_pos;
+  Options options;
+
+  // Copies of 'mem_index' on each NUMA node, see place_mem_index_on_numa_nodes()
+  std::vector<std::shared_ptr<MemIndex> > numa_mem_indexes; // Each copy once
+  std::vector<MemIndex const *> node_mem_indexes; // The copy used by threads on each node
+
+  // Set when regions are genotyped concurrently, sample pools are then run as tasks of the scheduler
+  TaskScheduler * scheduler{nullptr};
+  TaskKey task_key; // What this context currently works on
+
+
+  GenotypingContext(); // Starts with the options, scheduler and task key of the current context
+  explicit GenotypingContext(Options const & _options);
+  GenotypingContext(GenotypingContext const &) = delete;
+  GenotypingContext & operator=(GenotypingContext const &) = delete;
+
+  /** \brief Frees the graph and the index, but keeps the options and contig offsets. */
+  void clear();
+};
+
+
+/** \brief The context of threads no context is bound to. Options parsed from the command line are put here. */
+GenotypingContext & default_context();
+
+/** \brief The context bound to the calling thread, or the default context. */
+GenotypingContext & current_context();
+
+
+/** \brief Binds a context to the calling thread for the lifetime of the binding. Bindings may be nested. */
+class ContextBinding
+{
+public:
+  explicit ContextBinding(GenotypingContext & context);
+  ~ContextBinding();
+  ContextBinding(ContextBinding const &) = delete;
+  ContextBinding & operator=(ContextBinding const &) = delete;
+
+private:
+  GenotypingContext * previous;
+};
+
+} // namespace gyper
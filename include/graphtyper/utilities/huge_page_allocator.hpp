@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <cstdint> // uint64_t
+#include <new> // std::bad_alloc, ::operator new
+#include <vector> // std::vector
+
+
+namespace gyper
+{
+
+std::size_t constexpr HUGE_PAGE_SIZE = 2ull << 20;
+
+/**
+ * @brief Bytes of large allocations by how they were requested, since the start of the process.
+ * @details The kernel may still back memory requested as transparent huge pages with small pages, e.g. when it has no
+ *          free huge pages. 'anon_huge_page_bytes' is how much anonymous memory of the process has huge pages right now.
+ */
+struct HugePageStats
+{
+  uint64_t hugetlb_bytes = 0; // Reserved huge pages (MAP_HUGETLB)
+  uint64_t thp_bytes = 0; // Transparent huge pages requested with madvise, while they are enabled in the kernel
+  uint64_t small_page_bytes = 0; // Huge pages were not requested or not available
+  uint64_t anon_huge_page_bytes = 0; // AnonHugePages in /proc/self/smaps
+};
+
+/**
+ * @brief Allocates 'size' bytes aligned to HUGE_PAGE_SIZE, backed as the huge_pages option asks for.
+ * @details "hugetlb" uses reserved huge pages and falls back to "thp" when there are not enough of them, "thp" asks for
+ *          transparent huge pages with madvise. Otherwise, or if the kernel does not support it, the memory has small
+ *          pages. The mapping is 'size' rounded up to HUGE_PAGE_SIZE.
+ */
+void * allocate_huge_pages(std::size_t const size);
+void free_huge_pages(void * ptr, std::size_t const size);
+HugePageStats get_huge_page_stats();
+
+
+/**
+ * @brief Allocator for large arrays which are probed at random, e.g. hash tables and graph nodes.
+ * @details Allocations of at least HUGE_PAGE_SIZE bytes are mapped by allocate_huge_pages(), each of them then needs
+ *          far fewer TLB entries. Smaller ones use operator new. Which one is used only depends on the size, so the
+ *          huge_pages option can change between allocating and freeing.
+ */
+template <typename T>
+class HugePageAllocator
+{
+public:
+  using value_type = T;
+
+  HugePageAllocator() = default;
+
+  template <typename U>
+  HugePageAllocator(HugePageAllocator<U> const &) noexcept
+  {}
+
+  T *
+  allocate(std::size_t const n)
+  {
+    if (n > static_cast<std::size_t>(-1) / sizeof(T))
+      throw std::bad_alloc();
+
+    std::size_t const size = n * sizeof(T);
+
+    if (size >= HUGE_PAGE_SIZE)
+      return static_cast<T *>(allocate_huge_pages(size));
+
+    return static_cast<T *>(::operator new(size));
+  }
+
+  void
+  deallocate(T * ptr, std::size_t const n) noexcept
+  {
+    std::size_t const size = n * sizeof(T);
+
+    if (size >= HUGE_PAGE_SIZE)
+      free_huge_pages(ptr, size);
+    else
+      ::operator delete(ptr);
+  }
+};
+
+
+template <typename T, typename U>
+inline bool
+operator==(HugePageAllocator<T> const &, HugePageAllocator<U> const &)
+{
+  return true;
+}
+
+
+template <typename T, typename U>
+inline bool
+operator!=(HugePageAllocator<T> const &, HugePageAllocator<U> const &)
+{
+  return false;
+}
+
+
+template <typename T>
+using HugePageVector = std::vector<T, HugePageAllocator<T> >;
+
+} // namespace gyper
@@ -22,23 +22,39 @@ template <typename TSequence>
 uint32_t read_offset(TSequence const & dna);
 
 template <typename TSeq>
-std::vector<KmerLabel>
-query_index_for_first_kmer(TSeq const & read, MemIndex const & _mem_index = gyper::mem_index);
+std::vector<PackedKmerLabel>
+query_index_for_first_kmer(TSeq const & read, MemIndex const & _mem_index);
 
 template <typename TSeq>
-std::vector<KmerLabel>
-query_index_for_last_kmer(TSeq const & read, MemIndex const & _mem_index = gyper::mem_index);
+std::vector<PackedKmerLabel>
+query_index_for_last_kmer(TSeq const & read, MemIndex const & _mem_index);
 
+/** \brief Gets the keys of each seed of a read, seeds start every K - 1 bases. */
 template <typename TSeq>
-std::vector<std::vector<KmerLabel> >
-query_index(TSeq const & read, gyper::MemIndex const & mem_index = gyper::mem_index);
+std::vector<std::vector<TKmerKey> >
+get_seed_keys(TSeq const & read);
 
 template <typename TSeq>
-std::vector<std::vector<KmerLabel> >
-query_index_hamming_distance1(TSeq const & read, gyper::MemIndex const & mem_index = gyper::mem_index);
+TPackedKmerLabels
+query_index(TSeq const & read, gyper::MemIndex const & mem_index);
+
+TPackedKmerLabels
+query_index(std::vector<std::vector<TKmerKey> > const & seed_keys, gyper::MemIndex const & mem_index);
 
 template <typename TSeq>
-std::vector<std::vector<KmerLabel> >
-query_index_hamming_distance1_without_index(TSeq const & read, gyper::MemIndex const & mem_index = gyper::mem_index);
+TPackedKmerLabels
+query_index_hamming_distance1(TSeq const & read, gyper::MemIndex const & mem_index);
+
+TPackedKmerLabels
+query_index_hamming_distance1(std::vector<std::vector<TKmerKey> > const & seed_keys,
+                              gyper::MemIndex const & mem_index);
+
+template <typename TSeq>
+TPackedKmerLabels
+query_index_hamming_distance1_without_index(TSeq const & read, gyper::MemIndex const & mem_index);
+
+TPackedKmerLabels
+query_index_hamming_distance1_without_index(std::vector<std::vector<TKmerKey> > const & seed_keys,
+                                            gyper::MemIndex const & mem_index);
 
 } // namespace gyper
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array> // std::array
+#include <cstddef> // std::size_t
+#include <cstdint> // uint8_t, uint64_t
+#include <functional> // std::hash
+#include <type_traits> // std::conditional
+
+#include <graphtyper/constants.hpp> // gyper::K
+
+
+namespace gyper
+{
+
+__extension__ typedef unsigned __int128 TUint128; // Keys of k-mers with more than 32 bases
+
+/**
+ * @brief Keys of k-mers with 'k' bases, two bits per base (A=0, C=1, G=2, T=3) with the first base most significant.
+ * @details K-mers of up to 32 bases have 64 bit keys and k-mers of up to 64 bases have 128 bit keys. The index uses
+ *          the keys of the K of the build, which is set with GYPER_KMER_SIZE when configuring.
+ */
+template <unsigned k>
+struct KmerKey
+{
+  static_assert(k > 0 && k <= 64, "K-mers have at most 64 bases.");
+
+  using Type = typename std::conditional<(k <= 32), uint64_t, TUint128>::type;
+  static unsigned constexpr NUM_BITS = 8 * sizeof(Type);
+  static unsigned constexpr NUM_HAMMING1 = 3 * k; // Number of keys with a single mismatch
+
+  static constexpr Type mask() {return ~static_cast<Type>(0) >> (NUM_BITS - 2 * k);}
+
+  /** \brief Adds the base 'code' after the last base of 'key', dropping its first base. */
+  static constexpr Type
+  push_back(Type const key, uint8_t const code)
+  {
+    return ((key << 2) | code) & mask();
+  }
+
+  /** \brief The key of the 'k' 2-bit codes starting at 'first'. */
+  template <typename TCodes>
+  static Type
+  from_codes(TCodes const & codes, std::size_t const first)
+  {
+    Type key = 0;
+
+    for (std::size_t j = first; j < first + k; ++j)
+      key = (key << 2) | codes[j];
+
+    return key;
+  }
+
+  /**
+   * \brief All keys with a single mismatching base to 'key'.
+   * \details Ordered by the position of the mismatch from the last base, and then by the XOR of the base (1, 2, 3).
+   */
+  static std::array<Type, NUM_HAMMING1>
+  hamming_distance1(Type const key)
+  {
+    std::array<Type, NUM_HAMMING1> neighbours;
+
+    for (unsigned bb = 0; bb < k; ++bb)
+    {
+      neighbours[bb * 3 + 0] = (static_cast<Type>(1) << (bb * 2)) ^ key;
+      neighbours[bb * 3 + 1] = (static_cast<Type>(2) << (bb * 2)) ^ key;
+      neighbours[bb * 3 + 2] = (static_cast<Type>(3) << (bb * 2)) ^ key;
+    }
+
+    return neighbours;
+  }
+};
+
+
+using TKmerKey = KmerKey<K>::Type; // Keys of the k-mers in the index
+using THamming1Keys = std::array<TKmerKey, KmerKey<K>::NUM_HAMMING1>;
+
+
+/** \brief The 64 bits of a key which are hashed, the high half of a 128 bit key is multiplied into its low half. */
+inline uint64_t
+fold_key(uint64_t const key)
+{
+  return key;
+}
+
+
+inline uint64_t
+fold_key(TUint128 const key)
+{
+  return static_cast<uint64_t>(key) ^ (static_cast<uint64_t>(key >> 64) * 0x9e3779b97f4a7c15ULL);
+}
+
+
+/** \brief Hashes keys in standard containers, the standard library has no hash of 128 bit integers. */
+struct KmerKeyHash
+{
+  std::size_t operator()(TKmerKey const key) const {return std::hash<uint64_t>()(fold_key(key));}
+};
+
+} // namespace gyper
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <string> // std::string
+
+
+namespace gyper
+{
+
+/**
+ * @brief A file mapped read-only into memory.
+ * @details The pages are read from disk on first access and shared through the page cache by every process which maps
+ *          the same file.
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(MappedFile const &) = delete;
+  MappedFile & operator=(MappedFile const &) = delete;
+
+  /** \brief Maps the file at 'path', returns false if it cannot be opened or mapped. */
+  bool open(std::string const & path);
+  void close();
+
+  char const * data() const {return ptr;}
+  std::size_t size() const {return length;}
+  bool is_open() const {return ptr != nullptr;}
+
+private:
+  char const * ptr = nullptr;
+  std::size_t length = 0;
+};
+
+} // namespace gyper
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <vector> // std::vector
+
+#include <sched.h> // cpu_set_t
+
+
+namespace gyper
+{
+
+/**
+ * @brief CPUs of each NUMA node of the host, read from sysfs once.
+ * @details A host without NUMA information has a single node with the CPUs this process may run on.
+ */
+std::vector<std::vector<int> > const & get_numa_node_cpus();
+
+long get_num_numa_nodes();
+
+/** \brief Restricts the calling thread to the CPUs of 'node', returns false if that is not possible. */
+bool pin_thread_to_numa_node(long const node);
+
+/** \brief The node the calling thread was pinned to, or -1 if it was not pinned. */
+long get_thread_numa_node();
+
+
+/**
+ * @brief Pins the calling thread to a NUMA node while it is in scope.
+ * @details The CPUs the thread could run on and the node it was pinned to are restored on destruction, so a thread
+ *          which runs a pool and then goes on with other work (and the threads it creates later) is not left on the
+ *          CPUs of one node.
+ */
+class ScopedNumaPin
+{
+public:
+  explicit ScopedNumaPin(long const node);
+  ~ScopedNumaPin();
+  ScopedNumaPin(ScopedNumaPin const &) = delete;
+  ScopedNumaPin & operator=(ScopedNumaPin const &) = delete;
+
+  bool is_pinned() const {return pinned;}
+
+private:
+  cpu_set_t saved_cpus;
+  long saved_node = -1;
+  bool pinned = false;
+};
+
+
+/**
+ * @brief Anonymous memory whose pages are placed on a single NUMA node or interleaved across all of them.
+ * @details The placement is set with mbind before the pages are first touched. Kernels without NUMA support ignore it,
+ *          then the pages are placed on the node of the thread which first writes them.
+ */
+class NumaBuffer
+{
+public:
+  static long constexpr INTERLEAVE = -1;
+
+  NumaBuffer(std::size_t const size, long const node);
+  ~NumaBuffer();
+  NumaBuffer(NumaBuffer const &) = delete;
+  NumaBuffer & operator=(NumaBuffer const &) = delete;
+
+  char * data() const {return ptr;}
+  std::size_t size() const {return length;}
+  bool is_placed() const {return placed;} /** \brief Whether the kernel accepted the placement. */
+
+private:
+  char * ptr = nullptr;
+  std::size_t length = 0;
+  bool placed = false;
+};
+
+} // namespace gyper
@@ -15,6 +15,8 @@
 namespace gyper
 {
 
+class GenotypingContext;
+
 class Options
 {
 public:
@@ -53,6 +55,14 @@ public:
    * INDEXING OPTIONS *
    ********************/
   uint64_t max_index_labels{32};
+  bool hamming1_index{false}; // Look up k-mers with one mismatch in a split-key index instead of probing 3 * K neighbours
+  bool syncmer_seeds{false}; // Seed reads with closed syncmers and fall back to seeds every K - 1 bases if too few hit
+  long max_index_memory{0}; // MB of labels to buffer when writing an index to disk before spilling sorted runs, 0 is 2048
+  bool flat_index{false}; // Also write a flat index file when writing an index to disk, typing maps it in place
+  std::string shared_index = ""; // Name of a segment to share the graph and index with other processes on the host
+  long index_memory_budget{0}; // MB an index loaded for typing may use, larger ones are queried on disk, 0 is no limit
+  std::string numa_index = ""; // "replicate" the index on each NUMA node or "interleave" it, and pin pools to nodes
+  std::string huge_pages = ""; // "thp" or "hugetlb" to back large graph and index arrays with 2 MiB pages
 
   /*******************
    * CALLING OPTIONS *
@@ -84,17 +94,18 @@ public:
   /***********
    * METHODS *
    ***********/
-  static Options * instance(); // Gets the only instance (singleton pattern)
+  static Options * instance(); // Gets the options of the current genotyping context
   static const Options * const_instance(); // const version of instance()
   void print();
 
 
 private:
-  Options(); // Prevent construction of new instances
-  Options(Options const &); // Prevent copy-construction
-  Options & operator=(Options const &); // Prevent copy-assignment
+  Options(); // Only genotyping contexts have options
+  Options(Options const &) = default;
+  Options & operator=(Options const &) = default;
 
-  static Options * _instance;
+  friend class GenotypingContext;
+  friend GenotypingContext & default_context();
 };
 
 } // namespace gyper
@@ -0,0 +1,18 @@
+#pragma once
+
+
+namespace gyper
+{
+
+/** \brief Hints the CPU to fetch the cache line of 'address' for reading. Does nothing on unknown compilers. */
+inline void
+prefetch(void const * address)
+{
+#ifdef __GNUC__
+  __builtin_prefetch(address, 0 /*read*/, 3 /*keep in all cache levels*/);
+#else
+  (void)address;
+#endif
+}
+
+} // namespace gyper
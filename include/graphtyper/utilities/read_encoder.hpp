@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint> // uint8_t, uint64_t
+#include <utility> // std::pair
+#include <vector> // std::vector
+
+#include <seqan/sequence.h>
+
+#include <graphtyper/utilities/kmer_key.hpp>
+
+
+namespace gyper
+{
+
+/**
+ * @brief A read in 2-bit codes, decoded directly from the 4-bit sequence of a BAM record.
+ * @details The decoding uses AVX2 or SSSE3 shuffles when the CPU supports them (selected at runtime) and a table
+ *          lookup otherwise. Bases which are not A, C, G or T (N and other IUPAC codes) are flagged in the ambiguity
+ *          mask, only seeds covering one of those are expanded from the IUPAC sequence.
+ */
+class EncodedRead
+{
+public:
+  long length = 0;
+  std::vector<uint8_t> codes; /** \brief 2-bit code of each base, A=0, C=1, G=2, T=3 and 0 if ambiguous. */
+  std::vector<uint64_t> ambiguous; /** \brief Bit j%64 of word j/64 is set if base j is ambiguous. */
+
+  EncodedRead() = default;
+
+  /** \brief Decodes 'bam_seq' (as returned by bam_get_seq) of a read with 'length' bases. */
+  void encode(uint8_t const * bam_seq, long const length);
+
+  /** \brief Checks if any base in [first, first + count) is ambiguous. */
+  bool has_ambiguous(long const first, long const count) const;
+
+  /** \brief The K-mer starting at 'first' in the read. */
+  TKmerKey key(long const first) const;
+
+  /** \brief The K-mer starting at 'first' in the reverse complement of the read. */
+  TKmerKey reverse_complement_key(long const first) const;
+};
+
+
+/**
+ * @brief Gets the keys of each seed of a read, seeds start every K - 1 bases (as in to_uint64_vec()).
+ * @param encoded The read encoded from its BAM record.
+ * @param is_reverse_complement Set to get the seeds of the reverse complement of the read.
+ * @param read The IUPAC sequence of the read in the same orientation, used for seeds with ambiguous bases.
+ */
+std::vector<std::vector<TKmerKey> >
+get_seed_keys(EncodedRead const & encoded, bool const is_reverse_complement, seqan::IupacString const & read);
+
+long constexpr SYNCMER_S = 16; // Length of the s-mers which select syncmers
+
+/**
+ * @brief Gets the closed syncmers of a read, the K-mers whose smallest s-mer is their first or last s-mer.
+ * @details If a K-mer is a syncmer only depends on the K-mer itself, so a syncmer of a read is also a syncmer where it
+ *          is in the graph and the index needs no change for them. s-mers are compared by a hash so low complexity
+ *          s-mers are not favoured. K-mers with ambiguous bases are skipped.
+ * @return Pairs of the start of each syncmer in the read (in the given orientation) and its key.
+ */
+std::vector<std::pair<long, TKmerKey> >
+get_syncmer_seeds(EncodedRead const & encoded, bool const is_reverse_complement);
+
+/** \brief Name of the decoder selected for this CPU, "avx2", "ssse3" or "scalar". */
+char const * get_read_encoder_name();
+
+} // namespace gyper
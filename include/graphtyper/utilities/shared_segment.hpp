@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <functional> // std::function
+#include <string> // std::string
+
+
+namespace gyper
+{
+
+/**
+ * @brief Memory shared read-only between processes on a host, backed by a file in shared memory or on hugetlbfs.
+ * @details Every process using a segment holds a shared lock on it, so the kernel keeps the reference count and drops
+ *          the lock of a process which dies. The last process to close the segment removes it. A segment is
+ *          written under a temporary name and then linked to its name, so an existing name is always complete.
+ */
+class SharedSegment
+{
+public:
+  SharedSegment() = default;
+  ~SharedSegment();
+  SharedSegment(SharedSegment const &) = delete;
+  SharedSegment & operator=(SharedSegment const &) = delete;
+
+  /**
+   * \brief Path of the segment called 'name'.
+   * \details A name without slashes is a POSIX shared memory object in /dev/shm, other names are paths, e.g. of a
+   *          file on a hugetlbfs mount.
+   */
+  static std::string get_path(std::string const & name);
+
+  /** \brief Opens the segment at 'path', returns false if there is none. */
+  bool open(std::string const & path);
+
+  /**
+   * \brief Creates a segment of 'size' bytes, which 'write' fills, and publishes it at 'path'.
+   * \details If another process published a segment at 'path' first, this one is still usable but not shared.
+   */
+  bool create(std::string const & path, std::size_t const size, std::function<void(char * data)> const & write);
+
+  /** \brief Removes the segment if no other process uses it and closes it, returns true if it was removed. */
+  bool remove_if_unused();
+  void close();
+
+  char const * data() const {return ptr;}
+  std::size_t size() const {return length;}
+
+private:
+  std::string path; // Empty if the segment is not published
+  int fd = -1;
+  char * ptr = nullptr;
+  std::size_t length = 0;
+
+  bool is_published() const;
+  void unmap();
+};
+
+} // namespace gyper
@@ -30,4 +30,8 @@ check_file_exists_or_empty(std::string const & filename);
 bool
 is_directory(std::string const & filename);
 
+/** \brief Size of the file in bytes, 0 if it does not exist. */
+long
+get_file_size(std::string const & filename);
+
 } // namespace gyper
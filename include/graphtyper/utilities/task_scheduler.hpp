@@ -0,0 +1,113 @@
+#pragma once
+
+#include <condition_variable> // std::condition_variable
+#include <cstdint> // uint64_t
+#include <deque> // std::deque
+#include <functional> // std::function
+#include <memory> // std::unique_ptr
+#include <mutex> // std::mutex
+#include <string> // std::string
+#include <thread> // std::thread
+#include <vector> // std::vector
+
+
+namespace gyper
+{
+
+/** \brief What a task of the genotyping pipeline works on, -1 where it does not apply. */
+struct TaskKey
+{
+  long region{-1};
+  long iteration{-1};
+  long pool{-1};
+
+  std::string to_string() const;
+};
+
+
+/**
+ * @brief Runs tasks with dependencies on a fixed number of threads, idle threads steal tasks of busy ones.
+ * @details Each thread has a deque of ready tasks. A thread runs the oldest task of its own deque and, when it has
+ *          none, steals the oldest task of another thread. Tasks become ready on the thread which finished their last
+ *          dependency, so a region's next step tends to stay on the thread with its data. A task which opens files
+ *          only starts if the files fit within max_files_open with the files of the running tasks. Leaf tasks, those
+ *          never wait themselves, are taken before other tasks, so idle threads help with the pools, merges and
+ *          indexing of started regions before starting a new region. A thread waiting for tasks runs leaf tasks
+ *          meanwhile. Tasks take seconds to hours, so one lock guards all the deques.
+ */
+class TaskScheduler
+{
+public:
+  using TaskId = long;
+
+  /** \brief Starts 'num_threads' - 1 threads, the thread calling wait_all() is the last one. */
+  TaskScheduler(long num_threads, long max_files_open);
+  TaskScheduler(TaskScheduler const &) = delete;
+  TaskScheduler & operator=(TaskScheduler const &) = delete;
+  ~TaskScheduler(); // Waits for all tasks and stops the threads
+
+  /**
+   * \brief Adds a task which is run after all 'dependencies' have finished. May be called from within tasks.
+   * \param num_files The number of files the task keeps open at the same time.
+   * \param is_leaf Set if the task never waits for other tasks.
+   */
+  TaskId add_task(std::function<void()> work,
+                  TaskKey const & key,
+                  std::vector<TaskId> const & dependencies = std::vector<TaskId>(),
+                  long num_files = 0,
+                  bool is_leaf = true);
+
+  /** \brief Runs leaf tasks until all of 'task_ids' have finished. */
+  void wait(std::vector<TaskId> const & task_ids);
+
+  /** \brief Runs tasks on the calling thread until all tasks have finished. */
+  void wait_all();
+
+  std::string to_string() const; /** \brief Tasks and busy time of each thread and the most files open. */
+
+private:
+  enum class TaskState
+  {
+    WAITING, // For some dependency to finish
+    READY,
+    RUNNING,
+    DONE
+  };
+
+  struct Task
+  {
+    std::function<void()> work;
+    TaskKey key;
+    long num_files{0};
+    bool is_leaf{true};
+    TaskState state{TaskState::WAITING};
+    long num_dependencies_left{0};
+    std::vector<TaskId> dependents; // Tasks waiting for this one
+  };
+
+  struct ThreadStats
+  {
+    uint64_t num_tasks{0};
+    double busy_seconds{0.0};
+  };
+
+  long const num_threads;
+  long const max_files_open;
+  mutable std::mutex mutex;
+  std::condition_variable task_changed; // Notified when a task becomes ready or finishes
+  std::vector<std::unique_ptr<Task> > tasks; // Indexed by TaskId
+  std::vector<std::deque<TaskId> > ready; // Ready tasks of each thread
+  std::vector<ThreadStats> thread_stats;
+  std::vector<std::thread> threads;
+  long num_done{0};
+  long files_open{0};
+  long max_files_opened{0};
+  bool is_stopping{false};
+
+  long get_thread_index() const;
+  bool take_task(long const thread_index, bool const leaf_only, TaskId & task_id);
+  void run_task(std::unique_lock<std::mutex> & lock, long const thread_index, TaskId const task_id);
+  void run_thread(long const thread_index);
+};
+
+} // namespace gyper
@@ -9,6 +9,7 @@
 #include <seqan/sequence.h>
 
 #include <graphtyper/constants.hpp>
+#include <graphtyper/utilities/kmer_key.hpp> // gyper::THamming1Keys
 
 
 namespace gyper
@@ -19,31 +20,26 @@ static const uint64_t C_VALUE = 0x0000000000000001ULL; /** \brief 'C' is represe
 static const uint64_t G_VALUE = 0x0000000000000002ULL; /** \brief 'G' is represented by '10'. */
 static const uint64_t T_VALUE = 0x0000000000000003ULL; /** \brief 'T' is represented by '11'. */
 
-static const uint64_t A_LAST_VALUE = 0x0000000000000000ULL; /** \brief 0 is hex for 0000. */
-static const uint64_t C_LAST_VALUE = 0x4000000000000000ULL; /** \brief 4 is hex for 0100. */
-static const uint64_t G_LAST_VALUE = 0x8000000000000000ULL; /** \brief 8 is hex for 1000. */
-static const uint64_t T_LAST_VALUE = 0xC000000000000000ULL; /** \brief C is hex for 1100. */
-
 /**
  * @brief Converts a string/list of DNA bases to a unsigned 64 bit integer.
  *
  * @param s String of DNA bases.
- * @return The new unsigned 64 bit integer.
+ * @return The new unsigned 64 bit integer, or the key of the K-mer if 'K' bases are converted.
  */
 uint64_t to_uint64(char const c);
-uint64_t to_uint64(std::vector<char> const & s);
-uint64_t to_uint64(seqan::DnaString const & s, std::size_t i);
+TKmerKey to_uint64(std::vector<char> const & s);
+TKmerKey to_uint64(seqan::DnaString const & s, std::size_t i);
 
 uint16_t to_uint16(char const c);
 uint16_t to_uint16(std::vector<char> const & s, std::size_t i);
 
 template <typename TSeq>
-std::vector<uint64_t> to_uint64_vec(TSeq const & s, std::size_t i);
-std::array<uint64_t, 96> to_uint64_vec_hamming_distance_1(uint64_t const key);
+std::vector<TKmerKey> to_uint64_vec(TSeq const & s, std::size_t i);
+THamming1Keys to_uint64_vec_hamming_distance_1(TKmerKey const key);
 
-seqan::String<seqan::Dna> to_dna(uint64_t const & d, uint8_t k = K);
-std::array<uint64_t, 3> get_mismatches_of_last_base(uint64_t const d);
-std::array<uint64_t, 3> get_mismatches_of_first_base(uint64_t const d);
+seqan::String<seqan::Dna> to_dna(TKmerKey const & d, uint8_t k = K);
+std::array<TKmerKey, 3> get_mismatches_of_last_base(TKmerKey const d);
+std::array<TKmerKey, 3> get_mismatches_of_first_base(TKmerKey const d);
 
 /**
  * @brief Inserts all elements from one map to another and optionally deletes the elements from the old map.
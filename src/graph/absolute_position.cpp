@@ -75,12 +75,10 @@ AbsolutePosition::get_contig_position(uint32_t const absolute_position, Graph co
   auto offset_it = std::lower_bound(offsets.begin(), offsets.end(), absolute_position);
   long const i = std::distance(offsets.begin(), offset_it);
   assert(i > 0);
-  assert(i <= static_cast<long>(gyper::graph.contigs.size()));
+  assert(i <= static_cast<long>(graph.contigs.size()));
   return std::make_pair<std::string, uint32_t>(std::string(graph.contigs[i - 1].name),
                                                absolute_position - offsets[i - 1]);
 }
 
 
-AbsolutePosition absolute_pos;
-
 } // namespace gyper
@@ -12,6 +12,7 @@
 #include <graphtyper/graph/graph_serialization.hpp>
 #include <graphtyper/graph/constructor.hpp>
 #include <graphtyper/graph/var_record.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/options.hpp>
 #include <graphtyper/utilities/gzstream.hpp>
 
@@ -153,8 +154,9 @@ get_chrom_idx(seqan::FaiIndex const & fasta_index, std::string const & chrom)
 void
 append_sv_tag_to_node(std::vector<char> & alt)
 {
+  gyper::Graph const & graph = gyper::current_context().graph;
   std::ostringstream ss;
-  ss << "<SV:" << std::setw(7) << std::setfill('0') << gyper::graph.SVs.size() << ">";
+  ss << "<SV:" << std::setw(7) << std::setfill('0') << graph.SVs.size() << ">";
   std::string sv_id = ss.str();
   std::move(sv_id.begin(), sv_id.end(), std::back_inserter(alt));
 }
@@ -178,6 +180,8 @@ open_tabix(seqan::Tabix & tabix_file,
 void
 open_reference_genome(seqan::FaiIndex & fasta_index, std::string const & fasta_filename)
 {
+  gyper::Graph & graph = gyper::current_context().graph;
+
   // Read contigs and add them to the graph
   {
     std::ifstream f(fasta_filename + std::string(".fai"));
@@ -195,7 +199,7 @@ open_reference_genome(seqan::FaiIndex & fasta_index, std::string const & fasta_f
       gyper::Contig new_contig;
       ss >> new_contig.name;
       ss >> new_contig.length;
-      gyper::graph.contigs.push_back(std::move(new_contig));
+      graph.contigs.push_back(std::move(new_contig));
     }
   }
 
@@ -203,7 +207,7 @@ open_reference_genome(seqan::FaiIndex & fasta_index, std::string const & fasta_f
   {
     uint64_t sum = 0;
 
-    for (gyper::Contig const & contig : gyper::graph.contigs)
+    for (gyper::Contig const & contig : graph.contigs)
       sum += contig.length;
 
     if (sum > 0x00000000FFFFFFFFull)
@@ -256,7 +260,7 @@ read_reference_graph(std::vector<char> const & prefix,
                      uint32_t length
                      )
 {
-  uint32_t const abs_begin = gyper::absolute_pos.get_absolute_position(chr, begin);
+  uint32_t const abs_begin = gyper::current_context().absolute_pos.get_absolute_position(chr, begin);
   return sv_graph.get_all_sequences_of_length(abs_begin, length, prefix);
 }
 
@@ -338,6 +342,8 @@ add_sv_breakend(SV & sv,
                 uint32_t const EXTRA_SEQUENCE_LENGTH
                 )
 {
+  Graph & graph = current_context().graph;
+
   // Read the first matching reference base
   read_reference_seq(var.ref, fasta_index, chrom_idx, var.pos, 1);
 
@@ -486,6 +492,8 @@ add_sv_deletion(SV & sv,
                 uint32_t const EXTRA_SEQUENCE_LENGTH
                 )
 {
+  Graph & graph = current_context().graph;
+
   // Read the first matching reference base
   read_reference_seq(var.ref, fasta_index, chrom_idx, var.pos, 1);
 
@@ -528,6 +536,7 @@ add_sv_insertion(SV & sv,
                  uint32_t const EXTRA_SEQUENCE_LENGTH
                  )
 {
+  Graph & graph = current_context().graph;
   assert(seqan::length(vcf_record.ref) >= 1);
 
   if (static_cast<char>(vcf_record.ref[0]) != 'N')
@@ -766,6 +775,8 @@ add_sv_duplication(std::vector<VarRecord> & var_records,
                    uint32_t const EXTRA_SEQUENCE_LENGTH
                    )
 {
+  Graph & graph = current_context().graph;
+
   // Read the first matching reference base
   read_reference_seq(var.ref, fasta_index, chrom_idx, var.pos, 1);
 
@@ -915,6 +926,8 @@ add_sv_inversion(std::vector<VarRecord> & var_records,
                  uint32_t const EXTRA_SEQUENCE_LENGTH
                  )
 {
+  Graph & graph = current_context().graph;
+
   // Read the first matching reference base
   read_reference_seq(var.ref, fasta_index, chrom_idx, var.pos, 1);
 
@@ -1546,13 +1559,16 @@ add_var_record(std::vector<VarRecord> & var_records,
 
 
 void
-construct_graph(std::string const & reference_filename,
+construct_graph(GenotypingContext & context,
+                std::string const & reference_filename,
                 std::string const & vcf_filename,
                 std::string const & region,
                 bool const is_sv_graph,
                 bool const use_absolute_positions,
                 bool const check_index)
 {
+  ContextBinding binding(context); // The helpers above work on the bound context
+  Graph & graph = context.graph;
   graph = Graph(use_absolute_positions);
   graph.is_sv_graph = is_sv_graph;
 
@@ -1570,7 +1586,7 @@ construct_graph(std::string const & reference_filename,
   // Load the reference genome
   seqan::FaiIndex fasta_index;
   open_reference_genome(fasta_index, reference_filename);
-  absolute_pos.calculate_offsets(graph);
+  context.absolute_pos.calculate_offsets(graph);
 
   // Read the reference sequence
   std::vector<char> reference_sequence;
@@ -1701,16 +1717,37 @@ construct_graph(std::string const & reference_filename,
   if (!graph.check())
   {
     BOOST_LOG_TRIVIAL(error) << "[graphtyper::graph] Problem creating graph. Printing graph:";
-    gyper::graph.print();
+    graph.print();
     std::exit(1);
   }
 #endif // NDEBUG
 
-  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::constructor] Graph was successfully constructed.";
+  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::constructor] Graph was successfully constructed. Its "
+                           << graph.ref_nodes.size() << " reference and " << graph.var_nodes.size()
+                           << " variant nodes use "
+                           << (graph.ref_nodes.size_in_bytes() + graph.var_nodes.size_in_bytes()) << " bytes.";
 
   // Create all specials positions
   graph.create_special_positions();
 }
 
 
+void
+construct_graph(std::string const & reference_filename,
+                std::string const & vcf_filename,
+                std::string const & region,
+                bool const is_sv_graph,
+                bool const use_absolute_positions,
+                bool const check_index)
+{
+  construct_graph(current_context(),
+                  reference_filename,
+                  vcf_filename,
+                  region,
+                  is_sv_graph,
+                  use_absolute_positions,
+                  check_index);
+}
+
+
 } // namespace gyper
@@ -9,6 +9,8 @@
 #include <graphtyper/graph/absolute_position.hpp>
 #include <graphtyper/graph/genomic_region.hpp>
 #include <graphtyper/graph/var_record.hpp>
+#include <graphtyper/utilities/flat_archive.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp> // gyper::current_context
 
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
@@ -169,35 +171,35 @@ GenomicRegion::to_string() const
 uint32_t
 GenomicRegion::get_absolute_begin_position() const
 {
-  return absolute_pos.get_absolute_position(chr, begin + 1);
+  return current_context().absolute_pos.get_absolute_position(chr, begin + 1);
 }
 
 
 uint32_t
 GenomicRegion::get_absolute_end_position() const
 {
-  return absolute_pos.get_absolute_position(chr, end + 1);
+  return current_context().absolute_pos.get_absolute_position(chr, end + 1);
 }
 
 
 uint32_t
 GenomicRegion::get_absolute_position(std::string const & chromosome, uint32_t contig_position) const
 {
-  return absolute_pos.get_absolute_position(chromosome, contig_position);
+  return current_context().absolute_pos.get_absolute_position(chromosome, contig_position);
 }
 
 
 uint32_t
 GenomicRegion::get_absolute_position(uint32_t contig_position) const
 {
-  return absolute_pos.get_absolute_position(chr, contig_position);
+  return current_context().absolute_pos.get_absolute_position(chr, contig_position);
 }
 
 
 std::pair<std::string, uint32_t>
 GenomicRegion::get_contig_position(uint32_t absolute_position, Graph const & graph) const
 {
-  return absolute_pos.get_contig_position(absolute_position, graph);
+  return current_context().absolute_pos.get_contig_position(absolute_position, graph);
 }
 
 
@@ -272,6 +274,8 @@ template void GenomicRegion::serialize<boost::archive::binary_iarchive>(boost::a
                                                                         const unsigned int);
 template void GenomicRegion::serialize<boost::archive::binary_oarchive>(boost::archive::binary_oarchive &,
                                                                         const unsigned int);
+template void GenomicRegion::serialize<FlatIArchive>(FlatIArchive &, const unsigned int);
+template void GenomicRegion::serialize<FlatOArchive>(FlatOArchive &, const unsigned int);
 
 } // namespace gyper
 
@@ -8,10 +8,6 @@
 #include <seqan/sequence.h>
 #include <seqan/stream.h>
 
-#include <boost/archive/binary_oarchive.hpp>
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/serialization/vector.hpp>
-#include <boost/serialization/unordered_map.hpp>
 #include <boost/log/trivial.hpp>
 
 #include <graphtyper/graph/graph.hpp>
@@ -21,6 +17,7 @@
 #include <graphtyper/graph/sv.hpp>
 #include <graphtyper/typer/path.hpp>
 #include <graphtyper/typer/variant.hpp>
+#include <graphtyper/utilities/flat_archive.hpp>
 #include <graphtyper/utilities/type_conversions.hpp>
 #include <graphtyper/utilities/options.hpp>
 
@@ -48,9 +45,11 @@ Graph::clear()
   reference.clear();
   ref_nodes.clear();
   var_nodes.clear();
+  position_index.clear();
   ref_reach_to_special_pos.clear();
   ref_reach_poses.clear();
   actual_poses.clear();
+  mapping.reset(); // After the views of it are cleared
 
   reference_offset = 0;
   use_absolute_positions = true;
@@ -328,24 +327,27 @@ Graph::add_genomic_region(std::vector<char> && reference_sequence,
 
     while (ref_nodes[r].out_degree() != 0)
     {
-      ref_nodes[r].change_label_order(offset);
+      ref_nodes.change_label_order(r, offset);
 
       for (auto v : ref_nodes[r].get_vars())
       {
-        var_nodes[v].change_label_order(offset);
+        var_nodes.change_label_order(v, offset);
       }
 
       ++r;
     }
 
-    ref_nodes[r].change_label_order(offset);
+    ref_nodes.change_label_order(r, offset);
   }
 
   // Keep the reference_sequence
-  reference = std::move(reference_sequence);
+  reference.assign(reference_sequence.begin(), reference_sequence.end());
 
   // Set offset
   reference_offset = genomic_region.begin;
+
+  // The orders of the reference nodes are final
+  position_index.build(ref_nodes);
 }
 
 
@@ -387,7 +389,8 @@ Graph::get_all_ref() const
 void
 Graph::generate_reference_genome()
 {
-  reference = get_all_ref();
+  std::vector<char> const all_ref = get_all_ref();
+  reference.assign(all_ref.begin(), all_ref.end());
   reference_offset = genomic_region.begin;
 }
 
@@ -568,6 +571,7 @@ Graph::serialize(Archive & ar, const unsigned int /*version*/)
   ar & ref_reach_to_special_pos;
   ar & SVs;
   ar & contigs;
+  ar & position_index;
 }
 
 
@@ -582,16 +586,10 @@ void
 Graph::add_variants(VarRecord && record)
 {
   // Create a nodes for the reference and the alternative variants
-  {
-    Label reference_label(record.pos, std::move(record.ref), 0);
-    var_nodes.push_back(VarNode(std::move(reference_label), ref_nodes.size()));
-  }
+  var_nodes.push_back(record.pos, record.ref, 0, ref_nodes.size());
 
   for (long i = 0; i < static_cast<long>(record.alts.size()); ++i)
-  {
-    Label alternative_label(record.pos, std::move(record.alts[i]), i + 1);
-    var_nodes.push_back(VarNode(std::move(alternative_label), ref_nodes.size()));
-  }
+    var_nodes.push_back(record.pos, record.alts[i], static_cast<uint16_t>(i + 1), ref_nodes.size());
 }
 
 
@@ -607,7 +605,7 @@ Graph::add_reference(unsigned end_pos, unsigned const & num_var, std::vector<cha
 
   if (var_nodes.size() > 0)
   {
-    Label const & previous_var_label = var_nodes.at(ref_nodes.back().get_var_index(0)).get_label();
+    Label const previous_var_label = var_nodes.at(ref_nodes.back().get_var_index(0)).get_label();
     start_pos = previous_var_label.order + previous_var_label.dna.size();
   }
 
@@ -617,15 +615,8 @@ Graph::add_reference(unsigned end_pos, unsigned const & num_var, std::vector<cha
                                 reference_sequence.begin() + (end_pos - genomic_region.begin)
                                 );
 
-  // Create a vector of indexes
-  std::vector<TNodeIndex> var_indexes(num_var);
-
-  for (unsigned i = 0; i < num_var; ++i)
-  {
-    var_indexes[i] = i + var_nodes.size();
-  }
-
-  ref_nodes.push_back(RefNode(Label(start_pos, std::move(current_dna), 0), std::move(var_indexes)));
+  // The variants of the node are added next
+  ref_nodes.push_back(start_pos, current_dna, var_nodes.size(), num_var);
 }
 
 
@@ -960,68 +951,62 @@ Graph::get_locations_of_an_actual_position(uint32_t pos, Path const & path, bool
     return locs;
   }
 
-  for (uint32_t r = 1; r <= ref_nodes.size(); ++r)
-  {
-    if (r < ref_nodes.size() && ref_nodes[r].get_label().order <= pos)
-      continue;
-
-    int rr = r - 1;
+  assert(position_index.size() == ref_nodes.size());
+  long rr = static_cast<long>(position_index.upper_bound(pos)) - 1; // The last reference node at or before 'pos'
+  assert(rr >= 0); // Positions before the first reference node have returned above
 
-    if (pos < (ref_nodes[rr].get_label().order + ref_nodes[rr].get_label().dna.size()))
+  if (pos < (ref_nodes.get_order(rr) + ref_nodes[rr].get_label().dna.size()))
+  {
+    // Ref covers this location
+    if (!is_special)
     {
-      // Ref covers this location
-      if (!is_special)
-      {
-        locs.push_back(Location('R' /*type*/,
-                                static_cast<uint32_t>(rr) /*node_id*/,
-                                ref_nodes[rr].get_label().order /*node_order*/,
-                                pos - ref_nodes[rr].get_label().order /*offset*/
-                                )
-                       );
-        break; // There is no way there are also variants at this location if the position is not special
-      }
-
-      assert(rr > 0);
-      --rr; // Variants behind the reference can only have this location
+      locs.push_back(Location('R' /*type*/,
+                              static_cast<uint32_t>(rr) /*node_id*/,
+                              ref_nodes.get_order(rr) /*node_order*/,
+                              pos - ref_nodes.get_order(rr) /*offset*/
+                              )
+                     );
+      return locs; // There is no way there are also variants at this location if the position is not special
     }
 
-    // Check variants behind this reference
-    while (rr >= 0 && ref_nodes[rr].get_label().reach() + 5000u > pos)
+    assert(rr > 0);
+    --rr; // Variants behind the reference can only have this location
+  }
+
+  // Check variants behind this reference
+  while (rr >= 0 && ref_nodes[rr].get_label().reach() + 5000u > pos)
+  {
+    // Assume there is no variants larger than 5000 bp
+    for (unsigned i = 0; i < ref_nodes[rr].out_degree(); ++i)
     {
-      // Assume there is no variants larger than 5000 bp
-      for (unsigned i = 0; i < ref_nodes[rr].out_degree(); ++i)
-      {
-        uint32_t const v = static_cast<uint32_t>(ref_nodes[rr].get_var_index(i));
+      uint32_t const v = static_cast<uint32_t>(ref_nodes[rr].get_var_index(i));
 
-        if (pos >= var_nodes[v].get_label().order and pos <= var_nodes[v].get_label().reach())
-        {
-          // Only add this node if the path has it
-          auto find_it = std::find(path.var_order.cbegin(),
-                                   path.var_order.cend(),
-                                   var_nodes[v].get_label().order
-                                   );
+      if (pos >= var_nodes[v].get_label().order and pos <= var_nodes[v].get_label().reach())
+      {
+        // Only add this node if the path has it
+        auto find_it = std::find(path.var_order.cbegin(),
+                                 path.var_order.cend(),
+                                 var_nodes[v].get_label().order
+                                 );
 
-          long const j = std::distance(path.var_order.cbegin(), find_it);
-          assert(j >= 0);
-          assert(i == this->get_variant_num(v));
+        long const j = std::distance(path.var_order.cbegin(), find_it);
+        assert(j >= 0);
+        assert(i == this->get_variant_num(v));
 
-          if (path.is_empty() || (j < static_cast<long>(path.nums.size()) && path.nums[j].test(i)))
-          {
-            locs.push_back(
-              {'V' /*type*/,
-               v /*node_id*/,
-               var_nodes[v].get_label().order /*node_order*/,
-               pos - var_nodes[v].get_label().order  /*offset*/
-              }
-              );
-          }
+        if (path.is_empty() || (j < static_cast<long>(path.nums.size()) && path.nums[j].test(i)))
+        {
+          locs.push_back(
+            {'V' /*type*/,
+             v /*node_id*/,
+             var_nodes[v].get_label().order /*node_order*/,
+             pos - var_nodes[v].get_label().order  /*offset*/
+            }
+            );
         }
       }
-
-      --rr;
     }
 
-    break;
+    --rr;
   }
 
   return locs;
@@ -1827,16 +1812,7 @@ Graph::add_special_pos(uint32_t const actual_pos, uint32_t const ref_reach)
 {
   ref_reach_poses.push_back(ref_reach);
   actual_poses.push_back(actual_pos);
-  auto find_it = ref_reach_to_special_pos.find(ref_reach);
-
-  if (find_it != ref_reach_to_special_pos.end())
-  {
-    find_it->second.push_back(SPECIAL_START + this->ref_reach_poses.size() - 1);
-  }
-  else
-  {
-    ref_reach_to_special_pos[ref_reach] = std::vector<uint32_t>(1, SPECIAL_START + ref_reach_poses.size() - 1);
-  }
+  ref_reach_to_special_pos.add(ref_reach, SPECIAL_START + ref_reach_poses.size() - 1);
 }
 
 
@@ -1844,10 +1820,8 @@ uint32_t
 Graph::get_special_pos(uint32_t const pos, uint32_t const ref_reach) const
 {
   assert(pos > ref_reach);
-  assert(std::distance(ref_reach_to_special_pos.begin(), ref_reach_to_special_pos.end()) > 0);
   assert(ref_reach_to_special_pos.count(ref_reach) == 1);
-  assert(pos - ref_reach - 1 < ref_reach_to_special_pos.at(ref_reach).size());
-  return ref_reach_to_special_pos.at(ref_reach).at(pos - ref_reach - 1);
+  return ref_reach_to_special_pos.at(ref_reach, pos - ref_reach - 1);
 }
 
 
@@ -2119,7 +2093,7 @@ Graph::is_homopolymer(Genotype const & gt) const
   // Check if we can find N identical bases
   long constexpr N = 10;
   long same_base = 0;
-  std::vector<char> const & seq1 = var.get_label().dna;
+  DnaView const seq1 = var.get_label().dna;
   char prev_base = seq1.size() > 0 ? seq1[0] : 'N';
 
   // Check reference allele
@@ -2142,7 +2116,7 @@ Graph::is_homopolymer(Genotype const & gt) const
     long r = var.get_out_ref_index();
     assert(r < static_cast<long>(ref_nodes.size()));
     auto const & ref = ref_nodes[r];
-    std::vector<char> const & seq2 = ref.get_label().dna;
+    DnaView const seq2 = ref.get_label().dna;
     long const LEN = std::min(50l - static_cast<long>(seq1.size()), static_cast<long>(seq2.size()));
 
     for (long s = 0; s < LEN; ++s)
@@ -2255,14 +2229,8 @@ Graph::print() const
  * EXPLICIT INSTANTIATIONS *
  ***************************/
 
-template void Graph::serialize<boost::archive::binary_iarchive>(boost::archive::binary_iarchive &, const unsigned int);
-template void Graph::serialize<boost::archive::binary_oarchive>(boost::archive::binary_oarchive &, const unsigned int);
-
-/**
- * GLOBAL INSTANCE
- */
-
-Graph graph;
+template void Graph::serialize<FlatIArchive>(FlatIArchive &, const unsigned int);
+template void Graph::serialize<FlatOArchive>(FlatOArchive &, const unsigned int);
 
 } // namespace gyper
 
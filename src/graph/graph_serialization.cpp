@@ -1,78 +1,307 @@
+#include <algorithm> // std::sort
+#include <cassert> // assert
+#include <cstdint> // uint32_t, uint64_t, uintptr_t
+#include <cstdlib> // std::exit
+#include <cstring> // std::memcmp, std::memcpy, std::memset
 #include <fstream>
+#include <istream>
+#include <memory> // std::make_shared, std::shared_ptr
+#include <streambuf>
 #include <string>
+#include <utility> // std::move
+#include <vector>
 
-#include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/log/trivial.hpp>
 
 #include <graphtyper/graph/absolute_position.hpp>
 #include <graphtyper/graph/graph.hpp>
 #include <graphtyper/graph/graph_serialization.hpp>
+#include <graphtyper/graph/legacy_graph.hpp>
+#include <graphtyper/utilities/flat_archive.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp> // gyper::current_context
+#include <graphtyper/utilities/mapped_file.hpp>
 
 
-namespace gyper
+namespace
 {
 
+char const FLAT_GRAPH_MAGIC[8] = {'G', 'T', 'F', 'L', 'A', 'T', 'G', 'R'};
+uint32_t constexpr FLAT_GRAPH_VERSION = 2; // 2: Position index and flat special positions
+uint64_t constexpr FLAT_GRAPH_BYTE_ORDER = 0x0102030405060708ull; // Reads differently on a machine of other endianness
+
+
+/**
+ * \brief The header of a flat graph file. It is followed by the graph, its reference genome and the offsets of its
+ *        contigs, as a FlatOArchive wrote them.
+ */
+struct FlatGraphHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t byte_order;
+  uint64_t file_size;
+  uint64_t reserved[4];
+};
+
+static_assert(sizeof(FlatGraphHeader) == gyper::FLAT_ARCHIVE_ALIGNMENT, "The flat graph header must be a cache line.");
+
+
+// Reads a buffer in memory as a stream without copying it
+class MemoryStreamBuffer : public std::streambuf
+{
+public:
+  MemoryStreamBuffer(char const * data, std::size_t const size)
+  {
+    char * begin = const_cast<char *>(data); // The buffer is only read from
+    setg(begin, begin, begin + size);
+  }
+};
+
+
 void
-save_graph(std::string const & graph_path)
+set_offsets(gyper::AbsolutePosition & absolute_pos, gyper::Graph const & graph, std::vector<uint32_t> && offsets)
+{
+  if (graph.contigs.size() == 0 || graph.contigs.size() != offsets.size())
+    return;
+
+  absolute_pos.offsets = std::move(offsets);
+  absolute_pos.chromosome_to_offset.clear();
+
+  for (long i = 0; i < static_cast<long>(graph.contigs.size()); ++i)
+    absolute_pos.chromosome_to_offset[graph.contigs[i].name] = absolute_pos.offsets[i];
+}
+
+
+// Adds the nodes of a graph saved with boost::serialization to 'graph'
+void
+add_legacy_nodes(gyper::Graph & graph, gyper::LegacyGraph const & legacy)
+{
+  uint64_t next_var_id = 0;
+
+  for (gyper::LegacyRefNode const & ref_node : legacy.ref_nodes)
+  {
+    uint32_t const num_vars = static_cast<uint32_t>(ref_node.out_var_ids.size());
+
+    // The variant nodes of a reference node have always been consecutive and after those of the previous ones
+    for (uint32_t i = 0; i < num_vars; ++i)
+    {
+      if (ref_node.out_var_ids[i] != next_var_id + i)
+      {
+        BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::graph_serialization] Reference node at " << ref_node.label.order
+                                 << " has variant node " << ref_node.out_var_ids[i] << " but "
+                                 << (next_var_id + i) << " was expected.";
+        std::exit(1);
+      }
+    }
+
+    graph.ref_nodes.push_back(ref_node.label.order, ref_node.label.dna, next_var_id, num_vars);
+    next_var_id += num_vars;
+  }
+
+  for (gyper::LegacyVarNode const & var_node : legacy.var_nodes)
+  {
+    graph.var_nodes.push_back(var_node.label.order,
+                              var_node.label.dna,
+                              var_node.label.variant_num,
+                              var_node.out_ref_id);
+  }
+
+  // Special positions were in a hash map
+  std::vector<uint32_t> ref_reaches;
+
+  for (auto const & ref_reach_poses : legacy.ref_reach_to_special_pos)
+    ref_reaches.push_back(ref_reach_poses.first);
+
+  std::sort(ref_reaches.begin(), ref_reaches.end());
+
+  for (uint32_t const ref_reach : ref_reaches)
+  {
+    for (uint32_t const special_pos : legacy.ref_reach_to_special_pos.at(ref_reach))
+      graph.ref_reach_to_special_pos.add(ref_reach, special_pos);
+  }
+
+  graph.position_index.build(graph.ref_nodes);
+}
+
+
+void
+save_flat_graph(gyper::Graph const & graph, std::string const & graph_path)
 {
   std::ofstream ofs(graph_path.c_str(), std::ios::binary);
 
   if (!ofs.is_open())
   {
-    BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::constructor] Could not save graph at '" << graph_path << "'";
+    BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::graph_serialization] Could not save graph at '" << graph_path << "'";
     std::exit(1);
   }
 
-  boost::archive::binary_oarchive oa(ofs);
+  // The header is written last, so a partly written file is never valid
+  FlatGraphHeader header;
+  std::memset(&header, 0, sizeof(FlatGraphHeader));
+  ofs.write(reinterpret_cast<char const *>(&header), sizeof(FlatGraphHeader));
+
+  gyper::AbsolutePosition const absolute_pos(graph);
+  gyper::FlatOArchive oa(ofs);
   oa << graph;
+  oa << graph.reference;
+  oa << graph.reference_offset;
+  oa << absolute_pos.offsets;
+  oa.align();
+
+  std::memcpy(header.magic, FLAT_GRAPH_MAGIC, sizeof(FLAT_GRAPH_MAGIC));
+  header.version = FLAT_GRAPH_VERSION;
+  header.header_size = sizeof(FlatGraphHeader);
+  header.byte_order = FLAT_GRAPH_BYTE_ORDER;
+  header.file_size = sizeof(FlatGraphHeader) + oa.get_offset();
+  ofs.seekp(0);
+  ofs.write(reinterpret_cast<char const *>(&header), sizeof(FlatGraphHeader));
+
+  if (!ofs)
+  {
+    BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::graph_serialization] Could not write graph to '" << graph_path << "'";
+    std::exit(1);
+  }
+}
+
+
+bool
+is_flat_graph(char const * data, std::size_t const size)
+{
+  return size >= sizeof(FLAT_GRAPH_MAGIC) && std::memcmp(data, FLAT_GRAPH_MAGIC, sizeof(FLAT_GRAPH_MAGIC)) == 0;
 }
 
 
+/**
+ * \brief Reads a graph of either format. Arrays of a flat graph are views of 'data' if 'mapping' keeps it alive,
+ *        otherwise they are copied.
+ */
 void
-load_graph(std::string const & graph_path)
+read_graph(gyper::Graph & graph,
+           gyper::AbsolutePosition * absolute_pos,
+           char const * data,
+           std::size_t const size,
+           std::shared_ptr<void const> const & mapping)
 {
-  gyper::graph.clear();
-  gyper::graph = Graph();
-  std::ifstream ifs(graph_path.c_str(), std::ios::binary);
+  graph.clear();
+  graph = gyper::Graph();
+
+  if (!is_flat_graph(data, size))
+  {
+    // Graphs which were saved with boost::serialization
+    MemoryStreamBuffer buffer(data, size);
+    std::istream is(&buffer);
+    boost::archive::binary_iarchive ia(is);
+    gyper::LegacyGraph legacy(graph);
+    ia >> legacy;
+    add_legacy_nodes(graph, legacy);
+    assert(graph.size() > 0u);
+
+    // Create a reference genome each time the graph is loaded
+    graph.generate_reference_genome();
+
+    if (absolute_pos)
+      absolute_pos->calculate_offsets(graph);
+
+    return;
+  }
+
+  FlatGraphHeader header;
+
+  if (size < sizeof(FlatGraphHeader))
+  {
+    BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::graph_serialization] The flat graph header is truncated.";
+    std::exit(1);
+  }
+
+  std::memcpy(&header, data, sizeof(FlatGraphHeader));
 
-  if (!ifs.is_open())
+  if (header.byte_order != FLAT_GRAPH_BYTE_ORDER || header.version != FLAT_GRAPH_VERSION ||
+      header.header_size != sizeof(FlatGraphHeader) || header.file_size > size)
   {
-    BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::constructor] Could not load graph at '" << graph_path << "'";
+    BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::graph_serialization] Flat graph has version " << header.version
+                             << " and " << header.file_size << " bytes but version " << FLAT_GRAPH_VERSION
+                             << " is required and there are " << size << " bytes.";
     std::exit(1);
   }
 
-  boost::archive::binary_iarchive ia(ifs);
+  bool const is_viewing = mapping && reinterpret_cast<uintptr_t>(data) % 8 == 0;
+  std::vector<uint32_t> offsets;
+  gyper::FlatIArchive ia(data + header.header_size, header.file_size - header.header_size, is_viewing);
   ia >> graph;
+  ia >> graph.reference;
+  ia >> graph.reference_offset;
+  ia >> offsets;
   assert(graph.size() > 0u);
 
-  // Create a reference genome each time the graph is loaded
-  graph.generate_reference_genome();
-  absolute_pos.calculate_offsets(graph);
+  if (is_viewing)
+    graph.mapping = mapping;
+
+  if (absolute_pos)
+    set_offsets(*absolute_pos, graph, std::move(offsets));
 }
 
 
-Graph
-load_secondary_graph(std::string const & graph_path)
+void
+read_graph(gyper::Graph & graph, gyper::AbsolutePosition * absolute_pos, std::string const & graph_path)
 {
-  Graph second_graph = Graph();
-  std::ifstream ifs(graph_path.c_str(), std::ios::binary);
+  auto mapped_file = std::make_shared<gyper::MappedFile>();
 
-  if (!ifs.is_open())
+  if (!mapped_file->open(graph_path))
   {
-    BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::constructor] Could not load graph at '" << graph_path << "'";
+    BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::graph_serialization] Could not load graph at '" << graph_path << "'";
     std::exit(1);
   }
 
-  boost::archive::binary_iarchive ia(ifs);
-  ia >> second_graph;
-  assert(second_graph.size() > 0u);
+  read_graph(graph, absolute_pos, mapped_file->data(), mapped_file->size(), mapped_file);
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+void
+save_graph(std::string const & graph_path)
+{
+  save_flat_graph(current_context().graph, graph_path);
+}
 
-  // Create a reference genome each time the graph is loaded
-  second_graph.generate_reference_genome();
 
+void
+load_graph(std::string const & graph_path)
+{
+  GenotypingContext & context = current_context();
+  read_graph(context.graph, &context.absolute_pos, graph_path);
+}
+
+
+void
+load_graph(char const * data, std::size_t const size, std::shared_ptr<void const> const & mapping)
+{
+  GenotypingContext & context = current_context();
+  read_graph(context.graph, &context.absolute_pos, data, size, mapping);
+}
+
+
+Graph
+load_secondary_graph(std::string const & graph_path)
+{
+  Graph second_graph = Graph();
+  read_graph(second_graph, nullptr, graph_path);
   return second_graph;
 }
 
 
+void
+convert_graph(std::string const & old_graph_path, std::string const & graph_path)
+{
+  Graph const graph = load_secondary_graph(old_graph_path);
+  save_flat_graph(graph, graph_path);
+}
+
+
 } // namespace gyper
@@ -7,6 +7,7 @@
 #include <boost/log/trivial.hpp>
 
 #include <graphtyper/graph/graph.hpp> // gyper::Graph
+#include <graphtyper/utilities/genotyping_context.hpp> // gyper::current_context
 #include <graphtyper/utilities/graph_help_functions.hpp>
 #include <graphtyper/utilities/options.hpp> // *gyper::Options::instance()
 
@@ -78,6 +79,7 @@ Haplotype::add_genotype(Genotype && gt)
 void
 Haplotype::check_for_duplicate_haplotypes()
 {
+  Graph const & graph = current_context().graph;
   std::vector<std::bitset<MAX_NUMBER_OF_HAPLOTYPES> > unique_gts; // One per gt
 
   // No need to check if there is only one genotype
@@ -1,56 +1,56 @@
 #include <assert.h>
 
-#include <boost/archive/binary_oarchive.hpp>
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/serialization/vector.hpp>
-
 #include <graphtyper/graph/label.hpp>
+#include <graphtyper/utilities/flat_archive.hpp>
 
 namespace gyper
 {
 
-Label::Label() noexcept
-  : order(INVALID_ID)
-  , dna(0)
-  , variant_num(INVALID_NUM)
-{}
-
+void
+LabelArrays::push_back(uint32_t const order, std::vector<char> const & dna)
+{
+  orders.push_back(order);
+  lengths.push_back(static_cast<uint32_t>(dna.size()));
+  positions.push_back(sequences.add(dna));
+}
 
-Label::Label(Label const & l) noexcept
-  : order(l.order)
-  , dna(l.dna)
-  , variant_num(l.variant_num)
-{}
 
+void
+LabelArrays::change_order(std::size_t const i, uint32_t const change)
+{
+  // Make sure we do not overflow
+  assert(change + orders[i] >= change);
+  assert(change + orders[i] >= orders[i]);
 
-Label::Label(Label && l) noexcept
-  : order(std::forward<uint32_t>(l.order))
-  , dna(std::forward<std::vector<char> >(l.dna))
-  , variant_num(std::forward<uint16_t>(l.variant_num))
-{}
+  orders.set(i, orders[i] + change);
+}
 
 
-Label::Label(uint32_t const & _order, std::vector<char> && _dna, uint16_t const & _variant_num) noexcept
-  : order(_order)
-  , dna(std::move(_dna))
-  , variant_num(_variant_num)
-{}
+void
+LabelArrays::clear()
+{
+  orders.clear();
+  lengths.clear();
+  positions.clear();
+  sequences.clear();
+}
 
 
-uint32_t
-Label::reach() const
+std::size_t
+LabelArrays::size_in_bytes() const
 {
-  return order + dna.size() - 1;
+  return orders.size_in_bytes() + lengths.size_in_bytes() + positions.size_in_bytes() + sequences.size_in_bytes();
 }
 
 
 template <typename Archive>
 void
-Label::serialize(Archive & ar, const unsigned int)
+LabelArrays::serialize(Archive & ar, const unsigned int)
 {
-  ar & order;
-  ar & dna;
-  ar & variant_num;
+  ar & orders;
+  ar & lengths;
+  ar & positions;
+  ar & sequences;
 }
 
 
@@ -58,7 +58,7 @@ Label::serialize(Archive & ar, const unsigned int)
  * EXPLICIT INSTANTIATIONS *
  ***************************/
 
-template void Label::serialize<boost::archive::binary_iarchive>(boost::archive::binary_iarchive &, const unsigned int);
-template void Label::serialize<boost::archive::binary_oarchive>(boost::archive::binary_oarchive &, const unsigned int);
+template void LabelArrays::serialize<FlatIArchive>(FlatIArchive &, const unsigned int);
+template void LabelArrays::serialize<FlatOArchive>(FlatOArchive &, const unsigned int);
 
 } // namespace gyper
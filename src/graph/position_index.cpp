@@ -0,0 +1,189 @@
+#include <algorithm> // std::lower_bound
+#include <cassert> // assert
+#include <cstdint> // uint32_t
+#include <stdexcept> // std::out_of_range
+#include <utility> // std::move
+
+#include <graphtyper/graph/node.hpp>
+#include <graphtyper/graph/position_index.hpp>
+#include <graphtyper/utilities/flat_archive.hpp>
+#include <graphtyper/utilities/huge_page_allocator.hpp>
+
+
+namespace
+{
+
+// Places the orders of the nodes from 'r' on in the subtree of 'k' and returns the next node
+std::size_t
+fill_subtree(gyper::HugePageVector<uint32_t> & orders,
+             gyper::HugePageVector<uint32_t> & ref_ids,
+             gyper::RefNodes const & ref_nodes,
+             std::size_t r,
+             std::size_t const k)
+{
+  if (k >= orders.size())
+    return r;
+
+  r = fill_subtree(orders, ref_ids, ref_nodes, r, 2 * k);
+  orders[k] = ref_nodes.get_order(r);
+  ref_ids[k] = static_cast<uint32_t>(r);
+  return fill_subtree(orders, ref_ids, ref_nodes, r + 1, 2 * k + 1);
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+void
+PositionIndex::build(RefNodes const & ref_nodes)
+{
+  HugePageVector<uint32_t> new_orders(ref_nodes.size() + 1, 0);
+  HugePageVector<uint32_t> new_ref_ids(ref_nodes.size() + 1, 0);
+
+  for (std::size_t r = 1; r < ref_nodes.size(); ++r)
+    assert(ref_nodes.get_order(r - 1) <= ref_nodes.get_order(r));
+
+  std::size_t const num = fill_subtree(new_orders, new_ref_ids, ref_nodes, 0, 1);
+  assert(num == ref_nodes.size());
+  (void)num;
+  orders.assign(std::move(new_orders));
+  ref_ids.assign(std::move(new_ref_ids));
+}
+
+
+void
+PositionIndex::clear()
+{
+  orders.clear();
+  ref_ids.clear();
+}
+
+
+template <typename Archive>
+void
+PositionIndex::serialize(Archive & ar, unsigned int)
+{
+  ar & orders;
+  ar & ref_ids;
+}
+
+
+void
+SpecialPositions::add(uint32_t const ref_reach, uint32_t const special_pos)
+{
+  if (ref_reaches.empty() || ref_reaches.back() < ref_reach)
+  {
+    ref_reaches.push_back(ref_reach);
+    ends.push_back(static_cast<uint32_t>(special_poses.size() + 1));
+    special_poses.push_back(special_pos);
+    return;
+  }
+
+  if (ref_reaches.back() == ref_reach)
+  {
+    ends.set(ends.size() - 1, ends.back() + 1);
+    special_poses.push_back(special_pos);
+    return;
+  }
+
+  // Special positions are added out of order of reference reach, insert them in the middle
+  HugePageVector<uint32_t> new_ref_reaches(ref_reaches.begin(), ref_reaches.end());
+  HugePageVector<uint32_t> new_ends(ends.begin(), ends.end());
+  HugePageVector<uint32_t> new_special_poses(special_poses.begin(), special_poses.end());
+  std::size_t i = std::lower_bound(ref_reaches.begin(), ref_reaches.end(), ref_reach) - ref_reaches.begin();
+
+  if (ref_reaches[i] != ref_reach)
+  {
+    new_ref_reaches.insert(new_ref_reaches.begin() + i, ref_reach);
+    new_ends.insert(new_ends.begin() + i, static_cast<uint32_t>(get_begin(i)));
+  }
+
+  new_special_poses.insert(new_special_poses.begin() + new_ends[i], special_pos);
+
+  for (; i < new_ends.size(); ++i)
+    ++new_ends[i];
+
+  ref_reaches.assign(std::move(new_ref_reaches));
+  ends.assign(std::move(new_ends));
+  special_poses.assign(std::move(new_special_poses));
+}
+
+
+void
+SpecialPositions::clear()
+{
+  ref_reaches.clear();
+  ends.clear();
+  special_poses.clear();
+}
+
+
+uint32_t
+SpecialPositions::at(uint32_t const ref_reach, std::size_t const i) const
+{
+  std::size_t const index = find(ref_reach);
+
+  if (index == ref_reaches.size() || i >= ends[index] - get_begin(index))
+    throw std::out_of_range("SpecialPositions::at");
+
+  return special_poses[get_begin(index) + i];
+}
+
+
+std::size_t
+SpecialPositions::size_in_bytes() const
+{
+  return ref_reaches.size_in_bytes() + ends.size_in_bytes() + special_poses.size_in_bytes();
+}
+
+
+/***********
+ * PRIVATE *
+ ***********/
+
+std::size_t
+SpecialPositions::find(uint32_t const ref_reach) const
+{
+  std::size_t const n = ref_reaches.size();
+
+  if (n == 0)
+    return 0;
+
+  // Lower bound which halves the range without branching on the reaches
+  uint32_t const * base = ref_reaches.data();
+  std::size_t len = n;
+
+  while (len > 1)
+  {
+    std::size_t const half = len / 2;
+    base += (base[half - 1] < ref_reach) ? half : 0;
+    len -= half;
+  }
+
+  std::size_t const i = (base - ref_reaches.data()) + (*base < ref_reach);
+  return (i < n && ref_reaches[i] == ref_reach) ? i : n;
+}
+
+
+template <typename Archive>
+void
+SpecialPositions::serialize(Archive & ar, unsigned int)
+{
+  ar & ref_reaches;
+  ar & ends;
+  ar & special_poses;
+}
+
+
+/***************************
+ * EXPLICIT INSTANTIATIONS *
+ ***************************/
+template void PositionIndex::serialize<FlatIArchive>(FlatIArchive &, const unsigned int);
+template void PositionIndex::serialize<FlatOArchive>(FlatOArchive &, const unsigned int);
+template void SpecialPositions::serialize<FlatIArchive>(FlatIArchive &, const unsigned int);
+template void SpecialPositions::serialize<FlatOArchive>(FlatOArchive &, const unsigned int);
+
+} // namespace gyper
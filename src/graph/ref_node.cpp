@@ -1,62 +1,91 @@
-#include <boost/archive/binary_oarchive.hpp>
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/serialization/vector.hpp>
+#include <cassert>
+#include <stdexcept> // std::out_of_range
 
 #include <graphtyper/graph/node.hpp>
+#include <graphtyper/utilities/flat_archive.hpp>
 
 
 namespace gyper
 {
 
-RefNode::RefNode(Label && l, std::vector<TNodeIndex> && c) noexcept
-  : label(std::move(l))
-  , out_var_ids(std::move(c))
-{}
+TNodeIndex
+RefNode::get_var_index(unsigned const & index) const
+{
+  assert(index < num_vars);
+  return first_var_id + index;
+}
 
 
-RefNode::RefNode(RefNode const & rn) noexcept
-  : label(rn.label)
-  , out_var_ids(rn.out_var_ids)
-{}
+std::vector<TNodeIndex>
+RefNode::get_vars() const
+{
+  std::vector<TNodeIndex> vars(num_vars);
 
+  for (uint32_t i = 0; i < num_vars; ++i)
+    vars[i] = first_var_id + i;
 
-Label const &
-RefNode::get_label() const
+  return vars;
+}
+
+
+RefNode
+RefNodes::at(std::size_t const r) const
 {
-  return label;
+  if (r >= size())
+    throw std::out_of_range("RefNodes::at");
+
+  return (*this)[r];
 }
 
 
-TNodeIndex
-RefNode::get_var_index(unsigned const & index) const
+RefNode
+RefNodes::front() const
 {
-  assert(index < out_var_ids.size());
-  return out_var_ids[index];
+  assert(size() > 0);
+  return (*this)[0];
 }
 
 
-std::vector<TNodeIndex>
-RefNode::get_vars() const
+RefNode
+RefNodes::back() const
 {
-  return out_var_ids;
+  assert(size() > 0);
+  return (*this)[size() - 1];
 }
 
 
 void
-RefNode::change_label_order(uint32_t change)
+RefNodes::push_back(uint32_t const order,
+                    std::vector<char> const & dna,
+                    TNodeIndex const first_var,
+                    uint32_t const num_vars)
 {
-  // Make sure we do not overflow
-  assert(change + label.order >= change);
-  assert(change + label.order >= label.order);
+  labels.push_back(order, dna);
+  first_var_ids.push_back(static_cast<uint32_t>(first_var));
+  out_degrees.push_back(num_vars);
+}
+
 
-  label.order += change;
+void
+RefNodes::change_label_order(std::size_t const r, uint32_t const change)
+{
+  labels.change_order(r, change);
+}
+
+
+void
+RefNodes::clear()
+{
+  labels.clear();
+  first_var_ids.clear();
+  out_degrees.clear();
 }
 
 
 std::size_t
-RefNode::out_degree() const
+RefNodes::size_in_bytes() const
 {
-  return out_var_ids.size();
+  return labels.size_in_bytes() + first_var_ids.size_in_bytes() + out_degrees.size_in_bytes();
 }
 
 
@@ -64,23 +93,20 @@ RefNode::out_degree() const
  * PRIVATE *
  ***********/
 
-RefNode::RefNode()
-  : label(), out_var_ids(0) {}
-
-
 template <typename Archive>
 void
-RefNode::serialize(Archive & ar, const unsigned int)
+RefNodes::serialize(Archive & ar, const unsigned int)
 {
-  ar & label;
-  ar & out_var_ids;
+  ar & labels;
+  ar & first_var_ids;
+  ar & out_degrees;
 }
 
 
 /***************************
  * EXPLICIT INSTANTIATIONS *
  ***************************/
-template void RefNode::serialize<boost::archive::binary_iarchive>(boost::archive::binary_iarchive &, const unsigned int);
-template void RefNode::serialize<boost::archive::binary_oarchive>(boost::archive::binary_oarchive &, const unsigned int);
+template void RefNodes::serialize<FlatIArchive>(FlatIArchive &, const unsigned int);
+template void RefNodes::serialize<FlatOArchive>(FlatOArchive &, const unsigned int);
 
 } // namespace gyper
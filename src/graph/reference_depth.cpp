@@ -7,6 +7,7 @@
 #include <graphtyper/graph/reference_depth.hpp>
 #include <graphtyper/typer/genotype_paths.hpp>
 #include <graphtyper/typer/variant_candidate.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp> // gyper::current_context
 
 
 namespace gyper
@@ -18,6 +19,7 @@ namespace gyper
 
 ReferenceDepth::ReferenceDepth()
 {
+  Graph const & graph = current_context().graph;
   reference_offset = graph.ref_nodes.size() > 0 ?
                      graph.ref_nodes[0].get_label().order :
                      0;
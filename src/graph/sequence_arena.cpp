@@ -0,0 +1,139 @@
+#include <algorithm> // std::all_of, std::equal
+#include <cassert> // assert
+#include <cstdint> // uint64_t
+#include <vector> // std::vector
+
+#include <graphtyper/graph/sequence_arena.hpp>
+#include <graphtyper/utilities/flat_archive.hpp>
+
+
+namespace
+{
+
+// 2-bit code of a base, or -1 if it cannot be packed
+int
+to_2bit(char const c)
+{
+  switch (c)
+  {
+  case 'A': return 0;
+  case 'C': return 1;
+  case 'G': return 2;
+  case 'T': return 3;
+  default: return -1;
+  }
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+bool
+operator==(DnaView const & a, DnaView const & b)
+{
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+
+bool
+operator==(DnaView const & a, std::vector<char> const & b)
+{
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+
+bool
+operator==(std::vector<char> const & a, DnaView const & b)
+{
+  return b == a;
+}
+
+
+bool
+operator!=(DnaView const & a, DnaView const & b)
+{
+  return !(a == b);
+}
+
+
+bool
+operator!=(DnaView const & a, std::vector<char> const & b)
+{
+  return !(a == b);
+}
+
+
+bool
+operator!=(std::vector<char> const & a, DnaView const & b)
+{
+  return !(b == a);
+}
+
+
+uint64_t
+SequenceArena::add(std::vector<char> const & dna)
+{
+  bool const is_packable = std::all_of(dna.begin(), dna.end(), [](char const c){return to_2bit(c) >= 0;});
+
+  if (!is_packable)
+  {
+    uint64_t const position = unpacked.size() << 1 | 1ull;
+
+    for (char const c : dna)
+      unpacked.push_back(c);
+
+    return position;
+  }
+
+  uint64_t const position = num_packed_bases << 1;
+
+  for (char const c : dna)
+  {
+    if ((num_packed_bases & 31) == 0)
+      packed.push_back(0);
+
+    packed.set(packed.size() - 1, packed.back() | static_cast<uint64_t>(to_2bit(c)) << ((num_packed_bases & 31) << 1));
+    ++num_packed_bases;
+  }
+
+  return position;
+}
+
+
+void
+SequenceArena::clear()
+{
+  packed.clear();
+  num_packed_bases = 0;
+  unpacked.clear();
+}
+
+
+std::size_t
+SequenceArena::size_in_bytes() const
+{
+  return packed.size_in_bytes() + unpacked.size_in_bytes();
+}
+
+
+template <typename Archive>
+void
+SequenceArena::serialize(Archive & ar, const unsigned int)
+{
+  ar & packed;
+  ar & num_packed_bases;
+  ar & unpacked;
+}
+
+
+/***************************
+ * EXPLICIT INSTANTIATIONS *
+ ***************************/
+
+template void SequenceArena::serialize<FlatIArchive>(FlatIArchive &, const unsigned int);
+template void SequenceArena::serialize<FlatOArchive>(FlatOArchive &, const unsigned int);
+
+} // namespace gyper
@@ -4,6 +4,7 @@
 #include <graphtyper/graph/graph.hpp>
 #include <graphtyper/graph/sequence_extractor.hpp>
 #include <graphtyper/graph/graph_serialization.hpp> // gyper::load_graph
+#include <graphtyper/utilities/genotyping_context.hpp> // gyper::current_context
 #include <graphtyper/utilities/io.hpp>
 
 
@@ -14,6 +15,7 @@ void
 extract_to_fasta(std::string const & file_name, std::string const & graph_path, uint64_t n, uint64_t b, uint64_t e)
 {
   load_graph(graph_path);
+  Graph const & graph = current_context().graph;
 
   std::stringstream ss;
   ss << ">reference\n";
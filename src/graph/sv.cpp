@@ -11,7 +11,9 @@
 #include <graphtyper/graph/graph.hpp>
 #include <graphtyper/graph/sv.hpp>
 #include <graphtyper/graph/absolute_position.hpp>
+#include <graphtyper/utilities/flat_archive.hpp>
 #include <graphtyper/typer/variant.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/options.hpp>
 #include <graphtyper/utilities/graph_help_functions.hpp>
 
@@ -124,11 +126,15 @@ template void SV::serialize<boost::archive::binary_iarchive>(boost::archive::bin
 
 template void SV::serialize<boost::archive::binary_oarchive>(boost::archive::binary_oarchive &,
                                                              const unsigned int);
+template void SV::serialize<FlatIArchive>(FlatIArchive &, const unsigned int);
+template void SV::serialize<FlatOArchive>(FlatOArchive &, const unsigned int);
 
 
 void
 reformat_sv_vcf_records(std::vector<Variant> & variants, ReferenceDepth const & reference_depth)
 {
+  Graph const & graph = current_context().graph;
+  AbsolutePosition const & absolute_pos = current_context().absolute_pos;
   long const variants_original_size = variants.size();
   std::unordered_set<long> variant_ids_to_erase; // Index of variants to erase
   std::unordered_map<int32_t, int32_t> related_svs; // Map of all related SVs
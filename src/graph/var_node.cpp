@@ -1,77 +1,92 @@
-#include <boost/archive/binary_oarchive.hpp>
-#include <boost/archive/binary_iarchive.hpp>
+#include <cassert>
+#include <stdexcept> // std::out_of_range
 
 #include <graphtyper/graph/node.hpp>
+#include <graphtyper/utilities/flat_archive.hpp>
 
 
 namespace gyper
 {
 
-/**********
- * PUBLIC *
- **********/
+VarNode
+VarNodes::at(std::size_t const v) const
+{
+  if (v >= size())
+    throw std::out_of_range("VarNodes::at");
 
-VarNode::VarNode(Label && l, TNodeIndex && ori) noexcept
-  : label(std::move(l))
-  , out_ref_id(std::move(ori))
-{}
+  return (*this)[v];
+}
 
-VarNode::VarNode(VarNode const & vn) noexcept
-  : label(vn.label)
-  , out_ref_id(vn.out_ref_id)
-{}
 
-Label const &
-VarNode::get_label() const
+VarNode
+VarNodes::front() const
 {
-  return label;
+  assert(size() > 0);
+  return (*this)[0];
 }
 
 
-TNodeIndex
-VarNode::get_out_ref_index() const
+VarNode
+VarNodes::back() const
 {
-  return out_ref_id;
+  assert(size() > 0);
+  return (*this)[size() - 1];
 }
 
 
 void
-VarNode::change_label_order(uint32_t change)
+VarNodes::push_back(uint32_t const order,
+                    std::vector<char> const & dna,
+                    uint16_t const variant_num,
+                    TNodeIndex const out_ref)
 {
-  // Make sure we do not overflow
-  assert(change + label.order >= change);
-  assert(change + label.order >= label.order);
+  labels.push_back(order, dna);
+  variant_nums.push_back(variant_num);
+  out_ref_ids.push_back(static_cast<uint32_t>(out_ref));
+}
 
-  label.order += change;
+
+void
+VarNodes::change_label_order(std::size_t const v, uint32_t const change)
+{
+  labels.change_order(v, change);
+}
+
+
+void
+VarNodes::clear()
+{
+  labels.clear();
+  variant_nums.clear();
+  out_ref_ids.clear();
 }
 
 
 std::size_t
-VarNode::out_degree() const
+VarNodes::size_in_bytes() const
 {
-  return 1;
+  return labels.size_in_bytes() + variant_nums.size_in_bytes() + out_ref_ids.size_in_bytes();
 }
 
 
 /***********
  * PRIVATE *
  ***********/
-VarNode::VarNode()
-  : label(), out_ref_id(0) {}
 
 template <typename Archive>
 void
-VarNode::serialize(Archive & ar, const unsigned int)
+VarNodes::serialize(Archive & ar, const unsigned int)
 {
-  ar & label;
-  ar & out_ref_id;
+  ar & labels;
+  ar & variant_nums;
+  ar & out_ref_ids;
 }
 
 
 /***************************
  * EXPLICIT INSTANTIATIONS *
  ***************************/
-template void VarNode::serialize<boost::archive::binary_iarchive>(boost::archive::binary_iarchive &, const unsigned int);
-template void VarNode::serialize<boost::archive::binary_oarchive>(boost::archive::binary_oarchive &, const unsigned int);
+template void VarNodes::serialize<FlatIArchive>(FlatIArchive &, const unsigned int);
+template void VarNodes::serialize<FlatOArchive>(FlatOArchive &, const unsigned int);
 
 } // namespace gyper
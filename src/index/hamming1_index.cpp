@@ -0,0 +1,220 @@
+#include <algorithm> // std::sort, std::lower_bound, std::upper_bound, std::binary_search
+#include <cassert> // assert
+#include <utility> // std::pair
+
+#include <graphtyper/constants.hpp>
+#include <graphtyper/index/hamming1_index.hpp>
+
+
+namespace
+{
+
+// Buckets larger than this are probed with every neighbour of the query instead of being scanned
+long constexpr MAX_SCANNED_BUCKET_SIZE = 3 * gyper::K / 2;
+
+using gyper::TKmerKey;
+
+uint32_t constexpr KEY_BITS = 8 * sizeof(TKmerKey);
+uint32_t constexpr HALF_BITS = KEY_BITS / 2;
+uint32_t constexpr HALF_BASES = HALF_BITS / 2;
+
+// Keys are shifted to the most significant bits, so the first half of a key is always its leading HALF_BITS bits
+uint32_t constexpr PAD_BASES = 2 * HALF_BASES - gyper::K;
+
+TKmerKey constexpr LOW_HALF = ~static_cast<TKmerKey>(0) >> HALF_BITS;
+TKmerKey constexpr LOW_BITS_OF_BASES = ~static_cast<TKmerKey>(0) / 3; // 0101...01
+
+using TNeighbour = std::pair<uint32_t, TKmerKey>; // (position in to_uint64_vec_hamming_distance_1, key)
+
+
+inline TKmerKey
+swap_halves(TKmerKey const key)
+{
+  return (key << HALF_BITS) | (key >> HALF_BITS);
+}
+
+
+inline TKmerKey
+to_padded(TKmerKey const key)
+{
+  return key << (2 * PAD_BASES);
+}
+
+
+inline TKmerKey
+from_padded(TKmerKey const key)
+{
+  return key >> (2 * PAD_BASES);
+}
+
+
+gyper::HugePageVector<uint32_t>
+build_directory(gyper::HugePageVector<TKmerKey> const & sorted_keys, uint32_t const shift)
+{
+  uint64_t const num_buckets = 1ull << (KEY_BITS - shift);
+  gyper::HugePageVector<uint32_t> directory(num_buckets + 1);
+  uint64_t i = 0;
+
+  for (uint64_t b = 0; b < num_buckets; ++b)
+  {
+    directory[b] = static_cast<uint32_t>(i);
+
+    while (i < sorted_keys.size() && (sorted_keys[i] >> shift) == b)
+      ++i;
+  }
+
+  directory[num_buckets] = static_cast<uint32_t>(i);
+  assert(i == sorted_keys.size());
+  return directory;
+}
+
+
+/**
+ * Finds keys in 'sorted_keys' which have the same leading half as 'query' and a single mismatch in the other half.
+ * Keys are padded, when the halves are swapped the mismatch is in the leading half of the padded key. Either way the
+ * neighbours are given unpadded with the position of the mismatch in the unpadded key.
+ */
+void
+find_neighbours_in_half(gyper::HugePageVector<TKmerKey> const & sorted_keys,
+                        gyper::HugePageVector<uint32_t> const & directory,
+                        uint32_t const directory_shift,
+                        TKmerKey const query,
+                        bool const is_swapped,
+                        std::vector<TNeighbour> & neighbours)
+{
+  TKmerKey const first = query & ~LOW_HALF;
+  TKmerKey const last = query | LOW_HALF;
+  uint64_t const b = static_cast<uint64_t>(query >> directory_shift);
+  auto const bucket_begin = sorted_keys.begin() + directory[b];
+  auto const bucket_end = sorted_keys.begin() + directory[b + 1];
+  auto const begin_it = std::lower_bound(bucket_begin, bucket_end, first);
+  auto const end_it = std::upper_bound(begin_it, bucket_end, last);
+
+  if (begin_it == end_it)
+    return;
+
+  // Base 'bb' of the trailing half is base 'bb + base_offset' of the unpadded key
+  int32_t const base_offset = is_swapped ? static_cast<int32_t>(HALF_BASES) - static_cast<int32_t>(PAD_BASES) :
+                                           -static_cast<int32_t>(PAD_BASES);
+  auto to_key = [is_swapped](TKmerKey const padded_key)
+                {
+                  return from_padded(is_swapped ? swap_halves(padded_key) : padded_key);
+                };
+
+  if (std::distance(begin_it, end_it) <= MAX_SCANNED_BUCKET_SIZE)
+  {
+    for (auto it = begin_it; it != end_it; ++it)
+    {
+      TKmerKey const diff = *it ^ query;
+      TKmerKey const base_diff = (diff | (diff >> 1)) & LOW_BITS_OF_BASES; // One bit per mismatching base
+
+      // Skip the key itself and keys with more than one mismatch
+      if (base_diff == 0 || (base_diff & (base_diff - 1)) != 0)
+        continue;
+
+      uint32_t bb = 0;
+
+      while ((base_diff >> (2 * bb)) != 1)
+        ++bb;
+
+      uint32_t const flip = static_cast<uint32_t>((diff >> (2 * bb)) & 3ull);
+      neighbours.push_back({(bb + base_offset) * 3 + flip - 1, to_key(*it)});
+    }
+  }
+  else
+  {
+    // The padding of unswapped keys is at the end of the trailing half
+    for (uint32_t bb = is_swapped ? 0 : PAD_BASES; bb < HALF_BASES; ++bb)
+    {
+      for (uint32_t flip = 1; flip <= 3; ++flip)
+      {
+        TKmerKey const neighbour = query ^ (static_cast<TKmerKey>(flip) << (2 * bb));
+
+        if (std::binary_search(begin_it, end_it, neighbour))
+        {
+          neighbours.push_back({(bb + base_offset) * 3 + flip - 1, to_key(neighbour)});
+        }
+      }
+    }
+  }
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+void
+Hamming1Index::build(std::vector<TKmerKey> && keys)
+{
+  static_assert(K >= HALF_BASES && K <= 2 * HALF_BASES,
+                "The Hamming distance 1 index assumes the first half of a key holds at most half of a k-mer.");
+  clear();
+
+  if (keys.size() == 0)
+    return;
+
+  // Use about one directory entry per key, at most 2^24 entries
+  uint32_t directory_bits = 1;
+
+  while (directory_bits < 24 && (1ull << (directory_bits + 1)) <= keys.size())
+    ++directory_bits;
+
+  directory_shift = KEY_BITS - directory_bits;
+
+  last_half_keys.reserve(keys.size());
+
+  for (auto & key : keys)
+  {
+    key = to_padded(key);
+    last_half_keys.push_back(swap_halves(key));
+  }
+
+  std::sort(keys.begin(), keys.end());
+  std::sort(last_half_keys.begin(), last_half_keys.end());
+  first_half_keys.assign(keys.begin(), keys.end());
+  keys = std::vector<TKmerKey>();
+  first_half_directory = build_directory(first_half_keys, directory_shift);
+  last_half_directory = build_directory(last_half_keys, directory_shift);
+}
+
+
+void
+Hamming1Index::clear()
+{
+  first_half_keys = HugePageVector<TKmerKey>();
+  last_half_keys = HugePageVector<TKmerKey>();
+  first_half_directory = HugePageVector<uint32_t>();
+  last_half_directory = HugePageVector<uint32_t>();
+  directory_shift = KEY_BITS;
+}
+
+
+void
+Hamming1Index::find_neighbours(TKmerKey const key, std::vector<TKmerKey> & neighbours) const
+{
+  if (first_half_keys.size() == 0)
+    return;
+
+  std::vector<TNeighbour> found;
+  TKmerKey const padded_key = to_padded(key);
+  find_neighbours_in_half(first_half_keys, first_half_directory, directory_shift, padded_key, false, found);
+  find_neighbours_in_half(last_half_keys, last_half_directory, directory_shift, swap_halves(padded_key), true, found);
+  std::sort(found.begin(), found.end());
+
+  for (auto const & f : found)
+    neighbours.push_back(f.second);
+}
+
+
+std::size_t
+Hamming1Index::memory_usage() const
+{
+  return (first_half_keys.size() + last_half_keys.size()) * sizeof(TKmerKey) +
+         (first_half_directory.size() + last_half_directory.size()) * sizeof(uint32_t);
+}
+
+
+} // namespace gyper
@@ -1,5 +1,8 @@
 #include <algorithm>
+#include <array>
+#include <cstdio>
 #include <fstream>
+#include <functional>
 #include <iostream>
 
 #include <boost/log/trivial.hpp>
@@ -7,6 +10,13 @@
 #include <graphtyper/graph/graph.hpp>
 #include <graphtyper/graph/graph_serialization.hpp>
 #include <graphtyper/index/indexer.hpp>
+#include <graphtyper/index/mem_index.hpp>
+#include <graphtyper/index/sorted_run_writer.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
+#include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/task_scheduler.hpp>
+
+#include <paw/station.hpp>
 
 #include <seqan/stream.h>
 
@@ -14,6 +24,9 @@
 namespace
 {
 
+long constexpr DEFAULT_MAX_INDEX_MEMORY = 2048; // MB of labels buffered when writing an index without a limit set
+
+
 bool
 entry_has_too_many_nonrefs(gyper::IndexEntry const & entry)
 {
@@ -24,17 +37,148 @@ entry_has_too_many_nonrefs(gyper::IndexEntry const & entry)
 }
 
 
+
+/**
+ * \brief Puts labels into another index with the keys in their database order.
+ * \details Sorted runs of the labels are then merged in the order the database stores the keys.
+ */
+template <typename TIndex>
+class DbKeyOrderSink
+{
+public:
+  DbKeyOrderSink(TIndex & _sink)
+    : sink(_sink)
+  {}
+
+  void
+  put(gyper::TKmerKey const key, gyper::KmerLabel && label)
+  {
+    sink.put(gyper::to_db_key_order(key), std::move(label));
+  }
+
+  void
+  put(gyper::TKmerKey const key, std::vector<gyper::KmerLabel> && labels)
+  {
+    sink.put(gyper::to_db_key_order(key), std::move(labels));
+  }
+
+private:
+  TIndex & sink;
+};
+
+
 } // anon namespace
 
 
 namespace gyper
 {
 
+/**
+ * \brief The state of the indexer while it walks the graph, one for each thread indexing it.
+ * \details All buffers are reused from one bubble to the next, so indexing allocates no memory once they have grown
+ *          to fit the largest bubble.
+ */
+class IndexerState
+{
+public:
+  explicit IndexerState(Graph const & _graph)
+    : graph(_graph)
+  {}
+
+  Graph const & graph; /** \brief The graph being indexed. */
+  EntryRing mers; /** \brief The k-mers being extended along the graph. */
+  EntryRing clean_list; /** \brief The k-mers before a bubble, extended through each alternative allele. */
+  EntryRing new_list; /** \brief Copy of clean_list when there are more alternative alleles left. */
+  VariantIdArena arena;
+  VariantIdArena spare_arena; /** \brief Arena which live variant IDs are moved to when the arena is compacted. */
+  std::size_t max_arena_size = MIN_ARENA_SIZE;
+  std::array<uint32_t, 256> variant_ids; /** \brief Scratch space for the variant IDs of an entry. */
+
+  static std::size_t constexpr MIN_ARENA_SIZE = 1 << 16;
+};
+
+std::size_t constexpr IndexerState::MIN_ARENA_SIZE;
+
+
+/** \brief Puts a label for each variant ID of 'entry', or a single reference label if it has none. */
+template <typename TIndex>
+void
+put_entry(TIndex & new_index, IndexerState & state, IndexEntry const & entry, uint32_t const end_index)
+{
+  if (entry.num_variant_ids == 0)
+  {
+    new_index.put(entry.dna, KmerLabel(entry.start_index, end_index)); // KmerLabel has implicit var_id = INVALID_ID
+    return;
+  }
+
+  entry.get_variant_ids(state.variant_ids.data(), state.arena);
+
+  for (uint32_t i = 0; i < entry.num_variant_ids; ++i)
+    new_index.put(entry.dna, KmerLabel(entry.start_index, end_index, state.variant_ids[i]));
+}
+
+
+/**
+ * \brief Frees variant IDs which are no longer used, called between reference nodes when only 'mers' is live.
+ * \details The arena is cleared when no entry has IDs in it. Otherwise it is compacted when it has grown to twice its
+ *          size after the last compaction.
+ */
+void
+release_variant_ids(IndexerState & state)
+{
+  bool has_overflow = false;
+
+  for (std::size_t i = 0; i < state.mers.size() && !has_overflow; ++i)
+  {
+    for (auto const & entry : state.mers[i])
+    {
+      if (entry.num_variant_ids > IndexEntry::INLINE_IDS)
+      {
+        has_overflow = true;
+        break;
+      }
+    }
+  }
+
+  if (!has_overflow)
+  {
+    state.arena.clear();
+    state.max_arena_size = IndexerState::MIN_ARENA_SIZE;
+    return;
+  }
+
+  if (state.arena.size() <= state.max_arena_size)
+    return;
+
+  state.spare_arena.clear();
+
+  for (std::size_t i = 0; i < state.mers.size(); ++i)
+  {
+    for (auto & entry : state.mers[i])
+    {
+      if (entry.num_variant_ids <= IndexEntry::INLINE_IDS)
+        continue;
+
+      entry.get_variant_ids(state.variant_ids.data(), state.arena);
+      entry.overflow = VariantIdArena::NO_NODE;
+
+      for (uint32_t j = IndexEntry::INLINE_IDS; j < entry.num_variant_ids; ++j)
+        entry.overflow = state.spare_arena.push(state.variant_ids[j], entry.overflow);
+    }
+  }
 
+  std::swap(state.arena, state.spare_arena);
+  state.max_arena_size = std::max(IndexerState::MIN_ARENA_SIZE, 2 * state.arena.size());
+}
+
+
+template <typename TIndex>
 void
-index_reference_label(Index<RocksDB> & new_index, TEntryList & mers, Label const & label)
+index_reference_label(TIndex & new_index, IndexerState & state, Label const & label)
 {
-  for (unsigned d = 0; d < seqan::length(label.dna); ++d)
+  EntryRing & mers = state.mers;
+
+  for (unsigned d = 0; d < label.dna.size(); ++d)
   {
     if (label.dna[d] == 'N')
     {
@@ -42,43 +186,28 @@ index_reference_label(Index<RocksDB> & new_index, TEntryList & mers, Label const
       continue;
     }
 
-    for (auto list_it = mers.begin(); list_it != mers.end(); ++list_it)
+    for (std::size_t i = 0; i < mers.size(); ++i)
     {
-      for (auto sublist_it = list_it->begin(); sublist_it != list_it->end(); ++sublist_it)
-      {
-        sublist_it->add_to_dna(label.dna[d]);
-      }
+      for (auto & entry : mers[i])
+        entry.add_to_dna(label.dna[d]);
     }
 
     // Add a new element with the new DNA base
     {
       IndexEntry index_entry(label.order + d);
       index_entry.add_to_dna(label.dna[d]);
-      mers.push_front(TEntrySublist(1, index_entry));
+      mers.push_front().push_back(index_entry);
     }
 
     if (mers.size() >= K)
     {
-      for (auto q_it = mers.back().begin(); q_it != mers.back().end(); ++q_it)
+      for (auto const & entry : mers.back())
       {
         // Skip invalid labels (e.g. labels with '*')
-        if (q_it->valid > 0)
+        if (entry.valid > 0)
           continue;
 
-        if (q_it->variant_id.size() == 0)
-        {
-          new_index.put(q_it->dna, KmerLabel(q_it->start_index, label.order + d)); // KmerLabel has implicit var_id = INVALID_ID
-        }
-        else
-        {
-          std::vector<KmerLabel> new_labels;
-          new_labels.reserve(q_it->variant_id.size());
-
-          for (unsigned i = 0; i < q_it->variant_id.size(); ++i)
-            new_labels.push_back(KmerLabel(q_it->start_index, label.order + d, q_it->variant_id[i]));
-
-          new_index.put(q_it->dna, std::move(new_labels));
-        }
+        put_entry(new_index, state, entry, label.order + d);
       }
 
       mers.pop_back();
@@ -87,9 +216,11 @@ index_reference_label(Index<RocksDB> & new_index, TEntryList & mers, Label const
 }
 
 
+template <typename TIndex>
 void
-insert_variant_label(Index<RocksDB> & new_index,
-                     TEntryList & mers,
+insert_variant_label(TIndex & new_index,
+                     IndexerState & state,
+                     EntryRing & mers,
                      Label const & label,
                      TNodeIndex const v,
                      bool const is_reference,
@@ -97,16 +228,14 @@ insert_variant_label(Index<RocksDB> & new_index,
                      std::size_t const ref_reach
                      )
 {
-  for (unsigned d = 0; d < seqan::length(label.dna); ++d)
+  for (unsigned d = 0; d < label.dna.size(); ++d)
   {
-    for (auto sublist_it = mers.begin(); sublist_it != mers.end(); ++sublist_it)
+    for (std::size_t i = 0; i < mers.size(); ++i)
     {
-      for (auto entry_it = sublist_it->begin(); entry_it != sublist_it->end(); ++entry_it)
+      for (auto & entry : mers[i])
       {
-        entry_it->add_to_dna(label.dna[d]);
-
-        if (std::find(entry_it->variant_id.begin(), entry_it->variant_id.end(), v) == entry_it->variant_id.end())
-          entry_it->variant_id.push_back(static_cast<unsigned>(v));
+        entry.add_to_dna(label.dna[d]);
+        entry.add_variant_id(static_cast<uint32_t>(v), state.arena);
       }
     }
 
@@ -114,30 +243,22 @@ insert_variant_label(Index<RocksDB> & new_index,
     uint32_t pos = label.order + d;
 
     if (pos > ref_reach)
-      pos = graph.get_special_pos(pos, static_cast<uint32_t>(ref_reach));
+      pos = state.graph.get_special_pos(pos, static_cast<uint32_t>(ref_reach));
 
     IndexEntry new_index_entry(pos, static_cast<uint32_t>(v), is_reference, var_count);
     new_index_entry.add_to_dna(label.dna[d]);
-
-    // If we are using a list
-    mers.push_front(TEntrySublist(1, new_index_entry));
+    mers.push_front().push_back(new_index_entry);
 
     if (mers.size() >= K)
     {
       // Insert to map
-      for (auto q_it = mers.back().begin(); q_it != mers.back().end(); ++q_it)
+      for (auto const & entry : mers.back())
       {
         // Skip invalid labels (e.g. labels with '*')
-        if (q_it->valid > 0)
+        if (entry.valid > 0)
           continue;
 
-        std::vector<KmerLabel> new_labels;
-        new_labels.reserve(q_it->variant_id.size());
-
-        for (unsigned i = 0; i < q_it->variant_id.size(); ++i)
-          new_labels.push_back(KmerLabel(q_it->start_index, pos, q_it->variant_id[i]));
-
-        new_index.put(q_it->dna, std::move(new_labels));
+        put_entry(new_index, state, entry, pos);
       }
 
       mers.pop_back();
@@ -147,58 +268,60 @@ insert_variant_label(Index<RocksDB> & new_index,
 
 
 void
-append_list(TEntryList & mers, TEntryList && list)
+append_list(EntryRing & mers, EntryRing const & list)
 {
   if (mers.size() < list.size())
-    mers.resize(list.size());
+    mers.grow(list.size());
 
-  auto mer_it = mers.begin();
-  auto list_it = list.begin();
-
-  while (list_it != list.end())
-  {
-    std::move(list_it->begin(), list_it->end(), std::back_inserter(*mer_it));
-    ++list_it;
-    ++mer_it;
-  }
+  for (std::size_t i = 0; i < list.size(); ++i)
+    mers[i].insert(mers[i].end(), list[i].begin(), list[i].end());
 
   assert(list.size() <= mers.size());
 }
 
 
 void
-remove_large_variants_from_list(TEntryList & list, unsigned const var_count)
+remove_large_variants_from_list(EntryRing & list, unsigned const var_count)
 {
-  for (auto sublist_it = list.begin(); sublist_it != list.end(); ++sublist_it)
+  for (std::size_t i = 0; i < list.size(); ++i)
   {
-    for (auto entry_it = sublist_it->begin(); entry_it != sublist_it->end(); ++entry_it)
+    EntryRing::TSublist & sublist = list[i];
+
+    for (auto & entry : sublist)
     {
-      entry_it->total_var_num *= var_count;
-      ++entry_it->total_var_count;
+      entry.total_var_num *= var_count;
+      ++entry.total_var_count;
     }
 
-    sublist_it->erase(std::remove_if(sublist_it->begin(), sublist_it->end(), entry_has_too_many_nonrefs),
-                      sublist_it->end());
+    sublist.erase(std::remove_if(sublist.begin(), sublist.end(), entry_has_too_many_nonrefs), sublist.end());
   }
 }
 
 
+template <typename TIndex>
 void
-index_variant(Index<RocksDB> & new_index,
-              std::vector<VarNode> const & var_nodes,
-              TEntryList & mers,
+index_variant(TIndex & new_index,
+              TVarNodes const & var_nodes,
+              IndexerState & state,
               unsigned var_count,
               TNodeIndex v
               )
 {
-  TEntryList clean_list(mers); // copies all mers, we find new kmers using the copy.
+  state.clean_list.assign(state.mers); // copies all mers, we find new kmers using the copy.
 
   // Insert reference label
   std::size_t const ref_label_reach = var_nodes[v].get_label().reach();
-  insert_variant_label(new_index, mers, var_nodes[v].get_label(), v, true /*is reference*/, 1, ref_label_reach);
+  insert_variant_label(new_index,
+                       state,
+                       state.mers,
+                       var_nodes[v].get_label(),
+                       v,
+                       true /*is reference*/,
+                       1,
+                       ref_label_reach);
 
   // Remove all labels with large variants
-  remove_large_variants_from_list(clean_list, var_count);
+  remove_large_variants_from_list(state.clean_list, var_count);
   unsigned const var_num = var_count;
 
   // Loops over variants
@@ -207,48 +330,201 @@ index_variant(Index<RocksDB> & new_index,
     --var_count;
     ++v;
 
-    TEntryList new_list(clean_list); // copies all mers, we find new kmers using the new copy
+    state.new_list.assign(state.clean_list); // copies all mers, we find new kmers using the new copy
     insert_variant_label(new_index,
-                         new_list,
+                         state,
+                         state.new_list,
                          var_nodes[v].get_label(),
                          v,
                          false /*is reference*/,
                          var_num,
                          ref_label_reach);
-    append_list(mers, std::move(new_list));
+    append_list(state.mers, state.new_list);
   }
 
   // No need to copy clean_list on the last variant
   ++v;
   insert_variant_label(new_index,
-                       clean_list,
+                       state,
+                       state.clean_list,
                        var_nodes[v].get_label(),
                        v,
                        false /*is reference*/,
                        var_num,
                        ref_label_reach);
-  append_list(mers, std::move(clean_list));
+  append_list(state.mers, state.clean_list);
 }
 
 
+/** \brief Indexes reference node 'r' followed by the variants after it. */
+template <typename TIndex>
 void
-index_graph(std::string const & index_path)
+index_reference_node(TIndex & new_index, IndexerState & state, TNodeIndex const r)
 {
-  Index<RocksDB> new_index(index_path, true /*clear_first*/, false /*read_only*/);
+  Graph const & graph = state.graph;
+  index_reference_label(new_index, state, graph.ref_nodes[r].get_label());
 
-  assert(graph.ref_nodes.back().out_degree() == 0);
+  if (graph.ref_nodes[r].out_degree() > 0)
+  {
+    index_variant(new_index,
+                  graph.var_nodes,
+                  state,
+                  static_cast<int>(graph.ref_nodes[r].out_degree()),
+                  graph.ref_nodes[r].get_var_index(0)
+                  );
+  }
+
+  release_variant_ids(state);
+}
+
+
+/** \brief Discards all labels, used to rebuild the k-mer window at the start of a partition. */
+class NullIndex
+{
+public:
+  void put(TKmerKey const, KmerLabel &&) {}
+  void put(TKmerKey const, std::vector<KmerLabel> &&) {}
+};
+
+
+/** \brief Keeps the labels of a partition in the order they were put, to be replayed into the real index. */
+class KmerLabelBuffer
+{
+public:
+  std::vector<std::pair<TKmerKey, KmerLabel> > labels;
+
+  void
+  put(TKmerKey const key, KmerLabel && label)
+  {
+    labels.emplace_back(key, std::move(label));
+  }
+
+  void
+  put(TKmerKey const key, std::vector<KmerLabel> && new_labels)
+  {
+    for (auto & label : new_labels)
+      labels.emplace_back(key, std::move(label));
+  }
+};
+
+
+/**
+ * \brief Gives 'state' the k-mer window the serial walk has when it reaches reference node r_begin.
+ * \details Only the last K - 1 bases of reference node r_begin - 1 can reach into the partition and none of the older
+ *          k-mers survive past them. Indexing those bases and the variants after them first, while discarding their
+ *          labels, gives the same k-mer window as the serial walk.
+ */
+void
+start_partition(IndexerState & state, TNodeIndex const r_begin)
+{
+  if (r_begin == 0)
+    return;
+
+  Graph const & graph = state.graph;
+  Label const & prev_label = graph.ref_nodes[r_begin - 1].get_label();
+  assert(prev_label.dna.size() >= K - 1);
+  std::size_t const offset = prev_label.dna.size() - (K - 1);
+  Label const tail(static_cast<uint32_t>(prev_label.order + offset),
+                   prev_label.dna.substr(offset, K - 1),
+                   prev_label.variant_num);
+
+  NullIndex null_index;
+  index_reference_label(null_index, state, tail);
+
+  if (graph.ref_nodes[r_begin - 1].out_degree() > 0)
+  {
+    index_variant(null_index,
+                  graph.var_nodes,
+                  state,
+                  static_cast<int>(graph.ref_nodes[r_begin - 1].out_degree()),
+                  graph.ref_nodes[r_begin - 1].get_var_index(0)
+                  );
+  }
+}
+
+
+/** \brief Indexes reference nodes [r_begin, r_end) of 'graph' into 'buffer'. */
+void
+index_partition(KmerLabelBuffer * buffer, Graph const * graph, TNodeIndex const r_begin, TNodeIndex const r_end)
+{
+  IndexerState state(*graph);
+  start_partition(state, r_begin);
+
+  for (TNodeIndex r = r_begin; r < r_end; ++r)
+    index_reference_node(*buffer, state, r);
+}
+
+
+/**
+ * \brief Runs 'jobs' in parallel and returns when all have finished.
+ * \details When regions are genotyped concurrently the jobs are leaf tasks of their scheduler, so idle threads of any
+ *          region run them instead of each region starting threads of its own.
+ */
+void
+run_index_jobs(std::vector<std::function<void()> > & jobs)
+{
+  GenotypingContext const & context = current_context();
+
+  if (context.scheduler)
+  {
+    std::vector<TaskScheduler::TaskId> job_tasks;
+
+    for (auto & job : jobs)
+      job_tasks.push_back(context.scheduler->add_task(std::move(job), context.task_key));
+
+    context.scheduler->wait(job_tasks);
+    return;
+  }
+
+  long const num_jobs = static_cast<long>(jobs.size());
+  paw::Station index_station(num_jobs);
+
+  for (long j = 0; j + 1 < num_jobs; ++j)
+    index_station.add_work(jobs[j]);
+
+  index_station.add_to_thread(num_jobs - 1, jobs[num_jobs - 1]); // The last job runs on the calling thread
+  index_station.join();
+}
+
+
+/**
+ * \brief Picks up to 'num_partitions' reference nodes where partitions start, with about equally many bases in each.
+ * \details A partition can only start after a reference label of at least K - 1 bases.
+ */
+std::vector<TNodeIndex>
+get_partition_starts(Graph const & graph, std::size_t const num_partitions)
+{
+  uint64_t const start_order = graph.ref_nodes.front().get_label().order;
+  uint64_t const end_order = graph.ref_nodes.back().get_label().order + graph.ref_nodes.back().get_label().dna.size();
+  std::vector<TNodeIndex> starts(1, 0);
+
+  for (TNodeIndex r = 1; r < graph.ref_nodes.size() && starts.size() < num_partitions; ++r)
+  {
+    if (graph.ref_nodes[r - 1].get_label().dna.size() < K - 1)
+      continue;
+
+    uint64_t const goal_order = start_order + (end_order - start_order) * starts.size() / num_partitions;
+
+    if (graph.ref_nodes[r].get_label().order >= goal_order)
+      starts.push_back(r);
+  }
+
+  return starts;
+}
+
+
+template <typename TIndex>
+void
+index_graph_serial(TIndex & new_index, Graph const & graph)
+{
   uint32_t const start_order = graph.ref_nodes.front().get_label().order;
   uint32_t const end_order = static_cast<uint32_t>(graph.ref_nodes.back().get_label().order +
                                                    graph.ref_nodes.back().get_label().dna.size());
   uint32_t goal_order = start_order;
   uint32_t goal = 0;
+  IndexerState state(graph);
 
-  TNodeIndex r = 0; // Reference node index
-  // TNodeIndex v = 0; // Variant node index
-  TEntryList mers;
-  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] The number of reference nodes are " << graph.ref_nodes.size();
-
-  while (r < graph.ref_nodes.size() - 1)
+  for (TNodeIndex r = 0; r < graph.ref_nodes.size(); ++r)
   {
     if (graph.ref_nodes[r].get_label().order >= goal_order)
     {
@@ -257,38 +533,474 @@ index_graph(std::string const & index_path)
       goal += 20;
     }
 
-    index_reference_label(new_index, mers, graph.ref_nodes[r].get_label());
+    index_reference_node(new_index, state, r);
+  }
+
+  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] Indexing progress: 100" << '%';
+}
+
+
+template <typename TIndex>
+void
+index_graph_into(TIndex & new_index, Graph const & graph, long const max_index_memory)
+{
+  assert(graph.ref_nodes.back().out_degree() == 0);
+  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] The number of reference nodes are " << graph.ref_nodes.size();
+  long const num_threads = std::max(1l, static_cast<long>(Options::const_instance()->threads));
+
+  // A few partitions per thread even out partitions with more variants than others. With a memory limit, there are
+  // also enough partitions for the labels buffered in one wave to take at most half of it.
+  uint64_t num_partitions_goal = num_threads * 4;
+
+  if (max_index_memory > 0)
+  {
+    uint64_t const BYTES_PER_BASE = 2 * sizeof(std::pair<TKmerKey, KmerLabel>); // About two labels per base
+    uint64_t const num_bases = graph.ref_nodes.back().get_label().order + graph.ref_nodes.back().get_label().dna.size() -
+                               graph.ref_nodes.front().get_label().order;
+    uint64_t const wave_bases = std::max(static_cast<uint64_t>(1),
+                                         (static_cast<uint64_t>(max_index_memory) << 20) / 2 / BYTES_PER_BASE);
+    num_partitions_goal = std::max(num_partitions_goal, num_threads * (num_bases / wave_bases + 1));
+  }
+
+  std::vector<TNodeIndex> const starts =
+    num_threads > 1 ? get_partition_starts(graph, num_partitions_goal) : std::vector<TNodeIndex>(1, 0);
+
+  if (starts.size() <= 1)
+  {
+    index_graph_serial(new_index, graph);
+    return;
+  }
+
+  long const num_partitions = static_cast<long>(starts.size());
+  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] Indexing " << num_partitions << " partitions with "
+                           << num_threads << " threads";
+
+  // Partitions are indexed in waves of one per thread and their labels are put into the index in the same order as
+  // the serial walk puts them, so the index is identical. Only one wave of labels is buffered at a time.
+  std::vector<KmerLabelBuffer> buffers;
+
+  for (long p_begin = 0; p_begin < num_partitions; p_begin += num_threads)
+  {
+    long const p_end = std::min(num_partitions, p_begin + num_threads);
+    buffers.clear();
+    buffers.resize(p_end - p_begin);
+
+    std::vector<std::function<void()> > jobs;
+
+    for (long p = p_begin; p < p_end; ++p)
+    {
+      TNodeIndex const r_end = p + 1 < num_partitions ? starts[p + 1] : graph.ref_nodes.size();
+      jobs.push_back(std::bind(index_partition, &buffers[p - p_begin], &graph, starts[p], r_end));
+    }
+
+    run_index_jobs(jobs);
 
-    if (graph.ref_nodes[r].out_degree() > 0)
+    for (auto & buffer : buffers)
     {
-      index_variant(new_index,
-                    graph.var_nodes,
-                    mers,
-                    static_cast<int>(graph.ref_nodes[r].out_degree()),
-                    graph.ref_nodes[r].get_var_index(0)
-                    );
+      for (auto & key_label : buffer.labels)
+        new_index.put(key_label.first, std::move(key_label.second));
     }
 
-    ++r;
+    BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] Indexing progress: " << (100 * p_end / num_partitions) << '%';
   }
+}
 
-  index_reference_label(new_index, mers, graph.ref_nodes.back().get_label());
-  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] Indexing progress: 100" << '%';
-  mers.clear();
 
-  // Commit the rest of the buffer before closing
-  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] Writing index to disk...";
-  new_index.commit();
+void
+index_graph(std::string const & index_path)
+{
+  Index<RocksDB> new_index(index_path, true /*clear_first*/, false /*read_only*/);
+  long const max_index_memory = Options::const_instance()->max_index_memory > 0 ?
+                                Options::const_instance()->max_index_memory : DEFAULT_MAX_INDEX_MEMORY;
+  bool const is_flat_index = Options::const_instance()->flat_index;
+  std::string const flat_index_path = get_flat_index_path(index_path);
+  std::remove(flat_index_path.c_str()); // Clearing the database does not remove it
+
+  // The database is written once, so it is bulk loaded from SST files which have the keys in the database's order
+  SstIndexWriter sst_writer(new_index);
+
+  // Keep the labels in sorted runs within the memory limit and write each key once when merging them
+  SortedRunWriter runs(index_path + "_run", static_cast<std::size_t>(max_index_memory) << 20);
+  DbKeyOrderSink<SortedRunWriter> runs_sink(runs);
+  index_graph_into(runs_sink, current_context().graph, max_index_memory);
+  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] Merging " << runs.get_num_labels() << " labels in "
+                           << runs.get_num_runs() << " sorted runs";
+
+  // The flat index file needs the whole table in memory. Its labels are kept back to back as the runs are merged, so
+  // they are not buffered by key.
+  std::vector<TKmerKey> flat_keys;
+  std::vector<uint32_t> flat_counts;
+  HugePageVector<PackedKmerLabel> flat_labels;
+
+  if (is_flat_index)
+    flat_labels.reserve(runs.get_num_labels());
+
+  runs.merge([&](TKmerKey const key_order, std::vector<KmerLabel> & labels)
+    {
+      TKmerKey const key = to_db_key_order(key_order);
+      sst_writer.put(key, labels);
+
+      if (is_flat_index)
+      {
+        flat_keys.push_back(key);
+        flat_counts.push_back(static_cast<uint32_t>(labels.size()));
+        flat_labels.insert(flat_labels.end(), labels.begin(), labels.end());
+      }
+    });
+
+  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] Ingesting " << sst_writer.get_num_keys()
+                           << " K-mers into the index...";
+  sst_writer.ingest();
+
+  if (is_flat_index)
+  {
+    // The database keeps the labels of repeats, they are masked in the flat index
+    MemIndex new_mem_index;
+    new_mem_index.build(flat_keys, flat_counts, std::move(flat_labels));
+    BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] Writing flat index to " << flat_index_path;
+    new_mem_index.save(flat_index_path);
+  }
+
   BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] Done.";
 }
 
 
+void
+index_graph(MemIndex & new_mem_index, bool const mask_repeats)
+{
+  new_mem_index = MemIndex();
+  index_graph_into(new_mem_index, current_context().graph, Options::const_instance()->max_index_memory);
+
+  // Move the buffered labels into the hash table
+  new_mem_index.commit(mask_repeats);
+  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] Done. The in-memory index has "
+                           << new_mem_index.hamming0.size() << " K-mers. Multiplicity: "
+                           << new_mem_index.get_multiplicity_stats().to_string();
+}
+
+
+void
+index_graph(GenotypingContext & context, bool const mask_repeats)
+{
+  ContextBinding binding(context);
+  index_graph(context.mem_index, mask_repeats);
+}
+
+
+/** \brief The reference nodes where the segments of the incremental indexer start. */
+std::vector<TNodeIndex>
+get_segment_starts(Graph const & graph)
+{
+  std::vector<TNodeIndex> starts(1, 0);
+
+  for (TNodeIndex r = 1; r < graph.ref_nodes.size(); ++r)
+  {
+    if (graph.ref_nodes[r - 1].get_label().dna.size() >= K - 1)
+      starts.push_back(r);
+  }
+
+  return starts;
+}
+
+
+TNodeIndex
+get_segment_end(Graph const & graph, std::vector<TNodeIndex> const & starts, std::size_t const s)
+{
+  return s + 1 < starts.size() ? starts[s + 1] : graph.ref_nodes.size();
+}
+
+
+/** \brief Indexes segments [s_begin, s_end) into 'buffer' and adds where the labels of each segment end to 'label_ends'. */
+void
+index_segments(KmerLabelBuffer * buffer,
+               std::vector<std::size_t> * label_ends,
+               Graph const * graph,
+               std::vector<TNodeIndex> const * starts,
+               std::size_t const s_begin,
+               std::size_t const s_end)
+{
+  IndexerState state(*graph);
+  start_partition(state, (*starts)[s_begin]);
+
+  for (std::size_t s = s_begin; s < s_end; ++s)
+  {
+    for (TNodeIndex r = (*starts)[s]; r < get_segment_end(*graph, *starts, s); ++r)
+      index_reference_node(*buffer, state, r);
+
+    label_ends->push_back(buffer->labels.size());
+  }
+}
+
+
+bool
+is_same_label(Label const & a, Label const & b)
+{
+  return a.order == b.order && a.dna == b.dna;
+}
+
+
+/** \brief Checks if the variants after reference node 'old_r' of 'old_graph' and 'r' of 'graph' are the same. */
+bool
+is_same_bubble(Graph const & graph, Graph const & old_graph, TNodeIndex const old_r, TNodeIndex const r)
+{
+  RefNode const & old_ref_node = old_graph.ref_nodes[old_r];
+  RefNode const & ref_node = graph.ref_nodes[r];
+
+  if (old_ref_node.out_degree() != ref_node.out_degree())
+    return false;
+
+  for (TNodeIndex i = 0; i < ref_node.out_degree(); ++i)
+  {
+    if (!is_same_label(old_graph.var_nodes[old_ref_node.get_var_index(0) + i].get_label(),
+                       graph.var_nodes[ref_node.get_var_index(0) + i].get_label()))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+/** \brief Checks if the labels of a segment of 'old_graph' are also the labels of a segment of 'graph'. */
+bool
+is_same_segment(Graph const & graph,
+                Graph const & old_graph,
+                TNodeIndex const old_r_begin,
+                TNodeIndex const old_r_end,
+                TNodeIndex const r_begin,
+                TNodeIndex const r_end)
+{
+  if (old_r_end - old_r_begin != r_end - r_begin || (old_r_begin == 0) != (r_begin == 0))
+    return false;
+
+  if (r_begin > 0)
+  {
+    // Only the last K - 1 bases of the previous reference node and the variants after it reach into the segment
+    Label const & old_prev_label = old_graph.ref_nodes[old_r_begin - 1].get_label();
+    Label const & prev_label = graph.ref_nodes[r_begin - 1].get_label();
+
+    if (old_prev_label.order + old_prev_label.dna.size() != prev_label.order + prev_label.dna.size() ||
+        !std::equal(prev_label.dna.end() - (K - 1), prev_label.dna.end(), old_prev_label.dna.end() - (K - 1)) ||
+        !is_same_bubble(graph, old_graph, old_r_begin - 1, r_begin - 1))
+    {
+      return false;
+    }
+  }
+
+  for (TNodeIndex i = 0; i < r_end - r_begin; ++i)
+  {
+    if (!is_same_label(old_graph.ref_nodes[old_r_begin + i].get_label(), graph.ref_nodes[r_begin + i].get_label()) ||
+        !is_same_bubble(graph, old_graph, old_r_begin + i, r_begin + i))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+/** \brief The position in 'graph' of position 'pos' in 'old_graph'. Only special positions are numbered differently. */
+uint32_t
+renumber_pos(Graph const & graph, Graph const & old_graph, uint32_t const pos)
+{
+  if (!old_graph.is_special_pos(pos))
+    return pos;
+
+  uint32_t const i = pos - SPECIAL_START;
+  return graph.get_special_pos(old_graph.actual_poses[i], old_graph.ref_reach_poses[i]);
+}
+
+
+void
+IncrementalIndexer::index(MemIndex & new_mem_index)
+{
+  rebuild(new_mem_index, nullptr);
+}
+
+
+void
+IncrementalIndexer::update(MemIndex & new_mem_index, Graph const & old_graph)
+{
+  rebuild(new_mem_index, &old_graph);
+}
+
+
+void
+IncrementalIndexer::rebuild(MemIndex & new_mem_index, Graph const * old_graph)
+{
+  Graph const & graph = current_context().graph;
+  new_mem_index = MemIndex();
+
+  if (graph.ref_nodes.size() == 0)
+  {
+    segments.clear();
+    labels.clear();
+    num_indexed_segments = 0;
+    return;
+  }
+
+  std::vector<TNodeIndex> const starts = get_segment_starts(graph);
+  std::size_t const num_segments = starts.size();
+  std::size_t const NO_SEGMENT = static_cast<std::size_t>(-1);
+  std::vector<std::size_t> old_segments(num_segments, NO_SEGMENT); // The same segment of the old graph, if any
+
+  if (old_graph)
+  {
+    std::size_t o = 0;
+
+    for (std::size_t s = 0; s < num_segments; ++s)
+    {
+      uint32_t const order = graph.ref_nodes[starts[s]].get_label().order;
+
+      while (o < segments.size() && segments[o].order < order)
+        ++o;
+
+      if (o == segments.size() || segments[o].order != order)
+        continue;
+
+      TNodeIndex const old_r_end = o + 1 < segments.size() ? segments[o + 1].r_begin : old_graph->ref_nodes.size();
+
+      TNodeIndex const r_end = get_segment_end(graph, starts, s);
+
+      if (is_same_segment(graph, *old_graph, segments[o].r_begin, old_r_end, starts[s], r_end))
+        old_segments[s] = o;
+    }
+  }
+
+  // Index the other segments in jobs of consecutive segments, a few jobs for each thread
+  long const num_threads = std::max(1l, static_cast<long>(Options::const_instance()->threads));
+  std::size_t const max_job_segments = std::max(static_cast<std::size_t>(1), num_segments / (num_threads * 4));
+  std::vector<std::pair<std::size_t, std::size_t> > jobs; // Segments [first, second) are indexed in one job
+
+  for (std::size_t s = 0; s < num_segments; ++s)
+  {
+    if (old_segments[s] != NO_SEGMENT)
+      continue;
+
+    if (jobs.size() > 0 && jobs.back().second == s && jobs.back().second - jobs.back().first < max_job_segments)
+      ++jobs.back().second;
+    else
+      jobs.push_back({s, s + 1});
+  }
+
+  std::vector<KmerLabelBuffer> buffers(jobs.size());
+  std::vector<std::vector<std::size_t> > label_ends(jobs.size());
+
+  for (long j_begin = 0; j_begin < static_cast<long>(jobs.size()); j_begin += num_threads)
+  {
+    long const j_end = std::min(static_cast<long>(jobs.size()), j_begin + num_threads);
+    std::vector<std::function<void()> > index_jobs;
+
+    for (long j = j_begin; j < j_end; ++j)
+    {
+      index_jobs.push_back(std::bind(index_segments,
+                                     &buffers[j],
+                                     &label_ends[j],
+                                     &graph,
+                                     &starts,
+                                     jobs[j].first,
+                                     jobs[j].second));
+    }
+
+    run_index_jobs(index_jobs);
+  }
+
+  // Put the labels of the segments together in the order of the graph
+  struct BubbleIds
+  {
+    uint32_t old_first;
+    uint32_t count;
+    uint32_t first;
+  };
+
+  std::vector<Segment> new_segments;
+  std::vector<std::pair<TKmerKey, PackedKmerLabel> > new_labels;
+  std::vector<BubbleIds> bubble_ids;
+  new_segments.reserve(num_segments);
+  new_labels.reserve(labels.size());
+  std::size_t j = 0;
+
+  for (std::size_t s = 0; s < num_segments; ++s)
+  {
+    new_segments.push_back({graph.ref_nodes[starts[s]].get_label().order, starts[s], new_labels.size()});
+
+    if (old_segments[s] == NO_SEGMENT)
+    {
+      while (s >= jobs[j].second)
+        ++j;
+
+      std::size_t const k = s - jobs[j].first;
+      std::size_t const first = k == 0 ? 0 : label_ends[j][k - 1];
+
+      for (std::size_t l = first; l < label_ends[j][k]; ++l)
+        new_labels.emplace_back(buffers[j].labels[l].first, PackedKmerLabel(buffers[j].labels[l].second));
+
+      continue;
+    }
+
+    // The labels can have the variant IDs of the bubbles in the segment and the one before it
+    std::size_t const o = old_segments[s];
+    TNodeIndex const old_r_begin = segments[o].r_begin;
+    bubble_ids.clear();
+
+    for (TNodeIndex i = starts[s] > 0 ? 0 : 1; i <= get_segment_end(graph, starts, s) - starts[s]; ++i)
+    {
+      RefNode const & old_ref_node = old_graph->ref_nodes[old_r_begin + i - 1];
+
+      if (old_ref_node.out_degree() > 0)
+      {
+        bubble_ids.push_back({static_cast<uint32_t>(old_ref_node.get_var_index(0)),
+                              static_cast<uint32_t>(old_ref_node.out_degree()),
+                              static_cast<uint32_t>(graph.ref_nodes[starts[s] + i - 1].get_var_index(0))});
+      }
+    }
+
+    std::size_t const old_labels_end = o + 1 < segments.size() ? segments[o + 1].labels_begin : labels.size();
+
+    for (std::size_t l = segments[o].labels_begin; l < old_labels_end; ++l)
+    {
+      PackedKmerLabel label = labels[l].second;
+      label.start_index = renumber_pos(graph, *old_graph, label.start_index);
+      label.end_index = renumber_pos(graph, *old_graph, label.end_index);
+
+      for (auto const & ids : bubble_ids)
+      {
+        if (label.variant_id >= ids.old_first && label.variant_id < ids.old_first + ids.count)
+        {
+          label.variant_id = label.variant_id - ids.old_first + ids.first;
+          break;
+        }
+      }
+
+      new_labels.emplace_back(labels[l].first, label);
+    }
+  }
+
+  segments = std::move(new_segments);
+  labels = std::move(new_labels);
+  num_indexed_segments = std::count(old_segments.begin(), old_segments.end(), NO_SEGMENT);
+
+  for (auto const & key_label : labels)
+  {
+    PackedKmerLabel const & label = key_label.second;
+    new_mem_index.put(key_label.first, KmerLabel(label.start_index, label.end_index, label.variant_id));
+  }
+
+  new_mem_index.commit();
+  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::indexer] Indexed " << num_indexed_segments << " of " << num_segments
+                           << " segments again. The in-memory index has " << new_mem_index.hamming0.size()
+                           << " K-mers.";
+}
+
+
 void
 index_graph(std::string const & graph_path, std::string const & index_path)
 {
   load_graph(graph_path);
 
-  if (graph.size() == 0)
+  if (current_context().graph.size() == 0)
   {
     BOOST_LOG_TRIVIAL(warning) << "[graphtyper::indexer] WARNING: Trying to index empty graph.";
     return;
@@ -0,0 +1,151 @@
+#include <cassert> // assert
+#include <sstream> // std::ostringstream
+#include <utility> // std::move
+
+#include <graphtyper/index/kmer_filter.hpp>
+
+
+namespace gyper
+{
+
+uint64_t constexpr KmerFilter::BITS_PER_KEY;
+uint64_t constexpr KmerFilter::NUM_BITS;
+uint64_t constexpr KmerFilter::WORDS_PER_BLOCK;
+
+
+void
+KmerFilter::reset(std::size_t const num_keys)
+{
+  // The number of blocks is a power of two, at most 2^28 blocks (16 GB)
+  uint64_t const wanted_blocks = (num_keys * BITS_PER_KEY + 511ull) / 512ull;
+  uint64_t num_blocks = 1;
+
+  while (num_blocks < wanted_blocks && num_blocks < (1ull << 28))
+    num_blocks <<= 1;
+
+  blocks = HugePageVector<uint64_t>(num_blocks * WORDS_PER_BLOCK, 0ull);
+  words = blocks.data();
+  num_words = blocks.size();
+  block_mask = num_blocks - 1;
+}
+
+
+KmerFilter::KmerFilter(KmerFilter const & o)
+{
+  *this = o;
+}
+
+
+KmerFilter::KmerFilter(KmerFilter && o) noexcept
+{
+  *this = std::move(o);
+}
+
+
+KmerFilter &
+KmerFilter::operator=(KmerFilter const & o)
+{
+  if (this == &o)
+    return *this;
+
+  blocks = o.blocks;
+  words = o.words == o.blocks.data() ? blocks.data() : o.words;
+  num_words = o.num_words;
+  block_mask = o.block_mask;
+  return *this;
+}
+
+
+KmerFilter &
+KmerFilter::operator=(KmerFilter && o) noexcept
+{
+  if (this == &o)
+    return *this;
+
+  // Moving a vector keeps its buffer, so a pointer into owned words stays valid
+  blocks = std::move(o.blocks);
+  words = o.words;
+  num_words = o.num_words;
+  block_mask = o.block_mask;
+  o.clear();
+  return *this;
+}
+
+
+void
+KmerFilter::clear()
+{
+  blocks = HugePageVector<uint64_t>();
+  words = nullptr;
+  num_words = 0;
+  block_mask = 0;
+}
+
+
+void
+KmerFilter::view(uint64_t const * new_words, std::size_t const new_num_words)
+{
+  assert(new_num_words % WORDS_PER_BLOCK == 0);
+  blocks = HugePageVector<uint64_t>();
+  words = new_words;
+  num_words = new_num_words;
+  block_mask = new_num_words > 0 ? new_num_words / WORDS_PER_BLOCK - 1 : 0;
+}
+
+
+KmerFilterStats::KmerFilterStats(KmerFilterStats const & o)
+  : filtered(o.filtered.load())
+  , hits(o.hits.load())
+  , false_positives(o.false_positives.load())
+{}
+
+
+KmerFilterStats &
+KmerFilterStats::operator=(KmerFilterStats const & o)
+{
+  filtered = o.filtered.load();
+  hits = o.hits.load();
+  false_positives = o.false_positives.load();
+  return *this;
+}
+
+
+void
+KmerFilterStats::add(uint64_t const new_filtered, uint64_t const new_hits, uint64_t const new_false_positives)
+{
+  filtered.fetch_add(new_filtered, std::memory_order_relaxed);
+  hits.fetch_add(new_hits, std::memory_order_relaxed);
+  false_positives.fetch_add(new_false_positives, std::memory_order_relaxed);
+}
+
+
+void
+KmerFilterStats::clear()
+{
+  filtered = 0;
+  hits = 0;
+  false_positives = 0;
+}
+
+
+std::string
+KmerFilterStats::to_string() const
+{
+  uint64_t const f = filtered.load();
+  uint64_t const h = hits.load();
+  uint64_t const fp = false_positives.load();
+  uint64_t const total = f + h + fp;
+  uint64_t const misses = f + fp;
+
+  std::ostringstream ss;
+  ss << "lookups=" << total << " hits=" << h << " misses=" << misses << " filtered=" << f
+     << " false_positives=" << fp;
+
+  if (misses > 0)
+    ss << " (" << (100.0 * static_cast<double>(f) / static_cast<double>(misses)) << "% of misses filtered)";
+
+  return ss.str();
+}
+
+
+} // namespace gyper
@@ -0,0 +1,165 @@
+#include <cassert> // assert
+#include <cstdint> // uint64_t
+#include <mutex> // std::lock_guard
+#include <sstream> // std::ostringstream
+#include <string> // std::string
+#include <utility> // std::swap
+#include <vector> // std::vector
+
+#include <graphtyper/index/kmer_label_cache.hpp>
+
+
+namespace gyper
+{
+
+std::size_t constexpr KmerLabelCache::NUM_SHARDS;
+
+
+KmerLabelCache::KmerLabelCache(std::size_t const max_bytes)
+  : max_shard_bytes(max_bytes / NUM_SHARDS)
+{}
+
+
+KmerLabelCache::Shard &
+KmerLabelCache::get_shard(TKmerKey const key)
+{
+  // Neighbouring k-mers differ in their lowest bits, so mix them before picking a shard
+  return shards[((fold_key(key) * 0x9e3779b97f4a7c15ull) >> 58) % NUM_SHARDS];
+}
+
+
+std::size_t
+KmerLabelCache::get_entry_bytes(std::size_t const num_labels)
+{
+  std::size_t const MAP_NODE_BYTES = 32; // About the size of a node of the position map
+  return sizeof(Entry) + MAP_NODE_BYTES + num_labels * sizeof(PackedKmerLabel);
+}
+
+
+bool
+KmerLabelCache::get(TKmerKey const key, std::vector<PackedKmerLabel> & labels)
+{
+  Shard & shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.positions.find(key);
+
+  if (it == shard.positions.end())
+  {
+    ++shard.misses;
+    return false;
+  }
+
+  Entry & entry = shard.entries[it->second];
+  entry.referenced = true;
+  labels.insert(labels.end(), entry.labels.begin(), entry.labels.end());
+  ++shard.hits;
+  return true;
+}
+
+
+void
+KmerLabelCache::put(TKmerKey const key, std::vector<PackedKmerLabel> const & labels)
+{
+  std::size_t const entry_bytes = get_entry_bytes(labels.size());
+
+  if (entry_bytes > max_shard_bytes)
+    return;
+
+  Shard & shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  // Another thread may have looked up the same key at the same time
+  if (shard.positions.count(key) > 0)
+    return;
+
+  while (shard.bytes + entry_bytes > max_shard_bytes)
+    evict(shard);
+
+  shard.positions[key] = static_cast<uint32_t>(shard.entries.size());
+  shard.entries.push_back({key, labels, false});
+  shard.bytes += entry_bytes;
+}
+
+
+void
+KmerLabelCache::evict(Shard & shard)
+{
+  assert(shard.entries.size() > 0);
+
+  // Give referenced entries a second chance until the hand finds one which is not
+  while (true)
+  {
+    if (shard.hand >= shard.entries.size())
+      shard.hand = 0;
+
+    Entry & entry = shard.entries[shard.hand];
+
+    if (!entry.referenced)
+      break;
+
+    entry.referenced = false;
+    ++shard.hand;
+  }
+
+  // Move the last entry into the evicted slot, so the hand next looks at the entry which was moved there
+  Entry & victim = shard.entries[shard.hand];
+  shard.bytes -= get_entry_bytes(victim.labels.size());
+  shard.positions.erase(victim.key);
+
+  if (shard.hand + 1 < shard.entries.size())
+  {
+    std::swap(victim, shard.entries.back());
+    shard.positions[victim.key] = static_cast<uint32_t>(shard.hand);
+  }
+
+  shard.entries.pop_back();
+  ++shard.evictions;
+}
+
+
+std::size_t
+KmerLabelCache::memory_usage() const
+{
+  std::size_t bytes = 0;
+
+  for (auto const & shard : shards)
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    bytes += shard.bytes;
+  }
+
+  return bytes;
+}
+
+
+std::string
+KmerLabelCache::to_string() const
+{
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  std::size_t entries = 0;
+  std::size_t bytes = 0;
+
+  for (auto const & shard : shards)
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    hits += shard.hits;
+    misses += shard.misses;
+    evictions += shard.evictions;
+    entries += shard.entries.size();
+    bytes += shard.bytes;
+  }
+
+  std::ostringstream ss;
+  ss << "lookups=" << (hits + misses) << " hits=" << hits << " misses=" << misses << " evictions=" << evictions
+     << " entries=" << entries << " MB=" << (bytes >> 20);
+
+  if (hits + misses > 0)
+    ss << " (" << (100.0 * static_cast<double>(hits) / static_cast<double>(hits + misses)) << "% hit rate)";
+
+  return ss.str();
+}
+
+
+} // namespace gyper
@@ -0,0 +1,69 @@
+#include <algorithm> // std::max, std::min
+#include <sstream> // std::ostringstream
+
+#include <graphtyper/index/kmer_multiplicity.hpp>
+
+
+namespace gyper
+{
+
+std::size_t constexpr KmerMultiplicityStats::MAX_MULTIPLICITY;
+
+
+KmerMultiplicityStats::KmerMultiplicityStats()
+  : histogram(MAX_MULTIPLICITY + 1, 0ull)
+{}
+
+
+void
+KmerMultiplicityStats::add(uint64_t const multiplicity, bool const is_repeat)
+{
+  ++histogram[std::min(multiplicity, static_cast<uint64_t>(MAX_MULTIPLICITY))];
+  ++num_keys;
+  num_labels += multiplicity;
+  max_multiplicity = std::max(max_multiplicity, multiplicity);
+
+  if (is_repeat)
+  {
+    ++num_repeat_keys;
+    num_repeat_labels += multiplicity;
+  }
+}
+
+
+uint64_t
+KmerMultiplicityStats::get_quantile(double const fraction) const
+{
+  uint64_t count = 0;
+
+  for (std::size_t m = 0; m < histogram.size(); ++m)
+  {
+    count += histogram[m];
+
+    if (static_cast<double>(count) >= fraction * static_cast<double>(num_keys))
+      return m;
+  }
+
+  return MAX_MULTIPLICITY;
+}
+
+
+std::string
+KmerMultiplicityStats::to_string() const
+{
+  std::ostringstream ss;
+  ss << "keys=" << num_keys << " labels=" << num_labels << " unique=" << histogram[1]
+     << " median=" << get_quantile(0.5) << " p99=" << get_quantile(0.99) << " max=" << max_multiplicity
+     << " repeat_keys=" << num_repeat_keys << " repeat_labels=" << num_repeat_labels;
+
+  if (num_labels > 0)
+  {
+    ss << " (" << (100.0 * static_cast<double>(num_repeat_labels) / static_cast<double>(num_labels))
+       << "% of labels masked)";
+  }
+
+  return ss.str();
+}
+
+
+} // namespace gyper
@@ -1,196 +1,879 @@
+#include <algorithm> // std::min
 #include <array> // std::array
+#include <cstddef> // offsetof
+#include <cstdint> // uint64_t, uintptr_t
+#include <cstdio> // std::FILE, std::fopen, std::fwrite
+#include <cstdlib> // std::exit
+#include <cstring> // std::memcmp, std::memcpy, std::memset
+#include <memory> // std::make_shared
+#include <string> // std::string
+#include <thread> // std::thread
 #include <vector> // std::vector
 #include <unordered_map> // std::unordered_map
 #include <utility>
 
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/constants.hpp> // gyper::K
 #include <graphtyper/graph/graph.hpp> // gyper::Graph
 #include <graphtyper/index/indexer.hpp>
 #include <graphtyper/index/mem_index.hpp> // gyper::MemIndex
+#include <graphtyper/utilities/genotyping_context.hpp> // gyper::current_context
+#include <graphtyper/utilities/mapped_file.hpp> // gyper::MappedFile
+#include <graphtyper/utilities/numa.hpp> // gyper::NumaBuffer
 #include <graphtyper/utilities/options.hpp> // gyper::Options
+#include <graphtyper/utilities/type_conversions.hpp> // gyper::to_uint64_vec_hamming_distance_1
 
 
 namespace gyper
 {
 
+namespace
+{
+
+using TRange = FlatKmerMap<PackedKmerLabel>::Range;
+using THit = std::pair<uint32_t, TRange>;
+
+// How many keys ahead the filter blocks and the table slots are prefetched
+long constexpr FILTER_PREFETCH_DISTANCE = 16;
+long constexpr SLOT_PREFETCH_DISTANCE = 8;
+
+
+// Appends the labels of the ranges of a single seed, unless they are more than max_index_labels in total. Hits with
+// an empty range are masked repeats, which have more labels than that on their own.
 void
-MemIndex::load(Index<RocksDB> & index)
+add_seed_labels(THit const * first, THit const * last, std::vector<PackedKmerLabel> & labels)
 {
-  assert(index.hamming0.db); // Index is open
-  assert(index.opened);
-  this->hamming0 = google::dense_hash_map<uint64_t, std::vector<KmerLabel> >();
+  std::size_t num_results = 0;
+  uint64_t const max_index_labels = Options::const_instance()->max_index_labels;
 
-  for (uint64_t key = 0; key < 0xFFFFFFFFFFFFFFFFull; ++key)
+  for (THit const * it = first; it != last; ++it)
   {
-    if (!index.exists(key))
-    {
-      empty_key = key; // Empty key is a class member
-      break;
-    }
+    if (it->second.empty())
+      return;
+
+    num_results += it->second.size();
+
+    // Too many results, give up on this kmer
+    if (num_results > max_index_labels)
+      return;
+  }
+
+  labels.reserve(labels.size() + num_results);
+
+  for (THit const * it = first; it != last; ++it)
+    labels.insert(labels.end(), it->second.begin(), it->second.end());
+}
+
+
+// Adds the labels of each seed, where seed_ends[i] is one past the index of the last key of seed i
+void
+add_all_seed_labels(std::vector<std::size_t> const & seed_ends, std::vector<THit> const & hits, TPackedKmerLabels & labels)
+{
+  assert(seed_ends.size() == labels.size());
+  THit const * seed_first = hits.data();
+  THit const * const hits_end = hits.data() + hits.size();
+
+  for (std::size_t i = 0; i < seed_ends.size(); ++i)
+  {
+    THit const * seed_last = seed_first;
+
+    while (seed_last != hits_end && seed_last->first < seed_ends[i])
+      ++seed_last;
+
+    add_seed_labels(seed_first, seed_last, labels[i]);
+    seed_first = seed_last;
+  }
+}
+
+
+using TSlot = FlatKmerMap<PackedKmerLabel>::Slot;
+using TRepeatSlot = FlatKmerMap<uint32_t>::Slot;
+
+char const FLAT_INDEX_MAGIC[8] = {'G', 'T', 'F', 'L', 'A', 'T', 'I', 'X'};
+uint32_t constexpr FLAT_INDEX_VERSION = 2;
+uint64_t constexpr FLAT_INDEX_BYTE_ORDER = 0x0102030405060708ull; // Reads differently on a machine of other endianness
+uint64_t constexpr FLAT_INDEX_ALIGNMENT = 64; // Sections start on a cache line
+
+static_assert(sizeof(TSlot) == 2 * sizeof(TKmerKey), "The flat index file stores slots as 16 or 32 bytes.");
+static_assert(sizeof(TRepeatSlot) == sizeof(TSlot), "Repeat slots have the same layout as the other slots.");
+static_assert(sizeof(PackedKmerLabel) == 12, "The flat index file stores labels as 12 bytes.");
+
+
+/** \brief The header of a flat index file, it is followed by the slot, label, filter and repeat sections. */
+struct FlatIndexHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t k; // K-mer size of the keys
+  uint32_t slot_size;
+  uint32_t label_size;
+  uint64_t byte_order;
+  uint64_t num_keys;
+  uint64_t num_slots;
+  uint64_t num_labels;
+  uint64_t num_filter_words;
+  uint64_t slots_offset; // Offsets are from the start of the file
+  uint64_t labels_offset;
+  uint64_t filter_offset;
+  uint64_t num_repeat_keys;
+  uint64_t num_repeat_slots;
+  uint64_t repeat_threshold; // Keys with more labels are masked, zero if none were
+  uint64_t repeat_slots_offset;
+  uint64_t repeat_counts_offset; // One multiplicity per repeat key
+  uint64_t file_size;
+  uint64_t payload_checksum; // Of everything after the header
+  uint64_t header_checksum; // Of the fields above
+};
+
+static_assert(sizeof(FlatIndexHeader) % 8 == 0, "The flat index header must be a whole number of words.");
+uint64_t constexpr FLAT_INDEX_HEADER_SIZE = 192; // sizeof(FlatIndexHeader) rounded up to the alignment
+static_assert(sizeof(FlatIndexHeader) <= FLAT_INDEX_HEADER_SIZE, "The flat index header is too large.");
+
+
+uint64_t
+align_offset(uint64_t const offset)
+{
+  return (offset + FLAT_INDEX_ALIGNMENT - 1) / FLAT_INDEX_ALIGNMENT * FLAT_INDEX_ALIGNMENT;
+}
+
+
+// A fast 64 bit checksum of 'size' bytes, where 'size' is a multiple of eight
+uint64_t
+get_checksum(char const * data, uint64_t const size)
+{
+  assert(size % 8 == 0);
+  uint64_t h = size;
+
+  for (uint64_t i = 0; i < size; i += 8)
+  {
+    uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    h ^= word * 0x87c37b91114253d5ull;
+    h = ((h << 31) | (h >> 33)) * 0x4cf5ad432745937full;
   }
 
-  this->hamming0.set_empty_key(empty_key);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  return h;
+}
+
+
+uint64_t
+get_header_checksum(FlatIndexHeader const & header)
+{
+  return get_checksum(reinterpret_cast<char const *>(&header), offsetof(FlatIndexHeader, header_checksum));
+}
+
+
+void
+write_section(std::FILE * file, std::string const & path, void const * data, uint64_t const size, uint64_t & offset)
+{
+  std::vector<char> const padding(align_offset(offset) - offset, '\0');
+
+  if ((padding.size() > 0 && std::fwrite(padding.data(), 1, padding.size(), file) != padding.size()) ||
+      (size > 0 && std::fwrite(data, 1, size, file) != size))
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::mem_index] Could not write flat index file " << path;
+    std::exit(1);
+  }
+
+  offset += padding.size() + size;
+}
+
+
+// Memory the index takes once loaded. The table has at least two slots and the filter BITS_PER_KEY bits per key, the
+// labels take about as much as the database files.
+uint64_t
+get_memory_estimate(Index<RocksDB> & db_index)
+{
+  uint64_t num_keys = 0;
+  uint64_t sst_bytes = 0;
+  db_index.hamming0.db->GetIntProperty("rocksdb.estimate-num-keys", &num_keys);
+  db_index.hamming0.db->GetIntProperty("rocksdb.total-sst-files-size", &sst_bytes);
+  return num_keys * (2 * sizeof(TSlot) + KmerFilter::BITS_PER_KEY / 8 + 1) + sst_bytes;
+}
+
+
+} // anon namespace
+
+
+void
+MemIndex::load(Index<RocksDB> & index)
+{
+  assert(index.hamming0.db); // Index is open
+  assert(index.opened);
+  hamming0.clear();
+  buffer_map.clear();
   rocksdb::Iterator * it = index.hamming0.db->NewIterator(rocksdb::ReadOptions());
   assert(it);
 
   for (it->SeekToFirst(); it->Valid(); it->Next())
   {
-    uint64_t const key = key_to_uint64_t(it->key().ToString());
-    this->hamming0[key] = value_to_labels(it->value().ToString());
+    TKmerKey const key = key_to_uint64_t(it->key().ToString());
+    std::vector<KmerLabel> const labels = value_to_labels(it->value().ToString());
+    buffer_map[key].assign(labels.begin(), labels.end());
   }
 
   assert(it->status().ok()); // Check for any errors
   delete it;
+  commit();
 }
 
 
-/*
+namespace
+{
+
+FlatIndexHeader
+get_flat_header(MemIndex const & mem_index)
+{
+  FlatKmerMap<PackedKmerLabel> const & hamming0 = mem_index.hamming0;
+  FlatKmerMap<uint32_t> const & repeats = mem_index.repeats;
+  FlatIndexHeader header;
+  std::memset(&header, 0, sizeof(FlatIndexHeader));
+  std::memcpy(header.magic, FLAT_INDEX_MAGIC, sizeof(FLAT_INDEX_MAGIC));
+  header.version = FLAT_INDEX_VERSION;
+  header.k = K;
+  header.slot_size = sizeof(TSlot);
+  header.label_size = sizeof(PackedKmerLabel);
+  header.byte_order = FLAT_INDEX_BYTE_ORDER;
+  header.num_keys = hamming0.size();
+  header.num_slots = hamming0.capacity();
+  header.num_labels = hamming0.num_values();
+  header.num_filter_words = mem_index.filter.size();
+  header.num_repeat_keys = repeats.size();
+  header.num_repeat_slots = repeats.capacity();
+  header.repeat_threshold = mem_index.repeat_threshold;
+  header.slots_offset = FLAT_INDEX_HEADER_SIZE;
+  header.labels_offset = align_offset(header.slots_offset + header.num_slots * sizeof(TSlot));
+  header.filter_offset = align_offset(header.labels_offset + header.num_labels * sizeof(PackedKmerLabel));
+  header.repeat_slots_offset = align_offset(header.filter_offset + header.num_filter_words * sizeof(uint64_t));
+  header.repeat_counts_offset = align_offset(header.repeat_slots_offset + header.num_repeat_slots * sizeof(TRepeatSlot));
+  header.file_size = align_offset(header.repeat_counts_offset + header.num_repeat_keys * sizeof(uint32_t));
+  return header;
+}
+
+} // anon namespace
+
+
 void
-MemIndex::generate_hamming1_hash_map()
+MemIndex::save(std::string const & path) const
 {
-  hamming1.clear();
-  std::vector<uint64_t> duplicate_keys;
+  assert(buffer_map.size() == 0); // Only committed labels are saved
+  FlatIndexHeader header = get_flat_header(*this);
+
+  // The header is written last, with the checksum of the payload, so a partly written file is never valid
+  std::FILE * file = std::fopen(path.c_str(), "wb");
+
+  if (!file)
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::mem_index] Could not open flat index file " << path;
+    std::exit(1);
+  }
+
+  uint64_t offset = 0;
+  write_section(file, path, &header, sizeof(FlatIndexHeader), offset);
+  write_section(file, path, hamming0.slot_data(), header.num_slots * sizeof(TSlot), offset);
+  write_section(file, path, hamming0.value_data(), header.num_labels * sizeof(PackedKmerLabel), offset);
+  write_section(file, path, filter.data(), header.num_filter_words * sizeof(uint64_t), offset);
+  write_section(file, path, repeats.slot_data(), header.num_repeat_slots * sizeof(TRepeatSlot), offset);
+  write_section(file, path, repeats.value_data(), header.num_repeat_keys * sizeof(uint32_t), offset);
+  write_section(file, path, nullptr, 0, offset); // Pads the file to the alignment
+  assert(offset == header.file_size);
+  std::fclose(file);
 
-  for (auto it = hamming0.begin(); it != hamming0.end(); ++it)
   {
-    std::array<uint64_t, 96> hamming1_keys = to_uint64_vec_hamming_distance_1(it->first);
+    MappedFile written;
 
-    for (auto const & hamming1_key : hamming1_keys)
+    if (!written.open(path))
     {
-      auto find_it = hamming1.find(hamming1_key);
-
-      if (find_it == hamming1.end())
-        hamming1[hamming1_key] = it->first;
-      else
-        duplicate_keys.push_back(hamming1_key);
+      BOOST_LOG_TRIVIAL(error) << "[graphtyper::mem_index] Could not read back flat index file " << path;
+      std::exit(1);
     }
+
+    header.payload_checksum = get_checksum(written.data() + FLAT_INDEX_HEADER_SIZE,
+                                           header.file_size - FLAT_INDEX_HEADER_SIZE);
   }
 
-  // Delete all duplicated keys
-  for (auto const & d_key : duplicate_keys)
-    hamming1.erase(d_key);
+  header.header_checksum = get_header_checksum(header);
+  file = std::fopen(path.c_str(), "r+b");
+
+  if (!file || std::fwrite(&header, sizeof(FlatIndexHeader), 1, file) != 1)
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::mem_index] Could not write flat index header to " << path;
+    std::exit(1);
+  }
+
+  std::fclose(file);
 }
-*/
 
 
-std::vector<KmerLabel>
-MemIndex::get(std::vector<uint64_t> const & keys) const
+std::size_t
+MemIndex::get_flat_size() const
 {
-  std::vector<KmerLabel> labels;
-  std::vector<google::dense_hash_map<uint64_t, std::vector<KmerLabel> >::const_iterator> results;
+  return get_flat_header(*this).file_size;
+}
 
-  std::size_t num_results = 0;
 
-  for (std::size_t j = 0; j < keys.size(); ++j)
+void
+MemIndex::write_flat(char * data) const
+{
+  assert(buffer_map.size() == 0); // Only committed labels are written
+  FlatIndexHeader header = get_flat_header(*this);
+
+  if (header.num_slots > 0)
+    std::memcpy(data + header.slots_offset, hamming0.slot_data(), header.num_slots * sizeof(TSlot));
+
+  if (header.num_labels > 0)
+    std::memcpy(data + header.labels_offset, hamming0.value_data(), header.num_labels * sizeof(PackedKmerLabel));
+
+  if (header.num_filter_words > 0)
+    std::memcpy(data + header.filter_offset, filter.data(), header.num_filter_words * sizeof(uint64_t));
+
+  if (header.num_repeat_slots > 0)
+    std::memcpy(data + header.repeat_slots_offset, repeats.slot_data(), header.num_repeat_slots * sizeof(TRepeatSlot));
+
+  if (header.num_repeat_keys > 0)
+    std::memcpy(data + header.repeat_counts_offset, repeats.value_data(), header.num_repeat_keys * sizeof(uint32_t));
+
+  header.payload_checksum = get_checksum(data + FLAT_INDEX_HEADER_SIZE, header.file_size - FLAT_INDEX_HEADER_SIZE);
+  header.header_checksum = get_header_checksum(header);
+  std::memcpy(data, &header, sizeof(FlatIndexHeader));
+}
+
+
+void
+MemIndex::open_disk(std::string const & index_path, std::size_t const cache_bytes)
+{
+  auto new_disk_index = std::make_shared<Index<RocksDB> >();
+  new_disk_index->hamming0.use_block_cache = true;
+  new_disk_index->open(index_path, false /*clear_first*/, true /*read_only*/);
+
+  hamming0.clear();
+  repeats.clear();
+  repeat_threshold = 0;
+  hamming1.clear();
+  filter.clear();
+  filter_stats.clear();
+  buffer_map.clear();
+  mapping.reset();
+  disk_index = std::move(new_disk_index);
+  label_cache = std::make_shared<KmerLabelCache>(cache_bytes);
+}
+
+
+bool
+MemIndex::map(std::string const & path, bool const verify_payload)
+{
+  auto new_mapped_file = std::make_shared<MappedFile>();
+
+  if (!new_mapped_file->open(path))
+    return false;
+
+  if (!attach(new_mapped_file->data(), new_mapped_file->size(), verify_payload))
   {
-    if (keys[j] != empty_key)
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::mem_index] Ignoring flat index file " << path;
+    return false;
+  }
+
+  mapping = std::move(new_mapped_file);
+  return true;
+}
+
+
+bool
+MemIndex::attach(char const * data, std::size_t const size, bool const verify_payload)
+{
+  FlatIndexHeader header;
+
+  if (size < FLAT_INDEX_HEADER_SIZE || reinterpret_cast<uintptr_t>(data) % 8 != 0)
+    return false;
+
+  std::memcpy(&header, data, sizeof(FlatIndexHeader));
+
+  if (std::memcmp(header.magic, FLAT_INDEX_MAGIC, sizeof(FLAT_INDEX_MAGIC)) != 0 ||
+      header.byte_order != FLAT_INDEX_BYTE_ORDER ||
+      header.header_checksum != get_header_checksum(header))
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::mem_index] Not a flat index or its header is corrupt.";
+    return false;
+  }
+
+  if (header.version != FLAT_INDEX_VERSION || header.k != K || header.slot_size != sizeof(TSlot) ||
+      header.label_size != sizeof(PackedKmerLabel))
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::mem_index] Flat index has version " << header.version << " and K="
+                               << header.k << " but version " << FLAT_INDEX_VERSION << " and K=" << K
+                               << " are required.";
+    return false;
+  }
+
+  if (header.file_size > size ||
+      header.slots_offset + header.num_slots * sizeof(TSlot) > header.labels_offset ||
+      header.labels_offset + header.num_labels * sizeof(PackedKmerLabel) > header.filter_offset ||
+      header.filter_offset + header.num_filter_words * sizeof(uint64_t) > header.repeat_slots_offset ||
+      header.repeat_slots_offset + header.num_repeat_slots * sizeof(TRepeatSlot) > header.repeat_counts_offset ||
+      header.repeat_counts_offset + header.num_repeat_keys * sizeof(uint32_t) > header.file_size ||
+      (header.num_slots & (header.num_slots - 1)) != 0 ||
+      (header.num_repeat_slots & (header.num_repeat_slots - 1)) != 0 ||
+      header.num_keys > header.num_slots ||
+      header.num_repeat_keys > header.num_repeat_slots ||
+      header.slots_offset % FLAT_INDEX_ALIGNMENT != 0 ||
+      header.labels_offset % FLAT_INDEX_ALIGNMENT != 0 ||
+      header.filter_offset % FLAT_INDEX_ALIGNMENT != 0 ||
+      header.repeat_slots_offset % FLAT_INDEX_ALIGNMENT != 0 ||
+      header.repeat_counts_offset % FLAT_INDEX_ALIGNMENT != 0)
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::mem_index] Flat index is truncated or has an invalid layout.";
+    return false;
+  }
+
+  if (verify_payload &&
+      header.payload_checksum != get_checksum(data + FLAT_INDEX_HEADER_SIZE, header.file_size - FLAT_INDEX_HEADER_SIZE))
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::mem_index] Flat index checksum mismatch, the file is corrupt.";
+    return false;
+  }
+
+  buffer_map.clear();
+  mapping.reset();
+  disk_index.reset();
+  label_cache.reset();
+  hamming0.view(reinterpret_cast<TSlot const *>(data + header.slots_offset),
+                header.num_slots,
+                reinterpret_cast<PackedKmerLabel const *>(data + header.labels_offset),
+                header.num_labels,
+                header.num_keys);
+  filter.view(reinterpret_cast<uint64_t const *>(data + header.filter_offset), header.num_filter_words);
+  filter_stats.clear();
+  repeats.view(reinterpret_cast<TRepeatSlot const *>(data + header.repeat_slots_offset),
+               header.num_repeat_slots,
+               reinterpret_cast<uint32_t const *>(data + header.repeat_counts_offset),
+               header.num_repeat_keys,
+               header.num_repeat_keys);
+  repeat_threshold = header.repeat_threshold;
+
+  // Masked keys would be dropped even where the current limit allows their labels
+  if (repeat_threshold > 0 && repeat_threshold < Options::const_instance()->max_index_labels)
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::mem_index] The flat index masks k-mers with more than "
+                               << repeat_threshold << " labels but max_index_labels is "
+                               << Options::const_instance()->max_index_labels;
+  }
+
+  if (Options::const_instance()->hamming1_index)
+    generate_hamming1_index();
+  else
+    hamming1.clear();
+
+  return true;
+}
+
+
+void
+MemIndex::put(TKmerKey const key, KmerLabel && label)
+{
+  buffer_map[key].push_back(PackedKmerLabel(label));
+}
+
+
+void
+MemIndex::put(TKmerKey const key, std::vector<KmerLabel> && labels)
+{
+  std::vector<PackedKmerLabel> & key_labels = buffer_map[key];
+  key_labels.insert(key_labels.end(), labels.begin(), labels.end());
+}
+
+
+void
+MemIndex::commit(bool const mask_repeats)
+{
+  // Move previously committed labels back to the buffer since the table is read-only once built
+  hamming0.for_each([this](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const & labels)
     {
-      auto find_it = hamming0.find(keys[j]);
+      std::vector<PackedKmerLabel> & key_labels = buffer_map[key];
+      key_labels.insert(key_labels.begin(), labels.begin(), labels.end());
+    });
 
-      if (find_it != hamming0.end())
-      {
-        num_results += find_it->second.size();
+  // Previously masked keys stay masked, only their multiplicity grows
+  std::unordered_map<TKmerKey, std::vector<uint32_t>, KmerKeyHash> repeat_map;
 
-        if (num_results > Options::instance()->max_index_labels)
-        {
-          // Too many results, give up on this kmer
-          results.clear();
-          break;
-        }
+  repeats.for_each([&repeat_map](TKmerKey const key, FlatKmerMap<uint32_t>::Range const & multiplicity)
+    {
+      repeat_map[key].assign(multiplicity.begin(), multiplicity.end());
+    });
+
+  uint64_t const max_index_labels = Options::const_instance()->max_index_labels;
 
-        results.push_back(find_it);
-      }
+  for (auto it = buffer_map.begin(); it != buffer_map.end();)
+  {
+    auto repeat_it = repeat_map.find(it->first);
+
+    if (repeat_it != repeat_map.end())
+    {
+      repeat_it->second[0] += static_cast<uint32_t>(it->second.size());
+      it = buffer_map.erase(it);
+    }
+    else if (mask_repeats && it->second.size() > max_index_labels)
+    {
+      repeat_map[it->first].assign(1, static_cast<uint32_t>(it->second.size()));
+      it = buffer_map.erase(it);
+    }
+    else
+    {
+      ++it;
     }
   }
 
-  for (auto const res : results)
-    std::copy(res->second.begin(), res->second.end(), std::back_inserter(labels));
+  if (mask_repeats)
+    repeat_threshold = max_index_labels;
 
-  return labels;
+  hamming0.build(buffer_map);
+  buffer_map = std::unordered_map<TKmerKey, std::vector<PackedKmerLabel>, KmerKeyHash>(); // Free the buffer
+  repeats.build(repeat_map);
+  finish_build();
+}
+
+
+void
+MemIndex::build(std::vector<TKmerKey> const & keys,
+                std::vector<uint32_t> const & counts,
+                HugePageVector<PackedKmerLabel> && labels)
+{
+  buffer_map.clear();
+  repeats.clear();
+  hamming0.build(keys, counts, std::move(labels));
+  mask_repeats();
+  finish_build();
 }
 
 
-std::vector<std::vector<KmerLabel> >
-MemIndex::multi_get(std::vector<std::vector<uint64_t> > const & keys) const
+void
+MemIndex::finish_build()
+{
+  // Most lookups of k-mers with a mismatch miss, the filter answers those without touching the table
+  filter.reset(hamming0.size() + repeats.size());
+  hamming0.for_each([this](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const &)
+    {
+      filter.insert(key);
+    });
+
+  repeats.for_each([this](TKmerKey const key, FlatKmerMap<uint32_t>::Range const &)
+    {
+      filter.insert(key);
+    });
+
+  filter_stats.clear();
+  mapping.reset(); // The table and filter no longer refer to it
+  disk_index.reset();
+  label_cache.reset();
+
+  if (Options::const_instance()->hamming1_index)
+    generate_hamming1_index();
+  else
+    hamming1.clear();
+}
+
+
+void
+MemIndex::mask_repeats()
+{
+  uint64_t const max_index_labels = Options::const_instance()->max_index_labels;
+  std::unordered_map<TKmerKey, std::vector<uint32_t>, KmerKeyHash> repeat_map;
+
+  repeats.for_each([&repeat_map](TKmerKey const key, FlatKmerMap<uint32_t>::Range const & multiplicity)
+    {
+      repeat_map[key].assign(multiplicity.begin(), multiplicity.end());
+    });
+
+  hamming0.erase_if([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const & labels)
+    {
+      if (labels.size() <= max_index_labels)
+        return false;
+
+      repeat_map[key].assign(1, static_cast<uint32_t>(labels.size()));
+      return true;
+    });
+
+  repeats.build(repeat_map);
+  repeat_threshold = max_index_labels;
+}
+
+
+void
+MemIndex::generate_hamming1_index()
+{
+  std::vector<TKmerKey> keys;
+  keys.reserve(hamming0.size() + repeats.size());
+  hamming0.for_each([&keys](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const &)
+    {
+      keys.push_back(key);
+    });
+
+  // A masked neighbour drops the seed, so the repeats have to be found as well
+  repeats.for_each([&keys](TKmerKey const key, FlatKmerMap<uint32_t>::Range const &)
+    {
+      keys.push_back(key);
+    });
+
+  hamming1.build(std::move(keys));
+}
+
+
+KmerMultiplicityStats
+MemIndex::get_multiplicity_stats() const
+{
+  KmerMultiplicityStats stats;
+
+  hamming0.for_each([&stats](TKmerKey, FlatKmerMap<PackedKmerLabel>::Range const & labels)
+    {
+      stats.add(labels.size(), false /*is_repeat*/);
+    });
+
+  repeats.for_each([&stats](TKmerKey, FlatKmerMap<uint32_t>::Range const & multiplicity)
+    {
+      stats.add(*multiplicity.begin(), true /*is_repeat*/);
+    });
+
+  return stats;
+}
+
+
+void
+MemIndex::batch_find(std::vector<TKmerKey> const & keys, std::vector<THit> & hits) const
+{
+  long const n = keys.size();
+  hits.clear();
+
+  // First pass: Check the filter of all keys, prefetching the filter blocks of keys further ahead
+  std::vector<uint32_t> candidates;
+
+  for (long i = 0; i < std::min(n, FILTER_PREFETCH_DISTANCE); ++i)
+    filter.prefetch_key(keys[i]);
+
+  for (long i = 0; i < n; ++i)
+  {
+    if (i + FILTER_PREFETCH_DISTANCE < n)
+      filter.prefetch_key(keys[i + FILTER_PREFETCH_DISTANCE]);
+
+    if (filter.may_contain(keys[i]))
+      candidates.push_back(static_cast<uint32_t>(i));
+  }
+
+  // Second pass: Look up the keys which passed the filter, prefetching the table slots of keys further ahead
+  long const num_candidates = candidates.size();
+
+  for (long c = 0; c < std::min(num_candidates, SLOT_PREFETCH_DISTANCE); ++c)
+    hamming0.prefetch_key(keys[candidates[c]]);
+
+  for (long c = 0; c < num_candidates; ++c)
+  {
+    if (c + SLOT_PREFETCH_DISTANCE < num_candidates)
+      hamming0.prefetch_key(keys[candidates[c + SLOT_PREFETCH_DISTANCE]]);
+
+    TRange const range = hamming0.find(keys[candidates[c]]);
+
+    if (!range.empty())
+    {
+      prefetch(range.begin()); // The labels are copied after all keys are resolved
+      hits.push_back(THit(candidates[c], range));
+    }
+    else if (!repeats.find(keys[candidates[c]]).empty())
+    {
+      hits.push_back(THit(candidates[c], TRange())); // Masked, the seed is dropped
+    }
+  }
+
+  filter_stats.add(n - num_candidates, hits.size(), num_candidates - hits.size());
+}
+
+
+void
+MemIndex::find_all(std::vector<TKmerKey> const & keys,
+                   std::vector<THit> & hits,
+                   std::vector<std::vector<PackedKmerLabel> > & disk_labels) const
 {
-  std::vector<std::vector<KmerLabel> > labels(keys.size());
-  std::vector<std::vector<google::dense_hash_map<uint64_t, std::vector<KmerLabel> >::const_iterator> > results(
-    keys.size());
+  if (!disk_index)
+  {
+    batch_find(keys, hits);
+    return;
+  }
+
+  // Read the labels of all keys which are not cached with a single MultiGet
+  disk_labels.assign(keys.size(), std::vector<PackedKmerLabel>());
+  std::vector<uint32_t> missing;
 
   for (std::size_t i = 0; i < keys.size(); ++i)
   {
-    std::size_t num_results = 0;
+    if (!label_cache->get(keys[i], disk_labels[i]))
+      missing.push_back(static_cast<uint32_t>(i));
+  }
+
+  if (missing.size() > 0)
+  {
+    std::vector<rocksdb::Slice> slices;
+    slices.reserve(missing.size());
+
+    for (auto const i : missing)
+      slices.push_back(rocksdb::Slice(reinterpret_cast<char const *>(&keys[i]), sizeof(TKmerKey)));
+
+    std::vector<std::string> values;
+    disk_index->hamming0.db->MultiGet(rocksdb::ReadOptions(), slices, &values);
+    assert(values.size() == missing.size());
 
-    for (std::size_t j = 0; j < keys[i].size(); ++j)
+    for (std::size_t m = 0; m < missing.size(); ++m)
     {
-      if (keys[i][j] != empty_key)
-      {
-        auto find_it = hamming0.find(keys[i][j]);
+      // Labels are stored with the same layout as PackedKmerLabel
+      std::string const & value = values[m];
+      std::vector<PackedKmerLabel> & labels = disk_labels[missing[m]];
+      assert(value.size() % sizeof(PackedKmerLabel) == 0);
+      labels.resize(value.size() / sizeof(PackedKmerLabel));
 
-        if (find_it != hamming0.end())
-        {
-          num_results += find_it->second.size();
-
-          if (num_results > Options::instance()->max_index_labels)
-          {
-            // Too many results, give up on this kmer
-            results[i].clear();
-            break;
-          }
-
-          results[i].push_back(find_it);
-        }
-      }
+      if (labels.size() > 0)
+        std::memcpy(labels.data(), value.data(), labels.size() * sizeof(PackedKmerLabel));
+
+      label_cache->put(keys[missing[m]], labels);
     }
   }
 
-  // If there are not too many results, add them to labels and return them
-  for (std::size_t i = 0; i < results.size(); ++i)
+  hits.clear();
+
+  for (std::size_t i = 0; i < keys.size(); ++i)
   {
-    for (auto const res : results[i])
-      std::copy(res->second.begin(), res->second.end(), std::back_inserter(labels[i]));
+    if (disk_labels[i].size() > 0)
+    {
+      TRange const range(disk_labels[i].data(), disk_labels[i].data() + disk_labels[i].size());
+      hits.push_back(THit(static_cast<uint32_t>(i), range));
+    }
   }
+}
+
 
+std::vector<PackedKmerLabel>
+MemIndex::get(std::vector<TKmerKey> const & keys) const
+{
+  std::vector<PackedKmerLabel> labels;
+  std::vector<THit> hits;
+  std::vector<std::vector<PackedKmerLabel> > disk_labels;
+  find_all(keys, hits, disk_labels);
+  add_seed_labels(hits.data(), hits.data() + hits.size(), labels);
   return labels;
 }
 
 
-std::vector<std::vector<KmerLabel> >
-MemIndex::multi_get_hamming1(std::vector<std::vector<uint64_t> > const & keys) const
+TPackedKmerLabels
+MemIndex::multi_get(std::vector<std::vector<TKmerKey> > const & keys) const
 {
-  std::vector<std::vector<KmerLabel> > labels(keys.size());
+  // Look up the keys of all seeds together so their memory accesses overlap
+  std::vector<TKmerKey> all_keys;
+  std::vector<std::size_t> seed_ends(keys.size());
 
   for (std::size_t i = 0; i < keys.size(); ++i)
   {
-    for (std::size_t j = 0; j < keys[i].size(); ++j)
-    {
-      auto find_it = hamming1.find(keys[i][j]);
+    all_keys.insert(all_keys.end(), keys[i].begin(), keys[i].end());
+    seed_ends[i] = all_keys.size();
+  }
+
+  std::vector<THit> hits;
+  std::vector<std::vector<PackedKmerLabel> > disk_labels;
+  find_all(all_keys, hits, disk_labels);
+
+  TPackedKmerLabels labels(keys.size());
+  add_all_seed_labels(seed_ends, hits, labels);
+  return labels;
+}
 
-      if (find_it != hamming1.end())
-      {
-        auto hamming0_find_it = hamming0.find(find_it->second);
-        assert(hamming0_find_it != hamming0.end());
-        std::copy(hamming0_find_it->second.begin(), hamming0_find_it->second.end(), std::back_inserter(labels[i]));
-      }
+
+TPackedKmerLabels
+MemIndex::multi_get_hamming1(std::vector<std::vector<TKmerKey> > const & keys) const
+{
+  std::vector<TKmerKey> all_neighbours;
+  std::vector<std::size_t> seed_ends(keys.size());
+
+  for (std::size_t i = 0; i < keys.size(); ++i)
+  {
+    // Only unique keys are extended to their neighbours, other seeds are looked up as they are
+    if (keys[i].size() != 1)
+    {
+      all_neighbours.insert(all_neighbours.end(), keys[i].begin(), keys[i].end());
     }
+    else if (hamming1.size() > 0)
+    {
+      hamming1.find_neighbours(keys[i][0], all_neighbours);
+    }
+    else
+    {
+      THamming1Keys const hamming1_keys = to_uint64_vec_hamming_distance_1(keys[i][0]);
+      all_neighbours.insert(all_neighbours.end(), hamming1_keys.begin(), hamming1_keys.end());
+    }
+
+    seed_ends[i] = all_neighbours.size();
   }
 
-  assert(keys.size() == labels.size());
+  std::vector<THit> hits;
+  std::vector<std::vector<PackedKmerLabel> > disk_labels;
+  find_all(all_neighbours, hits, disk_labels);
+
+  TPackedKmerLabels labels(keys.size());
+  add_all_seed_labels(seed_ends, hits, labels);
   return labels;
 }
 
 
+std::string
+get_flat_index_path(std::string const & index_path)
+{
+  return index_path + "/flat_index.gti";
+}
+
+
+void
+load_mem_index(MemIndex & new_mem_index, std::string const & index_path)
+{
+  if (new_mem_index.map(get_flat_index_path(index_path)))
+  {
+    BOOST_LOG_TRIVIAL(debug) << "[graphtyper::mem_index] Mapped flat index with " << new_mem_index.hamming0.size()
+                             << " K-mers and " << new_mem_index.repeats.size() << " masked repeats.";
+    return;
+  }
+
+  Index<RocksDB> new_index = load_secondary_index(index_path);
+  long const index_memory_budget = Options::const_instance()->index_memory_budget;
+
+  if (index_memory_budget > 0)
+  {
+    uint64_t const budget_bytes = static_cast<uint64_t>(index_memory_budget) << 20;
+    uint64_t const estimated_bytes = get_memory_estimate(new_index);
+
+    if (estimated_bytes > budget_bytes)
+    {
+      BOOST_LOG_TRIVIAL(info) << "[graphtyper::mem_index] The index needs about " << (estimated_bytes >> 20)
+                              << " MB of memory, more than the budget of " << index_memory_budget
+                              << " MB. It is queried on disk.";
+      new_index.close();
+      new_mem_index.open_disk(index_path, budget_bytes);
+      return;
+    }
+  }
+
+  new_mem_index.load(new_index);
+  new_index.close();
+  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::mem_index] K-mer multiplicity: "
+                           << new_mem_index.get_multiplicity_stats().to_string();
+}
+
+
 MemIndex
 load_secondary_mem_index(std::string const & secondary_index_path, Graph & secondary_graph)
 {
+  MemIndex secondary_mem_index;
+  Graph & graph = current_context().graph;
+
   // Swap graphs
   std::swap(graph, secondary_graph);
 
-  Index<RocksDB> secondary_index = load_secondary_index(secondary_index_path);
-  std::swap(index, secondary_index);
-  MemIndex secondary_mem_index;
-  secondary_mem_index.load(index);
-  std::swap(index, secondary_index);
-  secondary_index.close();
+  load_mem_index(secondary_mem_index, secondary_index_path);
 
   // Swap graphs back to the way they were
   std::swap(graph, secondary_graph);
@@ -199,6 +882,112 @@ load_secondary_mem_index(std::string const & secondary_index_path, Graph & secon
 }
 
 
-MemIndex mem_index;
+namespace
+{
+
+std::shared_ptr<MemIndex>
+copy_to_numa_buffer(MemIndex const & original, long const node)
+{
+  auto buffer = std::make_shared<NumaBuffer>(original.get_flat_size(), node);
+  original.write_flat(buffer->data());
+  auto copy = std::make_shared<MemIndex>();
+
+  if (!copy->attach(buffer->data(), buffer->size(), false /*verify_payload*/))
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::mem_index] Could not copy the index to NUMA node " << node;
+    std::exit(1);
+  }
+
+  copy->mapping = std::move(buffer);
+  return copy;
+}
+
+
+} // anon namespace
+
+
+void
+place_mem_index_on_numa_nodes(std::string const & placement)
+{
+  clear_numa_mem_indexes();
+  GenotypingContext & context = current_context();
+  MemIndex const & mem_index = context.mem_index;
+
+  if (placement != "replicate" && placement != "interleave")
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::mem_index] Unknown NUMA placement '" << placement
+                             << "', it must be 'replicate' or 'interleave'.";
+    std::exit(1);
+  }
+
+  if (mem_index.is_on_disk())
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::mem_index] The index is queried on disk and is not placed on NUMA nodes.";
+    return;
+  }
+
+  long const num_nodes = get_num_numa_nodes();
+
+  if (placement == "interleave")
+  {
+    context.numa_mem_indexes.push_back(copy_to_numa_buffer(mem_index, NumaBuffer::INTERLEAVE));
+    context.node_mem_indexes.assign(num_nodes, context.numa_mem_indexes[0].get());
+  }
+  else
+  {
+    // Each copy is written by a thread on its node, so its pages are local even if the kernel ignores the placement
+    context.numa_mem_indexes.resize(num_nodes);
+    std::vector<std::thread> threads;
+
+    for (long node = 0; node < num_nodes; ++node)
+    {
+      threads.emplace_back([&context, node]()
+        {
+          pin_thread_to_numa_node(node);
+          context.numa_mem_indexes[node] = copy_to_numa_buffer(context.mem_index, node);
+        });
+    }
+
+    for (auto & thread : threads)
+      thread.join();
+
+    for (auto const & copy : context.numa_mem_indexes)
+      context.node_mem_indexes.push_back(copy.get());
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "[graphtyper::mem_index] Placed " << context.numa_mem_indexes.size()
+                          << " copies of the index (" << (mem_index.get_flat_size() >> 20) << " MB each) on "
+                          << num_nodes << " NUMA nodes.";
+}
+
+
+void
+clear_numa_mem_indexes()
+{
+  GenotypingContext & context = current_context();
+
+  for (auto const & copy : context.numa_mem_indexes)
+  {
+    context.mem_index.filter_stats.add(copy->filter_stats.filtered.load(),
+                                       copy->filter_stats.hits.load(),
+                                       copy->filter_stats.false_positives.load());
+  }
+
+  context.numa_mem_indexes.clear();
+  context.node_mem_indexes.clear();
+}
+
+
+MemIndex const &
+get_local_mem_index()
+{
+  GenotypingContext const & context = current_context();
+  long const node = get_thread_numa_node();
+
+  if (node < 0 || node >= static_cast<long>(context.node_mem_indexes.size()))
+    return context.mem_index;
+
+  return *context.node_mem_indexes[node];
+}
 
 }
@@ -1,19 +1,27 @@
 #include <cassert>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <string>
 #include <vector>
 
 #include <graphtyper/graph/graph.hpp>
 #include <graphtyper/index/rocksdb.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/type_conversions.hpp>
 
 #include <boost/log/trivial.hpp>
 
+#include <rocksdb/cache.h>
 #include <rocksdb/db.h>
 #include <rocksdb/env.h>
+#include <rocksdb/filter_policy.h>
 #include <rocksdb/slice.h>
 #include <rocksdb/options.h>
+#include <rocksdb/sst_file_writer.h>
 #include <rocksdb/statistics.h>
+#include <rocksdb/table.h>
 #include <rocksdb/merge_operator.h>
 #include <rocksdb/utilities/backupable_db.h>
 
@@ -28,6 +36,7 @@ std::vector<gyper::KmerLabel>
 value_to_labels(std::string const & value)
 {
   assert(value.size() % LABEL_SIZE == 0);
+  Graph const & graph = current_context().graph;
   std::vector<gyper::KmerLabel> results(value.size() / LABEL_SIZE);
 
   for (unsigned i = 0; i < value.size() / LABEL_SIZE; ++i)
@@ -57,12 +66,12 @@ value_to_labels(std::string const & value)
 }
 
 
-uint64_t
+TKmerKey
 key_to_uint64_t(std::string const & key_str)
 {
-  assert(key_str.size() == 8);
-  uint64_t key;
-  memcpy(&key, key_str.data(), sizeof(uint64_t));
+  assert(key_str.size() == sizeof(TKmerKey));
+  TKmerKey key;
+  memcpy(&key, key_str.data(), sizeof(TKmerKey));
   return key;
 }
 
@@ -70,8 +79,6 @@ key_to_uint64_t(std::string const & key_str)
 std::string
 labels_to_value(std::vector<gyper::KmerLabel> const & labels)
 {
-  using gyper::graph;
-
   // Convert labels to byte array
   uint32_t static const t = LABEL_SIZE;
   std::vector<char> v(t * labels.size());
@@ -146,6 +153,57 @@ namespace gyper
 
 using namespace rocksdb;
 
+
+namespace
+{
+
+// The K-mer size of an index is kept in a file next to its tables, indexes without it were written with K = 32
+std::string
+get_kmer_size_path(std::string const & filename)
+{
+  return filename + "/KMER_SIZE";
+}
+
+
+void
+check_kmer_size(std::string const & filename, bool const is_missing_allowed)
+{
+  std::ifstream in(get_kmer_size_path(filename));
+
+  if (!in && is_missing_allowed)
+    return;
+
+  unsigned index_k = 32;
+
+  if (in)
+    in >> index_k;
+
+  if (index_k != K)
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::rocksdb] The index '" << filename << "' has " << index_k << "-mers but "
+                             << "graphtyper was built with K=" << static_cast<unsigned>(K) << " (GYPER_KMER_SIZE).";
+    std::exit(1);
+  }
+}
+
+
+void
+write_kmer_size(std::string const & filename)
+{
+  std::ofstream out(get_kmer_size_path(filename));
+  out << static_cast<unsigned>(K) << '\n';
+
+  if (!out)
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::rocksdb] Could not write " << get_kmer_size_path(filename);
+    std::exit(1);
+  }
+}
+
+
+
+} // anon namespace
+
 template <>
 void
 Index<RocksDB>::construct(bool const);
@@ -237,11 +295,11 @@ Index<RocksDB>::operator=(Index<RocksDB> && mv_index)
 
 template <>
 bool
-Index<RocksDB>::exists(uint64_t const key) const
+Index<RocksDB>::exists(TKmerKey const key) const
 {
   std::string value;
   hamming0.db->Get(ReadOptions(),
-                   Slice(static_cast<const char *>(static_cast<const void *>(&key)), sizeof(uint64_t)),
+                   Slice(static_cast<const char *>(static_cast<const void *>(&key)), sizeof(TKmerKey)),
                    &value);
   return value.size() > 0;
 }
@@ -249,11 +307,11 @@ Index<RocksDB>::exists(uint64_t const key) const
 
 template <>
 std::vector<KmerLabel>
-Index<RocksDB>::get(uint64_t const key) const
+Index<RocksDB>::get(TKmerKey const key) const
 {
   std::string value;
   hamming0.db->Get(ReadOptions(),
-                   Slice(static_cast<const char *>(static_cast<const void *>(&key)), sizeof(uint64_t)),
+                   Slice(static_cast<const char *>(static_cast<const void *>(&key)), sizeof(TKmerKey)),
                    &value);
   return value_to_labels(value);
 }
@@ -261,11 +319,11 @@ Index<RocksDB>::get(uint64_t const key) const
 
 template <>
 std::vector<std::vector<KmerLabel> >
-Index<RocksDB>::multi_get(std::vector<std::vector<uint64_t> > const & multi_keys) const
+Index<RocksDB>::multi_get(std::vector<std::vector<TKmerKey> > const & multi_keys) const
 {
   std::vector<Slice> slices;
   std::vector<std::size_t> key_to_multi_key;
-  std::vector<uint64_t> keys;
+  std::vector<TKmerKey> keys;
 
   for (std::size_t i = 0; i < multi_keys.size(); ++i)
   {
@@ -277,7 +335,7 @@ Index<RocksDB>::multi_get(std::vector<std::vector<uint64_t> > const & multi_keys
   }
 
   for (std::size_t k = 0; k < keys.size(); ++k)
-    slices.push_back(Slice(static_cast<const char *>(static_cast<const void *>(&keys[k])), sizeof(uint64_t)));
+    slices.push_back(Slice(static_cast<const char *>(static_cast<const void *>(&keys[k])), sizeof(TKmerKey)));
 
   std::vector<std::string> values;
   hamming0.db->MultiGet(ReadOptions(), slices, &values);
@@ -301,7 +359,7 @@ Index<RocksDB>::check()
   bool no_errors = true;
 
   // Check if reference is in the index
-  std::vector<char> ref_seq = graph.get_all_ref();
+  std::vector<char> ref_seq = current_context().graph.get_all_ref();
 
   if (ref_seq.size() < gyper::K)
   {
@@ -320,7 +378,7 @@ Index<RocksDB>::check()
   auto start_it = ref_seq.begin();
   auto final_it = ref_seq.begin() + K;
 
-  std::vector<std::vector<uint64_t> > keys;
+  std::vector<std::vector<TKmerKey> > keys;
   std::size_t static const MAX_KEYS = 100000;
   std::size_t static const STEP_SIZE = 25;
   keys.reserve(MAX_KEYS);
@@ -335,7 +393,7 @@ Index<RocksDB>::check()
     // Ignore kmers with an N
     if (std::find(k_mer.begin(), k_mer.end(), 'N') == k_mer.end())
     {
-      keys.push_back(std::vector<uint64_t>(1, to_uint64(std::move(k_mer))));
+      keys.push_back(std::vector<TKmerKey>(1, to_uint64(std::move(k_mer))));
 
       if (keys.size() == MAX_KEYS)
       {
@@ -380,7 +438,7 @@ Index<RocksDB>::check()
 
 template <>
 void
-Index<RocksDB>::put(uint64_t const key, KmerLabel && label)
+Index<RocksDB>::put(TKmerKey const key, KmerLabel && label)
 {
   buffer_map[key].push_back(std::move(label));
 
@@ -391,7 +449,7 @@ Index<RocksDB>::put(uint64_t const key, KmerLabel && label)
 
 template <>
 void
-Index<RocksDB>::put(uint64_t const key, std::vector<KmerLabel> && labels)
+Index<RocksDB>::put(TKmerKey const key, std::vector<KmerLabel> && labels)
 {
   std::move(labels.begin(), labels.end(), std::back_inserter(buffer_map[key]));
 
@@ -408,7 +466,7 @@ Index<RocksDB>::commit()
   {
     hamming0.s = hamming0.db->Merge(WriteOptions(),
                                     Slice(static_cast<const char *>(static_cast<const void *>(&it->first)),
-                                          sizeof(uint64_t)),
+                                          sizeof(TKmerKey)),
                                     Slice(labels_to_value(it->second))
                                     );
     assert(hamming0.s.ok());
@@ -430,6 +488,7 @@ template <>
 void
 Index<RocksDB>::clear()
 {
+  std::remove(get_kmer_size_path(hamming0.filename).c_str());
   hamming0.s = rocksdb::DestroyDB(hamming0.filename.c_str(), hamming0.options);
 
   if (!hamming0.s.ok())
@@ -446,6 +505,24 @@ Index<RocksDB>::clear()
 }
 
 
+namespace
+{
+
+uint64_t constexpr BLOCK_CACHE_SIZE = 1ull << 30;
+
+
+// One block cache is shared by all indexes queried on disk, so their memory does not add up
+std::shared_ptr<rocksdb::Cache> const &
+get_block_cache()
+{
+  static std::shared_ptr<rocksdb::Cache> const block_cache = rocksdb::NewLRUCache(BLOCK_CACHE_SIZE);
+  return block_cache;
+}
+
+
+} // anon namespace
+
+
 template <>
 void
 Index<RocksDB>::construct(bool const read_only)
@@ -458,6 +535,22 @@ Index<RocksDB>::construct(bool const read_only)
   hamming0.options.OptimizeLevelStyleCompaction();
   hamming0.options.merge_operator.reset(new LabelAppendOperator);
 
+  // A bloom filter skips the files without the key on point lookups. Indexes queried on disk keep the blocks of
+  // frequent K-mers in the shared block cache, which only grows as blocks are read. Other indexes are written or read
+  // once into a MemIndex, so caching their blocks would only take memory.
+  BlockBasedTableOptions table_options;
+  table_options.filter_policy.reset(NewBloomFilterPolicy(10 /*bits per key*/, false /*use_block_based_builder*/));
+
+  if (hamming0.use_block_cache)
+    table_options.block_cache = get_block_cache();
+  else
+    table_options.no_block_cache = true;
+
+  hamming0.options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+
+  if (read_only)
+    hamming0.options.max_open_files = -1; // Keep every table open instead of reopening them on lookups
+
   if (read_only)
     hamming0.s = DB::OpenForReadOnly(hamming0.options, hamming0.filename.c_str(), &hamming0.db);
   else
@@ -469,6 +562,116 @@ Index<RocksDB>::construct(bool const read_only)
                              << "'. Message: " << hamming0.s.ToString();
     std::exit(1);
   }
+
+  // A new index has no K-mer size yet
+  check_kmer_size(hamming0.filename, !read_only);
+
+  if (!read_only)
+    write_kmer_size(hamming0.filename);
+}
+
+
+uint64_t constexpr SstIndexWriter::MAX_FILE_SIZE;
+
+
+SstIndexWriter::SstIndexWriter(Index<RocksDB> & _db_index)
+  : db_index(_db_index)
+{}
+
+
+SstIndexWriter::~SstIndexWriter()
+{
+  writer.reset();
+
+  for (auto const & path : paths)
+    std::remove(path.c_str());
+}
+
+
+void
+SstIndexWriter::put(TKmerKey const key, std::vector<KmerLabel> const & labels)
+{
+  TKmerKey const order = to_db_key_order(key);
+  assert(num_keys == 0 || order > last_order);
+
+  if (!writer)
+  {
+    // The files must use the same table options as the database to get its bloom filters
+    std::string const path = db_index.hamming0.filename + "_bulk." + std::to_string(paths.size()) + ".sst";
+    writer.reset(new SstFileWriter(EnvOptions(), db_index.hamming0.options));
+    Status const s = writer->Open(path);
+
+    if (!s.ok())
+    {
+      BOOST_LOG_TRIVIAL(error) << "[graphtyper::rocksdb] Could not open SST file '" << path << "'. Message: "
+                               << s.ToString();
+      std::exit(1);
+    }
+
+    paths.push_back(path);
+  }
+
+  Status const s = writer->Put(Slice(static_cast<const char *>(static_cast<const void *>(&key)), sizeof(TKmerKey)),
+                               Slice(labels_to_value(labels)));
+
+  if (!s.ok())
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::rocksdb] Could not write to SST file '" << paths.back()
+                             << "'. Message: " << s.ToString();
+    std::exit(1);
+  }
+
+  last_order = order;
+  ++num_keys;
+
+  if (writer->FileSize() >= MAX_FILE_SIZE)
+    finish_file();
+}
+
+
+void
+SstIndexWriter::ingest()
+{
+  finish_file();
+
+  if (paths.size() == 0)
+    return;
+
+  IngestExternalFileOptions ingest_options;
+  ingest_options.move_files = true; // Hard links the files into the database instead of copying them
+  Status const s = db_index.hamming0.db->IngestExternalFile(paths, ingest_options);
+
+  if (!s.ok())
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::rocksdb] Could not ingest SST files into '"
+                             << db_index.hamming0.filename << "'. Message: " << s.ToString();
+    std::exit(1);
+  }
+
+  // The database has its own links to the files now
+  for (auto const & path : paths)
+    std::remove(path.c_str());
+
+  paths.clear();
+}
+
+
+void
+SstIndexWriter::finish_file()
+{
+  if (!writer)
+    return;
+
+  Status const s = writer->Finish();
+
+  if (!s.ok())
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::rocksdb] Could not finish SST file '" << paths.back()
+                             << "'. Message: " << s.ToString();
+    std::exit(1);
+  }
+
+  writer.reset();
 }
 
 
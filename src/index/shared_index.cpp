@@ -0,0 +1,207 @@
+#include <cstdint> // uint32_t, uint64_t
+#include <cstdlib> // std::exit, std::free
+#include <cstring> // std::memcmp, std::memcpy, std::memset
+#include <fstream> // std::ifstream
+#include <iterator> // std::istreambuf_iterator
+#include <memory> // std::make_shared, std::shared_ptr
+#include <sstream> // std::ostringstream
+#include <string> // std::string
+
+#include <stdlib.h> // realpath
+#include <sys/stat.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/graph/graph_serialization.hpp>
+#include <graphtyper/index/indexer.hpp>
+#include <graphtyper/index/mem_index.hpp>
+#include <graphtyper/index/rocksdb.hpp>
+#include <graphtyper/index/shared_index.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
+#include <graphtyper/utilities/shared_segment.hpp>
+
+
+namespace
+{
+
+char const SHARED_INDEX_MAGIC[8] = {'G', 'T', 'S', 'H', 'A', 'R', 'E', 'D'};
+uint32_t constexpr SHARED_INDEX_VERSION = 1;
+std::size_t constexpr SHARED_INDEX_HEADER_SIZE = 4096;
+
+
+/** \brief The header of a shared segment, it is followed by the serialized graph and the flat index. */
+struct SharedIndexHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t source_size;
+  uint64_t graph_offset;
+  uint64_t graph_size;
+  uint64_t index_offset;
+  uint64_t index_size;
+  char source[SHARED_INDEX_HEADER_SIZE - 48]; // Describes the files the graph and index were loaded from
+};
+
+static_assert(sizeof(SharedIndexHeader) == SHARED_INDEX_HEADER_SIZE, "The shared index header must be one page.");
+
+
+std::string
+get_real_path(std::string const & path)
+{
+  char * real_path = realpath(path.c_str(), nullptr);
+
+  if (!real_path)
+    return path;
+
+  std::string const ret(real_path);
+  std::free(real_path);
+  return ret;
+}
+
+
+// Paths, sizes and modification times of the graph and index, a segment is only used if they are the same
+std::string
+get_source(std::string const & graph_path, std::string const & index_path)
+{
+  std::ostringstream ss;
+  ss << SHARED_INDEX_VERSION;
+
+  for (std::string const & path : {graph_path, index_path, gyper::get_flat_index_path(index_path)})
+  {
+    struct stat sb;
+    ss << '\n' << get_real_path(path);
+
+    if (stat(path.c_str(), &sb) == 0)
+      ss << ' ' << sb.st_size << ' ' << sb.st_mtime;
+  }
+
+  return ss.str();
+}
+
+
+bool
+attach_segment(std::shared_ptr<gyper::SharedSegment> const & segment, std::string const & source)
+{
+  SharedIndexHeader header;
+
+  if (segment->size() < SHARED_INDEX_HEADER_SIZE)
+    return false;
+
+  std::memcpy(&header, segment->data(), SHARED_INDEX_HEADER_SIZE);
+
+  if (std::memcmp(header.magic, SHARED_INDEX_MAGIC, sizeof(SHARED_INDEX_MAGIC)) != 0 ||
+      header.version != SHARED_INDEX_VERSION ||
+      header.source_size != source.size() ||
+      std::memcmp(header.source, source.data(), source.size()) != 0 ||
+      header.graph_offset + header.graph_size > segment->size() ||
+      header.index_offset + header.index_size > segment->size())
+  {
+    return false;
+  }
+
+  gyper::MemIndex & mem_index = gyper::current_context().mem_index;
+
+  if (!mem_index.attach(segment->data() + header.index_offset, header.index_size, false))
+    return false;
+
+  mem_index.mapping = segment;
+  gyper::load_graph(segment->data() + header.graph_offset, header.graph_size, segment); // Flat graphs are used in place
+  return true;
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+bool
+load_shared_graph_and_index(std::string const & name,
+                            std::string const & graph_path,
+                            std::string const & index_path)
+{
+  std::string const path = SharedSegment::get_path(name);
+  std::string const source = get_source(graph_path, index_path);
+
+  if (source.size() > sizeof(SharedIndexHeader::source))
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::shared_index] Paths are too long to share the graph and index.";
+    return false;
+  }
+
+  auto segment = std::make_shared<SharedSegment>();
+
+  if (segment->open(path))
+  {
+    if (attach_segment(segment, source))
+    {
+      BOOST_LOG_TRIVIAL(info) << "[graphtyper::shared_index] Attached to the shared graph and index at " << path;
+      return true;
+    }
+
+    if (!segment->remove_if_unused())
+    {
+      BOOST_LOG_TRIVIAL(warning) << "[graphtyper::shared_index] " << path << " is in use with another graph or "
+                                 << "index, loading them privately.";
+      return false;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "[graphtyper::shared_index] Removed the outdated segment " << path;
+  }
+
+  // No other process has published the graph and index, load them and publish them
+  std::string graph_data;
+
+  {
+    std::ifstream ifs(graph_path.c_str(), std::ios::binary);
+
+    if (!ifs.is_open())
+    {
+      BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::shared_index] Could not load graph at '" << graph_path << "'";
+      std::exit(1);
+    }
+
+    graph_data.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+  }
+
+  load_graph(graph_data.data(), graph_data.size());
+  MemIndex & mem_index = current_context().mem_index;
+
+  if (!mem_index.map(get_flat_index_path(index_path)))
+  {
+    load_index(index_path);
+    mem_index.load(index);
+    index.close();
+  }
+
+  SharedIndexHeader header;
+  std::memset(&header, 0, SHARED_INDEX_HEADER_SIZE);
+  std::memcpy(header.magic, SHARED_INDEX_MAGIC, sizeof(SHARED_INDEX_MAGIC));
+  header.version = SHARED_INDEX_VERSION;
+  header.source_size = static_cast<uint32_t>(source.size());
+  std::memcpy(header.source, source.data(), source.size());
+  header.graph_offset = SHARED_INDEX_HEADER_SIZE;
+  header.graph_size = graph_data.size();
+  header.index_offset = (header.graph_offset + header.graph_size + 4095) / 4096 * 4096;
+  header.index_size = mem_index.get_flat_size();
+
+  bool const is_created = segment->create(path, header.index_offset + header.index_size, [&](char * data)
+    {
+      std::memcpy(data + header.graph_offset, graph_data.data(), graph_data.size());
+      mem_index.write_flat(data + header.index_offset);
+      std::memcpy(data, &header, SHARED_INDEX_HEADER_SIZE);
+    });
+
+  // The private index is replaced by the one in the segment, unless it could not be created
+  if (is_created && mem_index.attach(segment->data() + header.index_offset, header.index_size, false))
+  {
+    mem_index.mapping = segment;
+    BOOST_LOG_TRIVIAL(info) << "[graphtyper::shared_index] Shared the graph and index at " << path;
+  }
+
+  return true;
+}
+
+
+} // namespace gyper
@@ -0,0 +1,321 @@
+#include <algorithm> // std::sort
+#include <cstdint> // uint32_t, uint64_t
+#include <cstdio> // std::FILE, std::fopen, std::fread, std::fwrite, std::remove
+#include <cstdlib> // std::exit
+#include <functional> // std::function, std::greater
+#include <memory> // std::unique_ptr
+#include <queue> // std::priority_queue
+#include <string> // std::string
+#include <utility> // std::pair
+#include <vector> // std::vector
+
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/index/sorted_run_writer.hpp>
+
+
+namespace
+{
+
+using TRecord = gyper::SortedRunWriter::Record;
+
+
+bool
+record_less(TRecord const & a, TRecord const & b)
+{
+  return a.key < b.key || (a.key == b.key && a.seq < b.seq);
+}
+
+
+gyper::KmerLabel
+record_to_label(TRecord const & record)
+{
+  return gyper::KmerLabel(record.start_index, record.end_index, record.variant_id);
+}
+
+
+/** \brief Reads the records of a sorted run a block at a time. */
+class RunReader
+{
+public:
+  RunReader(std::string const & path, std::size_t const block_records)
+    : block(block_records)
+  {
+    file = std::fopen(path.c_str(), "rb");
+
+    if (!file)
+    {
+      BOOST_LOG_TRIVIAL(error) << "[graphtyper::sorted_run_writer] Could not open run file " << path;
+      std::exit(1);
+    }
+
+    refill();
+  }
+
+  ~RunReader()
+  {
+    if (file)
+      std::fclose(file);
+  }
+
+  RunReader(RunReader const &) = delete;
+  RunReader & operator=(RunReader const &) = delete;
+
+  bool at_end() const {return pos == end;}
+  TRecord const & current() const {return block[pos];}
+
+  void
+  next()
+  {
+    ++pos;
+
+    if (pos == end)
+      refill();
+  }
+
+private:
+  std::FILE * file = nullptr;
+  std::vector<TRecord> block;
+  std::size_t pos = 0;
+  std::size_t end = 0;
+
+  void
+  refill()
+  {
+    pos = 0;
+    end = std::fread(block.data(), sizeof(TRecord), block.size(), file);
+  }
+};
+
+
+/**
+ * \brief Merges sorted runs and calls 'f' for each record in order of key.
+ * \details Records with the same key are given in the order of their runs and then in the order within the run.
+ */
+template <typename TFunc>
+void
+merge_run_files(std::vector<std::string> const & paths, std::size_t const block_records, TFunc && f)
+{
+  std::vector<std::unique_ptr<RunReader> > readers;
+  readers.reserve(paths.size());
+
+  for (auto const & path : paths)
+    readers.emplace_back(new RunReader(path, block_records));
+
+  using THeapEntry = std::pair<gyper::TKmerKey, std::size_t>;
+  std::priority_queue<THeapEntry, std::vector<THeapEntry>, std::greater<THeapEntry> > heap;
+
+  for (std::size_t r = 0; r < readers.size(); ++r)
+  {
+    if (!readers[r]->at_end())
+      heap.push({readers[r]->current().key, r});
+  }
+
+  while (!heap.empty())
+  {
+    gyper::TKmerKey const key = heap.top().first;
+    std::size_t const r = heap.top().second;
+    heap.pop();
+    RunReader & reader = *readers[r];
+
+    for (; !reader.at_end() && reader.current().key == key; reader.next())
+      f(reader.current());
+
+    if (!reader.at_end())
+      heap.push({reader.current().key, r});
+  }
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+std::size_t constexpr SortedRunWriter::MAX_MERGE_WIDTH;
+std::size_t constexpr SortedRunWriter::MIN_BLOCK_RECORDS;
+
+
+SortedRunWriter::SortedRunWriter(std::string const & _run_prefix, std::size_t const max_memory)
+  : run_prefix(_run_prefix)
+  , max_records(std::max(static_cast<std::size_t>(1), std::min(max_memory / sizeof(Record),
+                                                               static_cast<std::size_t>(0xFFFFFFFFul))))
+{
+  buffer.reserve(max_records);
+}
+
+
+SortedRunWriter::~SortedRunWriter()
+{
+  remove_runs();
+}
+
+
+void
+SortedRunWriter::put(TKmerKey const key, KmerLabel && label)
+{
+  if (buffer.size() == max_records)
+    write_run();
+
+  buffer.push_back({key, static_cast<uint32_t>(buffer.size()), label.start_index, label.end_index, label.variant_id});
+  ++num_labels;
+}
+
+
+void
+SortedRunWriter::put(TKmerKey const key, std::vector<KmerLabel> && labels)
+{
+  for (auto & label : labels)
+    put(key, std::move(label));
+}
+
+
+void
+SortedRunWriter::write_run()
+{
+  std::sort(buffer.begin(), buffer.end(), record_less);
+
+  std::string const path = get_run_path();
+  std::FILE * file = std::fopen(path.c_str(), "wb");
+
+  if (!file || std::fwrite(buffer.data(), sizeof(Record), buffer.size(), file) != buffer.size())
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::sorted_run_writer] Could not write run file " << path;
+    std::exit(1);
+  }
+
+  std::fclose(file);
+  run_paths.push_back(path);
+  buffer.clear();
+}
+
+
+void
+SortedRunWriter::merge(std::function<void(TKmerKey const key, std::vector<KmerLabel> & labels)> const & f)
+{
+  std::vector<KmerLabel> labels;
+
+  // Everything fit in memory
+  if (run_paths.size() == 0)
+  {
+    std::sort(buffer.begin(), buffer.end(), record_less);
+
+    for (auto it = buffer.begin(); it != buffer.end();)
+    {
+      TKmerKey const key = it->key;
+      labels.clear();
+
+      for (; it != buffer.end() && it->key == key; ++it)
+        labels.push_back(record_to_label(*it));
+
+      f(key, labels);
+    }
+
+    buffer = std::vector<Record>();
+    num_labels = 0;
+    return;
+  }
+
+  if (buffer.size() > 0)
+    write_run();
+
+  buffer = std::vector<Record>(); // Free the buffer, its memory is used for reading the runs
+
+  // Merge groups of consecutive runs until few enough are left to merge at once
+  while (run_paths.size() > MAX_MERGE_WIDTH)
+  {
+    std::size_t const block_records = std::max(MIN_BLOCK_RECORDS, max_records / (MAX_MERGE_WIDTH + 1));
+    std::vector<std::string> merged_paths;
+
+    for (std::size_t i = 0; i < run_paths.size(); i += MAX_MERGE_WIDTH)
+    {
+      std::vector<std::string> const group(run_paths.begin() + i,
+                                           run_paths.begin() + std::min(i + MAX_MERGE_WIDTH, run_paths.size()));
+
+      if (group.size() == 1)
+      {
+        merged_paths.push_back(group[0]);
+        continue;
+      }
+
+      std::string const path = get_run_path();
+      std::FILE * file = std::fopen(path.c_str(), "wb");
+      std::vector<Record> out_block;
+      out_block.reserve(block_records);
+
+      auto flush = [&]()
+        {
+          if (!file || std::fwrite(out_block.data(), sizeof(Record), out_block.size(), file) != out_block.size())
+          {
+            BOOST_LOG_TRIVIAL(error) << "[graphtyper::sorted_run_writer] Could not write run file " << path;
+            std::exit(1);
+          }
+
+          out_block.clear();
+        };
+
+      merge_run_files(group, block_records, [&](Record const & record)
+        {
+          out_block.push_back(record);
+
+          if (out_block.size() == block_records)
+            flush();
+        });
+
+      flush();
+      std::fclose(file);
+
+      for (auto const & group_path : group)
+        std::remove(group_path.c_str());
+
+      merged_paths.push_back(path);
+    }
+
+    run_paths = std::move(merged_paths);
+  }
+
+  // Each run gets an equal share of the memory
+  std::size_t const block_records = std::max(MIN_BLOCK_RECORDS, max_records / run_paths.size());
+  bool has_key = false;
+  TKmerKey key = 0;
+
+  merge_run_files(run_paths, block_records, [&](Record const & record)
+    {
+      if (has_key && record.key != key)
+      {
+        f(key, labels);
+        labels.clear();
+      }
+
+      has_key = true;
+      key = record.key;
+      labels.push_back(record_to_label(record));
+    });
+
+  if (has_key)
+    f(key, labels);
+
+  remove_runs();
+  num_labels = 0;
+}
+
+
+std::string
+SortedRunWriter::get_run_path()
+{
+  return run_prefix + "." + std::to_string(num_written_runs++) + ".run";
+}
+
+
+void
+SortedRunWriter::remove_runs()
+{
+  for (auto const & path : run_paths)
+    std::remove(path.c_str());
+
+  run_paths.clear();
+}
+
+
+} // namespace gyper
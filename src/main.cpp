@@ -280,7 +280,23 @@ subcmd_call(paw::Parser & parser)
   std::string sam;
   std::string sams;
 
+  parser.parse_option(opts.hamming1_index, ' ', "hamming1_index",
+                      "Set to look up k-mers with one mismatch in a split-key index (uses more memory).");
+  parser.parse_option(opts.syncmer_seeds, ' ', "syncmer_seeds",
+                      "Set to seed reads with syncmers, reads with too few syncmer hits are seeded every K - 1 bases.");
+  parser.parse_option(opts.numa_index, ' ', "numa_index",
+                      "Set to 'replicate' to copy the index to each NUMA node or 'interleave' to spread it across "
+                      "them. Sample pools are pinned to the nodes.");
+  parser.parse_option(opts.huge_pages, ' ', "huge_pages",
+                      "Set to 'thp' to back the graph and index with transparent huge pages or 'hugetlb' to use "
+                      "reserved huge pages, falling back to 'thp' when there are too few.");
   parser.parse_option(index_dir, ' ', "index", "Path to index directory.");
+  parser.parse_option(opts.index_memory_budget, ' ', "index_memory_budget",
+                      "Max. MB of memory for the index. Larger indexes are queried on disk through a cache of this "
+                      "size (0 means no limit).");
+  parser.parse_option(opts.shared_index, ' ', "shared_index",
+                      "Name of a shared memory segment (or path on a hugetlbfs mount) to share the graph and index with "
+                      "other processes on the host.");
   parser.parse_option(minimum_variant_support, ' ',
                       "minimum_variant_support", "Minimum variant support for it to be considered.");
   parser.parse_option(minimum_variant_support_ratio, ' ',
@@ -347,6 +363,23 @@ subcmd_check(paw::Parser & parser)
 }
 
 
+int
+subcmd_convert_graph(paw::Parser & parser)
+{
+  std::string old_graph_fn;
+  std::string graph_fn;
+  parser.parse_positional_argument(old_graph_fn, "OLD_GRAPH", "Path to a graph saved by an older version.");
+  parser.parse_positional_argument(graph_fn, "GRAPH", "Path to write the graph in the flat graph format to.");
+  parser.finalize();
+  setup_logger();
+
+  gyper::check_file_exists(old_graph_fn);
+  gyper::convert_graph(old_graph_fn, graph_fn);
+  BOOST_LOG_TRIVIAL(info) << "Graph saved at " << graph_fn;
+  return 0;
+}
+
+
 int
 subcmd_construct(paw::Parser & parser)
 {
@@ -366,6 +399,13 @@ subcmd_construct(paw::Parser & parser)
   parser.parse_option(opts.add_all_variants, ' ', "output_all_variants", "Set to create a graph with every possible "
                                                                          "haplotype on overlapping variants.");
   parser.parse_option(use_tabix, ' ', "use_tabix", "Set to use tabix index to extract variants of the given region.");
+  parser.parse_option(opts.threads, 't', "threads", "Max. number of threads to use when indexing.");
+  parser.parse_option(opts.max_index_memory, ' ', "max_index_memory",
+                      "Max. memory in MB for buffering index labels, sorted runs are spilled to disk beyond it. "
+                      "0 means 2048.");
+  parser.parse_option(opts.flat_index, ' ', "flat_index",
+                      "Set to also write a flat index file, which typing maps instead of loading the index. Writing "
+                      "it needs memory for the whole index.");
   parser.parse_option(vcf_fn, ' ', "vcf", "VCF variant input.");
 
   parser.parse_positional_argument(graph_fn, "GRAPH", "Path to graph.");
@@ -497,6 +537,17 @@ subcmd_genotype(paw::Parser & parser)
                       "avg_cov_by_readlen",
                       "File with average boverage by read length.");
 
+  parser.parse_option(opts.hamming1_index, ' ', "hamming1_index",
+                      "Set to look up k-mers with one mismatch in a split-key index (uses more memory).");
+  parser.parse_option(opts.syncmer_seeds, ' ', "syncmer_seeds",
+                      "Set to seed reads with syncmers, reads with too few syncmer hits are seeded every K - 1 bases.");
+  parser.parse_option(opts.numa_index, ' ', "numa_index",
+                      "Set to 'replicate' to copy the index to each NUMA node or 'interleave' to spread it across "
+                      "them. Sample pools are pinned to the nodes.");
+  parser.parse_option(opts.huge_pages, ' ', "huge_pages",
+                      "Set to 'thp' to back the graph and index with transparent huge pages or 'hugetlb' to use "
+                      "reserved huge pages, falling back to 'thp' when there are too few.");
+
   parser.parse_option(opts.max_files_open,
                       ' ',
                       "max_files_open",
@@ -581,6 +632,16 @@ subcmd_genotype_sv(paw::Parser & parser)
   bool force_no_copy_reference = false;
 
   // Parse options
+  parser.parse_option(opts.hamming1_index, ' ', "hamming1_index",
+                      "Set to look up k-mers with one mismatch in a split-key index (uses more memory).");
+  parser.parse_option(opts.syncmer_seeds, ' ', "syncmer_seeds",
+                      "Set to seed reads with syncmers, reads with too few syncmer hits are seeded every K - 1 bases.");
+  parser.parse_option(opts.numa_index, ' ', "numa_index",
+                      "Set to 'replicate' to copy the index to each NUMA node or 'interleave' to spread it across "
+                      "them. Sample pools are pinned to the nodes.");
+  parser.parse_option(opts.huge_pages, ' ', "huge_pages",
+                      "Set to 'thp' to back the graph and index with transparent huge pages or 'hugetlb' to use "
+                      "reserved huge pages, falling back to 'thp' when there are too few.");
   parser.parse_option(opts.max_files_open,
                       ' ',
                       "max_files_open",
@@ -653,6 +714,17 @@ subcmd_genotype_camou(paw::Parser & parser)
                       "avg_cov_by_readlen",
                       "File with average coverage by read length.");
 
+  parser.parse_option(opts.hamming1_index, ' ', "hamming1_index",
+                      "Set to look up k-mers with one mismatch in a split-key index (uses more memory).");
+  parser.parse_option(opts.syncmer_seeds, ' ', "syncmer_seeds",
+                      "Set to seed reads with syncmers, reads with too few syncmer hits are seeded every K - 1 bases.");
+  parser.parse_option(opts.numa_index, ' ', "numa_index",
+                      "Set to 'replicate' to copy the index to each NUMA node or 'interleave' to spread it across "
+                      "them. Sample pools are pinned to the nodes.");
+  parser.parse_option(opts.huge_pages, ' ', "huge_pages",
+                      "Set to 'thp' to back the graph and index with transparent huge pages or 'hugetlb' to use "
+                      "reserved huge pages, falling back to 'thp' when there are too few.");
+
   parser.parse_option(opts.max_files_open, ' ', "max_files_open",
                       "Select how many files can be open at the same time.");
 
@@ -829,6 +901,7 @@ main(int argc, char ** argv)
     parser.add_subcommand("call", "Call variants of a graph.");
     parser.add_subcommand("check", "Check a GraphTyper graph (useful for debugging).");
     parser.add_subcommand("construct", "Construct a graph.");
+    parser.add_subcommand("convert_graph", "Convert a graph of an older version to the flat graph format.");
     parser.add_subcommand("discover", "Discover variants from SAM/BAM/CRAMs.");
     parser.add_subcommand("discovery_vcf", "Create a VCF with discovered variants.");
     parser.add_subcommand("genotype", "Run the SNP/indel genotyping pipeline.");
@@ -855,6 +928,8 @@ main(int argc, char ** argv)
       ret = subcmd_check(parser);
     else if (subcmd == "construct")
       ret = subcmd_construct(parser);
+    else if (subcmd == "convert_graph")
+      ret = subcmd_convert_graph(parser);
     else if (subcmd == "discover")
       ret = subcmd_discover(parser);
     else if (subcmd == "discovery_vcf")
@@ -1,8 +1,11 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cstdint>
 #include <ctime>
 #include <iterator>
+#include <utility>
+#include <vector>
 
 #include <boost/log/trivial.hpp>
 
@@ -14,26 +17,37 @@
 #include <graphtyper/constants.hpp>
 #include <graphtyper/graph/graph_serialization.hpp>
 #include <graphtyper/typer/alignment.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/kmer_help_functions.hpp>
 #include <graphtyper/utilities/io.hpp>
 #include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/read_encoder.hpp>
 #include <graphtyper/utilities/type_conversions.hpp>
 
 
 namespace
 {
 
-void
-find_genotype_paths_of_one_of_the_sequences(seqan::IupacString const & read,
-                                            gyper::GenotypePaths & geno,
-                                            gyper::Graph const & graph = gyper::graph,
-                                            gyper::MemIndex const & mem_index = gyper::mem_index
-                                            )
+long constexpr MIN_SYNCMER_HITS = 2; // With fewer syncmers found in the index the read is seeded every K - 1 bases
+
+
+/**
+ * \brief Adds the labels of seeds every K - 1 bases of the read and of their Hamming distance 1 neighbours.
+ * \return False if every seed is extremely common, then no labels are added.
+ */
+bool
+add_grid_seed_labels(std::vector<std::vector<gyper::TKmerKey> > const & seed_keys,
+                     gyper::GenotypePaths & geno,
+                     gyper::Graph const & graph,
+                     gyper::MemIndex const & mem_index
+                     )
 {
   using namespace gyper;
 
-  TKmerLabels r_hamming0 = query_index(read, mem_index);
-  TKmerLabels r_hamming1 = query_index_hamming_distance1_without_index(read, mem_index);
+  TPackedKmerLabels r_hamming0 = query_index(seed_keys, mem_index);
+  TPackedKmerLabels r_hamming1 = Options::const_instance()->hamming1_index ?
+                                 query_index_hamming_distance1(seed_keys, mem_index) :
+                                 query_index_hamming_distance1_without_index(seed_keys, mem_index);
 
   // Stop if all kmer are extremely common
   for (auto it = r_hamming0.cbegin();;)
@@ -48,7 +62,7 @@ find_genotype_paths_of_one_of_the_sequences(seqan::IupacString const & read,
 
       // We found no k-mers with less than MAX_UNIQUE_KMER_POSITIONS locations!
       if (it == r_hamming0.cend())
-        return;
+        return false;
     }
   }
 
@@ -63,13 +77,15 @@ find_genotype_paths_of_one_of_the_sequences(seqan::IupacString const & read,
         geno.add_next_kmer_labels(r_hamming0[i],
                                   read_start_index,
                                   read_start_index + (K - 1),
-                                  0 /*mismatches*/
+                                  0 /*mismatches*/,
+                                  graph
                                   );
 
         geno.add_next_kmer_labels(r_hamming1[i],
                                   read_start_index,
                                   read_start_index + (K - 1),
-                                  1 /*mismatches*/
+                                  1 /*mismatches*/,
+                                  graph
                                   );
 
         read_start_index += (K - 1);
@@ -77,6 +93,159 @@ find_genotype_paths_of_one_of_the_sequences(seqan::IupacString const & read,
     }
   }
 
+  return true;
+}
+
+
+struct SyncmerHit
+{
+  int64_t diagonal; // Position in the graph minus position in the read
+  uint32_t read_start_index;
+  gyper::PackedKmerLabel label;
+};
+
+
+/**
+ * \brief Adds the labels of the syncmers of the read which are in the index.
+ * \details Only exact matches are looked up. Hits with diagonals (graph position minus read position) less than K
+ *          apart are chained, and only the chains with the most syncmers are kept. The labels of the first syncmer of
+ *          each kept chain are added, walking the read from them covers the rest of the chain. Walking keeps only the
+ *          extensions with the fewest mismatches, so without chaining a short walk from a repeat would win over the
+ *          long walk from the true location.
+ * \return False if fewer than MIN_SYNCMER_HITS syncmers have labels (which are not extremely common), then no labels
+ *         are added.
+ */
+bool
+add_syncmer_seed_labels(gyper::EncodedRead const & encoded,
+                        bool const is_reverse_complement,
+                        gyper::GenotypePaths & geno,
+                        gyper::Graph const & graph,
+                        gyper::MemIndex const & mem_index
+                        )
+{
+  using namespace gyper;
+
+  std::vector<std::pair<long, TKmerKey> > const seeds = get_syncmer_seeds(encoded, is_reverse_complement);
+  std::vector<std::vector<TKmerKey> > seed_keys;
+  seed_keys.reserve(seeds.size());
+
+  for (auto const & seed : seeds)
+    seed_keys.push_back(std::vector<TKmerKey>(1, seed.second));
+
+  TPackedKmerLabels const r_hamming0 = query_index(seed_keys, mem_index);
+  auto is_hit = [](std::vector<PackedKmerLabel> const & labels)
+                {
+                  return labels.size() > 0 && labels.size() < MAX_UNIQUE_KMER_POSITIONS;
+                };
+
+  if (std::count_if(r_hamming0.begin(), r_hamming0.end(), is_hit) < MIN_SYNCMER_HITS)
+    return false;
+
+  std::vector<SyncmerHit> hits;
+
+  for (std::size_t i = 0; i < seeds.size(); ++i)
+  {
+    if (!is_hit(r_hamming0[i]))
+      continue;
+
+    uint32_t const read_start_index = static_cast<uint32_t>(seeds[i].first);
+
+    for (auto const & label : r_hamming0[i])
+    {
+      int64_t const diagonal = static_cast<int64_t>(graph.get_actual_pos(label.start_index)) - read_start_index;
+      hits.push_back({diagonal, read_start_index, label});
+    }
+  }
+
+  // Hits of each syncmer were added in order of the read, a stable sort keeps that order within each diagonal
+  std::stable_sort(hits.begin(), hits.end(), [](SyncmerHit const & a, SyncmerHit const & b)
+                   {
+                     return a.diagonal < b.diagonal;
+                   });
+
+  // Split the hits into chains and count the syncmers in each chain
+  std::vector<std::size_t> chain_begins;
+  std::vector<std::size_t> chain_syncmers;
+  std::vector<uint32_t> read_start_indexes;
+
+  for (std::size_t i = 0; i < hits.size(); ++i)
+  {
+    if (i == 0 || hits[i].diagonal - hits[i - 1].diagonal >= static_cast<int64_t>(K))
+    {
+      chain_begins.push_back(i);
+      chain_syncmers.push_back(0);
+      read_start_indexes.clear();
+    }
+
+    if (std::find(read_start_indexes.begin(), read_start_indexes.end(), hits[i].read_start_index) ==
+        read_start_indexes.end())
+    {
+      read_start_indexes.push_back(hits[i].read_start_index);
+      ++chain_syncmers.back();
+    }
+  }
+
+  chain_begins.push_back(hits.size());
+  std::size_t const most_syncmers = *std::max_element(chain_syncmers.begin(), chain_syncmers.end());
+  std::vector<PackedKmerLabel> new_labels;
+
+  for (std::size_t c = 0; c < chain_syncmers.size(); ++c)
+  {
+    if (chain_syncmers[c] < most_syncmers)
+      continue;
+
+    auto const chain_begin = hits.begin() + chain_begins[c];
+    auto const chain_end = hits.begin() + chain_begins[c + 1];
+    uint32_t const first_read_start_index =
+      std::min_element(chain_begin, chain_end, [](SyncmerHit const & a, SyncmerHit const & b)
+                       {
+                         return a.read_start_index < b.read_start_index;
+                       })->read_start_index;
+
+    new_labels.clear();
+
+    for (auto it = chain_begin; it != chain_end; ++it)
+    {
+      if (it->read_start_index == first_read_start_index)
+        new_labels.push_back(it->label);
+    }
+
+    geno.add_next_kmer_labels(new_labels,
+                              first_read_start_index,
+                              first_read_start_index + (K - 1),
+                              0 /*mismatches*/,
+                              graph
+                              );
+  }
+
+  return true;
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+
+void
+find_genotype_paths_of_one_of_the_sequences(seqan::IupacString const & read,
+                                            EncodedRead const & encoded,
+                                            bool const is_reverse_complement,
+                                            GenotypePaths & geno,
+                                            SeedMode const seed_mode,
+                                            Graph const & graph,
+                                            MemIndex const & mem_index
+                                            )
+{
+  if (seed_mode != SeedMode::SYNCMER ||
+      !add_syncmer_seed_labels(encoded, is_reverse_complement, geno, graph, mem_index))
+  {
+    if (!add_grid_seed_labels(get_seed_keys(encoded, is_reverse_complement, read), geno, graph, mem_index))
+      return;
+  }
+
   geno.remove_short_paths();
 
   // Extend the paths
@@ -111,16 +280,17 @@ find_genotype_paths_of_one_of_the_sequences(seqan::IupacString const & read,
 }
 
 
-} // anon namespace
-
-
-namespace gyper
+std::pair<GenotypePaths, GenotypePaths>
+align_read(bam1_t * rec, seqan::IupacString const & seq, seqan::IupacString const & rseq)
 {
+  return align_read(current_context(), rec, seq, rseq);
+}
 
 
 std::pair<GenotypePaths, GenotypePaths>
-align_read(bam1_t * rec, seqan::IupacString const & seq, seqan::IupacString const & rseq)
+align_read(GenotypingContext & context, bam1_t * rec, seqan::IupacString const & seq, seqan::IupacString const & rseq)
 {
+  ContextBinding binding(context); // The path filters and the NUMA copies of the index are looked up in the context
   auto const & core = rec->core;
 
   std::pair<GenotypePaths, GenotypePaths> geno_paths = std::make_pair<GenotypePaths, GenotypePaths>(
@@ -128,8 +298,16 @@ align_read(bam1_t * rec, seqan::IupacString const & seq, seqan::IupacString cons
     GenotypePaths(core.flag, core.l_qseq)
     );
 
-  find_genotype_paths_of_one_of_the_sequences(seq, geno_paths.first);
-  find_genotype_paths_of_one_of_the_sequences(rseq, geno_paths.second);
+  // Seed keys are packed directly from the 4-bit BAM sequence
+  EncodedRead encoded;
+  encoded.encode(bam_get_seq(rec), core.l_qseq);
+
+  SeedMode const seed_mode = Options::const_instance()->syncmer_seeds ? SeedMode::SYNCMER : SeedMode::GRID;
+  MemIndex const & local_mem_index = get_local_mem_index(); // The copy on this thread's NUMA node, if there is one
+  find_genotype_paths_of_one_of_the_sequences(seq, encoded, false, geno_paths.first, seed_mode, context.graph,
+                                              local_mem_index);
+  find_genotype_paths_of_one_of_the_sequences(rseq, encoded, true, geno_paths.second, seed_mode, context.graph,
+                                              local_mem_index);
   return geno_paths;
 }
 
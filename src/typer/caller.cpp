@@ -1,9 +1,12 @@
+#include <algorithm> // std::stable_sort
 #include <cassert> // assert
+#include <functional> // std::bind, std::function
 #include <list> // std::list
 #include <memory> // std::shared_ptr
 #include <sstream> // std::ostringstream
 #include <string> // std::string
 #include <unordered_map> // std::unordered_map
+#include <utility> // std::pair
 #include <vector> // std::vector
 
 #include <paw/station.hpp>
@@ -23,7 +26,8 @@
 #include <graphtyper/graph/reference_depth.hpp>
 #include <graphtyper/index/rocksdb.hpp> // gyper::index (global)
 #include <graphtyper/index/indexer.hpp> // gyper::index (global)
-#include <graphtyper/index/mem_index.hpp> // gyper::mem_index (global)
+#include <graphtyper/index/mem_index.hpp> // gyper::MemIndex
+#include <graphtyper/index/shared_index.hpp> // gyper::load_shared_graph_and_index
 #include <graphtyper/typer/alignment.hpp>
 #include <graphtyper/typer/caller.hpp>
 #include <graphtyper/typer/graph_swapper.hpp>
@@ -32,9 +36,13 @@
 #include <graphtyper/typer/vcf.hpp>
 #include <graphtyper/typer/variant_map.hpp>
 #include <graphtyper/utilities/hts_parallel_reader.hpp> // gyper::HtsParallelReader
+#include <graphtyper/utilities/genotyping_context.hpp> // gyper::GenotypingContext
 #include <graphtyper/utilities/hts_reader.hpp> // gyper::HtsReader
 #include <graphtyper/utilities/io.hpp>
+#include <graphtyper/utilities/numa.hpp> // gyper::ScopedNumaPin
 #include <graphtyper/utilities/options.hpp> // gyper::Options
+#include <graphtyper/utilities/system.hpp> // gyper::get_file_size
+#include <graphtyper/utilities/task_scheduler.hpp> // gyper::TaskScheduler
 
 
 namespace
@@ -101,6 +109,88 @@ _determine_num_jobs_and_num_parts(long & jobs,
 }
 
 
+// Pools are spread over the NUMA nodes in turn when the index is placed on them, -1 if pools are not pinned
+long
+_get_pool_numa_node(long const pool)
+{
+  using namespace gyper;
+
+  if (Options::const_instance()->numa_index.size() == 0)
+    return -1;
+
+  return pool % get_num_numa_nodes();
+}
+
+
+// Pools in descending order of the total size of their files, so the longest pools start first
+std::vector<long>
+_get_pools_largest_first(std::vector<std::unique_ptr<std::vector<std::string> > > const & spl_hts_paths)
+{
+  using namespace gyper;
+  std::vector<std::pair<long, long> > pool_sizes; // (bytes, pool index)
+
+  for (long i = 0; i < static_cast<long>(spl_hts_paths.size()); ++i)
+  {
+    long num_bytes = 0;
+
+    for (auto const & hts_path : *spl_hts_paths[i])
+      num_bytes += get_file_size(hts_path);
+
+    pool_sizes.push_back({num_bytes, i});
+  }
+
+  std::stable_sort(pool_sizes.begin(), pool_sizes.end(), [](std::pair<long, long> const & a,
+                                                            std::pair<long, long> const & b){
+      return a.first > b.first;
+    });
+
+  std::vector<long> pools;
+
+  for (auto const & pool_size : pool_sizes)
+    pools.push_back(pool_size.second);
+
+  return pools;
+}
+
+
+void
+_genotype_pool_on_numa_node(gyper::GenotypingContext * context,
+                            long const numa_node,
+                            std::string * out_path,
+                            std::vector<std::string> const * hts_paths_ptr,
+                            std::string const & output_dir,
+                            bool const is_writing_calls_vcf,
+                            bool const is_writing_hap)
+{
+  gyper::ContextBinding binding(*context);
+  gyper::ScopedNumaPin const pin(numa_node); // The last pool runs on the calling thread
+  gyper::parallel_reader_genotype_only(out_path, hts_paths_ptr, output_dir, is_writing_calls_vcf, is_writing_hap);
+}
+
+
+void
+_discover_pool_on_numa_node(gyper::GenotypingContext * context,
+                            long const numa_node,
+                            std::string * out_path,
+                            std::vector<std::string> const * hts_paths_ptr,
+                            std::string const & output_dir,
+                            long const minimum_variant_support,
+                            double const minimum_variant_support_ratio,
+                            bool const is_writing_calls_vcf,
+                            bool const is_writing_hap)
+{
+  gyper::ContextBinding binding(*context);
+  gyper::ScopedNumaPin const pin(numa_node); // The last pool runs on the calling thread
+  gyper::parallel_reader_with_discovery(out_path,
+                                        hts_paths_ptr,
+                                        output_dir,
+                                        minimum_variant_support,
+                                        minimum_variant_support_ratio,
+                                        is_writing_calls_vcf,
+                                        is_writing_hap);
+}
+
+
 } // anon namespace
 
 
@@ -118,6 +208,33 @@ call(std::vector<std::string> const & hts_paths,
      bool const is_discovery,
      bool const is_writing_hap)
 {
+  return call(current_context(),
+              hts_paths,
+              graph_path,
+              index_path,
+              output_dir,
+              minimum_variant_support,
+              minimum_variant_support_ratio,
+              is_writing_calls_vcf,
+              is_discovery,
+              is_writing_hap);
+}
+
+
+std::vector<std::string>
+call(GenotypingContext & context,
+     std::vector<std::string> const & hts_paths,
+     std::string const & graph_path,
+     std::string const & index_path,
+     std::string const & output_dir,
+     long const minimum_variant_support,
+     double const minimum_variant_support_ratio,
+     bool const is_writing_calls_vcf,
+     bool const is_discovery,
+     bool const is_writing_hap)
+{
+  ContextBinding binding(context); // Graphs and indexes are loaded into the context
+  MemIndex & mem_index = context.mem_index;
   std::vector<std::string> paths;
 
   if (hts_paths.size() == 0)
@@ -126,14 +243,25 @@ call(std::vector<std::string> const & hts_paths,
     std::exit(1);
   }
 
-  if (graph_path.size() > 0)
-    load_graph(graph_path); // Loads the graph into the global variable 'graph'
+  std::string const & shared_index = Options::const_instance()->shared_index;
 
-  if (index_path.size() > 0)
-    load_index(index_path); // Loads the index into the global variable 'index'
+  // Other processes on this host may have loaded the same graph and index already
+  bool const is_shared = shared_index.size() > 0 && graph_path.size() > 0 && index_path.size() > 0 &&
+                         load_shared_graph_and_index(shared_index, graph_path, index_path);
 
-  mem_index.load(index); // Loads the in-memory index
-  index.close(); // Close the RocksDB index, we will use the in-memory index for querying reads
+  if (is_shared)
+  {
+    BOOST_LOG_TRIVIAL(debug) << "[graphtyper::caller] Using shared index with " << mem_index.hamming0.size()
+                             << " K-mers.";
+  }
+  else if (graph_path.size() > 0)
+  {
+    load_graph(graph_path); // Loads the graph into the context
+  }
+
+  // If no index path is given we use the in-memory index which has already been built from the graph
+  if (!is_shared && index_path.size() > 0)
+    load_mem_index(mem_index, index_path); // Loads the in-memory index, or queries it on disk if it is large
 
   // Split hts_paths
   std::vector<std::unique_ptr<std::vector<std::string> > > spl_hts_paths;
@@ -161,7 +289,55 @@ call(std::vector<std::string> const & hts_paths,
   long const NUM_POOLS = spl_hts_paths.size();
   paths.resize(NUM_POOLS);
 
-  // Run in parallel
+  if (Options::const_instance()->numa_index.size() > 0)
+    place_mem_index_on_numa_nodes(Options::const_instance()->numa_index);
+
+  if (context.scheduler)
+  {
+    // Pools are tasks of the scheduler shared by all regions
+    std::vector<TaskScheduler::TaskId> pool_tasks;
+
+    for (long const i : _get_pools_largest_first(spl_hts_paths))
+    {
+      TaskKey key = context.task_key;
+      key.pool = i;
+      std::function<void()> work;
+
+      if (!is_discovery)
+      {
+        work = std::bind(_genotype_pool_on_numa_node,
+                         &context,
+                         _get_pool_numa_node(i),
+                         &paths[i],
+                         spl_hts_paths[i].get(),
+                         output_dir,
+                         is_writing_calls_vcf,
+                         is_writing_hap);
+      }
+      else
+      {
+        work = std::bind(_discover_pool_on_numa_node,
+                         &context,
+                         _get_pool_numa_node(i),
+                         &paths[i],
+                         spl_hts_paths[i].get(),
+                         output_dir,
+                         minimum_variant_support,
+                         minimum_variant_support_ratio,
+                         is_writing_calls_vcf,
+                         is_writing_hap);
+      }
+
+      pool_tasks.push_back(context.scheduler->add_task(std::move(work),
+                                                       key,
+                                                       std::vector<TaskScheduler::TaskId>(),
+                                                       spl_hts_paths[i]->size()));
+    }
+
+    context.scheduler->wait(pool_tasks); // Runs pools of any region meanwhile
+    BOOST_LOG_TRIVIAL(info) << "Finished calling " << context.task_key.to_string() << ".";
+  }
+  else
   {
     paw::Station call_station(jobs); // last parameter is queue_size
 
@@ -170,7 +346,9 @@ call(std::vector<std::string> const & hts_paths,
     {
       for (long i = 0; i < NUM_POOLS - 1; ++i)
       {
-        call_station.add_work(parallel_reader_genotype_only,
+        call_station.add_work(_genotype_pool_on_numa_node,
+                              &context,
+                              _get_pool_numa_node(i),
                               &paths[i],
                               spl_hts_paths[i].get(),
                               output_dir,
@@ -180,7 +358,9 @@ call(std::vector<std::string> const & hts_paths,
 
       // Do the last pool on the current thread
       call_station.add_to_thread(jobs - 1,
-                                 parallel_reader_genotype_only,
+                                 _genotype_pool_on_numa_node,
+                                 &context,
+                                 _get_pool_numa_node(NUM_POOLS - 1),
                                  &paths[NUM_POOLS - 1],
                                  spl_hts_paths[NUM_POOLS - 1].get(),
                                  output_dir,
@@ -191,7 +371,9 @@ call(std::vector<std::string> const & hts_paths,
     {
       for (long i = 0; i < NUM_POOLS - 1; ++i)
       {
-        call_station.add_work(parallel_reader_with_discovery,
+        call_station.add_work(_discover_pool_on_numa_node,
+                              &context,
+                              _get_pool_numa_node(i),
                               &paths[i],
                               spl_hts_paths[i].get(),
                               output_dir,
@@ -203,7 +385,9 @@ call(std::vector<std::string> const & hts_paths,
 
       // Do the last pool on the current thread
       call_station.add_to_thread(jobs - 1,
-                                 parallel_reader_with_discovery,
+                                 _discover_pool_on_numa_node,
+                                 &context,
+                                 _get_pool_numa_node(NUM_POOLS - 1),
                                  &paths[NUM_POOLS - 1],
                                  spl_hts_paths[NUM_POOLS - 1].get(),
                                  output_dir,
@@ -214,9 +398,28 @@ call(std::vector<std::string> const & hts_paths,
     }
 
     std::string thread_info = call_station.join();
+
+    if (Options::const_instance()->numa_index.size() > 0)
+    {
+      std::ostringstream ss;
+      ss << " NUMA nodes of pools:";
+
+      for (long i = 0; i < NUM_POOLS; ++i)
+        ss << ' ' << i << "->" << _get_pool_numa_node(i);
+
+      thread_info += ss.str();
+    }
+
     BOOST_LOG_TRIVIAL(info) << "Finished calling. Thread work: " << thread_info;
   }
 
+  clear_numa_mem_indexes(); // Also adds the lookups of the copies to the filter statistics
+
+  BOOST_LOG_TRIVIAL(info) << "[graphtyper::caller] K-mer filter: " << mem_index.filter_stats.to_string();
+
+  if (mem_index.is_on_disk())
+    BOOST_LOG_TRIVIAL(info) << "[graphtyper::caller] K-mer cache: " << mem_index.label_cache->to_string();
+
   BOOST_LOG_TRIVIAL(debug) << "[graphtyper::caller] Finished calling all samples.";
   return paths;
 }
@@ -229,6 +432,8 @@ find_variants_in_cigar(seqan::BamAlignmentRecord const & record,
 {
   std::vector<VariantCandidate> new_var_candidates;
   assert(record.beginPos != -1);
+  Graph const & graph = current_context().graph;
+  AbsolutePosition const & absolute_pos = current_context().absolute_pos;
   long ref_abs_pos = absolute_pos.get_absolute_position(region.chr, record.beginPos + 1);
   long const reference_offset = graph.ref_nodes.size() > 0 ?
                                 graph.ref_nodes[0].get_label().order :
@@ -367,7 +572,8 @@ find_variants_in_cigar(seqan::BamAlignmentRecord const & record,
 
 
 void
-parallel_discover_from_cigar(std::string * output_ptr,
+parallel_discover_from_cigar(GenotypingContext * context,
+                             std::string * output_ptr,
                              std::vector<std::string> const * hts_paths_ptr,
                              GenomicRegion const & region,
                              std::string const & output_dir,
@@ -377,6 +583,7 @@ parallel_discover_from_cigar(std::string * output_ptr,
 {
   assert(output_ptr);
   assert(hts_paths_ptr);
+  ContextBinding binding(*context);
   auto const & hts_paths = *hts_paths_ptr;
 
   if (ref_str.size() == 0)
@@ -439,7 +646,7 @@ parallel_discover_from_cigar(std::string * output_ptr,
       assert(record.beginPos >= 0);
 
       // 0-based positions
-      int64_t begin_pos = absolute_pos.get_absolute_position(region.chr, record.beginPos + 1);
+      int64_t begin_pos = context->absolute_pos.get_absolute_position(region.chr, record.beginPos + 1);
       int64_t end_pos = begin_pos + seqan::getAlignmentLengthInRef(record);
 
       // Check if read is within region
@@ -524,13 +731,33 @@ discover_directly_from_bam(std::string const & graph_path,
                            long minimum_variant_support,
                            double minimum_variant_support_ratio)
 {
+  return discover_directly_from_bam(current_context(),
+                                    graph_path,
+                                    hts_paths,
+                                    region_str,
+                                    output_dir,
+                                    minimum_variant_support,
+                                    minimum_variant_support_ratio);
+}
+
+
+std::vector<std::string>
+discover_directly_from_bam(GenotypingContext & context,
+                           std::string const & graph_path,
+                           std::vector<std::string> const & hts_paths,
+                           std::string const & region_str,
+                           std::string const & output_dir,
+                           long minimum_variant_support,
+                           double minimum_variant_support_ratio)
+{
+  ContextBinding binding(context);
   std::vector<std::string> output_file_paths;
 
   if (graph_path.size() > 0)
     load_graph(graph_path);
 
   //graph.generate_reference_genome();
-  std::string ref_str(graph.reference.begin(), graph.reference.end());
+  std::string ref_str(context.graph.reference.begin(), context.graph.reference.end());
 
   // parse region
   GenomicRegion const region(region_str);
@@ -560,7 +787,34 @@ discover_directly_from_bam(std::string const & graph_path,
   BOOST_LOG_TRIVIAL(debug) << "[graphtyper::caller] Number of pools = " << NUM_POOLS;
   output_file_paths.resize(NUM_POOLS);
 
-  // Run in parallel
+  if (context.scheduler)
+  {
+    // Pools are tasks of the scheduler shared by all regions
+    std::vector<TaskScheduler::TaskId> pool_tasks;
+
+    for (long const i : _get_pools_largest_first(spl_hts_paths))
+    {
+      TaskKey key = context.task_key;
+      key.pool = i;
+
+      pool_tasks.push_back(context.scheduler->add_task(std::bind(parallel_discover_from_cigar,
+                                                                 &context,
+                                                                 &(output_file_paths[i]),
+                                                                 spl_hts_paths[i].get(),
+                                                                 region,
+                                                                 output_dir,
+                                                                 ref_str,
+                                                                 minimum_variant_support,
+                                                                 minimum_variant_support_ratio),
+                                                       key,
+                                                       std::vector<TaskScheduler::TaskId>(),
+                                                       spl_hts_paths[i]->size()));
+    }
+
+    context.scheduler->wait(pool_tasks); // Runs pools of any region meanwhile
+    BOOST_LOG_TRIVIAL(info) << "Finished discovery in " << context.task_key.to_string() << ".";
+  }
+  else
   {
     paw::Station call_station(jobs); // last parameter is queue_size
     //call_station.options.verbosity = 2; // Print messages
@@ -568,6 +822,7 @@ discover_directly_from_bam(std::string const & graph_path,
     for (long i = 0; i < NUM_POOLS - 1; ++i)
     {
       call_station.add_work(parallel_discover_from_cigar,
+                            &context,
                             &(output_file_paths[i]),
                             spl_hts_paths[i].get(),
                             region,
@@ -580,6 +835,7 @@ discover_directly_from_bam(std::string const & graph_path,
     // Do the last pool on the current thread
     call_station.add_to_thread(jobs - 1,
                                parallel_discover_from_cigar,
+                               &context,
                                &(output_file_paths[NUM_POOLS - 1]),
                                spl_hts_paths[NUM_POOLS - 1].get(),
                                region,
@@ -9,6 +9,7 @@
 #include <graphtyper/index/kmer_label.hpp>
 #include <graphtyper/typer/genotype_paths.hpp>
 #include <graphtyper/typer/variant_candidate.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/kmer_help_functions.hpp>
 #include <graphtyper/utilities/options.hpp>
 
@@ -301,6 +302,40 @@ GenotypePaths::add_prev_kmer_labels(std::vector<KmerLabel> const & ll,
 }
 
 
+void
+GenotypePaths::add_next_kmer_labels(std::vector<PackedKmerLabel> const & ll,
+                                    uint32_t const read_start_index,
+                                    uint32_t const read_end_index,
+                                    int const mismatches,
+                                    gyper::Graph const & graph
+                                    )
+{
+  if (ll.size() == 0)
+    return;
+
+  std::vector<KmerLabel> labels;
+  labels.reserve(ll.size());
+
+  for (auto const & l : ll)
+  {
+    if (l.variant_id == INVALID_ID)
+    {
+      labels.push_back(KmerLabel(l.start_index, l.end_index));
+    }
+    else
+    {
+      labels.push_back(KmerLabel(l.start_index,
+                                 l.end_index,
+                                 l.variant_id,
+                                 graph.get_variant_num(l.variant_id),
+                                 graph.var_nodes[l.variant_id].get_label().order));
+    }
+  }
+
+  add_next_kmer_labels(labels, read_start_index, read_end_index, mismatches);
+}
+
+
 void
 GenotypePaths::add_next_kmer_labels(std::vector<KmerLabel> const & ll,
                                     uint32_t const read_start_index,
@@ -402,6 +437,7 @@ void
 GenotypePaths::remove_support_from_read_ends()
 {
   long constexpr MIN_OFFSET = 4;
+  Graph const & graph = current_context().graph;
 
   for (Path & path : paths)
   {
@@ -454,6 +490,8 @@ GenotypePaths::remove_support_from_read_ends()
 void
 GenotypePaths::remove_paths_within_variant_node()
 {
+  Graph const & graph = current_context().graph;
+
   auto is_path_within_one_variant_node =
     [&](Path const & path)
     {
@@ -625,7 +663,6 @@ GenotypePaths::walk_read_starts(seqan::IupacString const & seq, int maximum_mism
     if (path.read_start_index == 0)
       continue;
 
-    assert(path.read_start_index % (K - 1) == 0);
     std::vector<char> kmer;
     kmer.reserve(path.read_start_index + 1); // It cannot get bigger than this
 
@@ -677,6 +714,7 @@ GenotypePaths::walk_read_starts(seqan::IupacString const & seq, int maximum_mism
 std::vector<VariantCandidate>
 GenotypePaths::find_new_variants() const
 {
+  Graph const & graph = current_context().graph;
   std::vector<VariantCandidate> new_variants;
 
   // Don't try to find variants in perfect reads or ambigous reads
@@ -937,6 +975,8 @@ GenotypePaths::longest_path_size() const
 bool
 GenotypePaths::check_no_variant_is_missing() const
 {
+  Graph const & graph = current_context().graph;
+
   for (auto const & path : paths)
   {
     std::vector<uint32_t> expected_orders = graph.get_var_orders(path.start_ref_reach_pos(), path.end_ref_reach_pos());
@@ -2,6 +2,7 @@
 
 #include <graphtyper/graph/graph.hpp> // gyper::Graph
 #include <graphtyper/typer/graph_swapper.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp> // gyper::current_context
 
 namespace gyper
 {
@@ -9,8 +10,10 @@ namespace gyper
 void
 swap_graph_and_index(Graph & secondary_graph, MemIndex & secondary_mem_index)
 {
-  std::swap(graph, secondary_graph);
-  std::swap(mem_index, secondary_mem_index);
+  GenotypingContext & context = current_context();
+  std::swap(context.graph, secondary_graph);
+  std::swap(context.mem_index, secondary_mem_index);
+  clear_numa_mem_indexes(); // The copies are of the other index now
 }
 
 } // namespace gyper
@@ -3,6 +3,7 @@
 
 #include <graphtyper/typer/path.hpp>
 #include <graphtyper/graph/graph.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 
 
 namespace gyper
@@ -124,28 +125,28 @@ Path::end_pos() const
 uint32_t
 Path::start_correct_pos() const
 {
-  return graph.get_actual_pos(start);
+  return current_context().graph.get_actual_pos(start);
 }
 
 
 uint32_t
 Path::start_ref_reach_pos() const
 {
-  return graph.get_ref_reach_pos(start);
+  return current_context().graph.get_ref_reach_pos(start);
 }
 
 
 uint32_t
 Path::end_correct_pos() const
 {
-  return graph.get_actual_pos(end);
+  return current_context().graph.get_actual_pos(end);
 }
 
 
 uint32_t
 Path::end_ref_reach_pos() const
 {
-  return graph.get_ref_reach_pos(end);
+  return current_context().graph.get_ref_reach_pos(end);
 }
 
 
@@ -6,6 +6,7 @@
 #include <graphtyper/graph/haplotype.hpp> // AlleleCoverage
 #include <graphtyper/graph/reference_depth.hpp>
 #include <graphtyper/graph/sv.hpp> // SV
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/graph_help_functions.hpp> // to_index
 #include <graphtyper/typer/sample_call.hpp>
 
@@ -239,6 +240,7 @@ SampleCall
 make_call_based_on_coverage(long pn_index, SV const & sv, ReferenceDepth const & reference_depth)
 {
   SampleCall call;
+  AbsolutePosition const & absolute_pos = current_context().absolute_pos;
   long abs_begin = absolute_pos.get_absolute_position(sv.chrom, sv.begin);
   long abs_end;
 
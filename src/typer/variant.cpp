@@ -18,6 +18,7 @@
 #include <graphtyper/graph/sv.hpp> // gyper::SVTYPE
 #include <graphtyper/typer/variant.hpp> // gyper::Variant
 #include <graphtyper/typer/variant_candidate.hpp> // gyper::VariantCandidate
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/graph_help_functions.hpp> // gyper::to_pair, gyper::to_index
 #include <graphtyper/utilities/options.hpp> // gyper::Options
 #include <graphtyper/utilities/sequence_operations.hpp> // gyper::remove_common_prefix, gyper::remove_common_suffix
@@ -166,7 +167,7 @@ Variant::operator=(Variant && o) noexcept
 
 Variant::Variant(Genotype const & gt)
 {
-  seqs = graph.get_all_sequences_of_a_genotype(gt);
+  seqs = current_context().graph.get_all_sequences_of_a_genotype(gt);
   abs_pos = gt.id - 1; // -1 cause we always fetch one position back as well
 }
 
@@ -174,6 +175,7 @@ Variant::Variant(Genotype const & gt)
 Variant::Variant(std::vector<Genotype> const & gts, std::vector<uint16_t> const & hap_calls)
 {
   assert(gts.size() > 0);
+  Graph const & graph = current_context().graph;
 
   for (long i = 0; i < static_cast<long>(hap_calls.size()); ++i)
     seqs.push_back(graph.get_sequence_of_a_haplotype_call(gts, hap_calls[i]));
@@ -730,7 +732,7 @@ Variant::add_base_in_front(bool const add_N)
 {
   uint32_t abs_pos_copy = abs_pos;
   uint32_t new_abs_pos = abs_pos - 1;
-  std::vector<char> first_base = graph.get_generated_reference_genome(new_abs_pos, abs_pos_copy);
+  std::vector<char> first_base = current_context().graph.get_generated_reference_genome(new_abs_pos, abs_pos_copy);
 
   if (first_base.size() != 1 || abs_pos_copy != abs_pos || new_abs_pos != abs_pos - 1)
     return false; // The base in front could not be extracted
@@ -793,7 +795,7 @@ Variant::add_base_in_back(bool const add_N)
   assert(seqs.size() >= 1);
   uint32_t abs_pos_copy = abs_pos + static_cast<uint32_t>(seqs[0].size());
   uint32_t abs_pos_end = abs_pos_copy + 1;
-  std::vector<char> last_base = graph.get_generated_reference_genome(abs_pos_copy, abs_pos_end);
+  std::vector<char> last_base = current_context().graph.get_generated_reference_genome(abs_pos_copy, abs_pos_end);
 
   if (last_base.size() != 1 || abs_pos_copy != (abs_pos + seqs[0].size()) ||
       abs_pos_end != (abs_pos + seqs[0].size() + 1))
@@ -990,7 +992,8 @@ std::string
 Variant::print() const
 {
   std::stringstream os;
-  auto contig_pos = absolute_pos.get_contig_position(this->abs_pos, gyper::graph);
+  GenotypingContext const & context = current_context();
+  auto contig_pos = context.absolute_pos.get_contig_position(this->abs_pos, context.graph);
   os << contig_pos.first << "\t" << contig_pos.second;
 
   if (this->seqs.size() > 0)
@@ -21,6 +21,7 @@
 #include <graphtyper/typer/variant_map.hpp>
 #include <graphtyper/typer/variant_support.hpp>
 #include <graphtyper/typer/vcf.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/io.hpp>
 #include <graphtyper/utilities/options.hpp>
 #include <graphtyper/utilities/type_conversions.hpp>
@@ -453,7 +454,7 @@ VariantMap::filter_varmap_for_all()
       std::remove_if(new_broken_down_var_candidates.begin(),
                      new_broken_down_var_candidates.end(),
                      [&](VariantCandidate const & broken_var){
-        return graph.is_variant_in_graph(Variant(broken_var));
+        return current_context().graph.is_variant_in_graph(Variant(broken_var));
       }), new_broken_down_var_candidates.end());
 
     if (new_broken_down_var_candidates.size() == 0)
@@ -493,11 +494,13 @@ VariantMap::write_stats(std::string const & prefix)
 
   //discovery_ss << '\n';
 
+  GenotypingContext const & context = current_context();
+
   for (auto map_it = pool_varmap.begin(); map_it != pool_varmap.end(); ++map_it)
   {
     Variant var(map_it->first);
     assert(var.seqs.size() == 2);
-    auto contig_pos = absolute_pos.get_contig_position(var.abs_pos, gyper::graph);
+    auto contig_pos = context.absolute_pos.get_contig_position(var.abs_pos, context.graph);
 
 
     discovery_ss << contig_pos.first << "\t" << contig_pos.second << "\t";
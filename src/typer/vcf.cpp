@@ -15,6 +15,7 @@
 #include <graphtyper/graph/reference_depth.hpp>
 #include <graphtyper/graph/var_record.hpp>
 #include <graphtyper/typer/vcf.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/graph_help_functions.hpp>
 #include <graphtyper/utilities/options.hpp> // gyper::options::instance()
 #include <graphtyper/utilities/type_conversions.hpp>
@@ -256,7 +257,7 @@ Vcf::read_record(bool const SITES_ONLY)
   std::vector<std::size_t> const alt_commas = get_all_pos(alts, ',');
 
   Variant new_var; // Create a new variant for this position
-  new_var.abs_pos = absolute_pos.get_absolute_position(chrom, pos); // Parse positions
+  new_var.abs_pos = current_context().absolute_pos.get_absolute_position(chrom, pos); // Parse positions
 
   // Check for graphtyper variant ID suffix
   {
@@ -476,7 +477,8 @@ Vcf::read_samples()
   if (!bgzf_in.rdbuf()->is_open())
     return;
 
-  bool const is_checking_contigs = gyper::graph.contigs.size() == 0ull;
+  GenotypingContext & context = current_context();
+  bool const is_checking_contigs = context.graph.contigs.size() == 0ull;
 
   while (true)
   {
@@ -507,7 +509,7 @@ Vcf::read_samples()
       contig.name = line.substr(13, comma_pos - 13);
       std::string length = line.substr(comma_pos + 8, closed_pos - comma_pos - 8);
       contig.length = static_cast<uint32_t>(std::stoul(length));
-      gyper::graph.contigs.push_back(std::move(contig));
+      context.graph.contigs.push_back(std::move(contig));
     }
     else if (line[0] == '#' && line[1] != '#')
     {
@@ -525,7 +527,7 @@ Vcf::read_samples()
 
   // Recalculate contig offsets since they may have been changed
   if (is_checking_contigs)
-    absolute_pos.calculate_offsets(gyper::graph);
+    context.absolute_pos.calculate_offsets(context.graph);
 }
 
 
@@ -581,7 +583,7 @@ Vcf::write_header()
               << "##graphtyperSHA1=" << GIT_COMMIT_LONG_HASH << '\n';
 
   // Definitions of contigs
-  for (auto const & contig : graph.contigs)
+  for (auto const & contig : current_context().graph.contigs)
     bgzf_stream << "##contig=<ID=" << contig.name << ",length=" << contig.length << ">\n";
 
   // INFO definitions
@@ -731,7 +733,7 @@ void
 Vcf::write_record(Variant const & var, std::string const & suffix, bool const FILTER_ZERO_QUAL)
 {
   // Parse the position
-  auto contig_pos = absolute_pos.get_contig_position(var.abs_pos, gyper::graph);
+  auto contig_pos = current_context().absolute_pos.get_contig_position(var.abs_pos, current_context().graph);
 
   if (!Options::instance()->output_all_variants && var.calls.size() > 0 && var.seqs.size() > 200)
   {
@@ -1097,6 +1099,7 @@ Vcf::write_records(std::string const & region, bool const FILTER_ZERO_QUAL)
   if (region != ".")
   {
     GenomicRegion genomic_region(region);
+    AbsolutePosition const & absolute_pos = current_context().absolute_pos;
 
     if (absolute_pos.is_contig_available(genomic_region.chr))
     {
@@ -1122,10 +1125,12 @@ Vcf::write_segments()
                            << " segments to "
                            << filename;
 
+  GenotypingContext const & context = current_context();
+
   for (auto const & segment : segments)
   {
     assert(sample_names.size() == segment.segment_calls.size());
-    auto contig_pos = absolute_pos.get_contig_position(segment.id, gyper::graph);
+    auto contig_pos = context.absolute_pos.get_contig_position(segment.id, context.graph);
 
     // Write CHROM and POS
     bgzf_stream << contig_pos.first << "\t" << contig_pos.second;
@@ -1371,6 +1376,7 @@ Vcf::add_haplotype(Haplotype & haplotype, bool const clear_haplotypes, uint32_t
 void
 Vcf::add_haplotypes_for_extraction(std::vector<HaplotypeCall> const & hap_calls, bool const is_splitting_vars)
 {
+  Graph const & graph = current_context().graph;
   assert(graph.size() > 0);
   bool const is_sv_graph = graph.is_sv_graph;
 
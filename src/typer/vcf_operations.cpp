@@ -11,6 +11,7 @@
 #include <graphtyper/typer/vcf_operations.hpp>
 #include <graphtyper/typer/vcf.hpp> // gyper::Vcf
 #include <graphtyper/typer/var_stats.hpp> // gyper::join_strand_bias, gyper::split_bias_to_strings
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/options.hpp> // gyper::Options
 
 
@@ -301,6 +302,7 @@ vcf_merge_and_break(std::vector<std::string> & vcfs,
 
   long const ploidy = Options::const_instance()->ploidy;
   GenomicRegion genomic_region(region);
+  AbsolutePosition const & absolute_pos = current_context().absolute_pos;
   uint32_t const region_begin = 1 + absolute_pos.get_absolute_position(genomic_region.chr,
                                                                        genomic_region.begin
                                                                        );
@@ -793,6 +795,7 @@ vcf_break_down(std::string const & vcf, std::string const & output, std::string
             );
 
   GenomicRegion genomic_region(region);
+  AbsolutePosition const & absolute_pos = current_context().absolute_pos;
   uint32_t const region_begin = 1 + absolute_pos.get_absolute_position(genomic_region.chr,
                                                                        genomic_region.begin
                                                                        );
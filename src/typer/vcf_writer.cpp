@@ -17,6 +17,7 @@
 #include <graphtyper/graph/haplotype_extractor.hpp>
 #include <graphtyper/typer/read_stats.hpp>
 #include <graphtyper/typer/vcf_writer.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/graph_help_functions.hpp>
 #include <graphtyper/utilities/io.hpp>
 #include <graphtyper/utilities/options.hpp>
@@ -26,7 +27,7 @@ namespace
 {
 
 bool
-are_genotype_paths_good(gyper::GenotypePaths const & geno)
+are_genotype_paths_good(gyper::GenotypePaths const & geno, bool const is_sv_graph)
 {
   if (geno.paths.size() == 0)
     return false;
@@ -45,7 +46,7 @@ are_genotype_paths_good(gyper::GenotypePaths const & geno)
   if (!fully_aligned && mismatch_ratio > 0.025)
     return false;
 
-  if (gyper::graph.is_sv_graph)
+  if (is_sv_graph)
   {
     if (!fully_aligned || geno.paths[0].size() < 90 || mismatch_ratio > 0.03)
       return false;
@@ -70,10 +71,16 @@ namespace gyper
 {
 
 VcfWriter::VcfWriter(uint32_t variant_distance)
+  : VcfWriter(current_context(), variant_distance)
+{}
+
+
+VcfWriter::VcfWriter(GenotypingContext const & _context, uint32_t variant_distance)
+  : context(_context)
 {
-  haplotypes = gyper::graph.get_all_haplotypes(variant_distance);
+  haplotypes = context.graph.get_all_haplotypes(variant_distance);
   BOOST_LOG_TRIVIAL(debug) << "[graphtyper::vcf_writer] Number of variant nodes in graph "
-                           << graph.var_nodes.size();
+                           << context.graph.var_nodes.size();
   BOOST_LOG_TRIVIAL(debug) << "[graphtyper::vcf_writer] Got "
                            << haplotypes.size()
                            << " haplotypes.";
@@ -106,7 +113,7 @@ VcfWriter::set_samples(std::vector<std::string> const & samples)
 void
 VcfWriter::update_haplotype_scores_geno(GenotypePaths & geno, long const pn_index)
 {
-  if (are_genotype_paths_good(geno))
+  if (are_genotype_paths_good(geno, context.graph.is_sv_graph))
   {
     push_to_haplotype_scores(geno, pn_index);
 
@@ -141,9 +148,9 @@ VcfWriter::print_variant_group_details() const
     {
       assert(hap.gts.size() > 0);
       uint32_t const abs_pos = hap.gts[0].id;
-      std::vector<char> seq = graph.get_sequence_of_a_haplotype_call(hap.gts, c);
+      std::vector<char> seq = context.graph.get_sequence_of_a_haplotype_call(hap.gts, c);
       assert(seq.size() > 1);
-      auto contig_pos = absolute_pos.get_contig_position(abs_pos, gyper::graph);
+      auto contig_pos = context.absolute_pos.get_contig_position(abs_pos, context.graph);
 
       hap_file << ps << "\t" << c << "\t"
                << contig_pos.first << "\t" << contig_pos.second << "\t"
@@ -169,6 +176,8 @@ VcfWriter::print_variant_details() const
 
   std::stringstream variant_file;
 
+  Graph const & graph = context.graph;
+
   // Write header file
   variant_file << "variantID\tcontig\tposition\tallele_num\tsequence\tSV\n";
 
@@ -176,7 +185,7 @@ VcfWriter::print_variant_details() const
   {
     long sv_id = -1; // -1 means not an SV
     auto const & label = graph.var_nodes[v].get_label();
-    auto contig_pos = absolute_pos.get_contig_position(label.order, gyper::graph);
+    auto contig_pos = context.absolute_pos.get_contig_position(label.order, graph);
     auto const & seq = label.dna;
     auto find_it = std::find(seq.cbegin(), seq.cend(), '<');
 
@@ -270,8 +279,8 @@ VcfWriter::print_geno_statistics(std::stringstream & read_ss,
     uint32_t const ref_reach_start = path.start_ref_reach_pos();
     uint32_t const ref_reach_end = path.end_ref_reach_pos();
 
-    auto const contig_pos_start = absolute_pos.get_contig_position(ref_reach_start, gyper::graph);
-    auto const contig_pos_end = absolute_pos.get_contig_position(ref_reach_end, gyper::graph);
+    auto const contig_pos_start = context.absolute_pos.get_contig_position(ref_reach_start, context.graph);
+    auto const contig_pos_end = context.absolute_pos.get_contig_position(ref_reach_end, context.graph);
 
     std::vector<std::size_t> overlapping_vars;
 
@@ -400,7 +409,7 @@ VcfWriter::update_statistics(std::vector<std::pair<GenotypePaths, GenotypePaths>
 void
 VcfWriter::push_to_haplotype_scores(GenotypePaths & geno, long const pn_index)
 {
-  assert(are_genotype_paths_good(geno));
+  assert(are_genotype_paths_good(geno, context.graph.is_sv_graph));
 
   // Quality metrics
   bool const fully_aligned = geno.all_paths_fully_aligned();
@@ -431,7 +440,7 @@ VcfWriter::push_to_haplotype_scores(GenotypePaths & geno, long const pn_index)
                             (p_it->end_ref_reach_pos() - MIN_OFFSET) > p_it->var_order[i];
       recent_ids[type_ids.first] |= is_overlapping;
 
-      if (!has_low_quality_snp && graph.is_snp(hap.gts[type_ids.second]))
+      if (!has_low_quality_snp && context.graph.is_snp(hap.gts[type_ids.second]))
       {
         long const offset = p_it->var_order[i] - p_it->start_correct_pos();
 
@@ -0,0 +1,77 @@
+#include <cstdlib> // std::exit
+#include <vector> // std::vector
+
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/utilities/flat_archive.hpp>
+
+
+namespace gyper
+{
+
+void
+FlatOArchive::align()
+{
+  std::vector<char> const padding((FLAT_ARCHIVE_ALIGNMENT - offset % FLAT_ARCHIVE_ALIGNMENT) % FLAT_ARCHIVE_ALIGNMENT,
+                                  '\0');
+  write(padding.data(), padding.size());
+}
+
+
+void
+FlatOArchive::write(void const * data, uint64_t const size)
+{
+  if (size == 0)
+    return;
+
+  if (!os.write(static_cast<char const *>(data), size))
+  {
+    BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::flat_archive] Could not write " << size << " bytes at offset " << offset;
+    std::exit(1);
+  }
+
+  offset += size;
+}
+
+
+void
+FlatIArchive::align()
+{
+  read((FLAT_ARCHIVE_ALIGNMENT - offset % FLAT_ARCHIVE_ALIGNMENT) % FLAT_ARCHIVE_ALIGNMENT);
+}
+
+
+char const *
+FlatIArchive::read(uint64_t const num_bytes)
+{
+  if (num_bytes > size - offset)
+  {
+    BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::flat_archive] Cannot read " << num_bytes << " bytes at offset "
+                             << offset << " of " << size << ", the file is truncated or corrupt.";
+    std::exit(1);
+  }
+
+  char const * const bytes = data + offset;
+  offset += num_bytes;
+  return bytes;
+}
+
+
+uint64_t
+FlatIArchive::read_count()
+{
+  uint64_t num{0};
+  load(num);
+
+  if (num > size - offset)
+  {
+    BOOST_LOG_TRIVIAL(fatal) << "[graphtyper::flat_archive] Read a count of " << num << " at offset " << offset
+                             << " of " << size << ", the file is corrupt.";
+    std::exit(1);
+  }
+
+  return num;
+}
+
+
+} // namespace gyper
@@ -11,9 +11,11 @@
 #include <graphtyper/typer/vcf_operations.hpp>
 #include <graphtyper/utilities/bamshrink.hpp>
 #include <graphtyper/utilities/genotype.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/hts_parallel_reader.hpp>
 #include <graphtyper/utilities/options.hpp>
 #include <graphtyper/utilities/system.hpp>
+#include <graphtyper/utilities/task_scheduler.hpp>
 
 #include <paw/station.hpp>
 
@@ -21,6 +23,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <functional>
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -44,7 +47,6 @@ run_bamshrink(std::vector<std::string> const & sams,
   GenomicRegion bs_region(region); // bs = bamshrink
   bs_region.pad(50);
 
-  paw::Station bamshrink_station(Options::const_instance()->threads);
   std::vector<std::string> output_paths;
   output_paths.reserve(sams.size());
 
@@ -61,6 +63,39 @@ run_bamshrink(std::vector<std::string> const & sams,
       return std::string(reversed.rbegin(), reversed.rend());
     };
 
+  GenotypingContext const & context = current_context();
+
+  if (context.scheduler)
+  {
+    // Each sample is a task which reads one file and writes another, threads of other regions may run them
+    std::vector<TaskScheduler::TaskId> sample_tasks;
+
+    for (long s = 0; s < static_cast<long>(sams.size()); ++s)
+    {
+      std::ostringstream ss;
+      ss << tmp << "/bams/" << get_basename_wo_ext(sams[s]) << ".bam";
+      output_paths.push_back(ss.str());
+
+      sample_tasks.push_back(context.scheduler->add_task(std::bind(bamshrink,
+                                                                   bs_region.chr,
+                                                                   bs_region.begin,
+                                                                   bs_region.end,
+                                                                   sams[s],
+                                                                   output_paths.back(),
+                                                                   avg_cov_by_readlen[s],
+                                                                   ref_fn),
+                                                         context.task_key,
+                                                         std::vector<TaskScheduler::TaskId>(),
+                                                         2));
+    }
+
+    context.scheduler->wait(sample_tasks);
+    BOOST_LOG_TRIVIAL(info) << "Finished copying data of " << context.task_key.to_string() << ".";
+    return output_paths;
+  }
+
+  paw::Station bamshrink_station(Options::const_instance()->threads);
+
   for (long s = 0; s < static_cast<long>(sams.size()) - 1l; ++s)
   {
     auto const & sam = sams[s];
@@ -190,53 +225,71 @@ run_samtools_merge(std::vector<std::string> & shrinked_sams, std::string const &
     std::vector<std::string> new_shrinked_sams;
     std::vector<std::vector<std::string> > all_input_sams;
     all_input_sams.resize(NUM_FILES / CHUNK_SIZE + 1);
+    std::vector<std::pair<std::string, long> > merges; // Merged file and the index of its input files
 
+    for (long i = 0; (i * CHUNK_SIZE) < NUM_FILES; ++i)
     {
-      paw::Station merge_station(Options::const_instance()->threads);
+      assert(i < static_cast<long>(all_input_sams.size()));
+      std::vector<std::string> & input_sams = all_input_sams[i];
+      long const file_i = i * CHUNK_SIZE;
+      long const next_file_i = file_i + CHUNK_SIZE;
 
-      for (long i = 0; (i * CHUNK_SIZE) < NUM_FILES; ++i)
+      if (next_file_i >= NUM_FILES)
+      {
+        std::copy(shrinked_sams.begin() + file_i, shrinked_sams.end(), std::back_inserter(input_sams));
+      }
+      else
       {
-        assert(i < static_cast<long>(all_input_sams.size()));
-        std::vector<std::string> & input_sams = all_input_sams[i];
-        long const file_i = i * CHUNK_SIZE;
-        long const next_file_i = file_i + CHUNK_SIZE;
+        std::copy(shrinked_sams.begin() + file_i, shrinked_sams.begin() + next_file_i,
+                  std::back_inserter(input_sams));
+      }
 
-        if (next_file_i >= NUM_FILES)
-        {
-          std::copy(shrinked_sams.begin() + file_i, shrinked_sams.end(), std::back_inserter(input_sams));
-        }
-        else
-        {
-          std::copy(shrinked_sams.begin() + file_i, shrinked_sams.begin() + next_file_i,
-                    std::back_inserter(input_sams));
-        }
+      if (input_sams.size() == 1)
+      {
+        // No merging needed
+        new_shrinked_sams.push_back(input_sams[0]);
+      }
+      else if (input_sams.size() > 1)
+      {
+        std::ostringstream ss;
+        ss << tmp << "/bams/merged" << std::setw(5) << std::setfill('0') << i << ".bam";
+        new_shrinked_sams.push_back(ss.str());
+        merges.push_back({ss.str(), i});
+      }
+    }
 
-        if (input_sams.size() == 1)
-        {
-          // No merging needed
-          new_shrinked_sams.push_back(input_sams[0]);
-        }
-        else if (input_sams.size() > 1)
-        {
-          std::ostringstream ss;
-          ss << tmp << "/bams/merged" << std::setw(5) << std::setfill('0') << i << ".bam";
-          new_shrinked_sams.push_back(ss.str());
-
-          if (next_file_i < NUM_FILES)
-          {
-            merge_station.add_work(sam_merge, new_shrinked_sams[new_shrinked_sams.size() - 1], all_input_sams[i]);
-          }
-          else
-          {
-            // Put the very last job to the main thread
-            merge_station.add_to_thread(Options::const_instance()->threads - 1,
-                                        sam_merge,
-                                        new_shrinked_sams[new_shrinked_sams.size() - 1],
-                                        all_input_sams[i]);
-          }
-        }
+    GenotypingContext const & context = current_context();
+
+    if (context.scheduler)
+    {
+      // Each merge is a task which keeps its input files and the merged file open, other regions may run them
+      std::vector<TaskScheduler::TaskId> merge_tasks;
+
+      for (auto const & merge : merges)
+      {
+        std::vector<std::string> const & input_sams = all_input_sams[merge.second];
+        merge_tasks.push_back(context.scheduler->add_task(std::bind(sam_merge, merge.first, input_sams),
+                                                          context.task_key,
+                                                          std::vector<TaskScheduler::TaskId>(),
+                                                          static_cast<long>(input_sams.size()) + 1));
       }
 
+      context.scheduler->wait(merge_tasks);
+      BOOST_LOG_TRIVIAL(info) << "Finished merging.";
+    }
+    else if (merges.size() > 0)
+    {
+      paw::Station merge_station(Options::const_instance()->threads);
+
+      for (long m = 0; m + 1 < static_cast<long>(merges.size()); ++m)
+        merge_station.add_work(sam_merge, merges[m].first, all_input_sams[merges[m].second]);
+
+      // Put the very last job to the main thread
+      merge_station.add_to_thread(Options::const_instance()->threads - 1,
+                                  sam_merge,
+                                  merges.back().first,
+                                  all_input_sams[merges.back().second]);
+
       std::string thread_info = merge_station.join();
       BOOST_LOG_TRIVIAL(info) << "Finished merging. Thread work: " << thread_info;
     }
@@ -276,6 +329,7 @@ genotype_with_a_vcf(std::string const & ref_path,
   bool const is_writing_calls_vcf{true};
   bool const is_discovery{false};
   bool const is_writing_hap{false};
+  GenotypingContext & context = current_context();
 
   gyper::construct_graph(ref_path,
                          Options::const_instance()->vcf,
@@ -284,18 +338,17 @@ genotype_with_a_vcf(std::string const & ref_path,
                          use_absolute_positions,
                          check_index);
 
-  absolute_pos.calculate_offsets(gyper::graph);
+  context.absolute_pos.calculate_offsets(context.graph);
 
 #ifndef NDEBUG
   // Save graph in debug mode
   save_graph(out_dir + "/graph");
 #endif // NDEBUG
 
-  std::string const index_path = out_dir + "/graph_gti";
-  index_graph(index_path);
+  index_graph(context); // Build the in-memory index directly from the graph
   std::vector<std::string> paths = gyper::call(shrinked_sams,
                                                "", // graph_path
-                                               index_path,
+                                               "", // index_path
                                                out_dir,
                                                5, //minimum_variant_support,
                                                0.25, //minimum_variant_support_ratio,
@@ -311,9 +364,7 @@ genotype_with_a_vcf(std::string const & ref_path,
     path += "_calls.vcf.gz";
 
   vcf_merge_and_break(paths, tmp + "/graphtyper.vcf.gz", region.to_string(), true); //> FILTER_ZERO_QUAL
-
-  // free memory
-  graph = Graph();
+  context.clear(); // free memory
 }
 
 
@@ -333,6 +384,10 @@ genotype(std::string ref_path,
   long minimum_variant_support = 5;
   double minimum_variant_support_ratio = 0.25;
 
+  // The region is genotyped on its own graph and index, other regions may be genotyped on other threads meanwhile
+  GenotypingContext context;
+  ContextBinding binding(context);
+
   long const NUM_SAMPLES = sams.size();
   BOOST_LOG_TRIVIAL(info) << "Genotyping region " << region.to_string();
   BOOST_LOG_TRIVIAL(info) << "Path to genome is '" << ref_path << "'";
@@ -425,6 +480,7 @@ genotype(std::string ref_path,
 
     // Iteration 1
     {
+      context.task_key.iteration = 1;
       BOOST_LOG_TRIVIAL(info) << "Initial variant discovery step starting.";
       std::string const output_vcf = tmp + "/it1/final.vcf.gz";
       std::string const out_dir = tmp + "/it1";
@@ -434,7 +490,7 @@ genotype(std::string ref_path,
       // Save graph in debug mode
       save_graph(out_dir + "/graph");
 #endif // NDEBUG
-      absolute_pos.calculate_offsets(gyper::graph);
+      context.absolute_pos.calculate_offsets(context.graph);
       auto output_paths = gyper::discover_directly_from_bam("",
                                                             shrinked_sams,
                                                             padded_region.to_string(),
@@ -451,8 +507,7 @@ genotype(std::string ref_path,
       final_vcf.write_tbi_index(); // Write index in debug mode
 #endif // NDEBUG
 
-      // free memory
-      graph = Graph();
+      context.clear(); // free memory
     }
 
 #ifndef NDEBUG
@@ -465,12 +520,17 @@ genotype(std::string ref_path,
     }
 #endif // NDEBUG
 
+    // The graphs of iterations 2 to LAST_ITERATION differ only around the variants which changed, so each graph is
+    // indexed by updating the index of the previous one
+    IncrementalIndexer incremental_indexer;
+    Graph old_graph;
+
     // Iteration 2
     //if (false)
     {
+      context.task_key.iteration = 2;
       BOOST_LOG_TRIVIAL(info) << "Further variant discovery step starting.";
       std::string const out_dir = tmp + "/it2";
-      std::string const index_path = out_dir + "/graph_gti";
       std::string const haps_output_vcf = out_dir + "/haps.vcf.gz";
       std::string const discovery_output_vcf = out_dir + "/discovery.vcf.gz";
       mkdir(out_dir.c_str(), 0755);
@@ -479,7 +539,7 @@ genotype(std::string ref_path,
       // Save graph in debug mode
       save_graph(out_dir + "/graph");
 #endif // NDEBUG
-      index_graph(index_path);
+      incremental_indexer.index(context.mem_index); // Build the in-memory index directly from the graph
 
       minimum_variant_support = 9;
       minimum_variant_support_ratio = 0.32;
@@ -493,7 +553,7 @@ genotype(std::string ref_path,
       std::vector<std::string> paths =
         gyper::call(shrinked_sams,
                     "", // graph_path
-                    index_path,
+                    "", // index_path
                     out_dir,
                     minimum_variant_support,
                     minimum_variant_support_ratio,
@@ -525,8 +585,8 @@ genotype(std::string ref_path,
 #endif // NDEBUG
 
       // free memory
-      graph = Graph();
-      mem_index = MemIndex();
+      old_graph = std::move(context.graph);
+      context.clear();
     }
 
     is_discovery = false; // No more discovery
@@ -560,7 +620,6 @@ genotype(std::string ref_path,
       }
 
       mkdir(out_dir.c_str(), 0755);
-      std::string const index_path = out_dir + "/graph_gti";
       std::string const haps_output_vcf = out_dir + "/final.vcf.gz";
       construct_graph(ref_path, prev_out_vcf, padded_region.to_string(), false, true, false);
 
@@ -569,10 +628,10 @@ genotype(std::string ref_path,
       save_graph(out_dir + "/graph");
 #endif // NDEBUG
 
-      index_graph(index_path);
+      incremental_indexer.update(context.mem_index, old_graph); // Only index again where the graph changed
       paths = gyper::call(shrinked_sams,
                           "", // graph_path
-                          index_path,
+                          "", // index_path
                           out_dir,
                           minimum_variant_support,
                           minimum_variant_support_ratio,
@@ -597,8 +656,8 @@ genotype(std::string ref_path,
 #endif // NDEBUG
 
         // free memory
-        graph = Graph();
-        mem_index = MemIndex();
+        old_graph = std::move(context.graph);
+        context.clear();
       }
     }
 
@@ -705,36 +764,39 @@ genotype_regions(std::string const & ref_path,
     Options::instance()->minimum_extract_score_over_homref += 3;
   }
 
-  //long const NUM_REGIONS = regions.size();
-  //gyper::Options & opts = *(gyper::Options::instance());
-  //long const NUM_THREADS = opts.threads;
+  long const NUM_REGIONS = regions.size();
+  long const NUM_THREADS = Options::const_instance()->threads;
 
-  /*
-  ** First make everything in genotype thread safe before enabling this
-  if (NUM_REGIONS > NUM_SAMPLES && NUM_THREADS > NUM_SAMPLES)
+  if (NUM_REGIONS > 1 && NUM_THREADS > 1)
   {
-    // Genotype regions in parallel
-    paw::Station region_station(NUM_THREADS);
-    opts.threads = 1;
-    opts.max_files_open /= NUM_THREADS;
+    // Genotype regions concurrently. Each region runs as a task which adds its sample pools as tasks of the same
+    // scheduler and runs pools of any region while waiting for its own, so no thread idles when a region ends or one
+    // of its pools is slow. The scheduler keeps the files open by all regions together within max_files_open.
+    TaskScheduler scheduler(NUM_THREADS, Options::const_instance()->max_files_open);
+    GenotypingContext const & caller_context = current_context();
 
-    for (long r = 0; r < static_cast<long>(regions.size()) - 1l; ++r)
+    for (long r = 0; r < NUM_REGIONS; ++r)
     {
-      region_station.add_work(genotype, ref_path, sams, regions[r], output_path, avg_cov_by_readlen);
-    }
+      TaskKey key;
+      key.region = r;
 
-    assert(regions.size() > 0);
-    region_station.add_to_thread(NUM_THREADS - 1,
-                                 genotype,
-                                 ref_path,
-                                 sams,
-                                 regions[regions.size() - 1l],
-                                 output_path,
-                                 avg_cov_by_readlen);
+      auto genotype_region =
+        [&, key]()
+        {
+          GenotypingContext region_context(caller_context.options);
+          region_context.scheduler = &scheduler;
+          region_context.task_key = key;
+          ContextBinding binding(region_context); // genotype() copies the bound context
+          genotype(ref_path, sams, regions[key.region], output_path, avg_cov_by_readlen, is_copy_reference);
+        };
+
+      scheduler.add_task(genotype_region, key, std::vector<TaskScheduler::TaskId>(), 0, false /*is_leaf*/);
+    }
 
+    scheduler.wait_all();
+    BOOST_LOG_TRIVIAL(info) << "Finished genotyping regions. " << scheduler.to_string();
   }
   else
-  */
   {
     // Genotype regions serially
     for (auto const & region : regions)
@@ -14,6 +14,7 @@
 #include <graphtyper/typer/variant_map.hpp>
 #include <graphtyper/typer/vcf.hpp>
 #include <graphtyper/typer/vcf_operations.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/options.hpp>
 #include <graphtyper/utilities/genotype.hpp>
 #include <graphtyper/utilities/hts_parallel_reader.hpp>
@@ -32,6 +33,7 @@ genotype_camou(std::string const & interval_fn,
                std::vector<double> const & avg_cov_by_readlen)
 {
   long const NUM_SAMPLES = sams.size();
+  GenotypingContext & context = current_context();
   bool is_writing_calls_vcf{false};
   bool is_writing_hap{false};
   bool is_discovery{true};
@@ -101,13 +103,12 @@ genotype_camou(std::string const & interval_fn,
   {
     BOOST_LOG_TRIVIAL(info) << "Camou variant discovery step starting.";
     std::string const out_dir = tmp + "/it1";
-    std::string const index_path = out_dir + "/graph_gti";
     std::string const haps_output_vcf = out_dir + "/haps.vcf.gz";
     std::string const discovery_output_vcf = out_dir + "/discovery.vcf.gz";
 
     mkdir(out_dir.c_str(), 0755);
     construct_graph(ref_fn, "", padded_genomic_region.to_string(), false, true, false);
-    absolute_pos.calculate_offsets(gyper::graph);
+    context.absolute_pos.calculate_offsets(context.graph);
     BOOST_LOG_TRIVIAL(info) << "Graph construction complete.";
 
 #ifndef NDEBUG
@@ -115,7 +116,7 @@ genotype_camou(std::string const & interval_fn,
     save_graph(out_dir + "/graph");
 #endif // NDEBUG
 
-    index_graph(index_path);
+    index_graph(context); // Build the in-memory index directly from the graph
     BOOST_LOG_TRIVIAL(info) << "Index construction complete.";
 
     long minimum_variant_support = 9;
@@ -130,7 +131,7 @@ genotype_camou(std::string const & interval_fn,
     std::vector<std::string> paths =
       gyper::call(shrinked_sams,
                   "",   // graph_path
-                  index_path,
+                  "",   // index_path
                   out_dir,
                   minimum_variant_support,
                   minimum_variant_support_ratio,
@@ -162,9 +163,7 @@ genotype_camou(std::string const & interval_fn,
     discovery_vcf.write_tbi_index(); // Write index in debug mode
 #endif // NDEBUG
 
-    // free memory
-    graph = Graph();
-    mem_index = MemIndex();
+    context.clear(); // free memory
   }
 
   // Iteration 2
@@ -175,7 +174,6 @@ genotype_camou(std::string const & interval_fn,
     is_discovery = false;
 
     std::string const out_dir = tmp + "/it2";
-    std::string const index_path = out_dir + "/graph_gti";
     std::string const haps_output_vcf = out_dir + "/haps.vcf.gz";
     std::string const discovery_output_vcf = out_dir + "/discovery.vcf.gz";
     mkdir(out_dir.c_str(), 0755);
@@ -187,12 +185,12 @@ genotype_camou(std::string const & interval_fn,
     save_graph(out_dir + "/graph");
     #endif // NDEBUG
 
-    index_graph(index_path);
+    index_graph(context); // Build the in-memory index directly from the graph
 
     std::vector<std::string> paths =
       gyper::call(shrinked_sams,
                   "",   // graph_path
-                  index_path,
+                  "",   // index_path
                   out_dir,
                   5, // minimum_variant_support - will be ignored
                   0.25, // minimum_variant_support_ratio - will be ignored
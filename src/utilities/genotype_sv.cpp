@@ -14,6 +14,7 @@
 #include <graphtyper/typer/variant_map.hpp>
 #include <graphtyper/typer/vcf.hpp>
 #include <graphtyper/typer/vcf_operations.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/options.hpp>
 #include <graphtyper/utilities/genotype.hpp>
 #include <graphtyper/utilities/hts_parallel_reader.hpp>
@@ -38,6 +39,7 @@ genotype_sv(std::string ref_path,
   bool constexpr is_writing_hap{false};
   bool constexpr is_discovery{false};
   long const NUM_SAMPLES = sams.size();
+  GenotypingContext & context = current_context();
 
   BOOST_LOG_TRIVIAL(info) << "SV genotyping region " << genomic_region.to_string();
   BOOST_LOG_TRIVIAL(info) << "Path to genome is '" << ref_path << "'";
@@ -97,7 +99,6 @@ genotype_sv(std::string ref_path,
     std::string const output_vcf = tmp + "/it1/final.vcf.gz";
     std::string const out_dir = tmp + "/it1";
     mkdir(out_dir.c_str(), 0755);
-    std::string const index_path = out_dir + "/graph_gti";
 
     {
       bool constexpr is_sv_graph{true};
@@ -116,13 +117,13 @@ genotype_sv(std::string ref_path,
     save_graph(out_dir + "/graph");
 #endif // NDEBUG
 
-    absolute_pos.calculate_offsets(gyper::graph);
-    index_graph(index_path);
+    context.absolute_pos.calculate_offsets(context.graph);
+    index_graph(context); // Build the in-memory index directly from the graph
 
     std::vector<std::string> paths =
       gyper::call(sams,
                   "",   // graph_path
-                  index_path,
+                  "",   // index_path
                   out_dir,
                   5,//minimum_variant_support,
                   0.25,//minimum_variant_support_ratio,
@@ -130,8 +131,7 @@ genotype_sv(std::string ref_path,
                   is_discovery,
                   is_writing_hap);
 
-    // free memory
-    graph = Graph();
+    context.clear(); // free memory
 
     BOOST_LOG_TRIVIAL(info) << "Merging output VCFs.";
 
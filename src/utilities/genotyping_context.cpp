@@ -0,0 +1,75 @@
+#include <graphtyper/graph/absolute_position.hpp>
+#include <graphtyper/graph/graph.hpp>
+#include <graphtyper/index/mem_index.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
+#include <graphtyper/utilities/options.hpp>
+
+
+namespace
+{
+
+thread_local gyper::GenotypingContext * bound_context = nullptr;
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+GenotypingContext::GenotypingContext()
+  : options(current_context().options)
+  , scheduler(current_context().scheduler)
+  , task_key(current_context().task_key)
+{}
+
+
+GenotypingContext::GenotypingContext(Options const & _options)
+  : options(_options)
+{}
+
+
+void
+GenotypingContext::clear()
+{
+  numa_mem_indexes.clear();
+  node_mem_indexes.clear();
+  graph = Graph();
+  mem_index = MemIndex();
+}
+
+
+GenotypingContext &
+default_context()
+{
+  // Never destroyed, threads may still use it while the process exits
+  static GenotypingContext * const context = new GenotypingContext(Options());
+  return *context;
+}
+
+
+GenotypingContext &
+current_context()
+{
+  return bound_context ? *bound_context : default_context();
+}
+
+
+ContextBinding::ContextBinding(GenotypingContext & context)
+  : previous(bound_context)
+{
+  bound_context = &context;
+}
+
+
+ContextBinding::~ContextBinding()
+{
+  bound_context = previous;
+}
+
+
+// The command line tools work on the default context through these
+Graph & graph = default_context().graph;
+MemIndex & mem_index = default_context().mem_index;
+AbsolutePosition & absolute_pos = default_context().absolute_pos;
+
+} // namespace gyper
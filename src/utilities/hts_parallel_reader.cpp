@@ -19,6 +19,7 @@
 #include <graphtyper/typer/variant_map.hpp>
 #include <graphtyper/typer/vcf.hpp>
 #include <graphtyper/typer/vcf_writer.hpp>
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/hash_seqan.hpp>
 #include <graphtyper/utilities/hts_parallel_reader.hpp>
 #include <graphtyper/utilities/hts_store.hpp>
@@ -289,6 +290,7 @@ genotype_only(HtsParallelReader const & hts_preader,
 
   TMapGPaths & map_gpaths = maps[rg_i];
   std::string read_name(reinterpret_cast<char *>(hts_rec.record->data));
+  bool const is_sv_graph = current_context().graph.is_sv_graph;
 
   if (update_prev_paths)
   {
@@ -319,7 +321,7 @@ genotype_only(HtsParallelReader const & hts_preader,
 
       if (selected)
       {
-        if (graph.is_sv_graph)
+        if (is_sv_graph)
         {
           // Add reference depth
           reference_depth.add_genotype_paths(*selected, sample_i);
@@ -344,7 +346,7 @@ genotype_only(HtsParallelReader const & hts_preader,
 
     if (better_paths.first)
     {
-      if (graph.is_sv_graph)
+      if (is_sv_graph)
       {
         // Add reference depth
         reference_depth.add_genotype_paths(*better_paths.first, sample_i);
@@ -487,12 +489,14 @@ parallel_reader_genotype_only(std::string * out_path,
   assert(hts_paths_ptr);
   auto const & hts_paths = *hts_paths_ptr;
 
+  GenotypingContext const & context = current_context();
+
   // Inititalize the HTS parallel reader
   HtsParallelReader hts_preader;
   hts_preader.open(hts_paths);
 
   // Set up VcfWriter
-  VcfWriter writer(SPLIT_VAR_THRESHOLD - 1);
+  VcfWriter writer(context, SPLIT_VAR_THRESHOLD - 1);
   writer.set_samples(hts_preader.get_samples());
 
   if (writer.pns.size() == 0)
@@ -506,8 +510,8 @@ parallel_reader_genotype_only(std::string * out_path,
   // Set up reference depth tracks if we are SV calling
   ReferenceDepth reference_depth;
 
-  if (graph.is_sv_graph)
-    reference_depth.set_depth_sizes(writer.pns.size());
+  if (context.graph.is_sv_graph)
+    reference_depth.set_depth_sizes(writer.pns.size(), context.graph.reference.size());
 
   std::vector<TMapGPaths> maps; // One map for each file. Each map relates read names to their graph alignments
   maps.resize(hts_preader.get_num_rg());
@@ -634,17 +638,19 @@ parallel_reader_with_discovery(std::string * out_path,
   assert(hts_paths_ptr);
   auto const & hts_paths = *hts_paths_ptr;
 
+  GenotypingContext const & context = current_context();
+
   // Initialize the HTS parallel reader
   HtsParallelReader hts_preader;
   hts_preader.open(hts_paths);
 
   // Set up VcfWriter
-  VcfWriter writer(SPLIT_VAR_THRESHOLD - 1);
+  VcfWriter writer(context, SPLIT_VAR_THRESHOLD - 1);
   writer.set_samples(hts_preader.get_samples());
   std::string const & first_sample = writer.pns[0];
 
   ReferenceDepth reference_depth;
-  reference_depth.set_depth_sizes(writer.pns.size());
+  reference_depth.set_depth_sizes(writer.pns.size(), context.graph.reference.size());
 
   VariantMap varmap;
   varmap.set_samples(hts_preader.get_samples());
@@ -0,0 +1,161 @@
+#include <atomic> // std::atomic
+#include <cstdint> // uintptr_t
+#include <fstream> // std::ifstream
+#include <new> // std::bad_alloc
+#include <sstream> // std::istringstream
+#include <string> // std::string
+
+#include <sys/mman.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/utilities/huge_page_allocator.hpp>
+#include <graphtyper/utilities/options.hpp> // gyper::Options
+
+
+namespace
+{
+
+std::atomic<uint64_t> hugetlb_bytes{0};
+std::atomic<uint64_t> thp_bytes{0};
+std::atomic<uint64_t> small_page_bytes{0};
+std::atomic<bool> has_warned_hugetlb{false};
+std::atomic<bool> has_warned_thp{false};
+
+
+std::size_t
+round_up_to_huge_page(std::size_t const size)
+{
+  return (size + gyper::HUGE_PAGE_SIZE - 1) / gyper::HUGE_PAGE_SIZE * gyper::HUGE_PAGE_SIZE;
+}
+
+
+// madvise(MADV_HUGEPAGE) also succeeds when transparent huge pages are disabled, so check what the kernel is set to
+bool
+is_thp_enabled()
+{
+  static bool const IS_ENABLED = []()
+    {
+      std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+      std::string line;
+      std::getline(in, line);
+      return !line.empty() && line.find("[never]") == std::string::npos;
+    }();
+
+  return IS_ENABLED;
+}
+
+
+// Bytes of anonymous memory of the process which are backed by transparent huge pages right now
+uint64_t
+read_anon_huge_page_bytes()
+{
+  std::ifstream in("/proc/self/smaps_rollup");
+
+  if (!in.is_open())
+    in.open("/proc/self/smaps");
+
+  uint64_t bytes = 0;
+  std::string line;
+
+  while (std::getline(in, line))
+  {
+    if (line.compare(0, 14, "AnonHugePages:") != 0)
+      continue;
+
+    std::istringstream ss(line.substr(14));
+    uint64_t kib = 0;
+    ss >> kib;
+    bytes += kib << 10;
+  }
+
+  return bytes;
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+void *
+allocate_huge_pages(std::size_t const size)
+{
+  std::size_t const length = round_up_to_huge_page(size);
+  std::string const & huge_pages = Options::const_instance()->huge_pages;
+
+  if (huge_pages == "hugetlb")
+  {
+    void * const addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if (addr != MAP_FAILED)
+    {
+      hugetlb_bytes += length;
+      return addr;
+    }
+
+    if (!has_warned_hugetlb.exchange(true))
+    {
+      BOOST_LOG_TRIVIAL(warning) << "[graphtyper::huge_page_allocator] Not enough reserved huge pages, using "
+                                 << "transparent huge pages instead (see /proc/sys/vm/nr_hugepages).";
+    }
+  }
+
+  // Map an extra huge page and unmap the ends, so the mapping is aligned and can be backed by whole huge pages
+  void * const addr = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (addr == MAP_FAILED)
+    throw std::bad_alloc();
+
+  uintptr_t const first = reinterpret_cast<uintptr_t>(addr);
+  uintptr_t const aligned = (first + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+  if (aligned > first)
+    munmap(addr, aligned - first);
+
+  if (first + HUGE_PAGE_SIZE > aligned)
+    munmap(reinterpret_cast<void *>(aligned + length), first + HUGE_PAGE_SIZE - aligned);
+
+  if ((huge_pages == "thp" || huge_pages == "hugetlb") &&
+      madvise(reinterpret_cast<void *>(aligned), length, MADV_HUGEPAGE) == 0 &&
+      is_thp_enabled())
+  {
+    thp_bytes += length;
+  }
+  else
+  {
+    if ((huge_pages == "thp" || huge_pages == "hugetlb") && !has_warned_thp.exchange(true))
+    {
+      BOOST_LOG_TRIVIAL(warning) << "[graphtyper::huge_page_allocator] Transparent huge pages are not available, using "
+                                 << "small pages instead (see /sys/kernel/mm/transparent_hugepage/enabled).";
+    }
+
+    small_page_bytes += length;
+  }
+
+  return reinterpret_cast<void *>(aligned);
+}
+
+
+void
+free_huge_pages(void * ptr, std::size_t const size)
+{
+  if (ptr)
+    munmap(ptr, round_up_to_huge_page(size));
+}
+
+
+HugePageStats
+get_huge_page_stats()
+{
+  HugePageStats stats;
+  stats.hugetlb_bytes = hugetlb_bytes.load();
+  stats.thp_bytes = thp_bytes.load();
+  stats.small_page_bytes = small_page_bytes.load();
+  stats.anon_huge_page_bytes = read_anon_huge_page_bytes();
+  return stats;
+}
+
+
+} // namespace gyper
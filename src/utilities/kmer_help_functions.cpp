@@ -43,74 +43,97 @@ template seqan::IupacString get_ith_kmer(seqan::IupacString const &, std::size_t
 
 
 template <typename TSeq>
-std::vector<KmerLabel>
+std::vector<PackedKmerLabel>
 query_index_for_first_kmer(TSeq const & read, MemIndex const & _mem_index)
 {
-  std::vector<uint64_t> keys = to_uint64_vec(read, 0);
+  std::vector<TKmerKey> keys = to_uint64_vec(read, 0);
   return _mem_index.get(keys);
 }
 
 template <typename TSeq>
-std::vector<KmerLabel>
+std::vector<PackedKmerLabel>
 query_index_for_last_kmer(TSeq const & read, MemIndex const & _mem_index)
 {
-  std::vector<uint64_t> keys = to_uint64_vec(read, seqan::length(read) - K);
+  std::vector<TKmerKey> keys = to_uint64_vec(read, seqan::length(read) - K);
   return _mem_index.get(keys);
 }
 
 
 template <typename TSeq>
-std::vector<std::vector<KmerLabel> >
-query_index(TSeq const & read, MemIndex const & _mem_index)
+std::vector<std::vector<TKmerKey> >
+get_seed_keys(TSeq const & read)
 {
-  std::vector<std::vector<uint64_t> > multi_keys;
+  std::vector<std::vector<TKmerKey> > multi_keys;
   std::size_t const num_keys = get_num_kmers(read);
 
   for (unsigned i = 0; i < num_keys; ++i)
     multi_keys.push_back(to_uint64_vec(read, (K - 1) * i));
 
-  return _mem_index.multi_get(multi_keys);
+  return multi_keys;
+}
+
+
+template <typename TSeq>
+TPackedKmerLabels
+query_index(TSeq const & read, MemIndex const & _mem_index)
+{
+  return query_index(get_seed_keys(read), _mem_index);
+}
+
+
+TPackedKmerLabels
+query_index(std::vector<std::vector<TKmerKey> > const & seed_keys, MemIndex const & _mem_index)
+{
+  return _mem_index.multi_get(seed_keys);
 }
 
 
 // Explicit instantation
-template std::vector<KmerLabel> query_index_for_first_kmer(seqan::IupacString const & read, MemIndex const & _mem_index);
-template std::vector<KmerLabel> query_index_for_last_kmer(seqan::IupacString const & read, MemIndex const & _mem_index);
-template std::vector<std::vector<KmerLabel> > query_index<seqan::Dna5String>(seqan::Dna5String const &, MemIndex const & mem_index);
-template std::vector<std::vector<KmerLabel> > query_index<seqan::IupacString>(seqan::IupacString const &, MemIndex const & mem_index);
+template std::vector<PackedKmerLabel> query_index_for_first_kmer(seqan::IupacString const & read, MemIndex const & _mem_index);
+template std::vector<PackedKmerLabel> query_index_for_last_kmer(seqan::IupacString const & read, MemIndex const & _mem_index);
+template std::vector<std::vector<TKmerKey> > get_seed_keys<seqan::Dna5String>(seqan::Dna5String const &);
+template std::vector<std::vector<TKmerKey> > get_seed_keys<seqan::IupacString>(seqan::IupacString const &);
+template TPackedKmerLabels query_index<seqan::Dna5String>(seqan::Dna5String const &, MemIndex const & mem_index);
+template TPackedKmerLabels query_index<seqan::IupacString>(seqan::IupacString const &, MemIndex const & mem_index);
 
 
 template <typename TSeq>
-std::vector<std::vector<KmerLabel> >
+TPackedKmerLabels
 query_index_hamming_distance1(TSeq const & read, gyper::MemIndex const & _mem_index)
 {
-  std::vector<std::vector<uint64_t> > multi_keys;
-  std::size_t const num_keys = get_num_kmers(read);
+  return query_index_hamming_distance1(get_seed_keys(read), _mem_index);
+}
 
-  for (unsigned i = 0; i < num_keys; ++i)
-    multi_keys.push_back(to_uint64_vec(read, (K - 1) * i));
 
-  return _mem_index.multi_get_hamming1(multi_keys);
+TPackedKmerLabels
+query_index_hamming_distance1(std::vector<std::vector<TKmerKey> > const & seed_keys,
+                              gyper::MemIndex const & _mem_index)
+{
+  return _mem_index.multi_get_hamming1(seed_keys);
 }
 
 
 // Explicit instantation
-template std::vector<std::vector<KmerLabel> >
+template TPackedKmerLabels
 query_index_hamming_distance1<seqan::Dna5String>(seqan::Dna5String const &, gyper::MemIndex const &);
-template std::vector<std::vector<KmerLabel> >
+template TPackedKmerLabels
 query_index_hamming_distance1<seqan::IupacString>(seqan::IupacString const &, gyper::MemIndex const &);
 
 
 template <typename TSeq>
-std::vector<std::vector<KmerLabel> >
+TPackedKmerLabels
 query_index_hamming_distance1_without_index(TSeq const & read, gyper::MemIndex const & _mem_index)
 {
-  std::vector<std::vector<uint64_t> > multi_keys;
-  std::size_t const num_keys = get_num_kmers(read);
+  return query_index_hamming_distance1_without_index(get_seed_keys(read), _mem_index);
+}
 
-  // Find exact keys
-  for (std::size_t i = 0; i < num_keys; ++i)
-    multi_keys.push_back(to_uint64_vec(read, (K - 1) * i));
+
+TPackedKmerLabels
+query_index_hamming_distance1_without_index(std::vector<std::vector<TKmerKey> > const & seed_keys,
+                                            gyper::MemIndex const & _mem_index)
+{
+  std::vector<std::vector<TKmerKey> > multi_keys(seed_keys);
+  std::size_t const num_keys = multi_keys.size();
 
   // Find keys in hamming distance 1 to the exact keys
   for (std::size_t i = 0; i < num_keys; ++i)
@@ -119,11 +142,11 @@ query_index_hamming_distance1_without_index(TSeq const & read, gyper::MemIndex c
     if (multi_keys[i].size() != 1)
       continue;
 
-    multi_keys[i].reserve(96);
-    std::array<uint64_t, 96> ham1_keys = to_uint64_vec_hamming_distance_1(multi_keys[i][0]);
+    multi_keys[i].reserve(3 * K);
+    THamming1Keys ham1_keys = to_uint64_vec_hamming_distance_1(multi_keys[i][0]);
     multi_keys[i][0] = ham1_keys[0]; // Remove the exact key from these results
     std::move(ham1_keys.begin() + 1, ham1_keys.end(), std::back_inserter(multi_keys[i]));
-    assert(multi_keys[i].size() == 96);
+    assert(multi_keys[i].size() == 3 * K);
   }
 
   return _mem_index.multi_get(multi_keys);
@@ -131,9 +154,9 @@ query_index_hamming_distance1_without_index(TSeq const & read, gyper::MemIndex c
 
 
 // Explicit instantation
-template std::vector<std::vector<KmerLabel> >
+template TPackedKmerLabels
 query_index_hamming_distance1_without_index<seqan::Dna5String>(seqan::Dna5String const &, gyper::MemIndex const &);
-template std::vector<std::vector<KmerLabel> >
+template TPackedKmerLabels
 query_index_hamming_distance1_without_index<seqan::IupacString>(seqan::IupacString const &, gyper::MemIndex const &);
 
 
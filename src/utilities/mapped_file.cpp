@@ -0,0 +1,63 @@
+#include <string> // std::string
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <graphtyper/utilities/mapped_file.hpp>
+
+
+namespace gyper
+{
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+
+bool
+MappedFile::open(std::string const & path)
+{
+  close();
+  int const fd = ::open(path.c_str(), O_RDONLY);
+
+  if (fd < 0)
+    return false;
+
+  struct stat sb;
+
+  if (fstat(fd, &sb) != 0 || sb.st_size <= 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  void * const addr = mmap(nullptr, static_cast<std::size_t>(sb.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd); // The mapping keeps the file open
+
+  if (addr == MAP_FAILED)
+    return false;
+
+  // Index lookups hit random pages, reading ahead would only evict useful pages
+  madvise(addr, static_cast<std::size_t>(sb.st_size), MADV_RANDOM);
+
+  ptr = static_cast<char const *>(addr);
+  length = static_cast<std::size_t>(sb.st_size);
+  return true;
+}
+
+
+void
+MappedFile::close()
+{
+  if (ptr)
+    munmap(const_cast<char *>(ptr), length);
+
+  ptr = nullptr;
+  length = 0;
+}
+
+
+} // namespace gyper
@@ -0,0 +1,252 @@
+#include <cassert> // assert
+#include <cstdlib> // std::exit, std::strtol
+#include <fstream> // std::ifstream
+#include <string> // std::string
+#include <vector> // std::vector
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/utilities/numa.hpp>
+
+
+namespace
+{
+
+// Memory policies of mbind(2), numaif.h is not installed everywhere
+int constexpr MPOL_PREFERRED_MODE = 1;
+int constexpr MPOL_INTERLEAVE_MODE = 3;
+
+thread_local long thread_numa_node = -1;
+
+
+// Parses a list such as "0-3,8,10-11"
+std::vector<int>
+parse_id_list(std::string const & list)
+{
+  std::vector<int> ids;
+  char const * it = list.c_str();
+
+  while (*it != '\0' && *it != '\n')
+  {
+    char * end = nullptr;
+    long const first = std::strtol(it, &end, 10);
+
+    if (end == it)
+      break;
+
+    long last = first;
+    it = end;
+
+    if (*it == '-')
+    {
+      last = std::strtol(it + 1, &end, 10);
+      it = end;
+    }
+
+    for (long id = first; id <= last; ++id)
+      ids.push_back(static_cast<int>(id));
+
+    if (*it == ',')
+      ++it;
+  }
+
+  return ids;
+}
+
+
+std::string
+read_line(std::string const & path)
+{
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+
+struct NumaTopology
+{
+  std::vector<int> node_ids;
+  std::vector<std::vector<int> > node_cpus;
+
+  NumaTopology()
+  {
+    for (int const id : parse_id_list(read_line("/sys/devices/system/node/online")))
+    {
+      std::vector<int> cpus =
+        parse_id_list(read_line("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist"));
+
+      // Nodes with only memory are not used for threads
+      if (cpus.size() > 0)
+      {
+        node_ids.push_back(id);
+        node_cpus.push_back(std::move(cpus));
+      }
+    }
+
+    if (node_ids.size() == 0)
+    {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      node_ids.push_back(0);
+      node_cpus.push_back(std::vector<int>());
+
+      if (sched_getaffinity(0, sizeof(cpu_set_t), &set) == 0)
+      {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+          if (CPU_ISSET(cpu, &set))
+            node_cpus[0].push_back(cpu);
+        }
+      }
+    }
+  }
+};
+
+
+NumaTopology const &
+get_topology()
+{
+  static NumaTopology const topology;
+  return topology;
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+long constexpr NumaBuffer::INTERLEAVE;
+
+
+std::vector<std::vector<int> > const &
+get_numa_node_cpus()
+{
+  return get_topology().node_cpus;
+}
+
+
+long
+get_num_numa_nodes()
+{
+  return static_cast<long>(get_topology().node_cpus.size());
+}
+
+
+bool
+pin_thread_to_numa_node(long const node)
+{
+  if (node < 0 || node >= get_num_numa_nodes())
+    return false;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  for (int const cpu : get_numa_node_cpus()[node])
+  {
+    if (cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &set);
+  }
+
+  if (CPU_COUNT(&set) == 0 || pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0)
+    return false;
+
+  thread_numa_node = node;
+  return true;
+}
+
+
+long
+get_thread_numa_node()
+{
+  return thread_numa_node;
+}
+
+
+ScopedNumaPin::ScopedNumaPin(long const node)
+  : saved_node(thread_numa_node)
+{
+  CPU_ZERO(&saved_cpus);
+
+  // Without the previous CPUs the thread could not be restored, so it is not pinned
+  if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &saved_cpus) == 0)
+    pinned = pin_thread_to_numa_node(node);
+}
+
+
+ScopedNumaPin::~ScopedNumaPin()
+{
+  if (!pinned)
+    return;
+
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &saved_cpus) != 0)
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::numa] Could not restore the CPUs of a thread pinned to NUMA node "
+                               << thread_numa_node << ".";
+  }
+
+  thread_numa_node = saved_node;
+}
+
+
+NumaBuffer::NumaBuffer(std::size_t const size, long const node)
+  : length(size)
+{
+  assert(node == INTERLEAVE || (node >= 0 && node < get_num_numa_nodes()));
+  void * const addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (addr == MAP_FAILED)
+  {
+    BOOST_LOG_TRIVIAL(error) << "[graphtyper::numa] Could not allocate " << length << " bytes.";
+    std::exit(1);
+  }
+
+  ptr = static_cast<char *>(addr);
+  NumaTopology const & topology = get_topology();
+  std::vector<unsigned long> node_mask(1);
+  int mode = MPOL_INTERLEAVE_MODE;
+
+  auto add_node = [&node_mask](int const id)
+    {
+      std::size_t const bits = 8 * sizeof(unsigned long);
+      std::size_t const word = static_cast<std::size_t>(id) / bits;
+
+      if (node_mask.size() <= word)
+        node_mask.resize(word + 1, 0ul);
+
+      node_mask[word] |= 1ul << (static_cast<std::size_t>(id) % bits);
+    };
+
+  if (node == INTERLEAVE)
+  {
+    for (int const id : topology.node_ids)
+      add_node(id);
+  }
+  else
+  {
+    mode = MPOL_PREFERRED_MODE; // Falls back to other nodes when the node is full
+    add_node(topology.node_ids[node]);
+  }
+
+  // The kernel reads one bit less than 'maxnode'
+  unsigned long const max_node = node_mask.size() * 8 * sizeof(unsigned long) + 1;
+  placed = syscall(SYS_mbind, ptr, length, mode, node_mask.data(), max_node, 0) == 0;
+}
+
+
+NumaBuffer::~NumaBuffer()
+{
+  if (ptr)
+    munmap(ptr, length);
+}
+
+
+} // namespace gyper
@@ -1,5 +1,6 @@
 #include <iostream>
 
+#include <graphtyper/utilities/genotyping_context.hpp>
 #include <graphtyper/utilities/options.hpp>
 
 namespace gyper
@@ -8,20 +9,18 @@ namespace gyper
 Options *
 Options::instance()
 {
-  return _instance;
+  return &current_context().options;
 }
 
 
 const Options *
 Options::const_instance()
 {
-  return _instance;
+  return &current_context().options;
 }
 
 
 Options::Options()
 {}
 
-Options * Options::_instance = new Options;
-
 } // namespace gyper
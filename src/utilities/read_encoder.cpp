@@ -0,0 +1,327 @@
+#include <algorithm> // std::min_element
+#include <cassert> // assert
+#include <cstdint> // uint8_t, uint64_t
+#include <utility> // std::pair
+#include <vector> // std::vector
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GYPER_READ_ENCODER_X86
+#include <immintrin.h>
+#endif
+
+#include <graphtyper/constants.hpp>
+#include <graphtyper/utilities/read_encoder.hpp>
+#include <graphtyper/utilities/type_conversions.hpp> // gyper::to_uint64_vec
+
+
+namespace
+{
+
+// Indexed by the 4-bit BAM code: =ACMGRSVTWYHKDBN
+uint8_t const NT16_TO_CODE[16] = {0, 0, 1, 0, 2, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0};
+uint8_t const NT16_IS_AMBIGUOUS[16] =
+  {0xFF, 0, 0, 0xFF, 0, 0xFF, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Decodes as many bases from the start of the read as the encoder handles and returns how many it decoded
+using TEncoder = long (*)(uint8_t const * bam_seq, long length, uint8_t * codes, uint64_t * ambiguous);
+
+
+void
+encode_scalar(uint8_t const * bam_seq, long first, long length, uint8_t * codes, uint64_t * ambiguous)
+{
+  for (long j = first; j < length; ++j)
+  {
+    uint8_t const nt16 = (bam_seq[j >> 1] >> ((~j & 1) << 2)) & 0x0F; // First base is in the high nibble
+    codes[j] = NT16_TO_CODE[nt16];
+    ambiguous[j >> 6] |= static_cast<uint64_t>(NT16_IS_AMBIGUOUS[nt16] & 1) << (j & 63);
+  }
+}
+
+
+long
+encode_none(uint8_t const *, long, uint8_t *, uint64_t *)
+{
+  return 0;
+}
+
+
+#ifdef GYPER_READ_ENCODER_X86
+
+__attribute__((target("ssse3")))
+long
+encode_ssse3(uint8_t const * bam_seq, long length, uint8_t * codes, uint64_t * ambiguous)
+{
+  __m128i const code_table = _mm_loadu_si128(reinterpret_cast<__m128i const *>(NT16_TO_CODE));
+  __m128i const ambiguous_table = _mm_loadu_si128(reinterpret_cast<__m128i const *>(NT16_IS_AMBIGUOUS));
+  __m128i const low_mask = _mm_set1_epi8(0x0F);
+  long j = 0;
+
+  // 16 bytes hold 32 bases
+  for (; j + 32 <= length; j += 32)
+  {
+    __m128i const packed = _mm_loadu_si128(reinterpret_cast<__m128i const *>(bam_seq + j / 2));
+    __m128i const high = _mm_and_si128(_mm_srli_epi16(packed, 4), low_mask);
+    __m128i const low = _mm_and_si128(packed, low_mask);
+    __m128i const first = _mm_unpacklo_epi8(high, low); // Bases 0-15
+    __m128i const second = _mm_unpackhi_epi8(high, low); // Bases 16-31
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(codes + j), _mm_shuffle_epi8(code_table, first));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(codes + j + 16), _mm_shuffle_epi8(code_table, second));
+
+    uint64_t const first_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_shuffle_epi8(ambiguous_table, first)));
+    uint64_t const second_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_shuffle_epi8(ambiguous_table, second)));
+    ambiguous[j >> 6] |= (first_mask | (second_mask << 16)) << (j & 63);
+  }
+
+  return j;
+}
+
+
+__attribute__((target("avx2")))
+long
+encode_avx2(uint8_t const * bam_seq, long length, uint8_t * codes, uint64_t * ambiguous)
+{
+  __m256i const code_table =
+    _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(NT16_TO_CODE)));
+  __m256i const ambiguous_table =
+    _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(NT16_IS_AMBIGUOUS)));
+  __m256i const low_mask = _mm256_set1_epi8(0x0F);
+  long j = 0;
+
+  // 32 bytes hold 64 bases
+  for (; j + 64 <= length; j += 64)
+  {
+    __m256i const packed = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(bam_seq + j / 2));
+    __m256i const high = _mm256_and_si256(_mm256_srli_epi16(packed, 4), low_mask);
+    __m256i const low = _mm256_and_si256(packed, low_mask);
+
+    // Unpacking works within each 128 bit lane
+    __m256i const lanes_low = _mm256_unpacklo_epi8(high, low); // Bases 0-15 and 32-47
+    __m256i const lanes_high = _mm256_unpackhi_epi8(high, low); // Bases 16-31 and 48-63
+    __m256i const first = _mm256_permute2x128_si256(lanes_low, lanes_high, 0x20); // Bases 0-31
+    __m256i const second = _mm256_permute2x128_si256(lanes_low, lanes_high, 0x31); // Bases 32-63
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(codes + j), _mm256_shuffle_epi8(code_table, first));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(codes + j + 32), _mm256_shuffle_epi8(code_table, second));
+
+    uint64_t const first_mask =
+      static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_shuffle_epi8(ambiguous_table, first)));
+    uint64_t const second_mask =
+      static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_shuffle_epi8(ambiguous_table, second)));
+    ambiguous[j >> 6] = first_mask | (second_mask << 32);
+  }
+
+  return j;
+}
+
+#endif // GYPER_READ_ENCODER_X86
+
+
+struct Encoder
+{
+  TEncoder encode = encode_none;
+  char const * name = "scalar";
+};
+
+
+Encoder
+select_encoder()
+{
+  Encoder encoder;
+
+#ifdef GYPER_READ_ENCODER_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+  {
+    encoder.encode = encode_avx2;
+    encoder.name = "avx2";
+  }
+  else if (__builtin_cpu_supports("ssse3"))
+  {
+    encoder.encode = encode_ssse3;
+    encoder.name = "ssse3";
+  }
+#endif // GYPER_READ_ENCODER_X86
+
+  return encoder;
+}
+
+
+Encoder const &
+get_encoder()
+{
+  static Encoder const encoder = select_encoder();
+  return encoder;
+}
+
+
+// Mixes the bits of an s-mer, the function is invertible so different s-mers never tie
+uint64_t
+hash_smer(uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  return x;
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+void
+EncodedRead::encode(uint8_t const * bam_seq, long const new_length)
+{
+  length = new_length;
+  codes.resize(length);
+  ambiguous.assign((length + 63) / 64, 0ull);
+
+  long const num_encoded = get_encoder().encode(bam_seq, length, codes.data(), ambiguous.data());
+  encode_scalar(bam_seq, num_encoded, length, codes.data(), ambiguous.data());
+}
+
+
+bool
+EncodedRead::has_ambiguous(long const first, long const count) const
+{
+  assert(first >= 0);
+  assert(count > 0);
+  assert(first + count <= length);
+
+  long const last = first + count - 1;
+
+  for (long w = first >> 6; w <= (last >> 6); ++w)
+  {
+    uint64_t word = ambiguous[w];
+
+    if (w == (first >> 6))
+      word &= ~0ull << (first & 63);
+
+    if (w == (last >> 6))
+      word &= ~0ull >> (63 - (last & 63));
+
+    if (word != 0)
+      return true;
+  }
+
+  return false;
+}
+
+
+TKmerKey
+EncodedRead::key(long const first) const
+{
+  assert(first + K <= length);
+  TKmerKey d = 0;
+
+  for (long j = first; j < first + K; ++j)
+    d = (d << 2) | codes[j];
+
+  return d;
+}
+
+
+TKmerKey
+EncodedRead::reverse_complement_key(long const first) const
+{
+  assert(first + K <= length);
+  TKmerKey d = 0;
+
+  // Base j of the reverse complement is the complement of base length - 1 - j, and the complement of code c is 3 - c
+  for (long j = length - 1 - first; j > length - 1 - first - K; --j)
+    d = (d << 2) | (3u - codes[j]);
+
+  return d;
+}
+
+
+std::vector<std::vector<TKmerKey> >
+get_seed_keys(EncodedRead const & encoded, bool const is_reverse_complement, seqan::IupacString const & read)
+{
+  assert(static_cast<long>(seqan::length(read)) == encoded.length);
+  std::vector<std::vector<TKmerKey> > seed_keys;
+
+  if (encoded.length < K)
+    return seed_keys;
+
+  long const num_seeds = 1 + (encoded.length - K) / (K - 1);
+  seed_keys.reserve(num_seeds);
+
+  for (long i = 0; i < num_seeds; ++i)
+  {
+    long const start = (K - 1) * i;
+    long const forward_start = is_reverse_complement ? encoded.length - start - K : start;
+
+    // Only seeds with N or other IUPAC bases need to be expanded from the sequence
+    if (encoded.has_ambiguous(forward_start, K))
+    {
+      seed_keys.push_back(to_uint64_vec(read, start));
+    }
+    else
+    {
+      seed_keys.push_back(std::vector<TKmerKey>(1, is_reverse_complement ? encoded.reverse_complement_key(start) :
+                                                                           encoded.key(start)));
+    }
+  }
+
+  return seed_keys;
+}
+
+
+std::vector<std::pair<long, TKmerKey> >
+get_syncmer_seeds(EncodedRead const & encoded, bool const is_reverse_complement)
+{
+  std::vector<std::pair<long, TKmerKey> > seeds;
+  long const length = encoded.length;
+
+  if (length < K)
+    return seeds;
+
+  // Hash of the s-mer starting at each base of the read in the given orientation
+  std::vector<uint64_t> smer_hashes(length - SYNCMER_S + 1);
+  uint64_t const smer_mask = (1ull << (2 * SYNCMER_S)) - 1;
+  uint64_t smer = 0;
+
+  for (long j = 0; j < length; ++j)
+  {
+    uint64_t const code = is_reverse_complement ? 3u - encoded.codes[length - 1 - j] : encoded.codes[j];
+    smer = ((smer << 2) | code) & smer_mask;
+
+    if (j >= SYNCMER_S - 1)
+      smer_hashes[j - SYNCMER_S + 1] = hash_smer(smer);
+  }
+
+  long const last_smer = K - SYNCMER_S; // Offset of the last s-mer in a K-mer
+
+  for (long start = 0; start + K <= length; ++start)
+  {
+    auto const first_smer = smer_hashes.begin() + start;
+    long const min_smer = std::min_element(first_smer, first_smer + last_smer + 1) - first_smer;
+
+    if (min_smer != 0 && min_smer != last_smer)
+      continue;
+
+    long const forward_start = is_reverse_complement ? length - start - K : start;
+
+    if (encoded.has_ambiguous(forward_start, K))
+      continue;
+
+    seeds.push_back({start, is_reverse_complement ? encoded.reverse_complement_key(start) : encoded.key(start)});
+  }
+
+  return seeds;
+}
+
+
+char const *
+get_read_encoder_name()
+{
+  return get_encoder().name;
+}
+
+
+} // namespace gyper
@@ -0,0 +1,213 @@
+#include <cerrno> // errno, EEXIST, EINTR
+#include <cstring> // std::strerror
+#include <string> // std::string
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/utilities/shared_segment.hpp>
+
+
+namespace
+{
+
+int
+lock_file(int const fd, int const operation)
+{
+  int ret;
+
+  do
+  {
+    ret = flock(fd, operation);
+  } while (ret != 0 && errno == EINTR);
+
+  return ret;
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+SharedSegment::~SharedSegment()
+{
+  close();
+}
+
+
+std::string
+SharedSegment::get_path(std::string const & name)
+{
+  if (name.find('/') == std::string::npos)
+    return "/dev/shm/" + name;
+
+  return name;
+}
+
+
+bool
+SharedSegment::open(std::string const & new_path)
+{
+  close();
+  fd = ::open(new_path.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0)
+    return false;
+
+  // Blocks while the last user is removing the segment
+  if (lock_file(fd, LOCK_SH) != 0)
+  {
+    close();
+    return false;
+  }
+
+  path = new_path;
+  struct stat sb;
+
+  // The segment may have been removed after it was opened, then it must be created again
+  if (!is_published() || fstat(fd, &sb) != 0 || sb.st_size <= 0)
+  {
+    path.clear();
+    close();
+    return false;
+  }
+
+  void * const addr = mmap(nullptr, static_cast<std::size_t>(sb.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+  if (addr == MAP_FAILED)
+  {
+    close();
+    return false;
+  }
+
+  ptr = static_cast<char *>(addr);
+  length = static_cast<std::size_t>(sb.st_size);
+  return true;
+}
+
+
+bool
+SharedSegment::create(std::string const & new_path,
+                      std::size_t const size,
+                      std::function<void(char * data)> const & write)
+{
+  close();
+  std::string const tmp_path = new_path + ".tmp." + std::to_string(getpid());
+  fd = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd < 0)
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::shared_segment] Could not create " << tmp_path << ": "
+                               << std::strerror(errno);
+    return false;
+  }
+
+  lock_file(fd, LOCK_SH);
+
+  // Files on hugetlbfs must be a multiple of the huge page size, which is the block size of the file system
+  struct statfs fs;
+  std::size_t const page_size = fstatfs(fd, &fs) == 0 && fs.f_bsize > 4096 ? static_cast<std::size_t>(fs.f_bsize) :
+                                4096;
+  std::size_t const new_length = (size + page_size - 1) / page_size * page_size;
+  void * addr = MAP_FAILED;
+
+  if (ftruncate(fd, static_cast<off_t>(new_length)) == 0)
+    addr = mmap(nullptr, new_length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (addr == MAP_FAILED)
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::shared_segment] Could not allocate " << new_length << " bytes in "
+                               << tmp_path << ": " << std::strerror(errno);
+    unlink(tmp_path.c_str());
+    close();
+    return false;
+  }
+
+  ptr = static_cast<char *>(addr);
+  length = new_length;
+  write(ptr);
+  mprotect(ptr, length, PROT_READ);
+
+  // Linking fails if the name exists, so a segment published by another process in the meantime is kept
+  if (link(tmp_path.c_str(), new_path.c_str()) == 0)
+  {
+    path = new_path;
+  }
+  else
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::shared_segment] Could not publish " << new_path << ": "
+                               << std::strerror(errno);
+  }
+
+  unlink(tmp_path.c_str());
+  return true;
+}
+
+
+bool
+SharedSegment::remove_if_unused()
+{
+  bool removed = false;
+
+  if (fd >= 0 && is_published() && lock_file(fd, LOCK_EX | LOCK_NB) == 0)
+    removed = unlink(path.c_str()) == 0;
+
+  path.clear();
+  close();
+  return removed;
+}
+
+
+void
+SharedSegment::close()
+{
+  unmap();
+
+  if (fd >= 0)
+  {
+    // Only the last user gets the exclusive lock
+    if (is_published() && lock_file(fd, LOCK_EX | LOCK_NB) == 0)
+      unlink(path.c_str());
+
+    ::close(fd);
+    fd = -1;
+  }
+
+  path.clear();
+}
+
+
+bool
+SharedSegment::is_published() const
+{
+  struct stat path_sb;
+  struct stat fd_sb;
+
+  return path.size() > 0 &&
+         stat(path.c_str(), &path_sb) == 0 &&
+         fstat(fd, &fd_sb) == 0 &&
+         path_sb.st_dev == fd_sb.st_dev &&
+         path_sb.st_ino == fd_sb.st_ino;
+}
+
+
+void
+SharedSegment::unmap()
+{
+  if (ptr)
+    munmap(ptr, length);
+
+  ptr = nullptr;
+  length = 0;
+}
+
+
+} // namespace gyper
@@ -172,4 +172,12 @@ is_directory(std::string const & filename)
 }
 
 
+long
+get_file_size(std::string const & filename)
+{
+  struct stat sb;
+  return stat(filename.c_str(), &sb) == 0 ? static_cast<long>(sb.st_size) : 0;
+}
+
+
 } // namespace gyper
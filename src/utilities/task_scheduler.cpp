@@ -0,0 +1,297 @@
+#include <algorithm> // std::all_of, std::max
+#include <cassert> // assert
+#include <chrono> // std::chrono::steady_clock
+#include <sstream> // std::ostringstream
+#include <string> // std::string
+#include <vector> // std::vector
+
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/utilities/task_scheduler.hpp>
+
+
+namespace
+{
+
+// The scheduler whose thread the calling thread is, and its index there
+thread_local gyper::TaskScheduler const * thread_scheduler = nullptr;
+thread_local long thread_index_in_scheduler = -1;
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+std::string
+TaskKey::to_string() const
+{
+  std::ostringstream ss;
+
+  if (region >= 0)
+    ss << "region " << region;
+
+  if (iteration >= 0)
+    ss << (ss.tellp() > 0 ? ", " : "") << "iteration " << iteration;
+
+  if (pool >= 0)
+    ss << (ss.tellp() > 0 ? ", " : "") << "pool " << pool;
+
+  return ss.tellp() > 0 ? ss.str() : std::string("task");
+}
+
+
+TaskScheduler::TaskScheduler(long const _num_threads, long const _max_files_open)
+  : num_threads(std::max(1l, _num_threads))
+  , max_files_open(std::max(1l, _max_files_open))
+  , ready(num_threads)
+  , thread_stats(num_threads)
+{
+  for (long i = 0; i < num_threads - 1; ++i)
+    threads.emplace_back(&TaskScheduler::run_thread, this, i);
+}
+
+
+TaskScheduler::~TaskScheduler()
+{
+  wait_all();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_stopping = true;
+  }
+
+  task_changed.notify_all();
+
+  for (auto & thread : threads)
+    thread.join();
+}
+
+
+TaskScheduler::TaskId
+TaskScheduler::add_task(std::function<void()> work,
+                        TaskKey const & key,
+                        std::vector<TaskId> const & dependencies,
+                        long const num_files,
+                        bool const is_leaf)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  TaskId const task_id = tasks.size();
+  tasks.emplace_back(new Task());
+  Task & task = *tasks.back();
+  task.work = std::move(work);
+  task.key = key;
+  task.num_files = num_files;
+  task.is_leaf = is_leaf;
+
+  for (TaskId const dependency : dependencies)
+  {
+    assert(dependency >= 0 && dependency < task_id);
+    Task & dependency_task = *tasks[dependency];
+
+    if (dependency_task.state != TaskState::DONE)
+    {
+      // Leaf tasks are run by waiting threads, so they cannot wait for tasks which may wait themselves
+      assert(!is_leaf || dependency_task.is_leaf);
+      dependency_task.dependents.push_back(task_id);
+      ++task.num_dependencies_left;
+    }
+  }
+
+  if (task.num_dependencies_left == 0)
+  {
+    task.state = TaskState::READY;
+    ready[get_thread_index()].push_back(task_id);
+    task_changed.notify_all();
+  }
+
+  return task_id;
+}
+
+
+void
+TaskScheduler::wait(std::vector<TaskId> const & task_ids)
+{
+  long const thread_index = get_thread_index();
+  std::unique_lock<std::mutex> lock(mutex);
+
+  auto is_all_done =
+    [&]() -> bool
+    {
+      return std::all_of(task_ids.begin(), task_ids.end(), [&](TaskId const task_id){
+          return tasks[task_id]->state == TaskState::DONE;
+        });
+    };
+
+  while (!is_all_done())
+  {
+    TaskId task_id;
+
+    if (take_task(thread_index, true /*leaf_only*/, task_id))
+      run_task(lock, thread_index, task_id);
+    else
+      task_changed.wait(lock);
+  }
+}
+
+
+void
+TaskScheduler::wait_all()
+{
+  // The calling thread is the last thread of the scheduler while it waits
+  TaskScheduler const * const previous_scheduler = thread_scheduler;
+  long const previous_thread_index = thread_index_in_scheduler;
+  thread_scheduler = this;
+  thread_index_in_scheduler = num_threads - 1;
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (num_done < static_cast<long>(tasks.size()))
+    {
+      TaskId task_id;
+
+      if (take_task(num_threads - 1, false /*leaf_only*/, task_id))
+        run_task(lock, num_threads - 1, task_id);
+      else
+        task_changed.wait(lock);
+    }
+  }
+
+  thread_scheduler = previous_scheduler;
+  thread_index_in_scheduler = previous_thread_index;
+}
+
+
+std::string
+TaskScheduler::to_string() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::ostringstream ss;
+  ss << "Tasks (busy seconds) of each thread:";
+
+  for (long i = 0; i < num_threads; ++i)
+  {
+    ss << ' ' << thread_stats[i].num_tasks
+       << " (" << static_cast<long>(thread_stats[i].busy_seconds) << ')';
+  }
+
+  ss << ". Most files open: " << max_files_opened << '/' << max_files_open;
+  return ss.str();
+}
+
+
+long
+TaskScheduler::get_thread_index() const
+{
+  // Threads outside the scheduler add and wait for tasks as its last thread
+  return thread_scheduler == this ? thread_index_in_scheduler : num_threads - 1;
+}
+
+
+bool
+TaskScheduler::take_task(long const thread_index, bool const leaf_only, TaskId & task_id)
+{
+  // Leaf tasks go first, so idle threads help with the regions which have started before starting new ones
+  for (bool const is_leaf_pass : {true, false})
+  {
+    if (!is_leaf_pass && leaf_only)
+      break;
+
+    auto is_runnable =
+      [&](TaskId const id) -> bool
+      {
+        Task const & task = *tasks[id];
+
+        // A task with more files than allowed still runs when no other files are open
+        return task.is_leaf == is_leaf_pass &&
+               (task.num_files == 0 || files_open == 0 || files_open + task.num_files <= max_files_open);
+      };
+
+    // The oldest task of the calling thread, so tasks run in the order they were added, else steal the oldest task of
+    // another thread
+    for (long i = 0; i < num_threads; ++i)
+    {
+      std::deque<TaskId> & thread_ready = ready[(thread_index + i) % num_threads];
+
+      for (auto it = thread_ready.begin(); it != thread_ready.end(); ++it)
+      {
+        if (is_runnable(*it))
+        {
+          task_id = *it;
+          thread_ready.erase(it);
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+
+void
+TaskScheduler::run_task(std::unique_lock<std::mutex> & lock, long const thread_index, TaskId const task_id)
+{
+  Task & task = *tasks[task_id]; // Tasks are never moved, only the pointers to them
+  assert(task.state == TaskState::READY);
+  task.state = TaskState::RUNNING;
+  files_open += task.num_files;
+  max_files_opened = std::max(max_files_opened, files_open);
+  std::function<void()> work = std::move(task.work);
+  BOOST_LOG_TRIVIAL(debug) << "[graphtyper::task_scheduler] Thread " << thread_index << " runs "
+                           << task.key.to_string();
+  lock.unlock();
+
+  auto const start = std::chrono::steady_clock::now();
+  work();
+  work = std::function<void()>(); // Frees what the task captured
+  std::chrono::duration<double> const duration = std::chrono::steady_clock::now() - start;
+
+  lock.lock();
+  ++thread_stats[thread_index].num_tasks;
+  thread_stats[thread_index].busy_seconds += duration.count();
+  files_open -= task.num_files;
+  task.state = TaskState::DONE;
+  ++num_done;
+
+  // Dependents become ready on this thread, which likely has their data in its caches
+  for (TaskId const dependent : task.dependents)
+  {
+    Task & dependent_task = *tasks[dependent];
+    assert(dependent_task.num_dependencies_left > 0);
+
+    if (--dependent_task.num_dependencies_left == 0)
+    {
+      dependent_task.state = TaskState::READY;
+      ready[thread_index].push_back(dependent);
+    }
+  }
+
+  task.dependents = std::vector<TaskId>();
+  task_changed.notify_all();
+}
+
+
+void
+TaskScheduler::run_thread(long const thread_index)
+{
+  thread_scheduler = this;
+  thread_index_in_scheduler = thread_index;
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true)
+  {
+    TaskId task_id;
+
+    if (take_task(thread_index, false /*leaf_only*/, task_id))
+      run_task(lock, thread_index, task_id);
+    else if (is_stopping)
+      break;
+    else
+      task_changed.wait(lock);
+  }
+}
+
+
+} // namespace gyper
@@ -34,13 +34,13 @@ to_uint64(char const c)
 }
 
 
-uint64_t
+TKmerKey
 to_uint64(seqan::DnaString const & s, std::size_t i)
 {
-  SEQAN_ASSERT_MSG(seqan::length(s) - i >= 32, "Cannot read 32 bases from read!");
-  uint64_t d = 0;
+  SEQAN_ASSERT_MSG(seqan::length(s) - i >= K, "Cannot read K bases from read!");
+  TKmerKey d = 0;
 
-  for (std::size_t const j = i + 32; i < j; ++i)
+  for (std::size_t const j = i + K; i < j; ++i)
   {
     d <<= 2;
     d += seqan::ordValue(s[i]);
@@ -50,13 +50,13 @@ to_uint64(seqan::DnaString const & s, std::size_t i)
 }
 
 
-uint64_t
+TKmerKey
 to_uint64(std::vector<char> const & s)
 {
-  assert(s.size() == 32u);
-  uint64_t d = 0ull;
+  assert(s.size() == K);
+  TKmerKey d = 0ull;
 
-  for (unsigned i = 0; i < 32; ++i)
+  for (unsigned i = 0; i < K; ++i)
   {
     d <<= 2;
     d += to_uint64(s[i]);
@@ -100,18 +100,18 @@ to_uint16(std::vector<char> const & s, std::size_t i)
 
 
 template <typename TSeq>
-std::vector<uint64_t>
+std::vector<TKmerKey>
 to_uint64_vec(TSeq const & s, std::size_t i)
 {
-  assert(seqan::length(s) >= 32 + i);  // Cannot read 32 bases from read!"
-  std::vector<uint64_t> uints(1, 0u);
+  assert(seqan::length(s) >= K + i);  // Cannot read K bases from read!"
+  std::vector<TKmerKey> uints(1, 0u);
 
-  for (unsigned const j = i + 32; i < j; ++i)
+  for (unsigned const j = i + K; i < j; ++i)
   {
     std::size_t const origin_size = uints.size();
 
     if (origin_size > 97)
-      return std::vector<uint64_t>();
+      return std::vector<TKmerKey>();
 
     for (std::size_t u = 0; u < origin_size; ++u)
     {
@@ -163,32 +163,19 @@ to_uint64_vec(TSeq const & s, std::size_t i)
 
 
 // Explicit instantation
-template std::vector<uint64_t> to_uint64_vec<seqan::Dna5String>(seqan::Dna5String const & s, std::size_t i);
-template std::vector<uint64_t> to_uint64_vec<seqan::IupacString>(seqan::IupacString const & s, std::size_t i);
+template std::vector<TKmerKey> to_uint64_vec<seqan::Dna5String>(seqan::Dna5String const & s, std::size_t i);
+template std::vector<TKmerKey> to_uint64_vec<seqan::IupacString>(seqan::IupacString const & s, std::size_t i);
 
 
-std::array<uint64_t, 96>
-to_uint64_vec_hamming_distance_1(uint64_t const key)
+THamming1Keys
+to_uint64_vec_hamming_distance_1(TKmerKey const key)
 {
-  std::array<uint64_t, 96> hamming1;
-
-  for (uint8_t bb = 0; bb < 32; ++bb)
-  {
-    // We add mask ^ exact kmer
-    // E.g. with bb = 2
-    // Mask for flipping both bits will be
-    // 0x0000000000000030
-    hamming1[bb * 3 + 0] = (1ull << (bb * 2)) ^ key; // Flip second bit
-    hamming1[bb * 3 + 1] = (2ull << (bb * 2)) ^ key; // Flip first bit
-    hamming1[bb * 3 + 2] = (3ull << (bb * 2)) ^ key; // Flip both bits
-  }
-
-  return hamming1;
+  return KmerKey<K>::hamming_distance1(key);
 }
 
 
 seqan::DnaString
-to_dna(uint64_t const & d, uint8_t k)
+to_dna(TKmerKey const & d, uint8_t k)
 {
   seqan::String<seqan::Dna> new_dna_string = "";
 
@@ -196,7 +183,7 @@ to_dna(uint64_t const & d, uint8_t k)
   {
     --k;
 
-    switch ((d & (0x0000000000000003ULL << 2 * k)) >> 2 * k)
+    switch (static_cast<uint64_t>(d >> 2 * k) & 0x0000000000000003ULL)
     {
     case A_VALUE:
       seqan::append(new_dna_string, seqan::Dna('A'));
@@ -220,12 +207,12 @@ to_dna(uint64_t const & d, uint8_t k)
 }
 
 
-std::array<uint64_t, 3>
-get_mismatches_of_last_base(uint64_t const d)
+std::array<TKmerKey, 3>
+get_mismatches_of_last_base(TKmerKey const d)
 {
-  uint64_t const d2 = ((d >> 2) << 2);
+  TKmerKey const d2 = ((d >> 2) << 2);
 
-  switch (d & 0x0000000000000003ULL)
+  switch (static_cast<uint64_t>(d) & 0x0000000000000003ULL)
   {
   case A_VALUE: return {{
                           d2 | C_VALUE, d2 | G_VALUE, d2 | T_VALUE
@@ -246,29 +233,22 @@ get_mismatches_of_last_base(uint64_t const d)
 }
 
 
-std::array<uint64_t, 3>
-get_mismatches_of_first_base(uint64_t const d)
+std::array<TKmerKey, 3>
+get_mismatches_of_first_base(TKmerKey const d)
 {
-  uint64_t const d2 = ((d << 2) >> 2);
+  unsigned const shift = 2 * (K - 1); // Of the first base
+  TKmerKey const first_base = (d >> shift) & 3ull;
+  TKmerKey const d2 = d ^ (first_base << shift);
+  std::array<TKmerKey, 3> mismatches;
+  std::size_t i = 0;
 
-  switch (d & 0xC000000000000000ULL)
+  for (TKmerKey base = A_VALUE; base <= T_VALUE; ++base)
   {
-  case A_LAST_VALUE: return {{
-                               d2 | C_LAST_VALUE, d2 | G_LAST_VALUE, d2 | T_LAST_VALUE
-                             }};
-
-  case C_LAST_VALUE: return {{
-                               d2 | A_LAST_VALUE, d2 | G_LAST_VALUE, d2 | T_LAST_VALUE
-                             }};
-
-  case G_LAST_VALUE: return {{
-                               d2 | A_LAST_VALUE, d2 | C_LAST_VALUE, d2 | T_LAST_VALUE
-                             }};
-
-  default: /*T*/ return {{
-                           d2 | A_LAST_VALUE, d2 | C_LAST_VALUE, d2 | G_LAST_VALUE
-                         }};
+    if (base != first_base)
+      mismatches[i++] = d2 | (base << shift);
   }
+
+  return mismatches;
 }
 
 
@@ -0,0 +1,134 @@
+// Compares Hamming distance 1 lookups by probing all 96 neighbours of each k-mer (as in
+// query_index_hamming_distance1_without_index) with lookups in the split-key Hamming1Index.
+//
+// Usage: bench_hamming1 [number of keys] [number of read k-mers]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <graphtyper/index/kmer_label.hpp>
+#include <graphtyper/index/mem_index.hpp>
+#include <graphtyper/utilities/type_conversions.hpp>
+
+
+namespace
+{
+
+template <typename TFunc>
+double
+time_ns(TFunc && f)
+{
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  auto const end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+
+uint64_t
+checksum(gyper::TPackedKmerLabels const & labels)
+{
+  uint64_t sum = 0;
+
+  for (auto const & seed_labels : labels)
+  {
+    for (auto const & label : seed_labels)
+      sum = sum * 31 + label.start_index;
+  }
+
+  return sum;
+}
+
+
+} // anon namespace
+
+
+int
+main(int argc, char ** argv)
+{
+  std::size_t const num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000ull;
+  std::size_t const num_queries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000ull;
+  std::size_t const BATCH = 5; // About the number of k-mers in a 150 bp read
+
+  std::mt19937_64 rng(42);
+  std::vector<gyper::TKmerKey> keys(num_keys);
+  gyper::MemIndex bench_mem_index;
+
+  for (std::size_t i = 0; i < num_keys; ++i)
+  {
+    keys[i] = rng();
+    bench_mem_index.put(keys[i], gyper::KmerLabel(static_cast<uint32_t>(i), static_cast<uint32_t>(i + 31), 0));
+  }
+
+  bench_mem_index.commit();
+
+  double const build_ns = time_ns([&bench_mem_index]() {bench_mem_index.generate_hamming1_index();});
+
+  // Most read k-mers have zero or one mismatch to an indexed k-mer
+  std::vector<std::vector<gyper::TKmerKey> > queries(num_queries);
+
+  for (auto & query : queries)
+  {
+    gyper::TKmerKey key = keys[rng() % keys.size()];
+    uint32_t const r = rng() % 10;
+
+    if (r < 3)
+      key ^= (1ull + rng() % 3) << (2 * (rng() % 32));
+    else if (r == 9)
+      key = rng();
+
+    query.push_back(key);
+  }
+
+  uint64_t probe_checksum = 0;
+  double const probe_ns = time_ns([&]()
+    {
+      std::vector<std::vector<gyper::TKmerKey> > expanded_keys(BATCH);
+
+      for (std::size_t i = 0; i < queries.size(); i += BATCH)
+      {
+        std::size_t const n = std::min(BATCH, queries.size() - i);
+        expanded_keys.resize(n);
+
+        for (std::size_t j = 0; j < n; ++j)
+        {
+          gyper::THamming1Keys const hamming1_keys = gyper::to_uint64_vec_hamming_distance_1(queries[i + j][0]);
+          expanded_keys[j].assign(hamming1_keys.begin(), hamming1_keys.end());
+        }
+
+        probe_checksum += checksum(bench_mem_index.multi_get(expanded_keys));
+      }
+    });
+
+  uint64_t index_checksum = 0;
+  double const index_ns = time_ns([&]()
+    {
+      for (std::size_t i = 0; i < queries.size(); i += BATCH)
+      {
+        std::size_t const n = std::min(BATCH, queries.size() - i);
+        std::vector<std::vector<gyper::TKmerKey> > const batch(queries.begin() + i, queries.begin() + i + n);
+        index_checksum += checksum(bench_mem_index.multi_get_hamming1(batch));
+      }
+    });
+
+  if (probe_checksum != index_checksum)
+  {
+    std::cerr << "Checksums differ: " << probe_checksum << " != " << index_checksum << "\n";
+    return 1;
+  }
+
+  double const n = static_cast<double>(num_queries);
+  std::cout << "keys=" << num_keys << " read k-mers=" << num_queries << "\n"
+            << "Hamming1Index built in " << (build_ns / 1e6) << " ms, "
+            << (bench_mem_index.hamming1.memory_usage() >> 20) << " MB\n"
+            << "96 probes:     " << (probe_ns / n) << " ns/k-mer\n"
+            << "Hamming1Index: " << (index_ns / n) << " ns/k-mer\n";
+
+  return 0;
+}
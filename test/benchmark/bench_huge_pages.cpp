@@ -0,0 +1,271 @@
+// Compares aligning reads to a large random graph when the graph and index arrays are backed by small pages, by
+// transparent huge pages (--huge_pages thp) and by reserved huge pages (--huge_pages hugetlb). The graph and index are
+// rebuilt for each mode with a SNP every 100 bases on average and the same reads, sampled from the reference with up to
+// three mismatches, are aligned to each of them. Reports the time per read and the dTLB load misses per read, which
+// are read with perf_event_open and are not available if the kernel does not allow it (see
+// /proc/sys/kernel/perf_event_paranoid), and how much memory the kernel backed by transparent huge pages (AnonHugePages).
+// Reserved huge pages need e.g. 'echo 1024 > /proc/sys/vm/nr_hugepages'.
+//
+// Usage: bench_huge_pages [reference Mbp] [reads]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <seqan/sequence.h>
+
+#include <graphtyper/constants.hpp>
+#include <graphtyper/graph/absolute_position.hpp>
+#include <graphtyper/graph/graph.hpp>
+#include <graphtyper/graph/var_record.hpp>
+#include <graphtyper/index/indexer.hpp>
+#include <graphtyper/index/mem_index.hpp>
+#include <graphtyper/typer/alignment.hpp>
+#include <graphtyper/typer/genotype_paths.hpp>
+#include <graphtyper/utilities/huge_page_allocator.hpp>
+#include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/read_encoder.hpp>
+
+
+namespace
+{
+
+struct SimulatedRead
+{
+  std::string seq; // As sequenced
+  std::string rseq; // Reverse complement
+  std::vector<uint8_t> bam_seq;
+};
+
+
+char
+complement(char const base)
+{
+  switch (base)
+  {
+  case 'A': return 'T';
+  case 'C': return 'G';
+  case 'G': return 'C';
+  case 'T': return 'A';
+  default: return 'N';
+  }
+}
+
+
+uint8_t
+to_nt16(char const base)
+{
+  switch (base)
+  {
+  case 'A': return 1;
+  case 'C': return 2;
+  case 'G': return 4;
+  case 'T': return 8;
+  default: return 15;
+  }
+}
+
+
+std::vector<SimulatedRead>
+simulate_reads(std::vector<char> const & reference, std::size_t const num_reads, std::mt19937 & rng)
+{
+  std::vector<SimulatedRead> reads;
+  char const * const BASES = "ACGT";
+  std::size_t const read_length = 150;
+
+  for (std::size_t i = 0; i < num_reads; ++i)
+  {
+    std::size_t const start = rng() % (reference.size() - read_length + 1);
+    SimulatedRead read;
+    read.seq.assign(reference.begin() + start, reference.begin() + start + read_length);
+
+    for (uint32_t m = rng() % 4; m > 0; --m)
+    {
+      char & base = read.seq[rng() % read_length];
+      base = BASES[(std::find(BASES, BASES + 4, base) - BASES + 1 + rng() % 3) % 4];
+    }
+
+    read.rseq.assign(read.seq.rbegin(), read.seq.rend());
+    std::transform(read.rseq.begin(), read.rseq.end(), read.rseq.begin(), complement);
+
+    if (rng() % 2 == 0)
+      std::swap(read.seq, read.rseq);
+
+    read.bam_seq.assign((read_length + 1) / 2, 0);
+
+    for (std::size_t j = 0; j < read_length; ++j)
+      read.bam_seq[j / 2] |= to_nt16(read.seq[j]) << ((j % 2 == 0) ? 4 : 0);
+
+    reads.push_back(std::move(read));
+  }
+
+  return reads;
+}
+
+
+void
+build_graph(std::vector<char> const & reference)
+{
+  using namespace gyper;
+
+  std::mt19937 rng(20);
+  std::vector<VarRecord> records;
+
+  for (uint32_t pos = 50 + rng() % 100; pos + 50 < reference.size(); pos += 1 + rng() % 200)
+  {
+    char const ref = reference[pos];
+    char const alt = ref == 'A' ? 'C' : 'A';
+    records.emplace_back(pos, std::vector<char>(1, ref), std::vector<std::vector<char> >(1, std::vector<char>(1, alt)));
+  }
+
+  graph = Graph();
+  Contig contig;
+  contig.name = "chr1";
+  contig.length = reference.size();
+  graph.contigs.push_back(contig);
+  absolute_pos.calculate_offsets(graph);
+  graph.add_genomic_region(std::vector<char>(reference),
+                           std::move(records),
+                           GenomicRegion("chr1:1-" + std::to_string(reference.size())));
+  graph.create_special_positions();
+  graph.generate_reference_genome();
+}
+
+
+// Counts dTLB load misses of the calling thread, or nothing if perf events are not available
+class DtlbMissCounter
+{
+public:
+  DtlbMissCounter()
+  {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+  ~DtlbMissCounter()
+  {
+    if (fd >= 0)
+      close(fd);
+  }
+
+  bool is_available() const {return fd >= 0;}
+
+  void
+  start()
+  {
+    if (fd >= 0)
+    {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  uint64_t
+  stop()
+  {
+    uint64_t count = 0;
+
+    if (fd >= 0)
+    {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+      if (read(fd, &count, sizeof(count)) != sizeof(count))
+        count = 0;
+    }
+
+    return count;
+  }
+
+private:
+  int fd = -1;
+};
+
+
+} // anon namespace
+
+
+int
+main(int argc, char ** argv)
+{
+  using namespace gyper;
+
+  std::size_t const reference_mbp = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20ull;
+  std::size_t const num_reads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200000ull;
+
+  std::mt19937 rng(42);
+  char const * const BASES = "ACGT";
+  std::vector<char> reference(reference_mbp * 1000000ull);
+
+  for (auto & base : reference)
+    base = BASES[rng() % 4];
+
+  std::vector<SimulatedRead> const reads = simulate_reads(reference, num_reads, rng);
+  DtlbMissCounter counter;
+  double const n = static_cast<double>(reads.size());
+
+  std::cout << "reference=" << reference_mbp << " Mbp reads=" << reads.size() << "\n";
+
+  for (std::string const mode : {"", "thp", "hugetlb"})
+  {
+    Options::instance()->huge_pages = mode;
+    HugePageStats const before = get_huge_page_stats();
+    build_graph(reference);
+    index_graph(mem_index);
+    HugePageStats const after = get_huge_page_stats();
+
+    std::size_t aligned = 0;
+    auto const start = std::chrono::steady_clock::now();
+    counter.start();
+
+    for (auto const & read : reads)
+    {
+      seqan::IupacString const seq(read.seq.c_str());
+      seqan::IupacString const rseq(read.rseq.c_str());
+      GenotypePaths geno(0, read.seq.size());
+      GenotypePaths rgeno(0, read.seq.size());
+      EncodedRead encoded;
+      encoded.encode(read.bam_seq.data(), read.seq.size());
+      find_genotype_paths_of_one_of_the_sequences(seq, encoded, false, geno, SeedMode::GRID, graph, mem_index);
+      find_genotype_paths_of_one_of_the_sequences(rseq, encoded, true, rgeno, SeedMode::GRID, graph, mem_index);
+      aligned += geno.longest_path_size() == read.seq.size() || rgeno.longest_path_size() == read.seq.size();
+    }
+
+    uint64_t const dtlb_misses = counter.stop();
+    auto const end = std::chrono::steady_clock::now();
+    double const ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+    std::cout << (mode.empty() ? "off" : mode) << ": " << (ns / n) << " ns/read, " << (aligned / n) << " aligned, ";
+
+    if (counter.is_available())
+      std::cout << (static_cast<double>(dtlb_misses) / n) << " dTLB misses/read";
+    else
+      std::cout << "dTLB misses not available";
+
+    std::cout << ", MiB on hugetlb=" << ((after.hugetlb_bytes - before.hugetlb_bytes) >> 20)
+              << " thp=" << ((after.thp_bytes - before.thp_bytes) >> 20)
+              << " small pages=" << ((after.small_page_bytes - before.small_page_bytes) >> 20)
+              << ", MiB backed by transparent huge pages=" << (after.anon_huge_page_bytes >> 20) << "\n";
+  }
+
+  return 0;
+}
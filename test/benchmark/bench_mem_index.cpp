@@ -0,0 +1,135 @@
+// Compares lookups in the frozen FlatKmerMap with the google::dense_hash_map<uint64_t, std::vector<KmerLabel> >
+// that MemIndex used before.
+//
+// Usage: bench_mem_index [number of keys] [number of lookups]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <google/dense_hash_map>
+
+#include <graphtyper/index/flat_kmer_map.hpp>
+#include <graphtyper/index/kmer_label.hpp>
+
+
+namespace
+{
+
+using TDenseMap = google::dense_hash_map<uint64_t, std::vector<gyper::KmerLabel> >;
+
+
+template <typename TFunc>
+double
+time_lookups(std::vector<uint64_t> const & queries, TFunc && lookup, uint64_t & checksum)
+{
+  auto const start = std::chrono::steady_clock::now();
+
+  for (auto const key : queries)
+    checksum += lookup(key);
+
+  auto const end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(queries.size());
+}
+
+
+} // anon namespace
+
+
+int
+main(int argc, char ** argv)
+{
+  std::size_t const num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000ull;
+  std::size_t const num_queries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000000ull;
+
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<uint32_t> num_labels_dist(0, 99);
+  std::unordered_map<uint64_t, std::vector<gyper::KmerLabel> > buffer_map;
+  std::vector<uint64_t> keys;
+  keys.reserve(num_keys);
+
+  // Most k-mers are unique, a few are repeated
+  while (keys.size() < num_keys)
+  {
+    uint64_t const key = rng();
+
+    if (key == 0 || buffer_map.count(key) > 0)
+      continue;
+
+    uint32_t const r = num_labels_dist(rng);
+    uint32_t const num_labels = r < 85 ? 1 : (r < 95 ? 2 : 3 + r % 5);
+    std::vector<gyper::KmerLabel> & labels = buffer_map[key];
+
+    for (uint32_t i = 0; i < num_labels; ++i)
+      labels.push_back(gyper::KmerLabel(static_cast<uint32_t>(keys.size()), static_cast<uint32_t>(keys.size() + 31), i));
+
+    keys.push_back(key);
+  }
+
+  // Half of the queries are hits
+  std::vector<uint64_t> queries(num_queries);
+
+  for (auto & query : queries)
+    query = (rng() & 1) ? keys[rng() % keys.size()] : rng();
+
+  TDenseMap dense_map;
+  dense_map.set_empty_key(0);
+  std::size_t dense_label_bytes = 0;
+
+  for (auto const & key_labels : buffer_map)
+  {
+    dense_map[key_labels.first] = key_labels.second;
+    dense_label_bytes += key_labels.second.capacity() * sizeof(gyper::KmerLabel) + 16; // 16 bytes malloc overhead
+  }
+
+  gyper::FlatKmerMap<gyper::KmerLabel, uint64_t> flat_map;
+  flat_map.build(buffer_map);
+  buffer_map.clear();
+
+  uint64_t dense_checksum = 0;
+  double const dense_ns = time_lookups(queries,
+                                       [&dense_map](uint64_t const key) -> uint64_t
+    {
+      auto find_it = dense_map.find(key);
+
+      if (find_it == dense_map.end())
+        return 0;
+
+      uint64_t sum = 0;
+
+      for (auto const & label : find_it->second)
+        sum += label.start_index;
+
+      return sum;
+    }, dense_checksum);
+
+  uint64_t flat_checksum = 0;
+  double const flat_ns = time_lookups(queries,
+                                      [&flat_map](uint64_t const key) -> uint64_t
+    {
+      uint64_t sum = 0;
+
+      for (auto const & label : flat_map.find(key))
+        sum += label.start_index;
+
+      return sum;
+    }, flat_checksum);
+
+  if (dense_checksum != flat_checksum)
+  {
+    std::cerr << "Checksums differ: " << dense_checksum << " != " << flat_checksum << "\n";
+    return 1;
+  }
+
+  std::size_t const dense_bytes = dense_map.bucket_count() * sizeof(TDenseMap::value_type) + dense_label_bytes;
+
+  std::cout << "keys=" << num_keys << " lookups=" << num_queries << "\n"
+            << "dense_hash_map: " << dense_ns << " ns/lookup, ~" << (dense_bytes >> 20) << " MB\n"
+            << "FlatKmerMap:    " << flat_ns << " ns/lookup, " << (flat_map.memory_usage() >> 20) << " MB\n";
+
+  return 0;
+}
@@ -0,0 +1,188 @@
+// Compares MemIndex::multi_get, which looks up all keys of a batch with prefetching, with resolving the keys one at
+// a time with dependent lookups in the filter and the table.
+//
+// Usage: bench_multi_get [number of keys] [number of reads]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <graphtyper/index/kmer_label.hpp>
+#include <graphtyper/index/mem_index.hpp>
+#include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/type_conversions.hpp>
+
+
+namespace
+{
+
+using TRange = gyper::FlatKmerMap<gyper::PackedKmerLabel>::Range;
+
+
+// Best of a few runs, the lookups are short enough to be disturbed by anything else on the machine
+template <typename TFunc>
+double
+time_ns(TFunc && f)
+{
+  double best = 0.0;
+
+  for (int i = 0; i < 5; ++i)
+  {
+    auto const start = std::chrono::steady_clock::now();
+    f();
+    auto const end = std::chrono::steady_clock::now();
+    double const ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+    if (i == 0 || ns < best)
+      best = ns;
+  }
+
+  return best;
+}
+
+
+uint64_t
+checksum(gyper::TPackedKmerLabels const & labels)
+{
+  uint64_t sum = 0;
+
+  for (auto const & seed_labels : labels)
+  {
+    for (auto const & label : seed_labels)
+      sum = sum * 31 + label.start_index;
+  }
+
+  return sum;
+}
+
+
+// The lookup before batching, one key at a time
+gyper::TPackedKmerLabels
+multi_get_one_by_one(gyper::MemIndex const & mem_index, std::vector<std::vector<gyper::TKmerKey> > const & keys)
+{
+  gyper::TPackedKmerLabels labels(keys.size());
+  std::vector<TRange> results;
+  uint64_t const max_index_labels = gyper::Options::const_instance()->max_index_labels;
+
+  for (std::size_t i = 0; i < keys.size(); ++i)
+  {
+    std::size_t num_results = 0;
+    results.clear();
+
+    for (auto const key : keys[i])
+    {
+      if (!mem_index.filter.may_contain(key))
+        continue;
+
+      TRange const find_range = mem_index.hamming0.find(key);
+
+      if (find_range.empty() && !mem_index.repeats.find(key).empty())
+      {
+        results.clear();
+        break;
+      }
+
+      if (!find_range.empty())
+      {
+        num_results += find_range.size();
+
+        if (num_results > max_index_labels)
+        {
+          results.clear();
+          break;
+        }
+
+        results.push_back(find_range);
+      }
+    }
+
+    for (auto const & res : results)
+      labels[i].insert(labels[i].end(), res.begin(), res.end());
+  }
+
+  return labels;
+}
+
+
+} // anon namespace
+
+
+int
+main(int argc, char ** argv)
+{
+  std::size_t const num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000ull;
+  std::size_t const num_reads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000ull;
+  std::size_t const SEEDS_PER_READ = 5; // About the number of k-mers in a 150 bp read
+
+  std::mt19937_64 rng(42);
+  std::vector<gyper::TKmerKey> keys(num_keys);
+  gyper::MemIndex bench_mem_index;
+
+  for (std::size_t i = 0; i < num_keys; ++i)
+  {
+    keys[i] = rng();
+    bench_mem_index.put(keys[i], gyper::KmerLabel(static_cast<uint32_t>(i), static_cast<uint32_t>(i + 31), 0));
+  }
+
+  bench_mem_index.commit();
+
+  // Exact seeds of each read and their 96 neighbours, as in query_index and the Hamming distance 1 lookup
+  std::vector<std::vector<std::vector<gyper::TKmerKey> > > exact_reads(num_reads);
+  std::vector<std::vector<std::vector<gyper::TKmerKey> > > hamming1_reads(num_reads);
+
+  for (std::size_t r = 0; r < num_reads; ++r)
+  {
+    for (std::size_t s = 0; s < SEEDS_PER_READ; ++s)
+    {
+      gyper::TKmerKey key = keys[rng() % keys.size()];
+
+      if (rng() % 4 == 0)
+        key ^= (1ull + rng() % 3) << (2 * (rng() % 32));
+
+      exact_reads[r].push_back({key});
+      gyper::THamming1Keys const hamming1_keys = gyper::to_uint64_vec_hamming_distance_1(key);
+      hamming1_reads[r].push_back(std::vector<gyper::TKmerKey>(hamming1_keys.begin(), hamming1_keys.end()));
+    }
+  }
+
+  double const n = static_cast<double>(num_reads);
+  std::cout << "keys=" << num_keys << " reads=" << num_reads << " seeds/read=" << SEEDS_PER_READ << "\n";
+
+  for (auto const * reads : {&exact_reads, &hamming1_reads})
+  {
+    uint64_t one_by_one_checksum = 0;
+    double const one_by_one_ns = time_ns([&]()
+      {
+        one_by_one_checksum = 0;
+
+        for (auto const & read : *reads)
+          one_by_one_checksum += checksum(multi_get_one_by_one(bench_mem_index, read));
+      });
+
+    uint64_t batched_checksum = 0;
+    double const batched_ns = time_ns([&]()
+      {
+        batched_checksum = 0;
+
+        for (auto const & read : *reads)
+          batched_checksum += checksum(bench_mem_index.multi_get(read));
+      });
+
+    if (one_by_one_checksum != batched_checksum)
+    {
+      std::cerr << "Checksums differ: " << one_by_one_checksum << " != " << batched_checksum << "\n";
+      return 1;
+    }
+
+    std::cout << (reads == &exact_reads ? "exact seeds\n" : "96 neighbours per seed\n")
+              << "  one by one: " << (one_by_one_ns / n) << " ns/read\n"
+              << "  batched:    " << (batched_ns / n) << " ns/read\n";
+  }
+
+  return 0;
+}
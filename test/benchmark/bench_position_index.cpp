@@ -0,0 +1,186 @@
+// Compares finding the reference node of random positions with the linear scan over the reference nodes which
+// Graph::get_locations_of_an_actual_position did before, with std::upper_bound over the sorted orders and with the
+// Eytzinger layout of PositionIndex. The graph has a SNP every 100 bases on average. Also reports the time of
+// Graph::get_locations_of_an_actual_position itself, which uses the position index.
+//
+// Usage: bench_position_index [reference Mbp] [positions]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <graphtyper/graph/absolute_position.hpp>
+#include <graphtyper/graph/graph.hpp>
+#include <graphtyper/graph/position_index.hpp>
+#include <graphtyper/graph/var_record.hpp>
+#include <graphtyper/utilities/options.hpp>
+
+
+namespace
+{
+
+// Best of a few runs, the lookups are short enough to be disturbed by anything else on the machine
+template <typename TFunc>
+double
+time_ns(TFunc && f)
+{
+  double best = 0.0;
+
+  for (int i = 0; i < 5; ++i)
+  {
+    auto const start = std::chrono::steady_clock::now();
+    f();
+    auto const end = std::chrono::steady_clock::now();
+    double const ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+    if (i == 0 || ns < best)
+      best = ns;
+  }
+
+  return best;
+}
+
+
+void
+build_graph(std::vector<char> const & reference)
+{
+  using namespace gyper;
+
+  std::mt19937 rng(20);
+  std::vector<VarRecord> records;
+
+  for (uint32_t pos = 50 + rng() % 100; pos + 50 < reference.size(); pos += 1 + rng() % 200)
+  {
+    char const ref = reference[pos];
+    char const alt = ref == 'A' ? 'C' : 'A';
+    records.emplace_back(pos, std::vector<char>(1, ref), std::vector<std::vector<char> >(1, std::vector<char>(1, alt)));
+  }
+
+  graph = Graph();
+  Contig contig;
+  contig.name = "chr1";
+  contig.length = reference.size();
+  graph.contigs.push_back(contig);
+  absolute_pos.calculate_offsets(graph);
+  graph.add_genomic_region(std::vector<char>(reference),
+                           std::move(records),
+                           GenomicRegion("chr1:1-" + std::to_string(reference.size())));
+}
+
+
+// The search before the position index, kept for comparison
+std::size_t
+linear_upper_bound(gyper::RefNodes const & ref_nodes, uint32_t const pos)
+{
+  std::size_t r = 1;
+
+  while (r < ref_nodes.size() && ref_nodes.get_order(r) <= pos)
+    ++r;
+
+  return r;
+}
+
+
+} // anon namespace
+
+
+int
+main(int argc, char ** argv)
+{
+  using namespace gyper;
+
+  std::size_t const reference_mbp = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20ull;
+  std::size_t const num_positions = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000ull;
+
+  std::mt19937 rng(42);
+  char const * const BASES = "ACGT";
+  std::vector<char> reference(reference_mbp * 1000000ull);
+
+  for (auto & base : reference)
+    base = BASES[rng() % 4];
+
+  build_graph(reference);
+
+  uint32_t const first = graph.ref_nodes.get_order(0);
+  uint32_t const last = graph.ref_nodes.back().get_label().reach();
+  std::vector<uint32_t> positions(num_positions);
+
+  for (auto & pos : positions)
+    pos = first + static_cast<uint32_t>(rng() % (last - first + 1));
+
+  std::vector<uint32_t> sorted_orders(graph.ref_nodes.size());
+
+  for (std::size_t r = 0; r < graph.ref_nodes.size(); ++r)
+    sorted_orders[r] = graph.ref_nodes.get_order(r);
+
+  // The linear scan takes time proportional to the graph, so it is timed on fewer positions
+  std::size_t const num_linear = std::min<std::size_t>(positions.size(), 1000);
+  uint64_t linear_checksum = 0;
+  double const linear_ns = time_ns([&]()
+    {
+      linear_checksum = 0;
+
+      for (std::size_t i = 0; i < num_linear; ++i)
+        linear_checksum += linear_upper_bound(graph.ref_nodes, positions[i]);
+    });
+
+  uint64_t sorted_checksum = 0;
+  uint64_t sorted_prefix_checksum = 0;
+  double const sorted_ns = time_ns([&]()
+    {
+      sorted_checksum = 0;
+
+      for (std::size_t i = 0; i < positions.size(); ++i)
+      {
+        if (i == num_linear)
+          sorted_prefix_checksum = sorted_checksum;
+
+        sorted_checksum += std::upper_bound(sorted_orders.begin(), sorted_orders.end(), positions[i]) -
+                           sorted_orders.begin();
+      }
+    });
+
+  uint64_t index_checksum = 0;
+  double const index_ns = time_ns([&]()
+    {
+      index_checksum = 0;
+
+      for (auto const pos : positions)
+        index_checksum += graph.position_index.upper_bound(pos);
+    });
+
+  uint64_t num_locations = 0;
+  double const locations_ns = time_ns([&]()
+    {
+      num_locations = 0;
+
+      for (auto const pos : positions)
+        num_locations += graph.get_locations_of_an_actual_position(pos).size();
+    });
+
+  if (positions.size() <= num_linear)
+    sorted_prefix_checksum = sorted_checksum;
+
+  if (linear_checksum != sorted_prefix_checksum || sorted_checksum != index_checksum)
+  {
+    std::cerr << "Checksums differ: " << linear_checksum << " != " << sorted_prefix_checksum << " or "
+              << sorted_checksum << " != " << index_checksum << "\n";
+    return 1;
+  }
+
+  double const n = static_cast<double>(positions.size());
+  std::cout << "reference=" << reference_mbp << " Mbp reference nodes=" << graph.ref_nodes.size()
+            << " positions=" << positions.size() << "\n"
+            << "  linear scan:            " << (linear_ns / num_linear) << " ns/position\n"
+            << "  std::upper_bound:       " << (sorted_ns / n) << " ns/position\n"
+            << "  position index:         " << (index_ns / n) << " ns/position\n"
+            << "  get_locations_of_an_actual_position: " << (locations_ns / n) << " ns/position, "
+            << (num_locations / n) << " locations/position\n";
+
+  return 0;
+}
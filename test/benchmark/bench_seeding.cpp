@@ -0,0 +1,227 @@
+// Compares seeding reads with K-mers every K - 1 bases and their Hamming distance 1 neighbours (SeedMode::GRID) with
+// seeding them with exact closed syncmers (SeedMode::SYNCMER). Reads are simulated from random paths through the test
+// graphs with up to three mismatches. Reports the time per read, the fraction of reads aligned over their full length
+// and how often both modes give the same alignment.
+//
+// Usage: bench_seeding [reads per graph] [reference.fa variants.vcf.gz region...]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <seqan/sequence.h>
+
+#include <graphtyper/constants.hpp>
+#include <graphtyper/graph/constructor.hpp>
+#include <graphtyper/graph/graph.hpp>
+#include <graphtyper/index/indexer.hpp>
+#include <graphtyper/index/mem_index.hpp>
+#include <graphtyper/typer/alignment.hpp>
+#include <graphtyper/typer/genotype_paths.hpp>
+#include <graphtyper/utilities/read_encoder.hpp>
+
+
+namespace
+{
+
+struct SimulatedRead
+{
+  std::string seq; // As sequenced
+  std::string rseq; // Reverse complement
+  std::vector<uint8_t> bam_seq;
+};
+
+
+struct ModeStats
+{
+  double ns = 0.0;
+  std::size_t aligned = 0;
+};
+
+
+char
+complement(char const base)
+{
+  switch (base)
+  {
+  case 'A': return 'T';
+  case 'C': return 'G';
+  case 'G': return 'C';
+  case 'T': return 'A';
+  default: return 'N';
+  }
+}
+
+
+uint8_t
+to_nt16(char const base)
+{
+  switch (base)
+  {
+  case 'A': return 1;
+  case 'C': return 2;
+  case 'G': return 4;
+  case 'T': return 8;
+  default: return 15;
+  }
+}
+
+
+std::vector<SimulatedRead>
+simulate_reads(std::size_t const num_reads, std::mt19937 & rng)
+{
+  std::vector<SimulatedRead> reads;
+  char const * const BASES = "ACGT";
+
+  for (std::size_t i = 0; i < num_reads; ++i)
+  {
+    std::vector<char> const haplotype = gyper::graph.walk_random_path(0, 0xFFFFFFFFul);
+    std::size_t const read_length = std::min(static_cast<std::size_t>(150), haplotype.size());
+
+    if (read_length < gyper::K)
+      break;
+
+    std::size_t const start = rng() % (haplotype.size() - read_length + 1);
+    SimulatedRead read;
+    read.seq.assign(haplotype.begin() + start, haplotype.begin() + start + read_length);
+
+    for (uint32_t m = rng() % 4; m > 0; --m)
+    {
+      char & base = read.seq[rng() % read_length];
+      base = BASES[(std::find(BASES, BASES + 4, base) - BASES + 1 + rng() % 3) % 4];
+    }
+
+    read.rseq.assign(read.seq.rbegin(), read.seq.rend());
+    std::transform(read.rseq.begin(), read.rseq.end(), read.rseq.begin(), complement);
+
+    if (rng() % 2 == 0)
+      std::swap(read.seq, read.rseq);
+
+    read.bam_seq.assign((read_length + 1) / 2, 0);
+
+    for (std::size_t j = 0; j < read_length; ++j)
+      read.bam_seq[j / 2] |= to_nt16(read.seq[j]) << ((j % 2 == 0) ? 4 : 0);
+
+    reads.push_back(std::move(read));
+  }
+
+  return reads;
+}
+
+
+// First alignment of the read in each orientation, or zeros if the read did not align over its full length
+std::vector<uint32_t>
+align(SimulatedRead const & read, gyper::SeedMode const seed_mode, ModeStats & stats)
+{
+  using namespace gyper;
+
+  seqan::IupacString const seq(read.seq.c_str());
+  seqan::IupacString const rseq(read.rseq.c_str());
+  GenotypePaths geno(0, read.seq.size());
+  GenotypePaths rgeno(0, read.seq.size());
+
+  auto const start = std::chrono::steady_clock::now();
+  EncodedRead encoded;
+  encoded.encode(read.bam_seq.data(), read.seq.size());
+  find_genotype_paths_of_one_of_the_sequences(seq, encoded, false, geno, seed_mode, graph, mem_index);
+  find_genotype_paths_of_one_of_the_sequences(rseq, encoded, true, rgeno, seed_mode, graph, mem_index);
+  auto const end = std::chrono::steady_clock::now();
+  stats.ns += std::chrono::duration<double, std::nano>(end - start).count();
+
+  std::vector<uint32_t> alignment;
+  bool is_aligned = false;
+
+  for (GenotypePaths const * g : {&geno, &rgeno})
+  {
+    if (g->paths.size() > 0 && g->longest_path_size() == read.seq.size())
+    {
+      is_aligned = true;
+      alignment.push_back(g->paths[0].start);
+      alignment.push_back(g->paths[0].end);
+    }
+    else
+    {
+      alignment.push_back(0);
+      alignment.push_back(0);
+    }
+  }
+
+  stats.aligned += is_aligned;
+  return alignment;
+}
+
+
+} // anon namespace
+
+
+int
+main(int argc, char ** argv)
+{
+  using namespace gyper;
+
+  std::size_t const num_reads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000ull;
+  std::string reference_path;
+  std::string vcf_path;
+  std::vector<std::string> regions;
+
+  if (argc > 4)
+  {
+    reference_path = argv[2];
+    vcf_path = argv[3];
+    regions.assign(argv + 4, argv + argc);
+  }
+  else
+  {
+    std::stringstream ss;
+    ss << gyper_SOURCE_DIRECTORY << "/test/data/reference/index_test.fa";
+    reference_path = ss.str();
+    ss.str("");
+    ss << gyper_SOURCE_DIRECTORY << "/test/data/reference/index_test.vcf.gz";
+    vcf_path = ss.str();
+    regions = {"chr1", "chr2", "chr3", "chr4", "chr5", "chr6", "chr7", "chr8"};
+  }
+
+  std::mt19937 rng(42);
+  std::srand(42);
+  ModeStats grid;
+  ModeStats syncmer;
+  std::size_t total_reads = 0;
+  std::size_t same_alignment = 0;
+
+  for (auto const & region : regions)
+  {
+    construct_graph(reference_path, vcf_path, region);
+    index_graph(mem_index);
+
+    std::vector<SimulatedRead> const reads = simulate_reads(num_reads, rng);
+
+    for (auto const & read : reads)
+    {
+      std::vector<uint32_t> const grid_alignment = align(read, SeedMode::GRID, grid);
+      std::vector<uint32_t> const syncmer_alignment = align(read, SeedMode::SYNCMER, syncmer);
+      same_alignment += grid_alignment == syncmer_alignment;
+    }
+
+    total_reads += reads.size();
+  }
+
+  if (total_reads == 0)
+  {
+    std::cerr << "No reads could be simulated from the graphs.\n";
+    return 1;
+  }
+
+  double const n = static_cast<double>(total_reads);
+  std::cout << "reads=" << total_reads << " graphs=" << regions.size() << "\n"
+            << "grid:    " << (grid.ns / n) << " ns/read, " << (grid.aligned / n) << " aligned\n"
+            << "syncmer: " << (syncmer.ns / n) << " ns/read, " << (syncmer.aligned / n) << " aligned\n"
+            << "same alignment: " << (same_alignment / n) << "\n";
+
+  return 0;
+}
@@ -8,8 +8,6 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
-#include <boost/archive/binary_oarchive.hpp>
-#include <boost/archive/binary_iarchive.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/log/utility/setup/console.hpp>
 
@@ -75,20 +73,11 @@ create_graph(std::string const & fasta,
   REQUIRE(gyper::graph.size() > 0);
   REQUIRE(gyper::graph.check());
 
-  {
-    std::ofstream ofs(graph_path.str().c_str(), std::ios::binary);
-    REQUIRE(ofs.is_open());
-    boost::archive::binary_oarchive oa(ofs);
-    oa << gyper::graph;
-  }
+  gyper::save_graph(graph_path.str());
 
   // test open
   {
-    gyper::Graph new_graph;
-    std::ifstream ifs(graph_path.str().c_str(), std::ios::binary);
-    REQUIRE(ifs.is_open());
-    boost::archive::binary_iarchive ia(ifs);
-    ia >> new_graph;
+    gyper::Graph const new_graph = gyper::load_secondary_graph(graph_path.str());
 
     REQUIRE(new_graph.size() == gyper::graph.size());
     REQUIRE(new_graph.genomic_region.chr == gyper::graph.genomic_region.chr);
@@ -105,8 +94,8 @@ TEST_CASE("Construct test graph (chr1)")
   REQUIRE(gyper::graph.ref_nodes.size() == 2);
   REQUIRE(gyper::graph.var_nodes.size() == 2);
 
-  std::vector<gyper::RefNode> const & ref_nodes = gyper::graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = gyper::graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = gyper::graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = gyper::graph.var_nodes;
 
   SECTION("The nodes should be correctly connected")
   {
@@ -150,8 +139,8 @@ TEST_CASE("Construct test graph (chr1) but with absolute positions")
   REQUIRE(graph.ref_nodes.size() == 2);
   REQUIRE(graph.var_nodes.size() == 2);
 
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The nodes should be correctly connected")
   {
@@ -195,8 +184,8 @@ TEST_CASE("Construct test graph (chr2)")
   REQUIRE(graph.ref_nodes.size() == 3);
   REQUIRE(graph.var_nodes.size() == 4);
 
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The nodes should be correctly connected")
   {
@@ -251,8 +240,8 @@ TEST_CASE("Construct test graph (chr3)")
 
   create_graph("/test/data/reference/index_test.fa", "/test/data/reference/index_test.vcf.gz", "chr3", true);
 
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("Nodes are correctly connected")
   {
@@ -307,8 +296,8 @@ TEST_CASE("Construct test graph (chr8) in a region that fully overlaps only a se
 
   create_graph("/test/data/reference/index_test.fa", "/test/data/reference/index_test.vcf.gz", "chr8:1-56", true);
 
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("Nodes are correctly connected")
   {
@@ -353,8 +342,8 @@ TEST_CASE("Construct test graph with SV deletion (chr5)")
 
   create_graph("/test/data/reference/index_test.fa", "/test/data/reference/index_test.vcf.gz", "chr5", false);
 
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   REQUIRE(ref_nodes.size() == 2);
   REQUIRE(var_nodes.size() == 2);
@@ -393,8 +382,8 @@ TEST_CASE("Construct test graph with SV duplication (chr6)")
 
   create_graph("/test/data/reference/index_test.fa", "/test/data/reference/index_test.vcf.gz", "chr6", false);
 
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   REQUIRE(ref_nodes.size() == 3);
   REQUIRE(var_nodes.size() == 4);
@@ -438,8 +427,8 @@ TEST_CASE("Construct test graph with SV duplication (chr7)")
 
   create_graph("/test/data/reference/index_test.fa", "/test/data/reference/index_test.vcf.gz", "chr7", false);
 
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   REQUIRE(ref_nodes.size() == 2);
   REQUIRE(var_nodes.size() == 3);
@@ -488,8 +477,8 @@ TEST_CASE("Construct test graph (chromosome 1, without chr in front)")
   REQUIRE(gyper::graph.ref_nodes.size() == 2);
   REQUIRE(gyper::graph.var_nodes.size() == 2);
 
-  std::vector<gyper::RefNode> const & ref_nodes = gyper::graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = gyper::graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = gyper::graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = gyper::graph.var_nodes;
 
   SECTION("The nodes should be correctly connected")
   {
@@ -6,6 +6,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
 
 #include <boost/log/trivial.hpp>
 #include <boost/log/utility/setup/console.hpp>
@@ -14,7 +16,10 @@
 
 #include <graphtyper/graph/absolute_position.hpp>
 #include <graphtyper/graph/graph.hpp>
+#include <graphtyper/graph/graph_serialization.hpp>
 #include <graphtyper/graph/label.hpp>
+#include <graphtyper/graph/position_index.hpp>
+#include <graphtyper/graph/sequence_arena.hpp>
 #include <graphtyper/graph/var_record.hpp>
 #include <graphtyper/utilities/type_conversions.hpp>
 #include <graphtyper/utilities/options.hpp>
@@ -41,7 +46,7 @@ TEST_CASE("Logging setup")
 
 
 std::vector<std::vector<char> >
-get_var_dna(std::vector<gyper::VarNode> const & var_nodes)
+get_var_dna(gyper::TVarNodes const & var_nodes)
 {
   std::vector<std::vector<char> > var_dna;
 
@@ -128,8 +133,8 @@ TEST_CASE("Graph with a reference only.")
 
   graph = gyper::Graph(false);
   graph.add_genomic_region(std::move(reference_sequence), std::vector<gyper::VarRecord>(0), gyper::GenomicRegion());
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The graph has the correct size")
   {
@@ -177,8 +182,8 @@ TEST_CASE("Graph with two variant records.")
 
   graph = gyper::Graph(false);
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The graph should have the correct size")
   {
@@ -267,8 +272,8 @@ TEST_CASE("Graph can start with a variant record.")
 
   graph = gyper::Graph(false);
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The graph should have the correct size")
   {
@@ -345,8 +350,8 @@ TEST_CASE("The reference can contain Ns. Note however that variants cannot overl
   REQUIRE(graph.var_nodes.size() == 5);
   REQUIRE(graph.size() == 8);
 
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The nodes should be correctly connected")
   {
@@ -436,8 +441,8 @@ TEST_CASE("The reference can start with Ns.")
   REQUIRE(graph.var_nodes.size() == 5);
   REQUIRE(graph.size() == 8);
 
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The nodes should be correctly connected")
   {
@@ -511,8 +516,8 @@ TEST_CASE("We can start at any location of the reference.")
   REQUIRE(graph.var_nodes.size() == 5);
   REQUIRE(graph.size() == 8);
 
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The nodes should be correctly connected")
   {
@@ -588,8 +593,8 @@ TEST_CASE("Variants can overlap", "[graph]")
 
   graph = gyper::Graph(false);
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The graph should have the correct size")
   {
@@ -663,8 +668,8 @@ TEST_CASE("Variants can overlap. Case where the second variant reaches further")
 
   graph = gyper::Graph(false);
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The graph should have the correct size")
   {
@@ -743,8 +748,8 @@ TEST_CASE("Two variants next to each other won't overlap")
 
   graph = gyper::Graph(false);
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The graph should have the correct size")
   {
@@ -850,8 +855,8 @@ TEST_CASE(
 
   graph = gyper::Graph(false);
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The graph should have the correct size")
   {
@@ -958,8 +963,8 @@ TEST_CASE("Same as above but with bases in between the variants.", "[test2]")
 
   graph = gyper::Graph(false);
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The nodes should have a label with the correct DNA bases")
   {
@@ -1073,8 +1078,8 @@ TEST_CASE("Four variants joined", "[test2]")
 
   graph = gyper::Graph(false);
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The nodes should have a label with the correct DNA bases")
   {
@@ -1206,8 +1211,8 @@ TEST_CASE("Variants of any number can be joined, here 3 are tested.", "[test]")
 
   graph = gyper::Graph(false);
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The nodes should have a label with the correct DNA bases")
   {
@@ -1317,8 +1322,8 @@ TEST_CASE("Check if the above creates the graph correctly")
   {
     graph = gyper::Graph(false);
     graph.add_genomic_region(std::move(reference_sequence), std::move(records_step1), gyper::GenomicRegion());
-    std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-    std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+    gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+    gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
     REQUIRE(ref_nodes[0].get_label().dna == gyper::to_vec("C"));
 
@@ -1335,8 +1340,8 @@ TEST_CASE("Check if the above creates the graph correctly")
   {
     graph = gyper::Graph(false);
     graph.add_genomic_region(std::move(reference_sequence), std::move(records_step2), gyper::GenomicRegion());
-    std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-    std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+    gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+    gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
     std::vector<std::vector<char> > var_dna;
 
@@ -1387,8 +1392,8 @@ TEST_CASE("Variant overlapping a N on the reference genome")
     graph.add_genomic_region(std::vector<char>(reference_sequence), std::move(records), gyper::GenomicRegion());
 
     // Here, we assume that nothing is added
-    std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-    std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+    gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+    gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
     REQUIRE(ref_nodes.size() == 1);
     REQUIRE(ref_nodes[0].get_label().dna == reference_sequence);
@@ -1410,8 +1415,8 @@ TEST_CASE("Variant overlapping a N on the reference genome")
     graph = gyper::Graph(false);
     graph.add_genomic_region(std::vector<char>(reference_sequence), std::move(records), gyper::GenomicRegion());
 
-    std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-    std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+    gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+    gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
     REQUIRE(ref_nodes.size() == 2);
     REQUIRE(var_nodes.size() == 2);
@@ -1436,8 +1441,8 @@ TEST_CASE("Variant overlapping a N on the reference genome")
     graph.add_genomic_region(std::vector<char>(reference_sequence), std::move(records), gyper::GenomicRegion());
 
     // Here, we assume that nothing is added
-    std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-    std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+    gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+    gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
     REQUIRE(ref_nodes.size() == 1);
     REQUIRE(ref_nodes[0].get_label().dna == reference_sequence);
@@ -1475,8 +1480,8 @@ TEST_CASE("Prior test for the next")
   graph.add_genomic_region(std::vector<char>(reference_sequence), std::move(records), gyper::GenomicRegion());
 
   // Here, we assume that nothing is added
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The number of nodes is correct")
   {
@@ -1530,8 +1535,8 @@ TEST_CASE("Merge one path should check if we can remove the suffix of a variant
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
 
   // Here, we assume that nothing is added
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   REQUIRE(ref_nodes.size() == 2);
   REQUIRE(var_nodes.size() == 4);
@@ -1579,8 +1584,8 @@ TEST_CASE("Merge one path works with connected indel+SNP")
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
 
   // Here, we assume that nothing is added
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The number of nodes is corrent")
   {
@@ -1635,8 +1640,8 @@ TEST_CASE("Merge path works with 3 pairs of connected SNPs")
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
 
   // Here, we assume that nothing is added
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The number of nodes is corrent")
   {
@@ -1691,8 +1696,8 @@ TEST_CASE("Two overlapping indels")
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion());
 
   // Here, we assume that nothing is added
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
   SECTION("The number of nodes is corrent")
   {
@@ -1759,8 +1764,8 @@ TEST_CASE("Two deletions and one of them overlaps SNPs")
   }
 
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion("chr1"));
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
 
   SECTION("The graph should have the correct size")
@@ -1803,7 +1808,7 @@ TEST_CASE("Two deletions and one of them overlaps SNPs")
   {
     REQUIRE(ref_nodes[0].get_label().order == 1);
 
-    for (auto & v : var_nodes)
+    for (auto const & v : var_nodes)
       REQUIRE(v.get_label().order == 2);
 
     //REQUIRE(var_nodes[0].get_label().order == 2);
@@ -1891,8 +1896,8 @@ TEST_CASE("Two deletions and one of them overlaps SNPs and an insertion")
   }
 
   graph.add_genomic_region(std::move(reference_sequence), std::move(records), gyper::GenomicRegion("chr1"));
-  std::vector<gyper::RefNode> const & ref_nodes = graph.ref_nodes;
-  std::vector<gyper::VarNode> const & var_nodes = graph.var_nodes;
+  gyper::TRefNodes const & ref_nodes = graph.ref_nodes;
+  gyper::TVarNodes const & var_nodes = graph.var_nodes;
 
 
   SECTION("The graph should have the correct size")
@@ -1907,7 +1912,7 @@ TEST_CASE("Two deletions and one of them overlaps SNPs and an insertion")
   {
     REQUIRE(ref_nodes[0].get_label().order == 1);
 
-    for (auto & v : var_nodes)
+    for (auto const & v : var_nodes)
       REQUIRE(v.get_label().order == 2);
   }
 
@@ -1935,3 +1940,172 @@ TEST_CASE("Two deletions and one of them overlaps SNPs and an insertion")
     REQUIRE(ref_nodes[1].get_label().dna == gyper::to_vec("TTATTACCGGGGGTAGTAGTAGTAGCGCAGAGGTTTTAGAGGGCF"));
   }
 }
+
+
+TEST_CASE("Sequences in the arena are read back unchanged")
+{
+  using namespace gyper;
+
+  SequenceArena arena;
+  std::vector<char> const seq1 = gyper::to_vec("ACGTACGTACGTACGTACGTACGTACGTACGTAC"); // Crosses a word
+  std::vector<char> const seq2 = gyper::to_vec("ACNNT");
+  std::vector<char> const seq3 = gyper::to_vec("GGT");
+
+  uint64_t const pos1 = arena.add(seq1);
+  uint64_t const pos2 = arena.add(seq2);
+  uint64_t const pos3 = arena.add(seq3);
+
+  DnaView const view1 = arena.view(pos1, seq1.size());
+  DnaView const view2 = arena.view(pos2, seq2.size());
+  DnaView const view3 = arena.view(pos3, seq3.size());
+
+  REQUIRE(view1 == seq1);
+  REQUIRE(view2 == seq2);
+  REQUIRE(view3 == seq3);
+  REQUIRE(view1 != view3);
+  REQUIRE(view1.to_vector() == seq1);
+  REQUIRE(view1.substr(30, 4) == gyper::to_vec("GTAC"));
+  REQUIRE(view3.substr(1, 2) == gyper::to_vec("GT"));
+  REQUIRE(view3.front() == 'G');
+  REQUIRE(view3.back() == 'T');
+}
+
+
+TEST_CASE("Graphs saved with boost::serialization are converted to flat graph files")
+{
+  using namespace gyper;
+
+  // Written by the serialization code from before flat graph files. It is the graph of ACCGGGAAAA with G>GT at 3 and
+  // A>AT,G at 6, a special position after each insertion and an insertion SV
+  std::stringstream boost_path;
+  boost_path << gyper_SOURCE_DIRECTORY << "/test/data/graphs/baseline_format.grf";
+  std::stringstream flat_path;
+  flat_path << gyper_SOURCE_DIRECTORY << "/test/data/graphs/flat_format_test.grf";
+
+  gyper::convert_graph(boost_path.str(), flat_path.str());
+  gyper::load_graph(flat_path.str());
+
+  REQUIRE(graph.mapping); // The arrays are views of the mapped file
+  REQUIRE(graph.ref_nodes.size() == 3);
+  REQUIRE(graph.var_nodes.size() == 5);
+  REQUIRE(graph.ref_nodes.size_in_bytes() == 0);
+
+  REQUIRE(graph.ref_nodes[0].get_label().order == 0);
+  REQUIRE(graph.ref_nodes[0].get_label().dna == gyper::to_vec("ACC"));
+  REQUIRE(graph.ref_nodes[0].get_vars() == std::vector<TNodeIndex>({0, 1}));
+  REQUIRE(graph.ref_nodes[1].get_label().order == 4);
+  REQUIRE(graph.ref_nodes[1].get_label().dna == gyper::to_vec("GG"));
+  REQUIRE(graph.ref_nodes[1].get_vars() == std::vector<TNodeIndex>({2, 3, 4}));
+  REQUIRE(graph.ref_nodes[2].get_label().order == 7);
+  REQUIRE(graph.ref_nodes[2].get_label().dna == gyper::to_vec("AAA"));
+  REQUIRE(graph.ref_nodes[2].get_vars().size() == 0);
+
+  std::vector<std::vector<char> > const var_dna = {
+    gyper::to_vec("G"), gyper::to_vec("GT"), gyper::to_vec("A"), gyper::to_vec("AT"), gyper::to_vec("G")
+  };
+
+  std::vector<uint32_t> const var_orders = {3, 3, 6, 6, 6};
+  std::vector<uint16_t> const variant_nums = {0, 1, 0, 1, 2};
+  std::vector<TNodeIndex> const out_refs = {1, 1, 2, 2, 2};
+
+  for (std::size_t v = 0; v < graph.var_nodes.size(); ++v)
+  {
+    REQUIRE(graph.var_nodes[v].get_label().order == var_orders[v]);
+    REQUIRE(graph.var_nodes[v].get_label().dna == var_dna[v]);
+    REQUIRE(graph.var_nodes[v].get_label().variant_num == variant_nums[v]);
+    REQUIRE(graph.var_nodes[v].get_out_ref_index() == out_refs[v]);
+  }
+
+  REQUIRE(graph.use_prefix_chr);
+  REQUIRE(!graph.use_absolute_positions);
+  REQUIRE(graph.is_sv_graph);
+  REQUIRE(graph.genomic_region.chr == "chr1");
+  REQUIRE(graph.get_all_ref() == gyper::to_vec("ACCGGGAAAA"));
+
+  // Special positions
+  REQUIRE(graph.ref_reach_to_special_pos.size() == 2);
+  REQUIRE(graph.ref_reach_to_special_pos.count(3) == 1);
+  REQUIRE(graph.ref_reach_to_special_pos.count(4) == 0);
+  REQUIRE(graph.ref_reach_to_special_pos.at(3, 0) == SPECIAL_START);
+  REQUIRE(graph.ref_reach_to_special_pos.at(6, 0) == SPECIAL_START + 1);
+  REQUIRE(graph.get_special_pos(4, 3) == SPECIAL_START);
+  REQUIRE(graph.is_special_pos(SPECIAL_START + 1));
+  REQUIRE(!graph.is_special_pos(SPECIAL_START + 2));
+  REQUIRE(graph.get_ref_reach_pos(SPECIAL_START + 1) == 6);
+  REQUIRE(graph.get_actual_pos(SPECIAL_START + 1) == 7);
+
+  // Structural variants and contigs
+  REQUIRE(graph.SVs.size() == 1);
+  REQUIRE(graph.SVs[0].type == INS);
+  REQUIRE(graph.SVs[0].chrom == "chr1");
+  REQUIRE(graph.SVs[0].begin == 6);
+  REQUIRE(graph.SVs[0].ins_seq == gyper::to_vec("T"));
+  REQUIRE(graph.SVs[0].original_alt == gyper::to_vec("<INS>"));
+  REQUIRE(graph.contigs.size() == 1);
+  REQUIRE(graph.contigs[0].name == "chr1");
+  REQUIRE(graph.contigs[0].length == 10);
+
+  REQUIRE(graph.position_index.size() == graph.ref_nodes.size());
+  REQUIRE(graph.get_locations_of_an_actual_position(graph.ref_nodes.get_order(0)).size() == 1);
+
+  // Changing a node copies the arrays out of the mapped file
+  graph.ref_nodes.change_label_order(0, 1);
+  REQUIRE(graph.ref_nodes[0].get_label().order == 1);
+  REQUIRE(graph.ref_nodes[1].get_label().dna == gyper::to_vec("GG"));
+
+  std::remove(flat_path.str().c_str());
+}
+
+
+TEST_CASE("The position index finds the same reference nodes as a linear search")
+{
+  using namespace gyper;
+
+  // Every shape of the search tree up to five levels
+  for (uint32_t num = 0; num < 40; ++num)
+  {
+    RefNodes ref_nodes;
+
+    for (uint32_t r = 0; r < num; ++r)
+      ref_nodes.push_back(3 * r + 1, gyper::to_vec("ACG"), 0, 0);
+
+    PositionIndex index;
+    index.build(ref_nodes);
+    REQUIRE(index.size() == num);
+
+    for (uint32_t pos = 0; pos < 3 * num + 3; ++pos)
+    {
+      std::size_t r = 0;
+
+      while (r < num && ref_nodes.get_order(r) <= pos)
+        ++r;
+
+      REQUIRE(index.upper_bound(pos) == r);
+    }
+  }
+}
+
+
+TEST_CASE("Special positions are found by their reference reach")
+{
+  using namespace gyper;
+
+  SpecialPositions special_poses;
+  special_poses.add(10, SPECIAL_START);
+  special_poses.add(10, SPECIAL_START + 1);
+  special_poses.add(30, SPECIAL_START + 2);
+  special_poses.add(20, SPECIAL_START + 3); // Out of order
+  special_poses.add(10, SPECIAL_START + 4);
+
+  REQUIRE(std::vector<uint32_t>(special_poses.begin(), special_poses.end()) == std::vector<uint32_t>({10, 20, 30}));
+  REQUIRE(special_poses.count(10) == 1);
+  REQUIRE(special_poses.count(15) == 0);
+  REQUIRE(special_poses.count(31) == 0);
+  REQUIRE(special_poses.at(10, 0) == SPECIAL_START);
+  REQUIRE(special_poses.at(10, 1) == SPECIAL_START + 1);
+  REQUIRE(special_poses.at(10, 2) == SPECIAL_START + 4);
+  REQUIRE(special_poses.at(20, 0) == SPECIAL_START + 3);
+  REQUIRE(special_poses.at(30, 0) == SPECIAL_START + 2);
+  REQUIRE_THROWS_AS(special_poses.at(20, 1), std::out_of_range);
+  REQUIRE_THROWS_AS(special_poses.at(15, 0), std::out_of_range);
+}
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <vector>
+
+#include <graphtyper/constants.hpp>
+#include <graphtyper/graph/graph.hpp>
+#include <graphtyper/graph/label.hpp>
+#include <graphtyper/index/kmer_label.hpp>
+
+
+// The indexer as it was before it kept its state in ring buffers with inline variant IDs. It copies lists of k-mers at
+// every bubble and allocates for every base, but is simple enough to serve as a reference for the index content.
+namespace reference_indexer
+{
+
+class IndexEntry
+{
+public:
+  uint64_t dna = 0u;
+  uint32_t start_index = 0u;
+  std::vector<uint32_t> variant_id;
+  uint32_t total_var_num = 1u;
+  uint32_t total_var_count = 0u;
+  uint8_t valid = 0u;
+
+  IndexEntry(uint32_t const s)
+    : start_index(s)
+  {}
+
+  IndexEntry(uint32_t const s, uint32_t const i, bool const is_reference, unsigned const var_num)
+    : start_index(s), variant_id(1, i), total_var_num(var_num), total_var_count(static_cast<uint32_t>(!is_reference))
+  {}
+
+  void
+  add_to_dna(char const base)
+  {
+    dna <<= 2;
+
+    if (valid > 0)
+    {
+      --valid;
+    }
+    else
+    {
+      switch(base)
+      {
+      case 'A': break;
+      case 'C': dna += 1; break;
+      case 'G': dna += 2; break;
+      case 'T': dna += 3; break;
+      default: valid = static_cast<uint8_t>(gyper::K); break;
+      }
+    }
+  }
+};
+
+
+using TEntrySublist = std::deque<IndexEntry>;
+using TEntryList = std::deque<TEntrySublist>;
+
+
+inline bool
+entry_has_too_many_nonrefs(IndexEntry const & entry)
+{
+  uint32_t const MAX_TOTAL_VAR_NUM = 401u;
+  uint32_t const MAX_TOTAL_VAR_COUNT = 4u;
+  return entry.total_var_count > 1 &&
+         (entry.total_var_num > MAX_TOTAL_VAR_NUM || entry.total_var_count > MAX_TOTAL_VAR_COUNT);
+}
+
+
+template <typename TIndex>
+void
+index_reference_label(TIndex & new_index, TEntryList & mers, gyper::Label const & label)
+{
+  for (unsigned d = 0; d < label.dna.size(); ++d)
+  {
+    if (label.dna[d] == 'N')
+    {
+      mers.clear();
+      continue;
+    }
+
+    for (auto list_it = mers.begin(); list_it != mers.end(); ++list_it)
+    {
+      for (auto sublist_it = list_it->begin(); sublist_it != list_it->end(); ++sublist_it)
+        sublist_it->add_to_dna(label.dna[d]);
+    }
+
+    {
+      IndexEntry index_entry(label.order + d);
+      index_entry.add_to_dna(label.dna[d]);
+      mers.push_front(TEntrySublist(1, index_entry));
+    }
+
+    if (mers.size() >= gyper::K)
+    {
+      for (auto q_it = mers.back().begin(); q_it != mers.back().end(); ++q_it)
+      {
+        if (q_it->valid > 0)
+          continue;
+
+        if (q_it->variant_id.size() == 0)
+        {
+          new_index.put(q_it->dna, gyper::KmerLabel(q_it->start_index, label.order + d));
+        }
+        else
+        {
+          std::vector<gyper::KmerLabel> new_labels;
+
+          for (unsigned i = 0; i < q_it->variant_id.size(); ++i)
+            new_labels.push_back(gyper::KmerLabel(q_it->start_index, label.order + d, q_it->variant_id[i]));
+
+          new_index.put(q_it->dna, std::move(new_labels));
+        }
+      }
+
+      mers.pop_back();
+    }
+  }
+}
+
+
+template <typename TIndex>
+void
+insert_variant_label(TIndex & new_index,
+                     TEntryList & mers,
+                     gyper::Label const & label,
+                     gyper::TNodeIndex const v,
+                     bool const is_reference,
+                     unsigned const var_count,
+                     std::size_t const ref_reach
+                     )
+{
+  for (unsigned d = 0; d < label.dna.size(); ++d)
+  {
+    for (auto sublist_it = mers.begin(); sublist_it != mers.end(); ++sublist_it)
+    {
+      for (auto entry_it = sublist_it->begin(); entry_it != sublist_it->end(); ++entry_it)
+      {
+        entry_it->add_to_dna(label.dna[d]);
+
+        if (std::find(entry_it->variant_id.begin(), entry_it->variant_id.end(), v) == entry_it->variant_id.end())
+          entry_it->variant_id.push_back(static_cast<unsigned>(v));
+      }
+    }
+
+    uint32_t pos = label.order + d;
+
+    if (pos > ref_reach)
+      pos = gyper::graph.get_special_pos(pos, static_cast<uint32_t>(ref_reach));
+
+    IndexEntry new_index_entry(pos, static_cast<uint32_t>(v), is_reference, var_count);
+    new_index_entry.add_to_dna(label.dna[d]);
+    mers.push_front(TEntrySublist(1, new_index_entry));
+
+    if (mers.size() >= gyper::K)
+    {
+      for (auto q_it = mers.back().begin(); q_it != mers.back().end(); ++q_it)
+      {
+        if (q_it->valid > 0)
+          continue;
+
+        std::vector<gyper::KmerLabel> new_labels;
+
+        for (unsigned i = 0; i < q_it->variant_id.size(); ++i)
+          new_labels.push_back(gyper::KmerLabel(q_it->start_index, pos, q_it->variant_id[i]));
+
+        new_index.put(q_it->dna, std::move(new_labels));
+      }
+
+      mers.pop_back();
+    }
+  }
+}
+
+
+inline void
+append_list(TEntryList & mers, TEntryList && list)
+{
+  if (mers.size() < list.size())
+    mers.resize(list.size());
+
+  auto mer_it = mers.begin();
+
+  for (auto list_it = list.begin(); list_it != list.end(); ++list_it, ++mer_it)
+    std::move(list_it->begin(), list_it->end(), std::back_inserter(*mer_it));
+}
+
+
+inline void
+remove_large_variants_from_list(TEntryList & list, unsigned const var_count)
+{
+  for (auto sublist_it = list.begin(); sublist_it != list.end(); ++sublist_it)
+  {
+    for (auto entry_it = sublist_it->begin(); entry_it != sublist_it->end(); ++entry_it)
+    {
+      entry_it->total_var_num *= var_count;
+      ++entry_it->total_var_count;
+    }
+
+    sublist_it->erase(std::remove_if(sublist_it->begin(), sublist_it->end(), entry_has_too_many_nonrefs),
+                      sublist_it->end());
+  }
+}
+
+
+template <typename TIndex>
+void
+index_variant(TIndex & new_index,
+              gyper::TVarNodes const & var_nodes,
+              TEntryList & mers,
+              unsigned var_count,
+              gyper::TNodeIndex v
+              )
+{
+  TEntryList clean_list(mers);
+  std::size_t const ref_label_reach = var_nodes[v].get_label().reach();
+  insert_variant_label(new_index, mers, var_nodes[v].get_label(), v, true /*is reference*/, 1, ref_label_reach);
+  remove_large_variants_from_list(clean_list, var_count);
+  unsigned const var_num = var_count;
+
+  while (var_count > 2)
+  {
+    --var_count;
+    ++v;
+    TEntryList new_list(clean_list);
+    insert_variant_label(new_index, new_list, var_nodes[v].get_label(), v, false, var_num, ref_label_reach);
+    append_list(mers, std::move(new_list));
+  }
+
+  ++v;
+  insert_variant_label(new_index, clean_list, var_nodes[v].get_label(), v, false, var_num, ref_label_reach);
+  append_list(mers, std::move(clean_list));
+}
+
+
+/** \brief Indexes the global graph into 'new_index' in a single pass over the reference nodes. */
+template <typename TIndex>
+void
+index_graph(TIndex & new_index)
+{
+  TEntryList mers;
+  auto const & ref_nodes = gyper::graph.ref_nodes;
+
+  for (std::size_t r = 0; r + 1 < ref_nodes.size(); ++r)
+  {
+    index_reference_label(new_index, mers, ref_nodes[r].get_label());
+
+    if (ref_nodes[r].out_degree() > 0)
+    {
+      index_variant(new_index,
+                    gyper::graph.var_nodes,
+                    mers,
+                    static_cast<unsigned>(ref_nodes[r].out_degree()),
+                    ref_nodes[r].get_var_index(0));
+    }
+  }
+
+  index_reference_label(new_index, mers, ref_nodes.back().get_label());
+}
+
+
+} // namespace reference_indexer
@@ -1,18 +1,38 @@
 #include <catch.hpp>
 
 #include <stdio.h>
+#include <algorithm>
+#include <array>
 #include <climits>
 #include <cstdio>
+#include <cstring>
 #include <string>
 #include <iostream>
+#include <iterator>
 #include <fstream>
+#include <random>
+#include <thread>
+#include <unordered_set>
 
+#include <sys/stat.h>
+
+#include <graphtyper/graph/absolute_position.hpp>
 #include <graphtyper/graph/graph_serialization.hpp>
 #include <graphtyper/graph/constructor.hpp>
+#include <graphtyper/graph/var_record.hpp>
+#include <graphtyper/index/hamming1_index.hpp>
 #include <graphtyper/index/indexer.hpp>
+#include <graphtyper/index/kmer_label_cache.hpp>
+#include <graphtyper/index/mem_index.hpp>
 #include <graphtyper/index/rocksdb.hpp>
+#include <graphtyper/index/shared_index.hpp>
+#include <graphtyper/index/sorted_run_writer.hpp>
+#include <graphtyper/utilities/numa.hpp>
+#include <graphtyper/utilities/options.hpp>
 #include <graphtyper/utilities/type_conversions.hpp>
 
+#include "reference_indexer.hpp"
+
 
 TEST_CASE("Test index chr1")
 {
@@ -223,6 +243,930 @@ TEST_CASE("Test index chr3")
   }
 }
 
+TEST_CASE("In-memory index built from the graph is the same as the one loaded from RocksDB")
+{
+  using namespace gyper;
+
+  std::stringstream my_graph;
+  my_graph << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr2.grf";
+  std::stringstream my_index;
+  my_index << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr2";
+
+  gyper::index_graph(my_graph.str(), my_index.str());
+  REQUIRE(graph.size() > 0);
+  gyper::load_index(my_index.str());
+
+  MemIndex rocksdb_mem_index;
+  rocksdb_mem_index.load(gyper::index);
+  gyper::index.close();
+
+  MemIndex graph_mem_index;
+  gyper::index_graph(graph_mem_index);
+
+  REQUIRE(rocksdb_mem_index.hamming0.size() > 0);
+  REQUIRE(rocksdb_mem_index.hamming0.size() == graph_mem_index.hamming0.size());
+  REQUIRE(graph_mem_index.buffer_map.size() == 0);
+
+  rocksdb_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const & labels)
+    {
+      FlatKmerMap<PackedKmerLabel>::Range const find_range = graph_mem_index.hamming0.find(key);
+      REQUIRE(std::vector<PackedKmerLabel>(find_range.begin(), find_range.end()) ==
+              std::vector<PackedKmerLabel>(labels.begin(), labels.end()));
+    });
+}
+
+
+TEST_CASE("Hamming distance 1 index finds the same neighbours as probing every neighbour")
+{
+  using namespace gyper;
+
+  std::mt19937_64 rng(7);
+  std::vector<TKmerKey> keys;
+
+  // Random keys, which mostly land in small buckets
+  for (int i = 0; i < 2000; ++i)
+    keys.push_back(rng());
+
+  // Neighbours of a few keys, in both halves
+  for (int i = 0; i < 200; ++i)
+    keys.push_back(keys[i] ^ ((1ull + rng() % 3) << (2 * (rng() % 32))));
+
+  // Many keys sharing their first half, which are probed instead of scanned
+  for (int i = 0; i < 200; ++i)
+    keys.push_back(0xAAAAAAAA00000000ull | (keys[i] & 0xFFFFFFFFull));
+
+  for (uint64_t bb = 0; bb < 16; ++bb)
+    keys.push_back(0xAAAAAAAA00000000ull ^ (2ull << (2 * bb)));
+
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  std::unordered_set<TKmerKey, KmerKeyHash> const key_set(keys.begin(), keys.end());
+
+  Hamming1Index hamming1;
+  hamming1.build(std::vector<TKmerKey>(keys));
+  REQUIRE(hamming1.size() == keys.size());
+
+  std::vector<TKmerKey> queries(keys);
+  queries.push_back(0xAAAAAAAA00000000ull);
+
+  for (int i = 0; i < 1000; ++i)
+    queries.push_back(rng());
+
+  for (auto const query : queries)
+  {
+    THamming1Keys const all_neighbours = to_uint64_vec_hamming_distance_1(query);
+    std::vector<TKmerKey> expected;
+
+    for (auto const neighbour : all_neighbours)
+    {
+      if (key_set.count(neighbour) > 0)
+        expected.push_back(neighbour);
+    }
+
+    std::vector<TKmerKey> neighbours;
+    hamming1.find_neighbours(query, neighbours);
+    REQUIRE(neighbours == expected);
+  }
+}
+
+
+TEST_CASE("Hamming distance 1 labels from the index are the same as without the index")
+{
+  using namespace gyper;
+
+  std::stringstream my_graph;
+  my_graph << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr2.grf";
+  gyper::load_graph(my_graph.str().c_str());
+  REQUIRE(graph.size() > 0);
+
+  MemIndex test_mem_index;
+  gyper::index_graph(test_mem_index);
+  test_mem_index.generate_hamming1_index();
+  REQUIRE(test_mem_index.hamming1.size() == test_mem_index.hamming0.size() + test_mem_index.repeats.size());
+
+  // Query every indexed k-mer and a k-mer with one mismatch to it
+  std::vector<std::vector<TKmerKey> > keys;
+
+  test_mem_index.hamming0.for_each([&keys](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const &)
+    {
+      keys.push_back({key});
+      keys.push_back({key ^ 0x0000000000000100ull});
+    });
+
+  std::vector<std::vector<TKmerKey> > expanded_keys;
+
+  for (auto const & seed : keys)
+  {
+    THamming1Keys const hamming1_keys = to_uint64_vec_hamming_distance_1(seed[0]);
+    expanded_keys.push_back(std::vector<TKmerKey>(hamming1_keys.begin(), hamming1_keys.end()));
+  }
+
+  REQUIRE(test_mem_index.multi_get_hamming1(keys) == test_mem_index.multi_get(expanded_keys));
+}
+
+
+TEST_CASE("K-mer filter has no false negatives and counts lookups")
+{
+  using namespace gyper;
+
+  std::stringstream my_graph;
+  my_graph << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr2.grf";
+  gyper::load_graph(my_graph.str().c_str());
+  REQUIRE(graph.size() > 0);
+
+  MemIndex test_mem_index;
+  gyper::index_graph(test_mem_index);
+  REQUIRE(!test_mem_index.filter.empty());
+
+  std::vector<std::vector<TKmerKey> > keys;
+
+  test_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const &)
+    {
+      REQUIRE(test_mem_index.filter.may_contain(key));
+      keys.push_back({key});
+    });
+
+  uint64_t const num_keys = keys.size();
+  std::mt19937_64 rng(11);
+  uint64_t num_absent = 0;
+
+  while (num_absent < 1000)
+  {
+    TKmerKey const key = rng();
+
+    if (test_mem_index.hamming0.find(key).empty())
+    {
+      keys.push_back({key});
+      ++num_absent;
+    }
+  }
+
+  test_mem_index.multi_get(keys);
+  KmerFilterStats const & stats = test_mem_index.filter_stats;
+  REQUIRE(stats.hits.load() == num_keys);
+  REQUIRE(stats.filtered.load() + stats.false_positives.load() == num_absent);
+  REQUIRE(stats.filtered.load() > stats.false_positives.load());
+}
+
+
+TEST_CASE("Batched lookups give the same labels as looking up each key")
+{
+  using namespace gyper;
+
+  std::stringstream my_graph;
+  my_graph << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr2.grf";
+  gyper::load_graph(my_graph.str().c_str());
+  REQUIRE(graph.size() > 0);
+
+  MemIndex test_mem_index;
+  gyper::index_graph(test_mem_index);
+
+  // Seeds of up to three keys, some of which are not in the index
+  std::vector<TKmerKey> all_keys;
+
+  test_mem_index.hamming0.for_each([&all_keys](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const &)
+    {
+      all_keys.push_back(key);
+      all_keys.push_back(~key);
+    });
+
+  std::vector<std::vector<TKmerKey> > keys;
+
+  for (std::size_t i = 0; i < all_keys.size(); i += 3)
+    keys.push_back(std::vector<TKmerKey>(all_keys.begin() + i, all_keys.begin() + std::min(i + 3, all_keys.size())));
+
+  TPackedKmerLabels expected_labels(keys.size());
+
+  for (std::size_t i = 0; i < keys.size(); ++i)
+  {
+    bool is_masked = false;
+
+    for (auto const key : keys[i])
+    {
+      FlatKmerMap<PackedKmerLabel>::Range const find_range = test_mem_index.hamming0.find(key);
+      expected_labels[i].insert(expected_labels[i].end(), find_range.begin(), find_range.end());
+      is_masked |= !test_mem_index.repeats.find(key).empty();
+    }
+
+    if (is_masked || expected_labels[i].size() > Options::const_instance()->max_index_labels)
+      expected_labels[i].clear();
+  }
+
+  REQUIRE(test_mem_index.multi_get(keys) == expected_labels);
+  REQUIRE(test_mem_index.get(keys[0]) == expected_labels[0]);
+}
+
+
+TEST_CASE("Masking repeated k-mers gives the same labels and keeps their multiplicity")
+{
+  using namespace gyper;
+  std::mt19937 rng(18);
+  char const * BASES = "ACGT";
+
+  // A unit repeated 60 times in the middle, so its k-mers have more than max_index_labels labels
+  std::vector<char> reference(6000);
+  std::vector<char> unit(40);
+
+  for (auto & base : unit)
+    base = BASES[rng() % 4];
+
+  for (std::size_t i = 0; i < reference.size(); ++i)
+    reference[i] = i >= 2000 && i < 2000 + 60 * unit.size() ? unit[i % unit.size()] : BASES[rng() % 4];
+
+  std::vector<VarRecord> records;
+  records.emplace_back(1000, std::vector<char>(1, reference[1000]),
+                       std::vector<std::vector<char> >(1, std::vector<char>(1, reference[1000] == 'A' ? 'C' : 'A')));
+
+  graph = Graph();
+  Contig contig;
+  contig.name = "chr1";
+  contig.length = 100000;
+  graph.contigs.push_back(contig);
+  absolute_pos.calculate_offsets(graph);
+  graph.add_genomic_region(std::vector<char>(reference), std::move(records), GenomicRegion("chr1:1-6000"));
+  graph.create_special_positions();
+  graph.generate_reference_genome();
+
+  MemIndex full_mem_index;
+  gyper::index_graph(full_mem_index, false /*mask_repeats*/);
+  MemIndex masked_mem_index;
+  gyper::index_graph(masked_mem_index);
+
+  REQUIRE(full_mem_index.repeats.size() == 0);
+  REQUIRE(full_mem_index.repeat_threshold == 0);
+  REQUIRE(masked_mem_index.repeats.size() > 0);
+  REQUIRE(masked_mem_index.repeat_threshold == Options::const_instance()->max_index_labels);
+  REQUIRE(masked_mem_index.hamming0.size() + masked_mem_index.repeats.size() == full_mem_index.hamming0.size());
+  REQUIRE(masked_mem_index.hamming0.num_values() < full_mem_index.hamming0.num_values());
+
+  // The statistics count the masked keys with all of their labels
+  KmerMultiplicityStats const full_stats = full_mem_index.get_multiplicity_stats();
+  KmerMultiplicityStats const masked_stats = masked_mem_index.get_multiplicity_stats();
+  REQUIRE(masked_stats.num_keys == full_stats.num_keys);
+  REQUIRE(masked_stats.num_labels == full_stats.num_labels);
+  REQUIRE(masked_stats.histogram == full_stats.histogram);
+  REQUIRE(masked_stats.max_multiplicity > Options::const_instance()->max_index_labels);
+  REQUIRE(masked_stats.num_repeat_keys == masked_mem_index.repeats.size());
+  REQUIRE(full_stats.num_repeat_keys == 0);
+
+  // Every key alone, with a mismatch and in pairs gives the same labels
+  std::vector<std::vector<TKmerKey> > keys;
+  TKmerKey previous_key = 0;
+
+  full_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const &)
+    {
+      keys.push_back({key});
+      keys.push_back({key ^ 0x0000000000000100ull});
+      keys.push_back({previous_key, key});
+      previous_key = key;
+    });
+
+  REQUIRE(masked_mem_index.multi_get(keys) == full_mem_index.multi_get(keys));
+  REQUIRE(masked_mem_index.multi_get_hamming1(keys) == full_mem_index.multi_get_hamming1(keys));
+
+  // Masking a committed index in place gives the same tables as masking while committing
+  MemIndex in_place_mem_index(full_mem_index);
+  in_place_mem_index.mask_repeats();
+  REQUIRE(in_place_mem_index.hamming0.size() == masked_mem_index.hamming0.size());
+  REQUIRE(in_place_mem_index.hamming0.num_values() == masked_mem_index.hamming0.num_values());
+  REQUIRE(in_place_mem_index.repeats.size() == masked_mem_index.repeats.size());
+  REQUIRE(in_place_mem_index.repeat_threshold == masked_mem_index.repeat_threshold);
+  REQUIRE(in_place_mem_index.get_multiplicity_stats().histogram == masked_stats.histogram);
+  REQUIRE(in_place_mem_index.multi_get(keys) == masked_mem_index.multi_get(keys));
+  REQUIRE(in_place_mem_index.multi_get_hamming1(keys) == masked_mem_index.multi_get_hamming1(keys));
+  REQUIRE(full_mem_index.repeats.size() == 0); // The copy was masked, not the original
+
+  masked_mem_index.generate_hamming1_index();
+  full_mem_index.generate_hamming1_index();
+  REQUIRE(masked_mem_index.multi_get_hamming1(keys) == full_mem_index.multi_get_hamming1(keys));
+
+  // The repeats are kept in the flat index file
+  std::stringstream flat_path;
+  flat_path << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_repeats.gti";
+  masked_mem_index.save(flat_path.str());
+  MemIndex mapped_mem_index;
+  REQUIRE(mapped_mem_index.map(flat_path.str(), true /*verify_payload*/));
+  REQUIRE(mapped_mem_index.repeats.size() == masked_mem_index.repeats.size());
+  REQUIRE(mapped_mem_index.repeat_threshold == masked_mem_index.repeat_threshold);
+  REQUIRE(mapped_mem_index.multi_get(keys) == full_mem_index.multi_get(keys));
+  std::remove(flat_path.str().c_str());
+
+  // Committing more labels keeps the masked keys masked and adds to their multiplicity
+  uint64_t repeat_multiplicity = 0;
+
+  masked_mem_index.repeats.for_each([&](TKmerKey const key, FlatKmerMap<uint32_t>::Range const & multiplicity)
+    {
+      if (repeat_multiplicity == 0)
+      {
+        masked_mem_index.put(key, KmerLabel(1, 32, INVALID_ID));
+        repeat_multiplicity = *multiplicity.begin();
+      }
+    });
+
+  masked_mem_index.commit();
+  REQUIRE(masked_mem_index.get_multiplicity_stats().num_repeat_labels == masked_stats.num_repeat_labels + 1);
+  REQUIRE(masked_mem_index.get_multiplicity_stats().num_repeat_keys == masked_stats.num_repeat_keys);
+  REQUIRE(repeat_multiplicity > Options::const_instance()->max_index_labels);
+
+  graph = Graph();
+}
+
+
+TEST_CASE("Indexing the graph in partitions on many threads gives the same index as indexing it serially")
+{
+  using namespace gyper;
+  int const old_threads = Options::const_instance()->threads;
+
+  for (std::string const chr : {"chr1", "chr2", "chr3"})
+  {
+    std::stringstream my_graph;
+    my_graph << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_" << chr << ".grf";
+    gyper::load_graph(my_graph.str().c_str());
+    REQUIRE(graph.size() > 0);
+
+    Options::instance()->threads = 1;
+    MemIndex serial_mem_index;
+    gyper::index_graph(serial_mem_index);
+    REQUIRE(serial_mem_index.hamming0.size() > 0);
+
+    for (int const threads : {2, 3, 8})
+    {
+      Options::instance()->threads = threads;
+      MemIndex partitioned_mem_index;
+      gyper::index_graph(partitioned_mem_index);
+      REQUIRE(partitioned_mem_index.hamming0.size() == serial_mem_index.hamming0.size());
+
+      serial_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const & labels)
+        {
+          FlatKmerMap<PackedKmerLabel>::Range const find_range = partitioned_mem_index.hamming0.find(key);
+          REQUIRE(std::vector<PackedKmerLabel>(find_range.begin(), find_range.end()) ==
+                  std::vector<PackedKmerLabel>(labels.begin(), labels.end()));
+        });
+    }
+  }
+
+  Options::instance()->threads = old_threads;
+}
+
+
+TEST_CASE("An incrementally updated index is the same as indexing the changed graph from scratch")
+{
+  using namespace gyper;
+  int const old_threads = Options::const_instance()->threads;
+  std::mt19937 rng(15);
+  char const * BASES = "ACGT";
+
+  std::vector<char> reference(20000);
+
+  for (auto & base : reference)
+    base = BASES[rng() % 4];
+
+  std::vector<VarRecord> all_records;
+
+  for (uint32_t pos = 10 + rng() % 150; pos + 40 < reference.size(); pos += 1 + rng() % 150)
+  {
+    std::vector<char> ref(reference.begin() + pos, reference.begin() + pos + 1 + (rng() % 4 == 0 ? rng() % 20 : 0));
+    std::vector<std::vector<char> > alts;
+
+    for (long a = 1 + rng() % 3; a > 0; --a)
+    {
+      std::vector<char> alt(1, ref[0]);
+
+      for (long j = rng() % 4 == 0 ? rng() % 30 : 0; j > 0; --j)
+        alt.push_back(BASES[rng() % 4]);
+
+      if (alt == ref)
+        alt.push_back('A');
+
+      alts.push_back(std::move(alt));
+    }
+
+    pos += static_cast<uint32_t>(ref.size());
+    all_records.emplace_back(pos - static_cast<uint32_t>(ref.size()), std::move(ref), std::move(alts));
+  }
+
+  std::vector<bool> is_used(all_records.size());
+  IncrementalIndexer incremental_indexer;
+  Graph old_graph;
+
+  for (int i = 0; i < 4; ++i)
+  {
+    // Add or remove about a tenth of the variants in each iteration
+    for (std::size_t v = 0; v < is_used.size(); ++v)
+      is_used[v] = i == 0 ? rng() % 2 == 0 : (rng() % 10 == 0) != is_used[v];
+
+    std::vector<VarRecord> records;
+
+    for (std::size_t v = 0; v < is_used.size(); ++v)
+    {
+      if (is_used[v])
+        records.push_back(all_records[v]);
+    }
+
+    graph = Graph();
+    Contig contig;
+    contig.name = "chr1";
+    contig.length = 100000;
+    graph.contigs.push_back(contig);
+    absolute_pos.calculate_offsets(graph);
+    graph.add_genomic_region(std::vector<char>(reference), std::move(records), GenomicRegion("chr1:1-20000"));
+    graph.create_special_positions();
+    graph.generate_reference_genome();
+
+    Options::instance()->threads = 1 + i % 3;
+    MemIndex expected_mem_index;
+    gyper::index_graph(expected_mem_index);
+
+    MemIndex test_mem_index;
+
+    if (i == 0)
+    {
+      incremental_indexer.index(test_mem_index);
+      REQUIRE(incremental_indexer.get_num_indexed_segments() == incremental_indexer.get_num_segments());
+    }
+    else
+    {
+      incremental_indexer.update(test_mem_index, old_graph);
+      REQUIRE(incremental_indexer.get_num_indexed_segments() > 0);
+      REQUIRE(incremental_indexer.get_num_indexed_segments() < incremental_indexer.get_num_segments() / 2);
+    }
+
+    REQUIRE(test_mem_index.hamming0.size() > 0);
+    REQUIRE(test_mem_index.hamming0.size() == expected_mem_index.hamming0.size());
+
+    expected_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const & labels)
+      {
+        FlatKmerMap<PackedKmerLabel>::Range const find_range = test_mem_index.hamming0.find(key);
+        REQUIRE(std::vector<PackedKmerLabel>(find_range.begin(), find_range.end()) ==
+                std::vector<PackedKmerLabel>(labels.begin(), labels.end()));
+      });
+
+    old_graph = std::move(graph);
+  }
+
+  graph = Graph();
+  Options::instance()->threads = old_threads;
+}
+
+
+TEST_CASE("Sorted runs give the labels of each key in the order they were put")
+{
+  using namespace gyper;
+
+  std::stringstream run_prefix;
+  run_prefix << gyper_SOURCE_DIRECTORY << "/test/data/graphs/test_sorted_runs";
+
+  std::mt19937_64 rng(42);
+  std::unordered_map<TKmerKey, std::vector<KmerLabel>, KmerKeyHash> expected_labels;
+  SortedRunWriter runs(run_prefix.str(), 100 * sizeof(SortedRunWriter::Record));
+
+  for (uint32_t i = 0; i < 1000; ++i)
+  {
+    TKmerKey const key = rng() % 300;
+    expected_labels[key].push_back(KmerLabel(i, i + 31, i % 7 == 0 ? INVALID_ID : i));
+    runs.put(key, KmerLabel(i, i + 31, i % 7 == 0 ? INVALID_ID : i));
+  }
+
+  REQUIRE(runs.get_num_runs() == 9);
+  REQUIRE(runs.get_num_labels() == 1000);
+
+  std::vector<TKmerKey> keys;
+
+  runs.merge([&](TKmerKey const key, std::vector<KmerLabel> & labels)
+    {
+      keys.push_back(key);
+      REQUIRE(labels == expected_labels[key]);
+    });
+
+  REQUIRE(keys.size() == expected_labels.size());
+  REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+  REQUIRE(runs.get_num_runs() == 0);
+}
+
+
+TEST_CASE("An index written through sorted runs is the same as one buffered in memory")
+{
+  using namespace gyper;
+
+  std::stringstream my_graph;
+  my_graph << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr3.grf";
+  std::stringstream my_index;
+  my_index << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr3";
+
+  gyper::index_graph(my_graph.str(), my_index.str());
+  MemIndex expected_mem_index;
+  gyper::index_graph(expected_mem_index); // Buffered in memory
+
+  // The smallest limit still fits the test graph in one run, so it is written through the in-memory merge
+  long const old_max_index_memory = Options::const_instance()->max_index_memory;
+  Options::instance()->max_index_memory = 1;
+  gyper::index_graph(my_graph.str(), my_index.str());
+  Options::instance()->max_index_memory = old_max_index_memory;
+
+  gyper::load_index(my_index.str());
+  MemIndex test_mem_index;
+  test_mem_index.load(gyper::index);
+  gyper::index.close();
+
+  REQUIRE(test_mem_index.hamming0.size() > 0);
+  REQUIRE(test_mem_index.hamming0.size() == expected_mem_index.hamming0.size());
+
+  expected_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const & labels)
+    {
+      FlatKmerMap<PackedKmerLabel>::Range const find_range = test_mem_index.hamming0.find(key);
+      REQUIRE(std::vector<PackedKmerLabel>(find_range.begin(), find_range.end()) ==
+              std::vector<PackedKmerLabel>(labels.begin(), labels.end()));
+    });
+}
+
+
+TEST_CASE("A bulk loaded index is the same as one written through merges")
+{
+  using namespace gyper;
+
+  // The database order of keys is the bytewise order of their bytes
+  std::mt19937_64 rng(14);
+  std::vector<TKmerKey> keys(1000);
+
+  for (auto & key : keys)
+    key = rng();
+
+  std::sort(keys.begin(), keys.end(), [](TKmerKey const a, TKmerKey const b)
+    {
+      return to_db_key_order(a) < to_db_key_order(b);
+    });
+
+  for (std::size_t i = 1; i < keys.size(); ++i)
+  {
+    REQUIRE(memcmp(&keys[i - 1], &keys[i], sizeof(TKmerKey)) < 0);
+    REQUIRE(to_db_key_order(to_db_key_order(keys[i])) == keys[i]);
+  }
+
+  std::stringstream my_graph;
+  my_graph << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr3.grf";
+  std::stringstream my_index;
+  my_index << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr3";
+
+  gyper::index_graph(my_graph.str(), my_index.str());
+  gyper::load_index(my_index.str());
+  MemIndex test_mem_index;
+  test_mem_index.load(gyper::index);
+  gyper::index.close();
+
+  MemIndex graph_mem_index;
+  gyper::index_graph(graph_mem_index);
+  MemIndex expected_mem_index;
+
+  {
+    Index<RocksDB> merged_index(my_index.str() + "_merged", true /*clear_first*/, false /*read_only*/);
+
+    graph_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const & labels)
+      {
+        std::vector<KmerLabel> key_labels;
+
+        for (auto const & label : labels)
+          key_labels.push_back(KmerLabel(label.start_index, label.end_index, label.variant_id));
+
+        merged_index.put(key, std::move(key_labels));
+      });
+
+    merged_index.commit();
+    expected_mem_index.load(merged_index);
+  }
+
+  REQUIRE(test_mem_index.hamming0.size() > 0);
+  REQUIRE(test_mem_index.hamming0.size() == expected_mem_index.hamming0.size());
+
+  expected_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const & labels)
+    {
+      FlatKmerMap<PackedKmerLabel>::Range const find_range = test_mem_index.hamming0.find(key);
+      REQUIRE(std::vector<PackedKmerLabel>(find_range.begin(), find_range.end()) ==
+              std::vector<PackedKmerLabel>(labels.begin(), labels.end()));
+    });
+}
+
+
+TEST_CASE("A mapped flat index file gives the same labels as the RocksDB index")
+{
+  using namespace gyper;
+
+  std::stringstream my_graph;
+  my_graph << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr3.grf";
+  std::stringstream my_index;
+  my_index << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr3_flat";
+
+  // The flat index file is only written when it is asked for
+  gyper::index_graph(my_graph.str(), my_index.str());
+  REQUIRE(!MemIndex().map(get_flat_index_path(my_index.str())));
+
+  // It is built from the sorted runs as they are merged
+  long const old_max_index_memory = Options::const_instance()->max_index_memory;
+  Options::instance()->max_index_memory = 1;
+  Options::instance()->flat_index = true;
+  gyper::index_graph(my_graph.str(), my_index.str());
+  Options::instance()->flat_index = false;
+  Options::instance()->max_index_memory = old_max_index_memory;
+
+  gyper::load_index(my_index.str());
+  MemIndex expected_mem_index;
+  expected_mem_index.load(gyper::index);
+  gyper::index.close();
+
+  MemIndex test_mem_index;
+  REQUIRE(test_mem_index.map(get_flat_index_path(my_index.str()), true /*verify_payload*/));
+  REQUIRE(test_mem_index.repeats.size() == expected_mem_index.repeats.size());
+  REQUIRE(test_mem_index.mapping);
+  REQUIRE(test_mem_index.hamming0.size() > 0);
+  REQUIRE(test_mem_index.hamming0.size() == expected_mem_index.hamming0.size());
+
+  std::vector<std::vector<TKmerKey> > keys;
+
+  expected_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const & labels)
+    {
+      FlatKmerMap<PackedKmerLabel>::Range const find_range = test_mem_index.hamming0.find(key);
+      REQUIRE(std::vector<PackedKmerLabel>(find_range.begin(), find_range.end()) ==
+              std::vector<PackedKmerLabel>(labels.begin(), labels.end()));
+      keys.push_back(std::vector<TKmerKey>(1, key));
+      keys.push_back(std::vector<TKmerKey>(1, ~key));
+    });
+
+  REQUIRE(test_mem_index.multi_get(keys) == expected_mem_index.multi_get(keys));
+
+  // A copy shares the mapping and stays valid after the original is gone
+  MemIndex copied_mem_index(test_mem_index);
+  test_mem_index = MemIndex();
+  REQUIRE(copied_mem_index.multi_get(keys) == expected_mem_index.multi_get(keys));
+
+  // Flip a byte in the middle of the table, only the payload checksum notices it
+  std::stringstream corrupt_path;
+  corrupt_path << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr3_corrupt.gti";
+
+  {
+    std::ifstream in(get_flat_index_path(my_index.str()), std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    content[content.size() / 2] = static_cast<char>(content[content.size() / 2] ^ 0x01);
+    std::ofstream out(corrupt_path.str(), std::ios::binary);
+    out << content;
+  }
+
+  MemIndex corrupt_mem_index;
+  REQUIRE(corrupt_mem_index.map(corrupt_path.str(), false));
+  REQUIRE(!corrupt_mem_index.map(corrupt_path.str(), true));
+  REQUIRE(!corrupt_mem_index.map(my_index.str() + "/does_not_exist.gti"));
+  std::remove(corrupt_path.str().c_str());
+}
+
+
+TEST_CASE("Processes share a published graph and index until the last one detaches")
+{
+  using namespace gyper;
+
+  std::stringstream my_graph;
+  my_graph << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr3.grf";
+  std::stringstream my_index;
+  my_index << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr3_flat";
+  std::stringstream segment_path;
+  segment_path << gyper_SOURCE_DIRECTORY << "/test/data/graphs/test_shared_index";
+
+  Options::instance()->flat_index = true;
+  gyper::index_graph(my_graph.str(), my_index.str());
+  Options::instance()->flat_index = false;
+  MemIndex expected_mem_index;
+  REQUIRE(expected_mem_index.map(get_flat_index_path(my_index.str())));
+  std::size_t const graph_size = graph.size();
+
+  std::vector<std::vector<TKmerKey> > keys;
+
+  expected_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const &)
+    {
+      keys.push_back(std::vector<TKmerKey>(1, key));
+    });
+
+  // The first process publishes the segment
+  struct stat sb;
+  REQUIRE(load_shared_graph_and_index(segment_path.str(), my_graph.str(), my_index.str()));
+  REQUIRE(stat(segment_path.str().c_str(), &sb) == 0);
+  REQUIRE(mem_index.mapping);
+  REQUIRE(mem_index.multi_get(keys) == expected_mem_index.multi_get(keys));
+  MemIndex first_mem_index(mem_index);
+
+  // A second process attaches to it
+  graph = Graph();
+  mem_index = MemIndex();
+  REQUIRE(load_shared_graph_and_index(segment_path.str(), my_graph.str(), my_index.str()));
+  REQUIRE(graph.size() == graph_size);
+  REQUIRE(mem_index.multi_get(keys) == expected_mem_index.multi_get(keys));
+
+  first_mem_index = MemIndex();
+  REQUIRE(stat(segment_path.str().c_str(), &sb) == 0);
+  mem_index = MemIndex();
+  REQUIRE(stat(segment_path.str().c_str(), &sb) != 0);
+}
+
+
+TEST_CASE("Copies of the index on NUMA nodes give the same labels as the index")
+{
+  using namespace gyper;
+
+  std::stringstream my_graph;
+  my_graph << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr2.grf";
+  gyper::load_graph(my_graph.str().c_str());
+  gyper::index_graph(mem_index);
+  REQUIRE(get_num_numa_nodes() > 0);
+  REQUIRE(get_numa_node_cpus()[0].size() > 0);
+
+  std::vector<std::vector<TKmerKey> > keys;
+
+  mem_index.hamming0.for_each([&keys](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const &)
+    {
+      keys.push_back(std::vector<TKmerKey>(1, key));
+      keys.push_back(std::vector<TKmerKey>(1, ~key));
+    });
+
+  TPackedKmerLabels const expected_labels = mem_index.multi_get(keys);
+  REQUIRE(&get_local_mem_index() == &mem_index); // This thread is not pinned
+
+  for (std::string const placement : {"replicate", "interleave"})
+  {
+    place_mem_index_on_numa_nodes(placement);
+
+    for (long node = 0; node < get_num_numa_nodes(); ++node)
+    {
+      bool is_pinned = false;
+      long thread_node = -1;
+      MemIndex const * local_mem_index = nullptr;
+      TPackedKmerLabels labels;
+
+      std::thread thread([&]()
+        {
+          is_pinned = pin_thread_to_numa_node(node);
+          thread_node = get_thread_numa_node();
+          local_mem_index = &get_local_mem_index();
+          labels = local_mem_index->multi_get(keys);
+        });
+
+      thread.join();
+      REQUIRE(is_pinned);
+      REQUIRE(thread_node == node);
+      REQUIRE(local_mem_index != &mem_index);
+      REQUIRE(labels == expected_labels);
+    }
+
+    // The lookups of the copies are added to the index
+    uint64_t const old_hits = mem_index.filter_stats.hits.load();
+    clear_numa_mem_indexes();
+    REQUIRE(mem_index.filter_stats.hits.load() > old_hits);
+  }
+
+  mem_index = MemIndex();
+}
+
+
+TEST_CASE("A thread pinned to a NUMA node for a scope gets its CPUs back")
+{
+  using namespace gyper;
+
+  bool got_before = false;
+  bool got_after = false;
+  bool is_pinned = false;
+  long pinned_node = -1;
+  long restored_node = 0;
+  cpu_set_t before;
+  cpu_set_t after;
+
+  std::thread thread([&]()
+    {
+      got_before = sched_getaffinity(0, sizeof(cpu_set_t), &before) == 0;
+
+      {
+        ScopedNumaPin const pin(0);
+        is_pinned = pin.is_pinned();
+        pinned_node = get_thread_numa_node();
+      }
+
+      got_after = sched_getaffinity(0, sizeof(cpu_set_t), &after) == 0;
+      restored_node = get_thread_numa_node();
+    });
+
+  thread.join();
+  REQUIRE(got_before);
+  REQUIRE(got_after);
+  REQUIRE(is_pinned);
+  REQUIRE(pinned_node == 0);
+  REQUIRE(CPU_EQUAL(&before, &after));
+  REQUIRE(restored_node == -1);
+}
+
+
+TEST_CASE("An index queried on disk through a small cache gives the same labels as the loaded index")
+{
+  using namespace gyper;
+
+  std::stringstream my_graph;
+  my_graph << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr3.grf";
+  std::stringstream my_index;
+  my_index << gyper_SOURCE_DIRECTORY << "/test/data/graphs/index_test_chr3";
+
+  gyper::index_graph(my_graph.str(), my_index.str());
+  gyper::load_index(my_index.str());
+  MemIndex expected_mem_index;
+  expected_mem_index.load(gyper::index);
+  gyper::index.close();
+
+  std::vector<std::vector<TKmerKey> > keys;
+
+  expected_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const &)
+    {
+      keys.push_back(std::vector<TKmerKey>(1, key));
+      keys.push_back(std::vector<TKmerKey>(1, ~key));
+    });
+
+  // The cache is too small for all keys, so the second pass both hits and reads from disk
+  MemIndex disk_mem_index;
+  disk_mem_index.open_disk(my_index.str(), 64 * 1024);
+  REQUIRE(disk_mem_index.is_on_disk());
+
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    REQUIRE(disk_mem_index.multi_get(keys) == expected_mem_index.multi_get(keys));
+    REQUIRE(disk_mem_index.multi_get_hamming1(keys) == expected_mem_index.multi_get_hamming1(keys));
+  }
+
+  REQUIRE(disk_mem_index.label_cache->memory_usage() <= 64 * 1024);
+}
+
+
+TEST_CASE("The k-mer label cache keeps recently used keys within its memory limit")
+{
+  using namespace gyper;
+
+  KmerLabelCache cache(KmerLabelCache::NUM_SHARDS * 1024);
+  std::vector<PackedKmerLabel> labels;
+
+  for (uint32_t i = 0; i < 10000; ++i)
+  {
+    cache.put(i, std::vector<PackedKmerLabel>(1, PackedKmerLabel(i, i + 31, INVALID_ID)));
+    REQUIRE(cache.memory_usage() <= KmerLabelCache::NUM_SHARDS * 1024);
+
+    // Key 0 is used all the time, so it is never evicted
+    labels.clear();
+    REQUIRE(cache.get(0, labels));
+    REQUIRE(labels.size() == 1);
+  }
+
+  std::size_t num_cached = 0;
+
+  for (uint32_t i = 1; i < 10000; ++i)
+  {
+    labels.clear();
+
+    if (cache.get(i, labels))
+    {
+      ++num_cached;
+      REQUIRE(labels == std::vector<PackedKmerLabel>(1, PackedKmerLabel(i, i + 31, INVALID_ID)));
+    }
+  }
+
+  REQUIRE(num_cached > 0);
+  REQUIRE(num_cached < 9999);
+}
+
+
+TEST_CASE("The indexer gives the same index as the reference implementation on the test reference")
+{
+  using namespace gyper;
+  int const old_threads = Options::const_instance()->threads;
+  Options::instance()->threads = 1;
+
+  std::stringstream reference_path;
+  reference_path << gyper_SOURCE_DIRECTORY << "/test/data/reference/index_test.fa";
+  std::stringstream vcf_path;
+  vcf_path << gyper_SOURCE_DIRECTORY << "/test/data/reference/index_test.vcf.gz";
+
+  for (std::string const region : {"chr1", "chr2", "chr3", "chr4", "chr5", "chr6", "chr7", "chr8"})
+  {
+    gyper::construct_graph(reference_path.str(), vcf_path.str(), region);
+    REQUIRE(graph.size() > 0);
+
+    MemIndex expected_mem_index;
+    reference_indexer::index_graph(expected_mem_index);
+    expected_mem_index.commit();
+
+    MemIndex test_mem_index;
+    gyper::index_graph(test_mem_index);
+    REQUIRE(test_mem_index.hamming0.size() == expected_mem_index.hamming0.size());
+
+    expected_mem_index.hamming0.for_each([&](TKmerKey const key, FlatKmerMap<PackedKmerLabel>::Range const & labels)
+      {
+        FlatKmerMap<PackedKmerLabel>::Range const find_range = test_mem_index.hamming0.find(key);
+        REQUIRE(std::vector<PackedKmerLabel>(find_range.begin(), find_range.end()) ==
+                std::vector<PackedKmerLabel>(labels.begin(), labels.end()));
+      });
+  }
+
+  Options::instance()->threads = old_threads;
+}
+
 /*
 TEST_CASE("Test index chr5")
 {
@@ -41,7 +41,7 @@ TEST_CASE("GENERAL PURPOSE", "[align]")
   SECTION("Common k-mer on the reference")
   {
     seqan::String<seqan::Dna> query = "TTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTT";
-    uint64_t tst = to_uint64(query);
+    gyper::TKmerKey tst = to_uint64(query);
     REQUIRE(aligner.index.get(to_uint64(query)).size() == 3);
     std::vector<gyper::KmerLabel> matching_kmers = aligner.index.get(to_uint64(query));
 
@@ -17,6 +17,7 @@
 #include <graphtyper/index/kmer_label.hpp>
 #include <graphtyper/utilities/type_conversions.hpp>
 #include <graphtyper/utilities/kmer_help_functions.hpp>
+#include <graphtyper/utilities/read_encoder.hpp>
 
 
 TEST_CASE("Get the number of kmers in a dna string")
@@ -72,7 +73,7 @@ TEST_CASE("Get multiple uint64_t with Iupac reads")
   SECTION("Non ACGT")
   {
     seqan::IupacString read1 = "ACCGGGGTTAAAATTGAAAACCCCTAAAATTGAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA";
-    std::vector<uint64_t> keys = gyper::to_uint64_vec(read1, 0);
+    std::vector<gyper::TKmerKey> keys = gyper::to_uint64_vec(read1, 0);
 
     REQUIRE(keys.size() == 1);
     REQUIRE(gyper::to_dna(keys[0]) == seqan::DnaString("ACCGGGGTTAAAATTGAAAACCCCTAAAATTG"));
@@ -85,7 +86,7 @@ TEST_CASE("Get multiple uint64_t with Iupac reads")
   SECTION("One and two non ACGT")
   {
     seqan::IupacString read1 = "ACCGGGGTTAAAATTGAAAACCCCTAAAATTNAAAAAAAAAAAAAAAAAAAAAAAAAWAAAAAAAAAATTTTTTTBTTTTTTTTTTTTTTTTTTT";
-    std::vector<uint64_t> keys = gyper::to_uint64_vec(read1, 0);
+    std::vector<gyper::TKmerKey> keys = gyper::to_uint64_vec(read1, 0);
 
     REQUIRE(keys.size() == 4);
     REQUIRE(gyper::to_dna(keys[0]) == seqan::DnaString("ACCGGGGTTAAAATTGAAAACCCCTAAAATTT"));
@@ -108,7 +109,99 @@ TEST_CASE("Get multiple uint64_t with Iupac reads")
   SECTION("High amounts of Ns result in no keys")
   {
     seqan::IupacString read1 = "NNNNNNNNNNNNAAAAAAAAAAAAAAAAAAAAAA";
-    std::vector<uint64_t> keys = gyper::to_uint64_vec(read1, 0);
+    std::vector<gyper::TKmerKey> keys = gyper::to_uint64_vec(read1, 0);
     REQUIRE(keys.size() == 0);
   }
 }
+
+
+TEST_CASE("Seed keys encoded from BAM sequences are the same as from the IUPAC sequence")
+{
+  using namespace gyper;
+
+  std::vector<seqan::IupacString> reads = {
+    "ACCGGGGTTAAAATTGAAAACCCCTAAAATTG",
+    "ACCGGGGTTAAAATTGAAAACCCCTAAAATTGAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA",
+    "ACCGGGGTTAAAATTGAAAACCCCTAAAATTNAAAAAAAAAAAAAAAAAAAAAAAAAWAAAAAAAAAATTTTTTTBTTTTTTTTTTTTTTTTTTT",
+    "NNNNNNNNNNNNAAAAAAAAAAAAAAAAAAAAAAGATTACAGATTACAGATTACAGATTACAGATTACAGATTACAGATTACAGATTACA"
+    "GATTACAGATTACAGATTACAGATTACAGATTACAGATTACAGATTACAGATTACAGATTACAGATTACAGATTACAGATTACAGATTAC"
+  };
+
+  for (auto const & read : reads)
+  {
+    // Pack the read as in a BAM record, the 4-bit codes are the same as the IUPAC order values
+    std::vector<uint8_t> bam_seq((seqan::length(read) + 1) / 2, 0);
+
+    for (std::size_t j = 0; j < seqan::length(read); ++j)
+      bam_seq[j / 2] |= seqan::ordValue(read[j]) << ((j % 2 == 0) ? 4 : 0);
+
+    EncodedRead encoded;
+    encoded.encode(bam_seq.data(), seqan::length(read));
+    seqan::IupacString rread(read);
+    seqan::reverseComplement(rread);
+
+    REQUIRE(get_seed_keys(encoded, false, read) == get_seed_keys(read));
+    REQUIRE(get_seed_keys(encoded, true, rread) == get_seed_keys(rread));
+  }
+}
+
+
+TEST_CASE("Syncmers of a read only depend on their own K-mer")
+{
+  using namespace gyper;
+
+  // A pseudo-random read with an ambiguous base
+  std::string bases;
+  uint32_t state = 42;
+
+  for (int j = 0; j < 150; ++j)
+  {
+    state = state * 1103515245u + 12345u;
+    bases.push_back("ACGT"[(state >> 16) % 4]);
+  }
+
+  bases[100] = 'N';
+
+  auto encode = [](seqan::IupacString const & read)
+                {
+                  std::vector<uint8_t> bam_seq((seqan::length(read) + 1) / 2, 0);
+
+                  for (std::size_t j = 0; j < seqan::length(read); ++j)
+                    bam_seq[j / 2] |= seqan::ordValue(read[j]) << ((j % 2 == 0) ? 4 : 0);
+
+                  EncodedRead encoded;
+                  encoded.encode(bam_seq.data(), seqan::length(read));
+                  return encoded;
+                };
+
+  seqan::IupacString read(bases);
+  seqan::IupacString rread(read);
+  seqan::reverseComplement(rread);
+  EncodedRead const encoded = encode(read);
+
+  for (bool const is_reverse_complement : {false, true})
+  {
+    seqan::IupacString const & oriented_read = is_reverse_complement ? rread : read;
+    std::vector<std::pair<long, TKmerKey> > const seeds = get_syncmer_seeds(encoded, is_reverse_complement);
+    REQUIRE(seeds.size() > 0);
+
+    for (auto const & seed : seeds)
+    {
+      std::vector<TKmerKey> const keys = to_uint64_vec(oriented_read, seed.first);
+      REQUIRE(keys.size() == 1);
+      REQUIRE(keys[0] == seed.second);
+    }
+  }
+
+  // The syncmers of a part of the read are the syncmers of the read within that part
+  seqan::IupacString const part(bases.substr(20, 70));
+  std::vector<std::pair<long, TKmerKey> > part_seeds;
+
+  for (auto const & seed : get_syncmer_seeds(encoded, false))
+  {
+    if (seed.first >= 20 && seed.first + K <= 90)
+      part_seeds.push_back({seed.first - 20, seed.second});
+  }
+
+  REQUIRE(get_syncmer_seeds(encode(part), false) == part_seeds);
+}
@@ -1,6 +1,7 @@
 #include <catch.hpp>
 
 #include <stdio.h>
+#include <atomic>
 #include <climits>
 #include <cstdio>
 #include <string>
@@ -9,8 +10,13 @@
 
 #include <graphtyper/graph/graph_serialization.hpp>
 #include <graphtyper/constants.hpp>
+#include <graphtyper/index/flat_kmer_map.hpp>
+#include <graphtyper/utilities/huge_page_allocator.hpp>
+#include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/task_scheduler.hpp>
 #include <graphtyper/utilities/type_conversions.hpp>
 #include <graphtyper/utilities/kmer_help_functions.hpp>
+#include <graphtyper/utilities/kmer_key.hpp>
 
 #include <seqan/basic.h>
 #include <seqan/sequence.h>
@@ -41,7 +47,7 @@ TEST_CASE("Mismatches of the last base")
   SECTION("Last base is 'A'")
   {
     seqan::String<seqan::Dna> kmer = "ATTCCCCAGGTTTCCCCAGGTTTCCCCAGGTA";
-    std::array<uint64_t, 3> mismatches = get_mismatches_of_last_base(to_uint64(kmer, 0));
+    std::array<TKmerKey, 3> mismatches = get_mismatches_of_last_base(to_uint64(kmer, 0));
 
     REQUIRE(to_dna(mismatches[0]) == "ATTCCCCAGGTTTCCCCAGGTTTCCCCAGGTC");
     REQUIRE(to_dna(mismatches[1]) == "ATTCCCCAGGTTTCCCCAGGTTTCCCCAGGTG");
@@ -51,7 +57,7 @@ TEST_CASE("Mismatches of the last base")
   SECTION("Last base is 'C'")
   {
     seqan::String<seqan::Dna> kmer = "TTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTC";
-    std::array<uint64_t, 3> mismatches = get_mismatches_of_last_base(to_uint64(kmer, 0));
+    std::array<TKmerKey, 3> mismatches = get_mismatches_of_last_base(to_uint64(kmer, 0));
 
     REQUIRE(to_dna(mismatches[0]) == "TTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTA");
     REQUIRE(to_dna(mismatches[1]) == "TTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTG");
@@ -61,7 +67,7 @@ TEST_CASE("Mismatches of the last base")
   SECTION("Last base is 'G'")
   {
     seqan::String<seqan::Dna> kmer = "CTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTG";
-    std::array<uint64_t, 3> mismatches = get_mismatches_of_last_base(to_uint64(kmer, 0));
+    std::array<TKmerKey, 3> mismatches = get_mismatches_of_last_base(to_uint64(kmer, 0));
 
     REQUIRE(to_dna(mismatches[0]) == "CTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTA");
     REQUIRE(to_dna(mismatches[1]) == "CTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTC");
@@ -71,7 +77,7 @@ TEST_CASE("Mismatches of the last base")
   SECTION("Last base is 'T'")
   {
     seqan::String<seqan::Dna> kmer = "GATCCCCAGGTTTCCCCAGGTTTCCCCAGGTT";
-    std::array<uint64_t, 3> mismatches = get_mismatches_of_last_base(to_uint64(kmer, 0));
+    std::array<TKmerKey, 3> mismatches = get_mismatches_of_last_base(to_uint64(kmer, 0));
 
     REQUIRE(to_dna(mismatches[0]) == "GATCCCCAGGTTTCCCCAGGTTTCCCCAGGTA");
     REQUIRE(to_dna(mismatches[1]) == "GATCCCCAGGTTTCCCCAGGTTTCCCCAGGTC");
@@ -87,7 +93,7 @@ TEST_CASE("Mismatches of the first base")
   SECTION("First base is 'A'")
   {
     seqan::String<seqan::Dna> kmer = "ATTCCCCAGGTTTCCCCAGGTTTCCCCAGGTA";
-    std::array<uint64_t, 3> mismatches = get_mismatches_of_first_base(to_uint64(kmer, 0));
+    std::array<TKmerKey, 3> mismatches = get_mismatches_of_first_base(to_uint64(kmer, 0));
 
     REQUIRE(to_dna(mismatches[0]) == "CTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTA");
     REQUIRE(to_dna(mismatches[1]) == "GTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTA");
@@ -97,7 +103,7 @@ TEST_CASE("Mismatches of the first base")
   SECTION("First base is 'C'")
   {
     seqan::String<seqan::Dna> kmer = "CTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTC";
-    std::array<uint64_t, 3> mismatches = get_mismatches_of_first_base(to_uint64(kmer, 0));
+    std::array<TKmerKey, 3> mismatches = get_mismatches_of_first_base(to_uint64(kmer, 0));
 
     REQUIRE(to_dna(mismatches[0]) == "ATTCCCCAGGTTTCCCCAGGTTTCCCCAGGTC");
     REQUIRE(to_dna(mismatches[1]) == "GTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTC");
@@ -107,7 +113,7 @@ TEST_CASE("Mismatches of the first base")
   SECTION("First base is 'G'")
   {
     seqan::String<seqan::Dna> kmer = "GTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTG";
-    std::array<uint64_t, 3> mismatches = get_mismatches_of_first_base(to_uint64(kmer, 0));
+    std::array<TKmerKey, 3> mismatches = get_mismatches_of_first_base(to_uint64(kmer, 0));
 
     REQUIRE(to_dna(mismatches[0]) == "ATTCCCCAGGTTTCCCCAGGTTTCCCCAGGTG");
     REQUIRE(to_dna(mismatches[1]) == "CTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTG");
@@ -117,7 +123,7 @@ TEST_CASE("Mismatches of the first base")
   SECTION("First base is 'T'")
   {
     seqan::String<seqan::Dna> kmer = "TTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTA";
-    std::array<uint64_t, 3> mismatches = get_mismatches_of_first_base(to_uint64(kmer, 0));
+    std::array<TKmerKey, 3> mismatches = get_mismatches_of_first_base(to_uint64(kmer, 0));
 
     REQUIRE(to_dna(mismatches[0]) == "ATTCCCCAGGTTTCCCCAGGTTTCCCCAGGTA");
     REQUIRE(to_dna(mismatches[1]) == "CTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTA");
@@ -155,3 +161,225 @@ TEST_CASE("Hamming distance 1")
   }
 
 }
+
+
+TEST_CASE("K-mer keys of other sizes")
+{
+  using namespace gyper;
+
+  SECTION("Keys of k-mers up to 32 bases are 64 bits")
+  {
+    REQUIRE(sizeof(KmerKey<20>::Type) == 8);
+    REQUIRE(KmerKey<20>::mask() == 0xFFFFFFFFFFull);
+    REQUIRE(KmerKey<32>::mask() == 0xFFFFFFFFFFFFFFFFull);
+
+    // Pushing a base drops the first base of a 20-mer
+    KmerKey<20>::Type key = KmerKey<20>::mask(); // TTTT...
+    key = KmerKey<20>::push_back(key, 0);
+    REQUIRE(key == 0xFFFFFFFFFCull);
+  }
+
+  SECTION("The neighbours of a key have a single mismatching base")
+  {
+    std::vector<uint8_t> codes(20, 0);
+    codes[0] = 3; // First base is 'T'
+    KmerKey<20>::Type const key = KmerKey<20>::from_codes(codes, 0);
+    REQUIRE(key == (3ull << 38));
+
+    auto neighbours = KmerKey<20>::hamming_distance1(key);
+    REQUIRE(neighbours.size() == 60);
+    REQUIRE(neighbours[0] == (key | 1)); // Last base is 'C'
+    REQUIRE(neighbours[19 * 3 + 2] == 0); // First base is 'A'
+
+    std::sort(neighbours.begin(), neighbours.end());
+    REQUIRE(std::adjacent_find(neighbours.begin(), neighbours.end()) == neighbours.end());
+  }
+
+  SECTION("Keys of k-mers with more than 32 bases are 128 bits")
+  {
+    REQUIRE(sizeof(KmerKey<48>::Type) == 16);
+
+    std::vector<uint8_t> codes(48, 0);
+    codes[0] = 3; // First base is 'T'
+    KmerKey<48>::Type const key = KmerKey<48>::from_codes(codes, 0);
+    REQUIRE(key == (static_cast<TUint128>(3) << 94));
+
+    auto neighbours = KmerKey<48>::hamming_distance1(key);
+    REQUIRE(neighbours.size() == 144);
+    REQUIRE(neighbours[0] == (key | 1)); // Last base is 'C'
+    REQUIRE(neighbours[47 * 3 + 2] == 0); // First base is 'A'
+
+    std::sort(neighbours.begin(), neighbours.end());
+    REQUIRE(std::adjacent_find(neighbours.begin(), neighbours.end()) == neighbours.end());
+  }
+
+  SECTION("A flat map with 128 bit keys tells apart keys which only differ in their high half")
+  {
+    std::vector<TUint128> keys;
+
+    for (uint64_t i = 0; i < 1000; ++i)
+      keys.push_back((static_cast<TUint128>(i % 10) << 64) | (i / 10));
+
+    std::sort(keys.begin(), keys.end());
+    HugePageVector<uint32_t> values(keys.size(), 0u);
+
+    for (std::size_t i = 0; i < keys.size(); ++i)
+      values[i] = i;
+
+    FlatKmerMap<uint32_t, TUint128> map;
+    map.build(keys, std::vector<uint32_t>(keys.size(), 1), std::move(values));
+    REQUIRE(map.size() == keys.size());
+    REQUIRE(sizeof(FlatKmerMap<uint32_t, TUint128>::Slot) == 32);
+
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+      auto const range = map.find(keys[i]);
+      REQUIRE(range.size() == 1);
+      REQUIRE(*range.begin() == i);
+    }
+
+    REQUIRE(map.find(static_cast<TUint128>(10) << 64).empty());
+  }
+
+  SECTION("The neighbours of the index k-mers match the generic keys")
+  {
+    TKmerKey const key = static_cast<TKmerKey>(0x0123456789ABCDEFull) & KmerKey<K>::mask();
+    auto const hamming1 = to_uint64_vec_hamming_distance_1(key);
+    auto const generic = KmerKey<K>::hamming_distance1(key);
+    REQUIRE(std::equal(hamming1.begin(), hamming1.end(), generic.begin()));
+  }
+}
+
+
+TEST_CASE("Large arrays with huge pages")
+{
+  using namespace gyper;
+  std::string const old_huge_pages = Options::const_instance()->huge_pages;
+  std::size_t const n = HUGE_PAGE_SIZE / sizeof(uint64_t) + 1;
+
+  for (std::string const mode : {"", "thp", "hugetlb"})
+  {
+    Options::instance()->huge_pages = mode;
+    HugePageStats const before = get_huge_page_stats();
+    HugePageVector<uint64_t> large(n, 7ull);
+    HugePageStats const after = get_huge_page_stats();
+
+    // Two huge pages are mapped, aligned to a huge page
+    REQUIRE(reinterpret_cast<uintptr_t>(large.data()) % HUGE_PAGE_SIZE == 0);
+    REQUIRE((after.hugetlb_bytes + after.thp_bytes + after.small_page_bytes) -
+            (before.hugetlb_bytes + before.thp_bytes + before.small_page_bytes) == 2 * HUGE_PAGE_SIZE);
+    REQUIRE(large.back() == 7ull);
+
+    if (mode.empty())
+      REQUIRE(after.small_page_bytes - before.small_page_bytes == 2 * HUGE_PAGE_SIZE);
+
+    // Small arrays are not mapped on their own
+    HugePageVector<uint64_t> small(16, 7ull);
+    REQUIRE(get_huge_page_stats().small_page_bytes == after.small_page_bytes);
+
+    // Moving and copying keeps the values, the copy may be freed after the mode changes
+    HugePageVector<uint64_t> copy(large);
+    Options::instance()->huge_pages = "";
+    HugePageVector<uint64_t> moved(std::move(large));
+    REQUIRE(moved.size() == n);
+    REQUIRE(copy == moved);
+  }
+
+  Options::instance()->huge_pages = old_huge_pages;
+}
+
+
+TEST_CASE("Task scheduler runs regions and their pools")
+{
+  using namespace gyper;
+  long constexpr NUM_REGIONS = 5;
+  long constexpr NUM_ITERATIONS = 3;
+  long constexpr NUM_POOLS = 4;
+  long constexpr MAX_FILES_OPEN = 5;
+
+  std::atomic<long> files_open(0);
+  std::atomic<long> max_files_opened(0);
+  std::atomic<long> num_pools_done(0);
+  std::vector<std::atomic<long> > iterations_done(NUM_REGIONS);
+  std::atomic<bool> is_order_ok(true);
+  long num_pools_done_before_last = -1;
+
+  {
+    TaskScheduler scheduler(4, MAX_FILES_OPEN);
+    std::vector<TaskScheduler::TaskId> region_tasks;
+
+    for (long r = 0; r < NUM_REGIONS; ++r)
+    {
+      iterations_done[r] = 0;
+
+      auto genotype_region =
+        [&, r]()
+        {
+          for (long i = 0; i < NUM_ITERATIONS; ++i)
+          {
+            std::vector<TaskScheduler::TaskId> pool_tasks;
+
+            for (long p = 0; p < NUM_POOLS; ++p)
+            {
+              TaskKey key;
+              key.region = r;
+              key.iteration = i;
+              key.pool = p;
+
+              auto run_pool =
+                [&, r, i]()
+                {
+                  // Pools of an iteration only run after the previous iteration of their region
+                  if (iterations_done[r] != i)
+                    is_order_ok = false;
+
+                  long const now_open = files_open += 2;
+                  long most_open = max_files_opened;
+
+                  while (now_open > most_open && !max_files_opened.compare_exchange_weak(most_open, now_open))
+                  {}
+
+                  files_open -= 2;
+                  ++num_pools_done;
+                };
+
+              pool_tasks.push_back(scheduler.add_task(run_pool, key, std::vector<TaskScheduler::TaskId>(), 2));
+            }
+
+            scheduler.wait(pool_tasks);
+            ++iterations_done[r];
+          }
+        };
+
+      TaskKey key;
+      key.region = r;
+      region_tasks.push_back(scheduler.add_task(genotype_region, key, std::vector<TaskScheduler::TaskId>(), 0, false));
+    }
+
+    scheduler.add_task([&](){num_pools_done_before_last = num_pools_done;}, TaskKey(), region_tasks, 0, false);
+    scheduler.wait_all();
+  }
+
+  REQUIRE(is_order_ok);
+  REQUIRE(num_pools_done == NUM_REGIONS * NUM_ITERATIONS * NUM_POOLS);
+  REQUIRE(num_pools_done_before_last == num_pools_done);
+  REQUIRE(max_files_opened <= MAX_FILES_OPEN);
+}
+
+
+TEST_CASE("Task scheduler runs leaf tasks before starting other tasks, oldest first")
+{
+  using namespace gyper;
+  std::vector<long> order;
+
+  {
+    TaskScheduler scheduler(1, 10);
+    scheduler.add_task([&](){order.push_back(0);}, TaskKey(), std::vector<TaskScheduler::TaskId>(), 0, false);
+    scheduler.add_task([&](){order.push_back(1);}, TaskKey());
+    scheduler.add_task([&](){order.push_back(2);}, TaskKey());
+    scheduler.add_task([&](){order.push_back(3);}, TaskKey(), std::vector<TaskScheduler::TaskId>(), 0, false);
+    scheduler.wait_all();
+  }
+
+  REQUIRE(order == std::vector<long>({1, 2, 0, 3}));
+}